@@ -0,0 +1,31 @@
+#version 450
+
+// Depth prepass for alpha-tested (MASK) materials: texels below the
+// cutoff are discarded so they write neither depth nor an object ID.
+// The object ID variant writes mesh index + 1 like object_id.frag.
+
+layout(constant_id = 0) const bool WRITE_ID = false;
+
+layout(set = 1, binding = 0) uniform sampler2D baseColorMap;
+
+// Per-material factors (set 1, binding 4), as in pbr.frag
+layout(set = 1, binding = 4) uniform MaterialFactors {
+    vec4  baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    float alphaCutoff;
+    float _pad0;
+    vec4  emissiveFactor;
+} matFactors;
+
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 5) flat in uint fragMeshIndex;
+
+layout(location = 0) out uint outObjectId;
+
+void main() {
+    float alpha = texture(baseColorMap, fragTexCoord).a *
+                  matFactors.baseColorFactor.a;
+    if (alpha < matFactors.alphaCutoff) discard;
+    if (WRITE_ID) outObjectId = fragMeshIndex + 1u;
+}
@@ -0,0 +1,11 @@
+#version 450
+
+// GPU picking: the depth prepass variant writes which mesh covers each
+// pixel. 0 is left for the background.
+layout(location = 5) flat in uint fragMeshIndex;
+
+layout(location = 0) out uint outObjectId;
+
+void main() {
+    outObjectId = fragMeshIndex + 1u;
+}
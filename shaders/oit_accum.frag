@@ -0,0 +1,33 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Weighted blended order-independent transparency (McGuire & Bavoil 2013).
+// Every blended fragment adds its premultiplied color, weighted by its view
+// depth, to the accumulation target and multiplies the revealage (how much
+// of what is behind stays visible) by 1 - alpha. Neither blend depends on
+// the draw order; oit_resolve.frag composites the two over the scene. The
+// result approximates the sorted blend, exactly so for equal colors.
+
+#include "pbr_shading.glsl"
+
+// Blended additively (ONE, ONE)
+layout(location = 0) out vec4 outAccum;
+// Blended with ZERO, ONE_MINUS_SRC_COLOR: revealage *= 1 - alpha
+layout(location = 1) out float outRevealage;
+
+void main()
+{
+    vec4 baseColor = texture(baseColorMap, fragTexCoord) * matFactors.baseColorFactor;
+    vec3 color = shade(baseColor.rgb);
+    float alpha = baseColor.a;
+
+    // Depth weight (equation 7 of the paper): nearer fragments dominate,
+    // within the range an RGBA16F sum holds
+    float z = abs((frame.view * vec4(fragWorldPos, 1.0)).z);
+    float weight = alpha * clamp(10.0 / (1e-5 + pow(z / 5.0, 2.0) +
+                                         pow(z / 200.0, 6.0)),
+                                 1e-2, 3e3);
+
+    outAccum = vec4(color * alpha, alpha) * weight;
+    outRevealage = alpha;
+}
@@ -0,0 +1,39 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// Per-pixel linked lists of blended fragments, the reference weighted OIT
+// is checked against. Each fragment is stored in the next free node with
+// its depth and pushed onto its pixel's list; oit_list_resolve.frag sorts
+// every list and blends it exactly. Once the nodes run out, further
+// fragments are dropped.
+
+// Fragments behind opaque geometry must fail before they are stored
+layout(early_fragment_tests) in;
+
+#include "pbr_shading.glsl"
+
+const uint LIST_END = 0xFFFFFFFFu;
+
+// Each pixel's most recent node, LIST_END for none
+layout(set = 3, binding = 0, r32ui) uniform coherent uimage2D heads;
+
+// count is the number of nodes handed out, which may exceed nodes.length().
+// A node: color (RGBA8), depth, next node, unused.
+layout(std430, set = 3, binding = 1) buffer Nodes {
+    uint count;
+    uint _pad[3];
+    uvec4 nodes[];
+};
+
+void main()
+{
+    vec4 baseColor = texture(baseColorMap, fragTexCoord) * matFactors.baseColorFactor;
+    vec3 color = shade(baseColor.rgb);
+
+    uint node = atomicAdd(count, 1);
+    if (node >= uint(nodes.length())) return;
+
+    uint next = imageAtomicExchange(heads, ivec2(gl_FragCoord.xy), node);
+    nodes[node] = uvec4(packUnorm4x8(vec4(color, baseColor.a)),
+                        floatBitsToUint(gl_FragCoord.z), next, 0);
+}
@@ -0,0 +1,58 @@
+#version 450
+
+// Composites the per-pixel linked lists of oit_list.frag over the scene:
+// the nearest MAX_LAYERS fragments of each pixel are sorted by depth and
+// blended back to front, as sorted blending would per fragment.
+// Premultiplied, blended with ONE, ONE_MINUS_SRC_ALPHA.
+
+const uint MAX_LAYERS = 16;
+const uint LIST_END = 0xFFFFFFFFu;
+
+layout(set = 0, binding = 0, r32ui) uniform readonly uimage2D heads;
+
+layout(std430, set = 0, binding = 1) readonly buffer Nodes {
+    uint count;
+    uint _pad[3];
+    uvec4 nodes[];
+};
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    uint node = imageLoad(heads, ivec2(gl_FragCoord.xy)).r;
+    if (node == LIST_END) discard;
+
+    // Insertion sort, nearest first; past MAX_LAYERS the farthest go
+    uint colors[MAX_LAYERS];
+    float depths[MAX_LAYERS];
+    uint layers = 0;
+    for (; node != LIST_END; node = nodes[node].z)
+    {
+        uvec4 n = nodes[node];
+        float depth = uintBitsToFloat(n.y);
+        if (layers == MAX_LAYERS && depth >= depths[MAX_LAYERS - 1])
+            continue;
+
+        uint i = min(layers, MAX_LAYERS - 1);
+        for (; i > 0 && depths[i - 1] > depth; --i)
+        {
+            colors[i] = colors[i - 1];
+            depths[i] = depths[i - 1];
+        }
+        colors[i] = n.x;
+        depths[i] = depth;
+        layers = min(layers + 1, MAX_LAYERS);
+    }
+
+    // Back to front: "over" with premultiplied colors
+    vec3 color = vec3(0.0);
+    float transmittance = 1.0;
+    for (uint i = layers; i > 0; --i)
+    {
+        vec4 c = unpackUnorm4x8(colors[i - 1]);
+        color = c.rgb * c.a + color * (1.0 - c.a);
+        transmittance *= 1.0 - c.a;
+    }
+    outColor = vec4(color, 1.0 - transmittance);
+}
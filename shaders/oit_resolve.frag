@@ -0,0 +1,22 @@
+#version 450
+
+// Composites weighted blended OIT (oit_accum.frag) over the scene: the
+// weighted average color of the pixel's blended fragments, covering
+// 1 - revealage of it. Premultiplied, blended with ONE, ONE_MINUS_SRC_ALPHA.
+
+layout(set = 0, binding = 0) uniform sampler2D accumMap;
+layout(set = 0, binding = 1) uniform sampler2D revealageMap;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float revealage = texelFetch(revealageMap, pixel, 0).r;
+    if (revealage >= 1.0) discard;  // no blended fragment here
+
+    vec4 accum = texelFetch(accumMap, pixel, 0);
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    float coverage = 1.0 - revealage;
+    outColor = vec4(average * coverage, coverage);
+}
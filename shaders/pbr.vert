@@ -14,10 +14,11 @@ layout(set = 0, binding = 0) uniform FrameUBO {
     uint  screenHeight;
 } frame;
 
-// Per-mesh push constant
-layout(push_constant) uniform PushConstants {
-    mat4 model;
-} push;
+// Per-mesh model matrices (set 0, binding 1), written by the scene graph.
+// Each draw selects its mesh's entry with firstInstance.
+layout(std430, set = 0, binding = 1) readonly buffer InstanceSSBO {
+    mat4 models[];
+} instances;
 
 // Vertex attributes
 layout(location = 0) in vec3 inPosition;
@@ -29,21 +30,24 @@ layout(location = 3) in vec4 inTangent;
 layout(location = 0) out vec3 fragWorldPos;
 layout(location = 1) out vec2 fragTexCoord;
 layout(location = 2) out mat3 fragTBN;
+layout(location = 5) flat out uint fragMeshIndex;  // for object_id.frag
 
 invariant gl_Position;  // ensure identical depth across pipelines
 
 void main() {
-    vec4 worldPos = push.model * vec4(inPosition, 1.0);
+    mat4 model = instances.models[gl_InstanceIndex];
+    vec4 worldPos = model * vec4(inPosition, 1.0);
     fragWorldPos = worldPos.xyz;
     fragTexCoord = inTexCoord;
 
-    mat3 normalMatrix = transpose(inverse(mat3(push.model)));
+    mat3 normalMatrix = transpose(inverse(mat3(model)));
     vec3 N = normalize(normalMatrix * inNormal);
     vec3 T = normalize(normalMatrix * inTangent.xyz);
     // Re-orthogonalize T with respect to N
     T = normalize(T - dot(T, N) * N);
     vec3 B = cross(N, T) * inTangent.w;
     fragTBN = mat3(T, B, N);
+    fragMeshIndex = uint(gl_InstanceIndex);
 
     gl_Position = frame.proj * frame.view * worldPos;
 }
@@ -0,0 +1,12 @@
+#version 450
+
+// Copies the resolved frame (kept as next frame's history) to the target
+layout(set = 0, binding = 0) uniform sampler2D resolved;
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    outColor = vec4(texelFetch(resolved, ivec2(gl_FragCoord.xy), 0).rgb, 1.0);
+}
@@ -0,0 +1,64 @@
+#version 450
+
+// Temporal upscale: reconstructs the output-resolution image from the
+// jittered low-resolution scene color and last frame's output (history).
+// The scene was rendered into the top-left renderScale part of the
+// scene color and depth images.
+
+layout(set = 0, binding = 0) uniform sampler2D sceneColor;
+layout(set = 0, binding = 1) uniform sampler2D sceneDepth;
+layout(set = 0, binding = 2) uniform sampler2D history;
+
+layout(push_constant) uniform TaaParams {
+    mat4  reprojection;   // current clip (unjittered) -> previous clip
+    vec2  jitterUV;       // this frame's jitter, in render-area UV
+    vec2  renderScale;    // render extent / output extent
+    vec2  renderTexel;    // one render-area pixel, in scene color UV
+    float historyWeight;  // 0 when there is no usable history
+} taa;
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+    // Undo the jitter so the current sample lines up with the history.
+    // Clamped half a pixel in so bilinear taps stay inside the render area.
+    vec2 renderUV = fragUV + taa.jitterUV;
+    vec2 srcUV = clamp(renderUV * taa.renderScale, taa.renderTexel * 0.5,
+                       taa.renderScale - taa.renderTexel * 0.5);
+    vec3 current = texture(sceneColor, srcUV).rgb;
+
+    if (taa.historyWeight <= 0.0)
+    {
+        outColor = vec4(current, 1.0);
+        return;
+    }
+
+    // 3x3 neighborhood bounds: history outside them is stale (disocclusion,
+    // moving lighting) and gets clamped back towards the current frame
+    vec3 lo = current;
+    vec3 hi = current;
+    for (int y = -1; y <= 1; ++y)
+    {
+        for (int x = -1; x <= 1; ++x)
+        {
+            vec3 c = texture(sceneColor,
+                             srcUV + vec2(x, y) * taa.renderTexel).rgb;
+            lo = min(lo, c);
+            hi = max(hi, c);
+        }
+    }
+
+    // Camera reprojection from depth
+    float depth = texture(sceneDepth, srcUV).r;
+    vec4 prevClip = taa.reprojection * vec4(fragUV * 2.0 - 1.0, depth, 1.0);
+    vec2 prevUV = prevClip.xy / prevClip.w * 0.5 + 0.5;
+
+    float weight = taa.historyWeight;
+    if (any(lessThan(prevUV, vec2(0.0))) || any(greaterThan(prevUV, vec2(1.0))))
+        weight = 0.0;
+
+    vec3 prev = clamp(texture(history, prevUV).rgb, lo, hi);
+    outColor = vec4(mix(current, prev, weight), 1.0);
+}
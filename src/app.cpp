@@ -6,15 +6,17 @@
 #include <imgui_impl_vulkan.h>
 
 #include <algorithm>
+#include <cfloat>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <fstream>
-#include <functional>
 #include <glm/glm.hpp>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
 
+#include "bench/benchReport.h"
 #include "config.h"
 #include "editor/sceneFile.h"
 #include "logger.h"
@@ -41,6 +43,18 @@
 
 void App::run()
 {
+	if (!benchScenePath.empty())
+	{
+		run_bench();
+		return;
+	}
+
+	if (headless)
+	{
+		run_headless();
+		return;
+	}
+
 	init_window();
 	init_vulkan();
 	main_loop();
@@ -75,22 +89,297 @@ void App::init_vulkan()
 	renderer.init(window, modelPath);
 	build_scene_graph();
 	init_imgui();
+	set_default_lights();
 
-	// Initialize default lights (matching previous hardcoded directional)
+	if (!startupScenePath.empty()) do_load_scene(startupScenePath);
+}
+
+void App::set_default_lights()
+{
+	lights = LightEnvironment{};
+	lights.ambient.color = glm::vec3(1.0f);
+	lights.ambient.intensity = 0.03f;
 	DirectionalLight sun;
 	sun.direction = glm::normalize(glm::vec3(0.5f, -1.0f, 0.3f));
 	sun.color = glm::vec3(1.0f);
 	sun.intensity = 3.0f;
 	lights.directionals.push_back(sun);
+}
 
-	lights.ambient.color = glm::vec3(1.0f);
-	lights.ambient.intensity = 0.03f;
+// =============================================================================
+// Headless -- offscreen frames, no window / ImGui
+// =============================================================================
+
+void App::run_headless()
+{
+	LOG_INFO("Headless mode: %ux%u, %u frame(s)", headlessWidth,
+			 headlessHeight, headlessFrames);
+
+	renderer.init_headless(headlessWidth, headlessHeight, modelPath);
+	renderer.showDebugLines_ = false;
+	build_scene_graph();
+	set_default_lights();
+
+	if (!startupScenePath.empty() && do_load_scene(startupScenePath))
+		finish_scene_streaming();
+
+	// Fixed timestep so repeated runs produce identical frames
+	constexpr float FIXED_DT = 1.0f / 60.0f;
+	uint32_t rendered = 0;
+	while (rendered < headlessFrames)
+	{
+		renderer.wait_for_frame();
+		update_texture_streaming();
+
+		auto frame = renderer.begin_frame();
+		if (!frame) continue;
+		update_instances(FIXED_DT);
+
+		float time = static_cast<float>(rendered) * FIXED_DT;
+		renderer.update_uniforms(camera, time, lights);
+		renderer.update_debug_lines(lights);
+		renderer.draw_scene(frame->cmd);
+		renderer.end_frame(*frame);
+		++rendered;
+	}
+	vkDeviceWaitIdle(renderer.vk_device());
+
+	bool saved = true;
+	if (!headlessOutput.empty())
+	{
+		saved = renderer.save_frame(headlessOutput);
+		if (saved) LOG_INFO("Wrote frame to: %s", headlessOutput.c_str());
+	}
+
+	renderer.cleanup();
+
+	if (!saved)
+		throw std::runtime_error("Failed to write frame: " + headlessOutput);
+}
+
+// =============================================================================
+// Benchmark -- scripted camera, fixed timestep, JSON report
+// =============================================================================
+
+void App::run_bench()
+{
+	using Clock = std::chrono::steady_clock;
+	auto ms_since = [](Clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(Clock::now() - start)
+			.count();
+	};
+
+	CameraPath path;
+	if (!benchCameraPath.empty() && !load_camera_path(benchCameraPath, path))
+		throw std::runtime_error("Failed to load camera path: " +
+								 benchCameraPath);
+
+	LOG_INFO("Benchmark: '%s', %u warm-up + %u measured frame(s), %s",
+			 benchScenePath.c_str(), benchWarmupFrames, benchFrames,
+			 headless ? "headless" : "windowed");
+
+	// Start from the bare cube so the scene's own load is what gets timed
+	modelPath.clear();
+	if (headless)
+	{
+		renderer.init_headless(headlessWidth, headlessHeight, modelPath);
+	}
+	else
+	{
+		init_window();
+		renderer.init(window, modelPath);
+	}
+	renderer.showDebugLines_ = false;
+	renderer.gpu_profiler().keepHistory = true;
+	build_scene_graph();
+	set_default_lights();
+
+	auto shutdown = [&]()
+	{
+		vkDeviceWaitIdle(renderer.vk_device());
+		renderer.cleanup();
+		if (window)
+		{
+			glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+	};
+
+	auto loadStart = Clock::now();
+	bool loaded = do_load_scene(benchScenePath);
+	if (loaded) finish_scene_streaming();
+	double loadMs = ms_since(loadStart);
+	if (!loaded)
+	{
+		shutdown();
+		throw std::runtime_error("Failed to load scene: " + benchScenePath);
+	}
+
+	// Fixed timestep: the camera and animated uniforms only depend on the
+	// frame number, never on how long frames took
+	constexpr float FIXED_DT = 1.0f / 60.0f;
+	uint32_t total = benchWarmupFrames + benchFrames;
+	std::vector<double> cpuFrameMs;
+	cpuFrameMs.reserve(benchFrames);
+	std::vector<double> animationCpuMs;
+	uint32_t animatedNodes = 0;
+	std::vector<double> transparencySortCpuMs;
+	uint32_t blendedMeshes = 0;
+	Renderer::TransparencyMode transparency =
+		Renderer::TransparencyMode::Sorted;
+
+	// Resize stress: every RESIZE_INTERVAL frames the size moves by a step,
+	// sweeping between half and full size like a window edge being dragged
+	constexpr uint32_t RESIZE_INTERVAL = 4;
+	constexpr uint32_t RESIZE_STEP = 24;
+	VkExtent2D fullSize = renderer.swapchain_extent();
+	std::vector<double> resizeCpuFrameMs;
+	uint64_t resizesAtStart = renderer.swapchain_recreations();
+	uint64_t reallocsAtStart = renderer.tile_buffer_reallocations();
+	auto stress_size = [&](uint32_t step, uint32_t full)
+	{
+		uint32_t range = std::max(full / 2 / RESIZE_STEP, 1u);
+		uint32_t phase = step % (2 * range);
+		uint32_t offset = phase < range ? phase : 2 * range - phase;
+		return std::max(full - offset * RESIZE_STEP, 1u);
+	};
+
+	uint32_t rendered = 0;
+	while (rendered < total)
+	{
+		if (benchResizeStress && rendered > 0 &&
+			rendered % RESIZE_INTERVAL == 0)
+		{
+			uint32_t step = rendered / RESIZE_INTERVAL;
+			uint32_t w = stress_size(step, fullSize.width);
+			uint32_t h = stress_size(step, fullSize.height);
+			if (window)
+				glfwSetWindowSize(window, static_cast<int>(w),
+								  static_cast<int>(h));
+			else
+				renderer.resize_offscreen(w, h);
+		}
+		uint64_t recreations = renderer.swapchain_recreations();
+
+		renderer.wait_for_frame();
+		if (window)
+		{
+			glfwPollEvents();
+			if (glfwWindowShouldClose(window)) break;
+		}
+
+		auto frameStart = Clock::now();
+		float time = static_cast<float>(rendered) * FIXED_DT;
+		path.sample(time, camera);
+		update_texture_streaming();
+
+		auto frame = renderer.begin_frame();
+		if (!frame) continue;
+		update_instances(FIXED_DT);
+
+		renderer.update_uniforms(camera, time, lights);
+		renderer.update_debug_lines(lights);
+		renderer.draw_scene(frame->cmd);
+		renderer.end_frame(*frame);
+
+		if (rendered >= benchWarmupFrames)
+		{
+			double ms = ms_since(frameStart);
+			cpuFrameMs.push_back(ms);
+			const Renderer::AnimationStats& anim = renderer.animation_stats();
+			if (anim.nodes > 0)
+			{
+				animationCpuMs.push_back(anim.cpuMs);
+				animatedNodes = std::max(animatedNodes, anim.nodes);
+			}
+			const Renderer::TransparencyStats& blend =
+				renderer.transparency_stats();
+			if (blend.meshes > 0)
+			{
+				transparencySortCpuMs.push_back(blend.sortMs);
+				blendedMeshes = std::max(blendedMeshes, blend.meshes);
+				transparency = renderer.transparency_mode();
+			}
+			if (renderer.swapchain_recreations() != recreations)
+				resizeCpuFrameMs.push_back(ms);
+		}
+		++rendered;
+	}
+	vkDeviceWaitIdle(renderer.vk_device());
+
+	GpuProfiler& profiler = renderer.gpu_profiler();
+	profiler.flush();
+
+	BenchReport report;
+	report.scene = benchScenePath;
+	report.cameraPath = benchCameraPath;
+	report.gpu = renderer.gpu_name();
+	report.headless = headless;
+	report.width = fullSize.width;
+	report.height = fullSize.height;
+	report.warmupFrames = benchWarmupFrames;
+	report.fixedTimestep = FIXED_DT;
+	report.loadTimeMs = loadMs;
+	report.cpuFrameMs = std::move(cpuFrameMs);
+	report.animatedNodes = animatedNodes;
+	report.animationCpuMs = std::move(animationCpuMs);
+	static constexpr const char* TRANSPARENCY_NAMES[] = {"sorted", "weighted",
+														 "list"};
+	report.transparency =
+		TRANSPARENCY_NAMES[static_cast<uint32_t>(transparency)];
+	report.blendedMeshes = blendedMeshes;
+	report.transparencySortCpuMs = std::move(transparencySortCpuMs);
+	report.resizeStress = benchResizeStress;
+	report.resizes = renderer.swapchain_recreations() - resizesAtStart;
+	report.tileBufferReallocations =
+		renderer.tile_buffer_reallocations() - reallocsAtStart;
+	report.resizeCpuFrameMs = std::move(resizeCpuFrameMs);
+
+	auto add_scope_sample = [&](const char* name, double ms)
+	{
+		auto it = std::find_if(report.gpuScopeMs.begin(),
+							   report.gpuScopeMs.end(),
+							   [&](const auto& s)
+							   { return s.first == name; });
+		if (it == report.gpuScopeMs.end())
+		{
+			report.gpuScopeMs.emplace_back(name, std::vector<double>{});
+			it = report.gpuScopeMs.end() - 1;
+		}
+		it->second.push_back(ms);
+	};
+
+	// Profiler frame numbers match `rendered`: both count submitted frames
+	bool async = renderer.asyncCompute_ && renderer.async_compute_supported();
+	for (const auto& t : profiler.history)
+	{
+		if (t.frameNumber < benchWarmupFrames) continue;
+		report.gpuFrameMs.push_back(t.frameMs);
+		for (const auto& scope : t.scopes)
+			add_scope_sample(scope.name, scope.durationMs);
+		if (async) add_scope_sample("Async overlap", t.asyncOverlapMs);
+	}
+
+	shutdown();
+	report.peakRssBytes = peak_rss_bytes();
+
+	LOG_INFO("Benchmark complete: %zu CPU / %zu GPU samples, load %.1f ms",
+			 report.cpuFrameMs.size(), report.gpuFrameMs.size(), loadMs);
+
+	if (!write_bench_report(benchReportPath, report))
+		throw std::runtime_error("Failed to write benchmark report: " +
+								 benchReportPath);
 }
 
 void App::main_loop()
 {
 	while (!glfwWindowShouldClose(window))
 	{
+		// Pace first, then wait for the GPU, then sample input, so the
+		// input is as fresh as possible when the frame is recorded
+		framePacer.wait();
+		renderer.wait_for_frame();
 		glfwPollEvents();
 
 		float now = static_cast<float>(glfwGetTime());
@@ -99,6 +388,16 @@ void App::main_loop()
 
 		process_input();
 
+		// Camera path recording: one key every 0.25 s is plenty for the
+		// spline to reproduce the flight
+		if (recordingPath_)
+		{
+			float t = now - recordStartTime_;
+			if (recordedPath_.keys.empty() ||
+				t - recordedPath_.keys.back().time >= 0.25f)
+				recordedPath_.add_key(t, camera);
+		}
+
 		// --- ImGui frame -----------------------------------------------------
 		ImGui_ImplVulkan_NewFrame();
 		ImGui_ImplGlfw_NewFrame();
@@ -121,6 +420,20 @@ void App::main_loop()
 				ImGui::Separator();
 				if (ImGui::MenuItem("Import Mesh...")) showImportDialog_ = true;
 				ImGui::Separator();
+				if (!recordingPath_ && ImGui::MenuItem("Record Camera Path"))
+				{
+					recordedPath_.keys.clear();
+					recordStartTime_ = now;
+					recordingPath_ = true;
+				}
+				else if (recordingPath_ &&
+						 ImGui::MenuItem("Stop Recording Camera Path..."))
+				{
+					recordedPath_.add_key(now - recordStartTime_, camera);
+					recordingPath_ = false;
+					showSavePathDialog_ = true;
+				}
+				ImGui::Separator();
 				if (ImGui::MenuItem("Exit"))
 					glfwSetWindowShouldClose(window, true);
 				ImGui::EndMenu();
@@ -142,16 +455,18 @@ void App::main_loop()
 		{
 			IGFD::FileDialogConfig config;
 			config.path = ".";
-			ImGuiFileDialog::Instance()->OpenDialog("LoadScene", "Load Scene",
-													".scene", config);
+			ImGuiFileDialog::Instance()->OpenDialog(
+				"LoadScene", "Load Scene", "Scene files{.sceneb,.scene}",
+				config);
 			showLoadDialog_ = false;
 		}
 		if (showSaveDialog_)
 		{
 			IGFD::FileDialogConfig config;
 			config.path = ".";
+			// Binary by default; pick .scene to export JSON
 			ImGuiFileDialog::Instance()->OpenDialog("SaveScene", "Save Scene",
-													".scene", config);
+													".sceneb,.scene", config);
 			showSaveDialog_ = false;
 		}
 		if (showImportDialog_)
@@ -162,6 +477,14 @@ void App::main_loop()
 													".gltf,.glb", config);
 			showImportDialog_ = false;
 		}
+		if (showSavePathDialog_)
+		{
+			IGFD::FileDialogConfig config;
+			config.path = ".";
+			ImGuiFileDialog::Instance()->OpenDialog(
+				"SaveCameraPath", "Save Camera Path", ".json", config);
+			showSavePathDialog_ = false;
+		}
 
 		// Render file dialogs
 		if (ImGuiFileDialog::Instance()->Display("LoadScene"))
@@ -182,10 +505,27 @@ void App::main_loop()
 				do_import_mesh(ImGuiFileDialog::Instance()->GetFilePathName());
 			ImGuiFileDialog::Instance()->Close();
 		}
+		if (ImGuiFileDialog::Instance()->Display("SaveCameraPath"))
+		{
+			if (ImGuiFileDialog::Instance()->IsOk())
+			{
+				std::string file =
+					ImGuiFileDialog::Instance()->GetFilePathName();
+				if (save_camera_path(file, recordedPath_))
+					LOG_INFO("Saved camera path (%zu keys) to: %s",
+							 recordedPath_.keys.size(), file.c_str());
+			}
+			ImGuiFileDialog::Instance()->Close();
+		}
 
 		gizmo.begin_frame();
 
-		debugWindow.draw(renderer, lights, selection, gizmo, sceneGraph);
+		debugWindow.draw(renderer, framePacer, lights, selection, gizmo,
+						 sceneGraph);
+		draw_selection_overlay();
+		update_scene_streaming();
+		update_texture_streaming();
+		draw_loading_progress();
 
 		// Handle import/delete requests from debug window
 		if (debugWindow.importRequested)
@@ -202,48 +542,55 @@ void App::main_loop()
 		// Delete key shortcut
 		if (!ImGui::GetIO().WantCaptureKeyboard &&
 			ImGui::IsKeyPressed(ImGuiKey_Delete) &&
-			selection.selectedNode.has_value())
+			!selection.selectedNodes.empty())
 		{
 			do_delete_selected();
 		}
 
 		// --- Gizmo manipulation ------------------------------------------
+		// The gizmo sits on the active node; its world-space change is
+		// applied to every selected node in one pass
 		if (selection.selectedNode.has_value())
 		{
 			uint32_t nodeIdx = selection.selectedNode.value();
 			if (nodeIdx < sceneGraph.nodes.size())
 			{
-				auto& node = sceneGraph.nodes[nodeIdx];
+				glm::mat4 pivot = sceneGraph.world_transform(nodeIdx);
+				glm::mat4 moved = pivot;
 				VkExtent2D ext = renderer.swapchain_extent();
-				gizmo.manipulate(renderer.last_view(), renderer.last_proj(),
-								 node.localTransform, 0.0f, 0.0f,
-								 static_cast<float>(ext.width),
-								 static_cast<float>(ext.height));
+				if (gizmo.manipulate(renderer.last_view(),
+									 renderer.last_proj(), moved, 0.0f, 0.0f,
+									 static_cast<float>(ext.width),
+									 static_cast<float>(ext.height)))
+				{
+					sceneGraph.transform_nodes(selection.selectedNodes,
+											   moved * glm::inverse(pivot));
+					for (uint32_t n : selection.selectedNodes)
+						selection.node_moved(n);
+				}
 			}
 		}
 
-		// --- Sync scene graph → mesh transforms --------------------------
-		sceneGraph.update_world_transforms();
-		auto& meshes = renderer.meshes();
-		for (const auto& node : sceneGraph.nodes)
-		{
-			if (node.meshIndex.has_value() &&
-				node.meshIndex.value() < meshes.size())
-				meshes[node.meshIndex.value()].transform = node.worldTransform;
-		}
-
 		ImGui::Render();
 
 		// --- Draw ------------------------------------------------------------
 		auto frame = renderer.begin_frame();
 		if (!frame) continue;  // swapchain was recreated
+		update_instances(deltaTime);
+
+		// A GPU pick resolves once its frame has finished
+		std::optional<uint32_t> pickedMesh;
+		if (renderer.pick_result(pickedMesh))
+			selection.select_mesh(pickedMesh, sceneGraph, gpuPickMode_);
 
 		float time = static_cast<float>(glfwGetTime());
 		renderer.update_uniforms(camera, time, lights);
-		renderer.update_debug_lines(lights);
+		renderer.update_debug_lines(lights, placeholderLines_);
 		renderer.draw_scene(frame->cmd);
+		renderer.finish_scene(*frame);
 
-		// ImGui draws into the same render pass
+		// ImGui draws at full resolution into the pass finish_scene left
+		// open (the main pass, or the upscale output)
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), frame->cmd);
 
 		renderer.end_frame(*frame);
@@ -309,24 +656,52 @@ void App::process_input()
 		camera.front = glm::normalize(d);
 	}
 
-	// --- Left-click picking --------------------------------------------------
-	if (!io.WantCaptureMouse && !gizmo.is_using())
+	// --- Left-click selection -----------------------------------------------
+	// Selection happens on release: a press that barely moved is a click
+	// pick, anything longer a marquee or lasso
 	{
-		if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS &&
-			!leftClickHeld)
+		double mx, my;
+		glfwGetCursorPos(window, &mx, &my);
+		glm::vec2 cursor(static_cast<float>(mx), static_cast<float>(my));
+		bool leftDown =
+			glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+
+		if (leftDown && !leftClickHeld)
 		{
 			leftClickHeld = true;
-			double mx, my;
-			glfwGetCursorPos(window, &mx, &my);
-			VkExtent2D ext = renderer.swapchain_extent();
-			selection.pick(static_cast<float>(mx), static_cast<float>(my),
-						   static_cast<float>(ext.width),
-						   static_cast<float>(ext.height), renderer.last_view(),
-						   renderer.last_proj(), sceneGraph, renderer.meshes());
+			// Presses on the UI or on a gizmo handle are theirs
+			selectPress_ = !io.WantCaptureMouse && !gizmo.is_using() &&
+						   !gizmo.is_over();
+			dragging_ = false;
+			lasso_ =
+				glfwGetKey(window, GLFW_KEY_LEFT_ALT) == GLFW_PRESS ||
+				glfwGetKey(window, GLFW_KEY_RIGHT_ALT) == GLFW_PRESS;
+			dragStart_ = cursor;
+			dragEnd_ = cursor;
+			lassoPoints_.assign(1, cursor);
+		}
+		else if (leftDown && selectPress_)
+		{
+			constexpr float DRAG_THRESHOLD = 4.0f;	// pixels
+			constexpr float LASSO_SPACING = 2.0f;
+			dragEnd_ = cursor;
+			glm::vec2 moved = cursor - dragStart_;
+			if (std::max(std::abs(moved.x), std::abs(moved.y)) >
+				DRAG_THRESHOLD)
+				dragging_ = true;
+			glm::vec2 step = cursor - lassoPoints_.back();
+			if (lasso_ &&
+				std::max(std::abs(step.x), std::abs(step.y)) >= LASSO_SPACING)
+				lassoPoints_.push_back(cursor);
+		}
+		else if (!leftDown && leftClickHeld)
+		{
+			leftClickHeld = false;
+			if (selectPress_) finish_selection(cursor);
+			selectPress_ = false;
+			dragging_ = false;
 		}
 	}
-	if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE)
-		leftClickHeld = false;
 
 	// --- Keyboard movement ---------------------------------------------------
 	if (!io.WantCaptureKeyboard)
@@ -358,11 +733,72 @@ void App::process_input()
 		}
 		if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS)
 			camera.position += camera.up * v;
-		if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
+		// Only while flying: Ctrl+click toggles the selection
+		if (mouseCaptured &&
+			glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS)
 			camera.position -= camera.up * v;
 	}
 }
 
+void App::finish_selection(glm::vec2 cursor)
+{
+	Selection::Mode mode = Selection::Mode::Replace;
+	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL) == GLFW_PRESS ||
+		glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL) == GLFW_PRESS)
+		mode = Selection::Mode::Toggle;
+	else if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
+			 glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS)
+		mode = Selection::Mode::Add;
+
+	VkExtent2D ext = renderer.swapchain_extent();
+	float screenW = static_cast<float>(ext.width);
+	float screenH = static_cast<float>(ext.height);
+	const glm::mat4& view = renderer.last_view();
+	const glm::mat4& proj = renderer.last_proj();
+
+	if (!dragging_)
+	{
+		if (renderer.gpuPicking_)
+		{
+			gpuPickMode_ = mode;
+			renderer.request_pick(
+				static_cast<uint32_t>(std::max(cursor.x, 0.0f)),
+				static_cast<uint32_t>(std::max(cursor.y, 0.0f)));
+		}
+		else
+			selection.pick(cursor.x, cursor.y, screenW, screenH, view, proj,
+						   sceneGraph, renderer.meshes(), mode);
+	}
+	else if (lasso_)
+		selection.lasso_select(lassoPoints_, screenW, screenH, view, proj,
+							   sceneGraph, renderer.meshes(), mode);
+	else
+		selection.box_select(dragStart_, cursor, screenW, screenH, view,
+							 proj, sceneGraph, renderer.meshes(), mode);
+}
+
+void App::draw_selection_overlay()
+{
+	if (!selectPress_ || !dragging_) return;
+
+	ImDrawList* drawList = ImGui::GetForegroundDrawList();
+	const ImU32 outline = IM_COL32(255, 190, 60, 255);
+	if (lasso_)
+	{
+		std::vector<ImVec2> points;
+		points.reserve(lassoPoints_.size());
+		for (glm::vec2 p : lassoPoints_) points.emplace_back(p.x, p.y);
+		drawList->AddPolyline(points.data(), static_cast<int>(points.size()),
+							  outline, ImDrawFlags_Closed, 1.5f);
+		return;
+	}
+	glm::vec2 lo = glm::min(dragStart_, dragEnd_);
+	glm::vec2 hi = glm::max(dragStart_, dragEnd_);
+	drawList->AddRectFilled(ImVec2(lo.x, lo.y), ImVec2(hi.x, hi.y),
+							IM_COL32(255, 190, 60, 40));
+	drawList->AddRect(ImVec2(lo.x, lo.y), ImVec2(hi.x, hi.y), outline);
+}
+
 // =============================================================================
 // Scene graph
 // =============================================================================
@@ -381,32 +817,92 @@ void App::build_scene_graph()
 	}
 }
 
+void App::update_instances(float dt)
+{
+	// Animated meshes take the pose of their node in the animation set;
+	// skinned ones are posed by their joints and only read morph weights
+	renderer.update_animation(dt, &threadPool);
+	auto& animations = renderer.animations();
+	if (std::any_of(animations.begin(), animations.end(),
+					[](const AnimationSet& set) { return set.changed; }))
+	{
+		const auto& meshes = renderer.meshes();
+		for (uint32_t n = 0; n < static_cast<uint32_t>(sceneGraph.nodes.size());
+			 ++n)
+		{
+			auto meshIndex = sceneGraph.nodes[n].meshIndex;
+			if (!meshIndex.has_value() || meshIndex.value() >= meshes.size())
+				continue;
+			const Mesh& mesh = meshes[meshIndex.value()];
+			if (mesh.animation < 0 || mesh.skin >= 0 ||
+				!animations[mesh.animation].changed)
+				continue;
+			sceneGraph.set_local_transform(
+				n, animations[mesh.animation].globals[mesh.animationNode]);
+		}
+		for (auto& set : animations) set.changed = false;
+		// Cheaper than queueing refits of every animated node each frame
+		selection.scene_changed();
+	}
+
+	// Only moved subtrees are recomputed, straight into this frame's
+	// instance buffer
+	sceneGraph.set_frame_slots(renderer.frames_in_flight());
+	sceneGraph.update_world_transforms(
+		renderer.frame_slot(), renderer.instance_transforms(), &threadPool);
+	renderer.update_skinning(&threadPool);
+	sort_transparent();
+}
+
+void App::sort_transparent()
+{
+	// The order-independent modes need no order
+	blendedMeshes_.clear();
+	blendedWorlds_.clear();
+	if (renderer.has_blended_materials() &&
+		renderer.transparency_mode() == Renderer::TransparencyMode::Sorted)
+	{
+		for (uint32_t n = 0; n < static_cast<uint32_t>(sceneGraph.nodes.size());
+			 ++n)
+		{
+			auto meshIndex = sceneGraph.nodes[n].meshIndex;
+			if (!meshIndex.has_value() || !renderer.blended(meshIndex.value()))
+				continue;
+			blendedMeshes_.push_back(meshIndex.value());
+			blendedWorlds_.push_back(sceneGraph.world_transform(n));
+		}
+	}
+	renderer.sort_transparent(blendedMeshes_, blendedWorlds_,
+							  camera.view_matrix());
+}
+
 // =============================================================================
 // Scene file operations
 // =============================================================================
 
 void App::new_scene()
 {
+	cancel_scene_streaming();
 	renderer.unload_scene();
 	renderer.load_scene_empty();
 	sceneGraph.clear();
 	build_scene_graph();
 	camera = Camera{};
-	lights = LightEnvironment{};
-	lights.ambient.color = glm::vec3(1.0f);
-	lights.ambient.intensity = 0.03f;
-	DirectionalLight sun;
-	sun.direction = glm::normalize(glm::vec3(0.5f, -1.0f, 0.3f));
-	sun.color = glm::vec3(1.0f);
-	sun.intensity = 3.0f;
-	lights.directionals.push_back(sun);
-	selection.selectedNode.reset();
+	set_default_lights();
+	selection.clear();
+	selection.invalidate();
 	currentScenePath.clear();
 	modelPath.clear();
 }
 
 void App::do_save_scene(const std::string& path)
 {
+	// Nodes waiting for their model have no mesh yet
+	if (scene_streaming())
+	{
+		LOG_WARN("Cannot save while the scene is still loading");
+		return;
+	}
 	LOG_INFO("Saving scene to: %s", path.c_str());
 	SceneFileData data;
 	data.modelPath = modelPath;
@@ -424,94 +920,294 @@ void App::do_save_scene(const std::string& path)
 	}
 }
 
-void App::do_load_scene(const std::string& path)
+bool App::do_load_scene(const std::string& path)
 {
+	using Clock = std::chrono::steady_clock;
+	auto loadStart = Clock::now();
 	LOG_INFO("Loading scene: %s", path.c_str());
 
 	SceneFileData data;
 	if (!load_scene_file(path, data))
 	{
 		LOG_ERROR("load_scene_file failed for: %s", path.c_str());
-		return;
+		return false;
 	}
+	cancel_scene_streaming();
 
 	LOG_INFO("Scene file parsed. modelPath='%s', nodes=%zu",
 			 data.modelPath.c_str(), data.sceneGraph.nodes.size());
 
+	// Group the nodes by model dependency, in first-use order. They keep
+	// no mesh until their model has been uploaded.
+	std::vector<std::string> modelPaths;
+	{
+		std::unordered_map<std::string, uint32_t> modelIndices;
+		for (uint32_t i = 0;
+			 i < static_cast<uint32_t>(data.sceneGraph.nodes.size()); ++i)
+		{
+			auto& node = data.sceneGraph.nodes[i];
+			if (!node.meshIndex.has_value()) continue;
+
+			// Backward compatibility: if node has no modelPath, use the
+			// global one
+			if (node.modelPath.empty())
+			{
+				node.modelPath = data.modelPath;
+				node.meshIndexInModel = node.meshIndex.value();
+			}
+
+			if (node.modelPath.empty()) continue;
+			auto [it, added] = modelIndices.emplace(
+				node.modelPath, static_cast<uint32_t>(modelPaths.size()));
+			if (added)
+			{
+				modelPaths.push_back(node.modelPath);
+				pendingModels_.push_back({node.modelPath, {}, {}, 0.0f});
+			}
+			pendingModels_[it->second].nodes.push_back(i);
+			data.sceneGraph.set_mesh_index(i, std::nullopt);
+		}
+	}
+
 	renderer.unload_scene();
 	renderer.load_scene_empty();  // Loads the default cube at index 0
 
-	// Track loaded models to avoid double-loading and to compute offsets
-	std::unordered_map<std::string, uint32_t> modelOffsets;
-	modelOffsets["internal://cube"] = 0;
+	sceneGraph = std::move(data.sceneGraph);
+	camera = data.camera;
+	lights = data.lights;
+	modelPath = data.modelPath;
+
+	selection.clear();
+	selection.invalidate();
+	currentScenePath = path;
+
+	modelsLeft_ = static_cast<uint32_t>(modelPaths.size());
+	streamStart_ = Clock::now();
+	modelStreamer_.start(std::move(modelPaths));
+	LOG_INFO("Scene file loaded in %.1f ms: %zu node(s), streaming %u "
+			 "model(s)",
+			 std::chrono::duration<double, std::milli>(Clock::now() -
+													   loadStart)
+				 .count(),
+			 sceneGraph.nodes.size(), modelsLeft_);
+	return true;
+}
+
+void App::cancel_scene_streaming()
+{
+	modelStreamer_.cancel();
+	pendingModels_.clear();
+	modelsLeft_ = 0;
+	placeholderLines_.clear();
+}
+
+void App::store_streamed_model(ModelStreamer::Result& result)
+{
+	PendingModel& model = pendingModels_[result.model];
+	if (result.error.empty())
+	{
+		model.scene = std::move(result.scene);
+		return;
+	}
+	LOG_ERROR("Failed to load model '%s': %s", model.path.c_str(),
+			  result.error.c_str());
+	model.nodes.clear();
+	--modelsLeft_;
+}
+
+void App::upload_streamed_models(std::span<const uint32_t> models,
+								 uint32_t textureSizeLimit)
+{
+	if (models.empty()) return;
 
-	// For each node, ensure its model is loaded and its meshIndex is re-mapped
-	for (auto& node : data.sceneGraph.nodes)
+	std::vector<Scene> scenes;
+	std::vector<std::string> paths;
+	std::vector<uint32_t> offsets;
+	uint32_t offset = static_cast<uint32_t>(renderer.meshes().size());
+	for (uint32_t m : models)
 	{
-		if (!node.meshIndex.has_value()) continue;
+		PendingModel& model = pendingModels_[m];
+		offsets.push_back(offset);
+		offset += static_cast<uint32_t>(model.scene->meshes.size());
+		scenes.push_back(std::move(*model.scene));
+		paths.push_back(model.path);
+		model.scene.reset();
+	}
+
+	// One batched upload and descriptor rebuild for the lot
+	renderer.import_scenes(scenes, paths, textureSizeLimit);
 
-		// Backward compatibility: if node has no modelPath, use the global one
-		if (node.modelPath.empty())
+	// Point each waiting node at its mesh in the renderer's list
+	for (size_t k = 0; k < models.size(); ++k)
+	{
+		PendingModel& model = pendingModels_[models[k]];
+		uint32_t meshCount = static_cast<uint32_t>(scenes[k].meshes.size());
+		for (uint32_t n : model.nodes)
 		{
-			node.modelPath = data.modelPath;
-			node.meshIndexInModel = node.meshIndex.value();
+			uint32_t inModel = sceneGraph.nodes[n].meshIndexInModel;
+			if (inModel < meshCount)
+				sceneGraph.set_mesh_index(n, offsets[k] + inModel);
+			else
+				LOG_WARN("Node '%s' refers to mesh %u of '%s', which has %u "
+						 "mesh(es) -- object will not render",
+						 sceneGraph.nodes[n].name.c_str(), inModel,
+						 model.path.c_str(), meshCount);
 		}
+		model.nodes.clear();
+		--modelsLeft_;
+	}
+	selection.scene_changed();
+
+	if (modelsLeft_ == 0)
+		LOG_INFO("Scene models streamed in %.1f ms, %zu renderer meshes",
+				 std::chrono::duration<double, std::milli>(
+					 std::chrono::steady_clock::now() - streamStart_)
+					 .count(),
+				 renderer.meshes().size());
+}
 
-		if (node.modelPath.empty()) continue;
+void App::update_scene_streaming()
+{
+	// Small enough that a model's first upload is quick, big enough to
+	// tell materials apart
+	constexpr uint32_t PREVIEW_TEXTURE_SIZE = 64;
+	constexpr uint32_t MAX_UPLOADS_PER_FRAME = 4;
+	constexpr size_t MAX_PLACEHOLDERS = 1024;
+	// Anything in view outranks anything out of view
+	constexpr float VISIBLE_BONUS = 1.0e6f;
+
+	placeholderLines_.clear();
+	if (!scene_streaming()) return;
+
+	// Rank the models by their best node: in view, then nearest
+	glm::mat4 viewProj = renderer.last_proj() * renderer.last_view();
+	std::vector<uint32_t> order;
+	for (uint32_t m = 0; m < static_cast<uint32_t>(pendingModels_.size());
+		 ++m)
+	{
+		PendingModel& model = pendingModels_[m];
+		if (model.nodes.empty()) continue;
 
-		if (modelOffsets.find(node.modelPath) == modelOffsets.end())
+		float best = -FLT_MAX;
+		for (uint32_t n : model.nodes)
+		{
+			glm::vec3 p = glm::vec3(sceneGraph.world_transform(n)[3]);
+			glm::vec4 clip = viewProj * glm::vec4(p, 1.0f);
+			bool visible = clip.w > 0.0f && std::abs(clip.x) <= clip.w &&
+						   std::abs(clip.y) <= clip.w;
+			best = std::max(best, (visible ? VISIBLE_BONUS : 0.0f) -
+									  glm::length(p - camera.position));
+		}
+		model.priority = best;
+		if (!model.scene) modelStreamer_.set_priority(m, best);
+		order.push_back(m);
+	}
+	std::sort(order.begin(), order.end(),
+			  [&](uint32_t a, uint32_t b)
+			  {
+				  return pendingModels_[a].priority >
+						 pendingModels_[b].priority;
+			  });
+
+	ModelStreamer::Result result;
+	while (modelStreamer_.pop_result(result)) store_streamed_model(result);
+
+	std::vector<uint32_t> uploads;
+	for (uint32_t m : order)
+		if (pendingModels_[m].scene && uploads.size() < MAX_UPLOADS_PER_FRAME)
+			uploads.push_back(m);
+	upload_streamed_models(uploads, PREVIEW_TEXTURE_SIZE);
+
+	// Placeholders for what is still missing: a unit box while the model
+	// decodes, then its meshes' bounds until the upload
+	size_t boxes = 0;
+	for (uint32_t m : order)
+	{
+		const PendingModel& model = pendingModels_[m];
+		for (uint32_t n : model.nodes)
 		{
-			LOG_INFO("Loading model dependency: %s", node.modelPath.c_str());
-			uint32_t offset = static_cast<uint32_t>(renderer.meshes().size());
-			try
+			if (boxes++ == MAX_PLACEHOLDERS) return;
+			const glm::mat4& world = sceneGraph.world_transform(n);
+			uint32_t inModel = sceneGraph.nodes[n].meshIndexInModel;
+			if (model.scene && inModel < model.scene->meshes.size())
 			{
-				renderer.import_gltf(node.modelPath);
-				modelOffsets[node.modelPath] = offset;
+				const AABB& bounds = model.scene->meshes[inModel].localBounds;
+				append_box_lines(placeholderLines_, bounds.min, bounds.max,
+								 world, glm::vec3(1.0f, 0.8f, 0.2f));
 			}
-			catch (const std::exception& e)
+			else
 			{
-				LOG_ERROR("Failed to load model '%s': %s",
-						  node.modelPath.c_str(), e.what());
-				node.meshIndex.reset();
-				continue;
+				append_box_lines(placeholderLines_, glm::vec3(-0.5f),
+								 glm::vec3(0.5f), world, glm::vec3(0.5f));
 			}
 		}
-
-		node.meshIndex = modelOffsets[node.modelPath] + node.meshIndexInModel;
 	}
+}
 
-	sceneGraph = std::move(data.sceneGraph);
-	camera = data.camera;
-	lights = data.lights;
-	modelPath = data.modelPath;
+void App::finish_scene_streaming()
+{
+	ModelStreamer::Result result;
+	while (modelStreamer_.wait_result(result)) store_streamed_model(result);
+
+	std::vector<uint32_t> uploads;
+	for (uint32_t m = 0; m < static_cast<uint32_t>(pendingModels_.size());
+		 ++m)
+		if (pendingModels_[m].scene) uploads.push_back(m);
+	upload_streamed_models(uploads, 0);
+
+	// Without streaming, the preview levels are replaced right away
+	if (!renderer.textureStreaming_) renderer.upgrade_textures(UINT32_MAX);
+	placeholderLines_.clear();
+}
 
-	// Sync scene graph → mesh transforms
-	sceneGraph.update_world_transforms();
-	auto& meshes = renderer.meshes();
-	LOG_INFO("Post-load: %zu scene nodes, %zu renderer meshes",
-			 sceneGraph.nodes.size(), meshes.size());
+void App::update_texture_streaming()
+{
+	// Fresh mip estimates every few frames; in between the renderer keeps
+	// working through the last one
+	constexpr uint64_t FEEDBACK_INTERVAL = 8;
 
-	for (const auto& node : sceneGraph.nodes)
+	std::vector<glm::mat4> meshWorlds;
+	if (renderer.textureStreaming_ &&
+		textureFeedbackFrame_++ % FEEDBACK_INTERVAL == 0)
 	{
-		if (!node.meshIndex.has_value()) continue;
-
-		uint32_t mi = node.meshIndex.value();
-		if (mi < meshes.size())
-		{
-			meshes[mi].transform = node.worldTransform;
-		}
-		else
+		// Zero for meshes no node places
+		meshWorlds.assign(renderer.meshes().size(), glm::mat4(0.0f));
+		for (uint32_t n = 0; n < static_cast<uint32_t>(sceneGraph.nodes.size());
+			 ++n)
 		{
-			LOG_WARN(
-				"Node '%s' has meshIndex=%u but only %zu meshes loaded — "
-				"object will not render",
-				node.name.c_str(), mi, meshes.size());
+			auto meshIndex = sceneGraph.nodes[n].meshIndex;
+			if (meshIndex.has_value() && meshIndex.value() < meshWorlds.size())
+				meshWorlds[meshIndex.value()] = sceneGraph.world_transform(n);
 		}
 	}
+	renderer.update_texture_streaming(meshWorlds);
+}
 
-	selection.selectedNode.reset();
-	currentScenePath = path;
-	LOG_INFO("Scene load complete");
+void App::draw_loading_progress()
+{
+	if (!scene_streaming()) return;
+
+	uint32_t total = static_cast<uint32_t>(pendingModels_.size());
+	uint32_t done = total - modelsLeft_;
+	char label[64];
+	std::snprintf(label, sizeof(label), "%u / %u models", done, total);
+
+	const ImGuiViewport* viewport = ImGui::GetMainViewport();
+	ImGui::SetNextWindowPos(
+		ImVec2(viewport->WorkPos.x + viewport->WorkSize.x * 0.5f,
+			   viewport->WorkPos.y + viewport->WorkSize.y - 20.0f),
+		ImGuiCond_Always, ImVec2(0.5f, 1.0f));
+	ImGui::SetNextWindowBgAlpha(0.7f);
+	ImGui::Begin("##SceneLoading", nullptr,
+				 ImGuiWindowFlags_NoDecoration |
+					 ImGuiWindowFlags_AlwaysAutoResize |
+					 ImGuiWindowFlags_NoSavedSettings |
+					 ImGuiWindowFlags_NoFocusOnAppearing |
+					 ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoInputs);
+	ImGui::TextUnformatted("Loading scene");
+	ImGui::ProgressBar(static_cast<float>(done) / static_cast<float>(total),
+					   ImVec2(260.0f, 0.0f), label);
+	ImGui::End();
 }
 
 void App::do_import_mesh(const std::string& path)
@@ -533,23 +1229,26 @@ void App::do_import_mesh(const std::string& path)
 		sceneGraph.add_node(name, meshes[i].transform, i, meshes[i].sourcePath,
 							meshes[i].sourceMeshIndex, std::nullopt);
 	}
-
-	sceneGraph.update_world_transforms();
+	selection.scene_changed();
 }
 
 void App::do_delete_selected()
 {
-	if (!selection.selectedNode.has_value()) return;
-	uint32_t nodeIdx = selection.selectedNode.value();
-	if (nodeIdx >= sceneGraph.nodes.size()) return;
-
-	auto meshIdx = sceneGraph.nodes[nodeIdx].meshIndex;
+	// Pending models refer to their nodes by index
+	if (scene_streaming())
+	{
+		LOG_WARN("Cannot delete while the scene is still loading");
+		return;
+	}
+	std::vector<uint32_t> selected;
+	for (uint32_t n : selection.selectedNodes)
+		if (n < sceneGraph.nodes.size()) selected.push_back(n);
+	if (selected.empty()) return;
 
-	// Collect all mesh indices that will be removed (node + descendants)
+	// Collect all mesh indices that will be removed (nodes + descendants)
 	std::vector<uint32_t> meshIndicesToRemove;
 	{
-		std::vector<uint32_t> nodesToVisit;
-		nodesToVisit.push_back(nodeIdx);
+		std::vector<uint32_t> nodesToVisit = selected;
 		for (size_t i = 0; i < nodesToVisit.size(); ++i)
 			for (uint32_t child : sceneGraph.nodes[nodesToVisit[i]].children)
 				nodesToVisit.push_back(child);
@@ -559,41 +1258,38 @@ void App::do_delete_selected()
 					sceneGraph.nodes[n].meshIndex.value());
 	}
 
-	// Remove the node (and descendants) from scene graph
-	sceneGraph.remove_node(nodeIdx);
-
-	// Sort mesh indices descending so we delete from back to front
-	std::sort(meshIndicesToRemove.begin(), meshIndicesToRemove.end(),
-			  std::greater<uint32_t>());
-
-	// Delete each mesh from renderer (each call compacts and fixes indices)
-	for (uint32_t mi : meshIndicesToRemove) renderer.delete_mesh(mi);
-
-	// Fix up scene graph meshIndex values for shifted mesh indices
-	// After each delete_mesh, meshes shift down. We need to recompute.
-	// Since we deleted in descending order, we can compute the cumulative
-	// shift.
-	for (auto& node : sceneGraph.nodes)
+	// Remove the nodes (and descendants) from scene graph in one pass
+	sceneGraph.remove_nodes(selected);
+
+	// Old -> new mesh index, built in one pass before the meshes shift. A
+	// node selected along with its ancestor was visited twice, which only
+	// marks its mesh again.
+	uint32_t meshCount = static_cast<uint32_t>(renderer.meshes().size());
+	std::vector<uint32_t> meshRemap(meshCount, 0);
+	for (uint32_t mi : meshIndicesToRemove)
+		if (mi < meshCount) meshRemap[mi] = SceneGraph::NO_INDEX;
+	for (uint32_t mi = 0, kept = 0; mi < meshCount; ++mi)
+		if (meshRemap[mi] != SceneGraph::NO_INDEX) meshRemap[mi] = kept++;
+
+	// The renderer compacts with the same table, all meshes at once
+	renderer.delete_meshes(meshRemap);
+
+	// Fix up scene graph meshIndex values for the shifted meshes
+	for (uint32_t i = 0; i < static_cast<uint32_t>(sceneGraph.nodes.size());
+		 ++i)
 	{
-		if (!node.meshIndex.has_value()) continue;
-		uint32_t oldIdx = node.meshIndex.value();
-		uint32_t shift = 0;
-		for (uint32_t removed : meshIndicesToRemove)
-			if (removed <= oldIdx) ++shift;
-		node.meshIndex = oldIdx - shift;
+		auto meshIndex = sceneGraph.nodes[i].meshIndex;
+		if (!meshIndex.has_value() || meshIndex.value() >= meshCount)
+			continue;
+		uint32_t newIdx = meshRemap[meshIndex.value()];
+		if (newIdx == SceneGraph::NO_INDEX)
+			sceneGraph.set_mesh_index(i, std::nullopt);
+		else
+			sceneGraph.set_mesh_index(i, newIdx);
 	}
 
-	selection.selectedNode.reset();
-
-	// Re-sync transforms
-	sceneGraph.update_world_transforms();
-	auto& meshes = renderer.meshes();
-	for (const auto& node : sceneGraph.nodes)
-	{
-		if (node.meshIndex.has_value() &&
-			node.meshIndex.value() < meshes.size())
-			meshes[node.meshIndex.value()].transform = node.worldTransform;
-	}
+	selection.meshes_removed(meshRemap);
+	selection.clear();
 }
 
 // =============================================================================
@@ -630,8 +1326,8 @@ void App::init_imgui()
 	initInfo.MinImageCount = 2;
 	initInfo.ImageCount = renderer.swapchain_image_count();
 	initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
-	initInfo.RenderPass = renderer.vk_render_pass();
-	initInfo.Subpass = 0;
+	initInfo.UseDynamicRendering = true;
+	initInfo.PipelineRenderingCreateInfo = renderer.main_pass_formats();
 
 	ImGui_ImplVulkan_Init(&initInfo);
 }
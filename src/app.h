@@ -3,15 +3,23 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 
+#include <chrono>
+#include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
+#include "bench/cameraPath.h"
+#include "core/threadPool.h"
 #include "editor/debugWindow.h"
 #include "editor/gizmo.h"
 #include "editor/sceneGraph.h"
 #include "editor/selection.h"
 #include "graphics/camera.h"
+#include "graphics/framePacer.h"
 #include "graphics/light.h"
 #include "graphics/renderer.h"
+#include "loaders/modelStreamer.h"
 
 struct App
 {
@@ -27,12 +35,22 @@ struct App
 	// Scene graph
 	SceneGraph sceneGraph;
 
+	// Workers for data-parallel CPU work (large transform updates)
+	ThreadPool threadPool{std::thread::hardware_concurrency()};
+
+	// Decodes the models of a loading scene in the background, leaving
+	// the other half of the cores to the frame
+	ModelStreamer modelStreamer_{std::thread::hardware_concurrency() / 2};
+
 	// ImGui
 	VkDescriptorPool imguiPool = VK_NULL_HANDLE;
 
 	// Debug UI
 	DebugWindow debugWindow;
 
+	// CPU frame limiter (--fps-limit, Frame Statistics window)
+	FramePacer framePacer;
+
 	// Lights
 	LightEnvironment lights;
 
@@ -43,6 +61,16 @@ struct App
 	// State
 	bool mouseCaptured = false;
 	bool leftClickHeld = false;
+	// Left press that started in the viewport: a click picks, a drag
+	// selects by marquee (or lasso, when Alt was held at the press)
+	bool selectPress_ = false;
+	bool dragging_ = false;
+	bool lasso_ = false;
+	glm::vec2 dragStart_{0.0f};
+	glm::vec2 dragEnd_{0.0f};
+	std::vector<glm::vec2> lassoPoints_;
+	// Mode of the GPU pick in flight, applied when its result arrives
+	Selection::Mode gpuPickMode_ = Selection::Mode::Replace;
 	bool firstMouse = true;
 	double lastMouseX = 0.0;
 	double lastMouseY = 0.0;
@@ -53,6 +81,27 @@ struct App
 	// Model path
 	std::string modelPath;
 
+	// Optional .scene loaded after startup (--scene)
+	std::string startupScenePath;
+
+	// Headless mode (--headless): offscreen rendering, no window or UI
+	bool headless = false;
+	uint32_t headlessWidth = INITIAL_WIDTH;
+	uint32_t headlessHeight = INITIAL_HEIGHT;
+	uint32_t headlessFrames = 1;
+	std::string headlessOutput;	 // .png / .exr written after the last frame
+
+	// Benchmark mode (--bench): loads benchScenePath, plays benchCameraPath
+	// at a fixed timestep and writes frame-time statistics as JSON. Runs
+	// windowed (no ImGui) or offscreen when headless is also set.
+	std::string benchScenePath;
+	std::string benchCameraPath;
+	uint32_t benchWarmupFrames = 60;
+	uint32_t benchFrames = 1000;
+	std::string benchReportPath;  // empty = stdout
+	// Resize the target every few frames, like dragging a window edge
+	bool benchResizeStress = false;
+
 	// Scene file state
 	std::string currentScenePath;
 
@@ -67,8 +116,14 @@ struct App
 	void init_vulkan();
 	void main_loop();
 	void cleanup();
+	void run_headless();
+	void run_bench();
+	void set_default_lights();
+	void update_instances(float dt);
 	void init_imgui();
 	void process_input();
+	void finish_selection(glm::vec2 cursor);
+	void draw_selection_overlay();
 	void build_scene_graph();
 	void save_window_config();
 	bool load_window_config(int& x, int& y, int& w, int& h);
@@ -78,7 +133,50 @@ struct App
 	bool showSaveDialog_ = false;
 	void new_scene();
 	void do_save_scene(const std::string& path);
-	void do_load_scene(const std::string& path);
+	bool do_load_scene(const std::string& path);
 	void do_import_mesh(const std::string& path);
 	void do_delete_selected();
+
+	// Progressive scene loading: do_load_scene() shows the scene graph at
+	// once, with placeholder boxes, and its models stream in behind it.
+	// Decoded models are uploaded a few per frame, visible and nearest
+	// first. Their textures start with only the levels up to 64 px; the
+	// renderer's texture streaming (or upgrade, without it) adds the rest.
+	struct PendingModel
+	{
+		std::string path;
+		std::vector<uint32_t> nodes;  // waiting for this model's meshes
+		std::optional<Scene> scene;	  // decoded, not yet uploaded
+		float priority = 0.0f;
+	};
+	std::vector<PendingModel> pendingModels_;
+	uint32_t modelsLeft_ = 0;  // neither uploaded nor failed
+	std::chrono::steady_clock::time_point streamStart_;
+	std::vector<LineVertex> placeholderLines_;
+	bool scene_streaming() const { return modelsLeft_ > 0; }
+	void update_scene_streaming();
+	// Blocks until every model is in, at full texture size (headless and
+	// benchmark runs)
+	void finish_scene_streaming();
+	void cancel_scene_streaming();
+	void store_streamed_model(ModelStreamer::Result& result);
+	void upload_streamed_models(std::span<const uint32_t> models,
+								uint32_t textureSizeLimit);
+	void draw_loading_progress();
+
+	// Feeds the scene's mesh placement to Renderer texture streaming
+	uint64_t textureFeedbackFrame_ = 0;
+	void update_texture_streaming();
+
+	// Hands the placement of blended meshes to the renderer, which sorts
+	// them back to front each frame
+	std::vector<uint32_t> blendedMeshes_;
+	std::vector<glm::mat4> blendedWorlds_;
+	void sort_transparent();
+
+	// Camera path recording (File > Record Camera Path)
+	bool recordingPath_ = false;
+	bool showSavePathDialog_ = false;
+	float recordStartTime_ = 0.0f;
+	CameraPath recordedPath_;
 };
@@ -0,0 +1,152 @@
+#include "benchReport.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+// windows.h must come first
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+
+#include "logger.h"
+
+using json = nlohmann::json;
+
+// =============================================================================
+// Statistics
+// =============================================================================
+
+FrameTimeStats compute_frame_stats(std::vector<double> samples)
+{
+	FrameTimeStats s;
+	if (samples.empty()) return s;
+
+	std::sort(samples.begin(), samples.end());
+	size_t n = samples.size();
+	auto percentile = [&](double p)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * n));
+		return samples[std::clamp<size_t>(rank, 1, n) - 1];
+	};
+
+	s.count = static_cast<uint32_t>(n);
+	s.min = samples.front();
+	s.max = samples.back();
+	s.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+	s.p50 = percentile(50.0);
+	s.p95 = percentile(95.0);
+	s.p99 = percentile(99.0);
+	return s;
+}
+
+uint64_t peak_rss_bytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS pmc{};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		return static_cast<uint64_t>(pmc.PeakWorkingSetSize);
+	return 0;
+#else
+	rusage usage{};
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+	return static_cast<uint64_t>(usage.ru_maxrss);	// bytes
+#else
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;	 // kilobytes
+#endif
+#endif
+}
+
+// =============================================================================
+// JSON
+// =============================================================================
+
+static json stats_to_json(const std::vector<double>& samples)
+{
+	FrameTimeStats s = compute_frame_stats(samples);
+	return {
+		{"count", s.count},
+		{"min", s.min},
+		{"mean", s.mean},
+		{"p50", s.p50},
+		{"p95", s.p95},
+		{"p99", s.p99},
+		{"max", s.max},
+	};
+}
+
+bool write_bench_report(const std::string& path, const BenchReport& report)
+{
+	json root;
+	root["version"] = 1;
+	root["scene"] = report.scene;
+	root["cameraPath"] = report.cameraPath;
+	root["gpu"] = report.gpu;
+	root["headless"] = report.headless;
+	root["resolution"] = json::array({report.width, report.height});
+	root["warmupFrames"] = report.warmupFrames;
+	root["fixedTimestep"] = report.fixedTimestep;
+	root["loadTimeMs"] = report.loadTimeMs;
+	root["peakRssBytes"] = report.peakRssBytes;
+	root["cpuFrameMs"] = stats_to_json(report.cpuFrameMs);
+
+	if (report.gpuFrameMs.empty())
+	{
+		root["gpuFrameMs"] = nullptr;
+	}
+	else
+	{
+		root["gpuFrameMs"] = stats_to_json(report.gpuFrameMs);
+		json scopes = json::object();
+		for (const auto& [name, samples] : report.gpuScopeMs)
+			scopes[name] = stats_to_json(samples);
+		root["gpuScopeMs"] = scopes;
+	}
+
+	if (report.animatedNodes > 0)
+	{
+		root["animatedNodes"] = report.animatedNodes;
+		root["animationCpuMs"] = stats_to_json(report.animationCpuMs);
+	}
+
+	if (report.blendedMeshes > 0)
+	{
+		root["transparency"] = report.transparency;
+		root["blendedMeshes"] = report.blendedMeshes;
+		root["transparencySortCpuMs"] =
+			stats_to_json(report.transparencySortCpuMs);
+	}
+
+	if (report.resizeStress)
+	{
+		root["resizes"] = report.resizes;
+		root["tileBufferReallocations"] = report.tileBufferReallocations;
+		root["resizeCpuFrameMs"] = stats_to_json(report.resizeCpuFrameMs);
+	}
+
+	std::string text = root.dump(2);
+	if (path.empty())
+	{
+		std::cout << text << std::endl;
+		return static_cast<bool>(std::cout);
+	}
+
+	std::ofstream f(path);
+	if (!f)
+	{
+		LOG_ERROR("write_bench_report: cannot open '%s' for writing",
+				  path.c_str());
+		return false;
+	}
+	f << text << '\n';
+	return f.good();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// =============================================================================
+// Benchmark report
+// =============================================================================
+
+struct FrameTimeStats
+{
+	uint32_t count = 0;
+	double min = 0.0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+// Nearest-rank percentiles over the samples (milliseconds)
+FrameTimeStats compute_frame_stats(std::vector<double> samples);
+
+// Peak resident set size of this process, 0 if unavailable
+uint64_t peak_rss_bytes();
+
+struct BenchReport
+{
+	std::string scene;
+	std::string cameraPath;
+	std::string gpu;
+	bool headless = false;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t warmupFrames = 0;
+	double fixedTimestep = 0.0;
+	double loadTimeMs = 0.0;
+	uint64_t peakRssBytes = 0;
+
+	// One sample per measured frame (warm-up excluded)
+	std::vector<double> cpuFrameMs;
+	std::vector<double> gpuFrameMs;	 // empty without timestamp support
+	std::vector<std::pair<std::string, std::vector<double>>> gpuScopeMs;
+
+	// Animation playback, when the scene animates: nodes driven by a
+	// channel, and the CPU time spent sampling them each frame
+	uint32_t animatedNodes = 0;
+	std::vector<double> animationCpuMs;
+
+	// Transparency, when the scene has blended meshes: the mode they were
+	// composited with (--transparency) and the CPU time sorting them each
+	// frame, which is zero for the order-independent modes
+	std::string transparency;
+	uint32_t blendedMeshes = 0;
+	std::vector<double> transparencySortCpuMs;
+
+	// Resize stress (--resize-stress): the target size changes every few
+	// frames; resizeCpuFrameMs holds the frames that recreated the swapchain
+	bool resizeStress = false;
+	uint64_t resizes = 0;
+	uint64_t tileBufferReallocations = 0;
+	std::vector<double> resizeCpuFrameMs;
+};
+
+// Write the report as JSON. An empty path writes to stdout.
+bool write_bench_report(const std::string& path, const BenchReport& report);
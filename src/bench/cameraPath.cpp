@@ -0,0 +1,179 @@
+#include "cameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+#include "logger.h"
+
+using json = nlohmann::json;
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+// Uniform Catmull-Rom between p1 and p2
+template <typename T>
+static T catmull_rom(const T& p0, const T& p1, const T& p2, const T& p3,
+					 float u)
+{
+	float u2 = u * u;
+	float u3 = u2 * u;
+	return 0.5f * ((2.0f * p1) + (p2 - p0) * u +
+				   (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 +
+				   (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+}
+
+// =============================================================================
+// Playback
+// =============================================================================
+
+float CameraPath::duration() const
+{
+	return keys.empty() ? 0.0f : keys.back().time - keys.front().time;
+}
+
+void CameraPath::sample(float t, Camera& camera) const
+{
+	if (keys.empty()) return;
+
+	float start = keys.front().time;
+	float len = duration();
+	float local = start;
+	if (len > 0.0f) local = start + std::fmod(std::max(t, 0.0f), len);
+
+	// Segment [i, i+1] containing local
+	size_t i = 0;
+	while (i + 2 < keys.size() && keys[i + 1].time <= local) ++i;
+
+	const CameraKey& k1 = keys[i];
+	const CameraKey& k2 = keys[std::min(i + 1, keys.size() - 1)];
+	const CameraKey& k0 = keys[i > 0 ? i - 1 : i];
+	const CameraKey& k3 = keys[std::min(i + 2, keys.size() - 1)];
+
+	float span = k2.time - k1.time;
+	float u = span > 0.0f ? std::clamp((local - k1.time) / span, 0.0f, 1.0f)
+						  : 0.0f;
+
+	camera.position =
+		catmull_rom(k0.position, k1.position, k2.position, k3.position, u);
+	camera.yaw = catmull_rom(k0.yaw, k1.yaw, k2.yaw, k3.yaw, u);
+	camera.pitch = std::clamp(catmull_rom(k0.pitch, k1.pitch, k2.pitch,
+										  k3.pitch, u),
+							  -89.0f, 89.0f);
+
+	glm::vec3 d;
+	d.x = std::cos(glm::radians(camera.yaw)) *
+		  std::cos(glm::radians(camera.pitch));
+	d.y = std::sin(glm::radians(camera.pitch));
+	d.z = std::sin(glm::radians(camera.yaw)) *
+		  std::cos(glm::radians(camera.pitch));
+	camera.front = glm::normalize(d);
+}
+
+void CameraPath::add_key(float time, const Camera& camera)
+{
+	CameraKey key;
+	key.time = time;
+	key.position = camera.position;
+	key.yaw = camera.yaw;
+	key.pitch = camera.pitch;
+	keys.push_back(key);
+}
+
+// =============================================================================
+// Save / Load
+// =============================================================================
+
+bool save_camera_path(const std::string& path, const CameraPath& cameraPath)
+{
+	json keys = json::array();
+	for (const auto& k : cameraPath.keys)
+	{
+		keys.push_back({
+			{"time", k.time},
+			{"position", json::array({k.position.x, k.position.y,
+									  k.position.z})},
+			{"yaw", k.yaw},
+			{"pitch", k.pitch},
+		});
+	}
+
+	json root;
+	root["version"] = 1;
+	root["keys"] = keys;
+
+	std::ofstream f(path);
+	if (!f)
+	{
+		LOG_ERROR("save_camera_path: cannot open '%s' for writing",
+				  path.c_str());
+		return false;
+	}
+	f << root.dump(2);
+	return f.good();
+}
+
+bool load_camera_path(const std::string& path, CameraPath& cameraPath)
+{
+	std::ifstream f(path);
+	if (!f)
+	{
+		LOG_ERROR("load_camera_path: cannot open '%s'", path.c_str());
+		return false;
+	}
+
+	json root;
+	try
+	{
+		root = json::parse(f);
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR("load_camera_path: JSON parse error in '%s': %s",
+				  path.c_str(), e.what());
+		return false;
+	}
+
+	if (!root.contains("keys") || !root["keys"].is_array())
+	{
+		LOG_ERROR("load_camera_path: '%s' has no \"keys\" array", path.c_str());
+		return false;
+	}
+
+	cameraPath.keys.clear();
+	try
+	{
+		for (const auto& k : root["keys"])
+		{
+			CameraKey key;
+			key.time = k.value("time", 0.0f);
+			const auto& p = k.at("position");
+			key.position = {p[0].get<float>(), p[1].get<float>(),
+							p[2].get<float>()};
+			key.yaw = k.value("yaw", -90.0f);
+			key.pitch = k.value("pitch", 0.0f);
+			cameraPath.keys.push_back(key);
+		}
+	}
+	catch (const std::exception& e)
+	{
+		LOG_ERROR("load_camera_path: malformed key in '%s': %s", path.c_str(),
+				  e.what());
+		return false;
+	}
+
+	std::stable_sort(cameraPath.keys.begin(), cameraPath.keys.end(),
+					 [](const CameraKey& a, const CameraKey& b)
+					 { return a.time < b.time; });
+
+	if (cameraPath.keys.empty())
+	{
+		LOG_ERROR("load_camera_path: '%s' contains no keys", path.c_str());
+		return false;
+	}
+	LOG_INFO("Loaded camera path '%s': %zu keys, %.2f s", path.c_str(),
+			 cameraPath.keys.size(), cameraPath.duration());
+	return true;
+}
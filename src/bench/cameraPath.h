@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "graphics/camera.h"
+
+// =============================================================================
+// Camera path
+// =============================================================================
+
+// Recorded camera keyframes played back through a Catmull-Rom spline, so
+// benchmark runs see exactly the same views every time.
+//
+// File format (JSON):
+//   { "version": 1,
+//     "keys": [ { "time": 0.0, "position": [x, y, z],
+//                 "yaw": -90.0, "pitch": 0.0 }, ... ] }
+struct CameraKey
+{
+	float time = 0.0f;	// seconds
+	glm::vec3 position{0.0f};
+	float yaw = -90.0f;
+	float pitch = 0.0f;
+};
+
+struct CameraPath
+{
+	std::vector<CameraKey> keys;  // sorted by time
+
+	float duration() const;
+
+	// Pose the camera at time t. Past the last key the path loops, so runs
+	// longer than the recording keep moving.
+	void sample(float t, Camera& camera) const;
+
+	// Append the camera's current pose (recording)
+	void add_key(float time, const Camera& camera);
+};
+
+bool save_camera_path(const std::string& path, const CameraPath& cameraPath);
+bool load_camera_path(const std::string& path, CameraPath& cameraPath);
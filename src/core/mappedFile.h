@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// =============================================================================
+// Memory-mapped file
+// =============================================================================
+
+// Read-only view of a whole file. Pages are read in on first touch, so
+// opening is cheap regardless of size. The mapping starts on a page
+// boundary, so data() is suitably aligned for any scalar type.
+struct MappedFile
+{
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// False when the file cannot be opened or mapped (or is empty)
+	bool open(const std::string& path);
+	void close();
+
+	const std::byte* data() const { return data_; }
+	size_t size() const { return size_; }
+
+   private:
+	const std::byte* data_ = nullptr;
+	size_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = nullptr;
+	void* mapping_ = nullptr;
+#endif
+};
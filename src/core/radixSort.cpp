@@ -0,0 +1,58 @@
+#include "radixSort.h"
+
+#include <algorithm>
+#include <cstring>
+
+void radix_sort(std::span<uint32_t> keys, std::span<uint32_t> values,
+				std::vector<uint32_t>& scratch)
+{
+	size_t count = std::min(keys.size(), values.size());
+	if (count < 2) return;
+
+	// All four digit histograms in one read of the keys
+	uint32_t counts[4][256] = {};
+	for (size_t i = 0; i < count; ++i)
+	{
+		uint32_t k = keys[i];
+		++counts[0][k & 0xFF];
+		++counts[1][(k >> 8) & 0xFF];
+		++counts[2][(k >> 16) & 0xFF];
+		++counts[3][k >> 24];
+	}
+
+	scratch.resize(count * 2);
+	uint32_t* srcKeys = keys.data();
+	uint32_t* srcValues = values.data();
+	uint32_t* dstKeys = scratch.data();
+	uint32_t* dstValues = scratch.data() + count;
+
+	for (uint32_t digit = 0; digit < 4; ++digit)
+	{
+		// Every key has the same digit: this pass would not move anything
+		uint32_t shift = digit * 8;
+		if (counts[digit][(srcKeys[0] >> shift) & 0xFF] == count) continue;
+
+		uint32_t offsets[256];
+		uint32_t sum = 0;
+		for (uint32_t b = 0; b < 256; ++b)
+		{
+			offsets[b] = sum;
+			sum += counts[digit][b];
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint32_t o = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+			dstKeys[o] = srcKeys[i];
+			dstValues[o] = srcValues[i];
+		}
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcValues, dstValues);
+	}
+
+	// An odd number of passes leaves the result in scratch
+	if (srcKeys != keys.data())
+	{
+		std::memcpy(keys.data(), srcKeys, count * sizeof(uint32_t));
+		std::memcpy(values.data(), srcValues, count * sizeof(uint32_t));
+	}
+}
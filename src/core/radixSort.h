@@ -0,0 +1,28 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// =============================================================================
+// Radix sort
+// =============================================================================
+
+// Sorts keys in ascending order and moves values[i] along with keys[i].
+// Least-significant-digit radix sort over 8-bit digits: four counting
+// passes at most, and digits every key shares are skipped. Stable, so
+// equal keys keep their order. scratch is resized to hold one copy of both
+// arrays and can be reused between calls.
+void radix_sort(std::span<uint32_t> keys, std::span<uint32_t> values,
+				std::vector<uint32_t>& scratch);
+
+// Maps a float to a key that sorts in the same order as the float (for
+// non-NaN values, with -0 before +0)
+inline uint32_t float_sort_key(float f)
+{
+	auto bits = std::bit_cast<uint32_t>(f);
+	// Negative floats sort backwards as integers: flip all their bits.
+	// Positive ones only need to land above them.
+	return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
@@ -0,0 +1,88 @@
+#include "threadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	workers_.reserve(threadCount - 1);
+	for (uint32_t i = 1; i < threadCount; ++i)
+		workers_.emplace_back([this] { worker_main(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::parallel_for(
+	uint32_t count, uint32_t minChunk,
+	const std::function<void(uint32_t, uint32_t)>& fn)
+{
+	if (count == 0) return;
+
+	// A few chunks per thread balance uneven work without much contention
+	uint32_t threads = thread_count();
+	uint32_t chunkSize =
+		std::max({minChunk, 1u, (count + threads * 4 - 1) / (threads * 4)});
+	if (workers_.empty() || chunkSize >= count)
+	{
+		fn(0, count);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		fn_ = &fn;
+		count_ = count;
+		chunkSize_ = chunkSize;
+		chunkCount_ = (count + chunkSize - 1) / chunkSize;
+		nextChunk_.store(0, std::memory_order_relaxed);
+		activeWorkers_ = static_cast<uint32_t>(workers_.size());
+		++generation_;
+	}
+	wake_.notify_all();
+
+	run_chunks();
+
+	// Workers still holding fn_ must leave the loop before it goes away
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] { return activeWorkers_ == 0; });
+	fn_ = nullptr;
+}
+
+void ThreadPool::worker_main()
+{
+	uint64_t seen = 0;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+			if (stop_) return;
+			seen = generation_;
+		}
+
+		run_chunks();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (--activeWorkers_ == 0) done_.notify_one();
+	}
+}
+
+void ThreadPool::run_chunks()
+{
+	for (;;)
+	{
+		uint32_t chunk = nextChunk_.fetch_add(1, std::memory_order_relaxed);
+		if (chunk >= chunkCount_) return;
+		uint32_t begin = chunk * chunkSize_;
+		uint32_t end = std::min(begin + chunkSize_, count_);
+		(*fn_)(begin, end);
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// =============================================================================
+// Thread pool
+// =============================================================================
+
+// Fixed set of worker threads for data-parallel loops. The calling thread
+// takes part in every loop, so a pool of N threads starts N - 1 workers and
+// a pool of 1 runs everything inline. One loop runs at a time.
+struct ThreadPool
+{
+	explicit ThreadPool(uint32_t threadCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	uint32_t thread_count() const
+	{
+		return static_cast<uint32_t>(workers_.size()) + 1;
+	}
+
+	// Calls fn(begin, end) over [0, count) in chunks of at least minChunk
+	// items and returns once all of them have run
+	void parallel_for(uint32_t count, uint32_t minChunk,
+					  const std::function<void(uint32_t, uint32_t)>& fn);
+
+   private:
+	std::vector<std::thread> workers_;
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	bool stop_ = false;
+	uint64_t generation_ = 0;  // bumped for every loop
+
+	// Current loop
+	const std::function<void(uint32_t, uint32_t)>* fn_ = nullptr;
+	uint32_t count_ = 0;
+	uint32_t chunkSize_ = 0;
+	uint32_t chunkCount_ = 0;
+	std::atomic<uint32_t> nextChunk_{0};
+	uint32_t activeWorkers_ = 0;  // still inside the current loop
+
+	void worker_main();
+	void run_chunks();
+};
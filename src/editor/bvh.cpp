@@ -0,0 +1,540 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "sceneGraph.h"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define BVH_SSE 1
+#endif
+
+static constexpr uint32_t NO_NODE = UINT32_MAX;
+static constexpr uint32_t MAX_DEPTH = 64;
+static constexpr float DET_EPSILON = 1e-12f;
+
+// =============================================================================
+// Shared helpers
+// =============================================================================
+
+BvhRay::BvhRay(const glm::vec3& o, const glm::vec3& d)
+{
+	for (int i = 0; i < 3; ++i)
+	{
+		origin[i] = o[i];
+		direction[i] = d[i];
+		// An axis-parallel ray gets an infinite slope, which the slab test
+		// turns into an unbounded interval on that axis
+		invDirection[i] = 1.0f / d[i];
+	}
+	origin[3] = direction[3] = invDirection[3] = 0.0f;
+}
+
+// Slab test. On a hit, tNear is where the ray enters the box (0 if it
+// starts inside).
+static bool ray_box(const BvhNode& box, const BvhRay& ray, float tMax,
+					float& tNear)
+{
+#ifdef BVH_SSE
+	// Lane 3 holds first/count and is left out of the reductions
+	__m128 o = _mm_load_ps(ray.origin);
+	__m128 inv = _mm_load_ps(ray.invDirection);
+	__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&box.min.x), o), inv);
+	__m128 t2 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&box.max.x), o), inv);
+	__m128 lo = _mm_min_ps(t1, t2);
+	__m128 hi = _mm_max_ps(t1, t2);
+	__m128 enter = _mm_max_ss(
+		_mm_max_ss(lo, _mm_shuffle_ps(lo, lo, _MM_SHUFFLE(1, 1, 1, 1))),
+		_mm_shuffle_ps(lo, lo, _MM_SHUFFLE(2, 2, 2, 2)));
+	__m128 exit = _mm_min_ss(
+		_mm_min_ss(hi, _mm_shuffle_ps(hi, hi, _MM_SHUFFLE(1, 1, 1, 1))),
+		_mm_shuffle_ps(hi, hi, _MM_SHUFFLE(2, 2, 2, 2)));
+	float tEnter = std::max(_mm_cvtss_f32(enter), 0.0f);
+	float tExit = std::min(_mm_cvtss_f32(exit), tMax);
+#else
+	float tEnter = 0.0f;
+	float tExit = tMax;
+	for (int i = 0; i < 3; ++i)
+	{
+		float t1 = (box.min[i] - ray.origin[i]) * ray.invDirection[i];
+		float t2 = (box.max[i] - ray.origin[i]) * ray.invDirection[i];
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2));
+	}
+#endif
+	tNear = tEnter;
+	return tEnter <= tExit;
+}
+
+// Median split on the longest centroid axis until every leaf holds at most
+// maxLeaf items. Reorders `items`; leaves point into it with first/count.
+static void build_nodes(std::vector<BvhNode>& nodes,
+						std::vector<uint32_t>& items,
+						const std::vector<AABB>& boxes, uint32_t maxLeaf)
+{
+	nodes.clear();
+	if (items.empty()) return;
+
+	std::vector<glm::vec3> centers(boxes.size());
+	for (size_t i = 0; i < boxes.size(); ++i)
+		centers[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+
+	struct Task
+	{
+		uint32_t node, begin, end;
+	};
+	nodes.reserve(2 * items.size() / maxLeaf + 1);
+	nodes.emplace_back();
+	std::vector<Task> stack{{0, 0, static_cast<uint32_t>(items.size())}};
+	while (!stack.empty())
+	{
+		Task task = stack.back();
+		stack.pop_back();
+
+		AABB bounds, centroids;
+		for (uint32_t i = task.begin; i < task.end; ++i)
+		{
+			bounds.expand(boxes[items[i]].min);
+			bounds.expand(boxes[items[i]].max);
+			centroids.expand(centers[items[i]]);
+		}
+		nodes[task.node].min = bounds.min;
+		nodes[task.node].max = bounds.max;
+
+		uint32_t count = task.end - task.begin;
+		if (count <= maxLeaf)
+		{
+			nodes[task.node].first = task.begin;
+			nodes[task.node].count = count;
+			continue;
+		}
+
+		glm::vec3 extent = centroids.max - centroids.min;
+		int axis = extent.y > extent.x ? 1 : 0;
+		if (extent.z > extent[axis]) axis = 2;
+		uint32_t mid = task.begin + count / 2;
+		std::nth_element(items.begin() + task.begin, items.begin() + mid,
+						 items.begin() + task.end,
+						 [&](uint32_t a, uint32_t b)
+						 { return centers[a][axis] < centers[b][axis]; });
+
+		auto left = static_cast<uint32_t>(nodes.size());
+		nodes.emplace_back();
+		nodes.emplace_back();
+		nodes[task.node].first = left;
+		nodes[task.node].count = 0;
+		stack.push_back({left + 1, mid, task.end});
+		stack.push_back({left, task.begin, mid});
+	}
+}
+
+// Walks the tree front to back, calling visitLeaf(node, tMax) for every
+// leaf the ray reaches before tMax; visitLeaf may lower tMax.
+template <typename VisitLeaf>
+static void traverse(const std::vector<BvhNode>& nodes, const BvhRay& ray,
+					 float& tMax, VisitLeaf&& visitLeaf)
+{
+	float tNear = 0.0f;
+	if (nodes.empty() || !ray_box(nodes[0], ray, tMax, tNear)) return;
+
+	uint32_t stack[MAX_DEPTH];
+	float stackNear[MAX_DEPTH];
+	uint32_t depth = 0;
+	uint32_t index = 0;
+	for (;;)
+	{
+		const BvhNode& node = nodes[index];
+		if (node.count == 0)
+		{
+			uint32_t a = node.first;
+			uint32_t b = node.first + 1;
+			float tA = 0.0f, tB = 0.0f;
+			bool hitA = ray_box(nodes[a], ray, tMax, tA);
+			bool hitB = ray_box(nodes[b], ray, tMax, tB);
+			if (hitA && hitB)
+			{
+				// Nearer child first; the other waits on the stack
+				if (tB < tA)
+				{
+					std::swap(a, b);
+					std::swap(tA, tB);
+				}
+				stack[depth] = b;
+				stackNear[depth] = tB;
+				++depth;
+				index = a;
+				continue;
+			}
+			if (hitA || hitB)
+			{
+				index = hitA ? a : b;
+				continue;
+			}
+		}
+		else
+		{
+			visitLeaf(node, tMax);
+		}
+
+		// Pop the next subtree that is still closer than the nearest hit
+		bool found = false;
+		while (depth > 0 && !found)
+		{
+			--depth;
+			if (stackNear[depth] <= tMax)
+			{
+				index = stack[depth];
+				found = true;
+			}
+		}
+		if (!found) return;
+	}
+}
+
+// =============================================================================
+// MeshBvh
+// =============================================================================
+
+void MeshBvh::build(const std::vector<Vertex>& vertices,
+					const std::vector<uint32_t>& indices)
+{
+	nodes_.clear();
+	packets_.clear();
+
+	auto triCount = static_cast<uint32_t>(indices.size() / 3);
+	std::vector<AABB> boxes;
+	std::vector<uint32_t> items;
+	boxes.reserve(triCount);
+	items.reserve(triCount);
+	for (uint32_t t = 0; t < triCount; ++t)
+	{
+		AABB box;
+		bool valid = true;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = indices[t * 3 + k];
+			if (v >= vertices.size())
+				valid = false;
+			else
+				box.expand(vertices[v].pos);
+		}
+		boxes.push_back(box);
+		if (valid) items.push_back(t);
+	}
+
+	build_nodes(nodes_, items, boxes, LEAF_TRIANGLES);
+
+	// Each leaf's triangles become one packet; unused lanes stay zero,
+	// which makes them degenerate and never hit
+	for (auto& node : nodes_)
+	{
+		if (node.count == 0) continue;
+		TrianglePacket packet{};
+		for (uint32_t lane = 0; lane < node.count; ++lane)
+		{
+			uint32_t t = items[node.first + lane];
+			const glm::vec3& v0 = vertices[indices[t * 3 + 0]].pos;
+			const glm::vec3& v1 = vertices[indices[t * 3 + 1]].pos;
+			const glm::vec3& v2 = vertices[indices[t * 3 + 2]].pos;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				packet.v0[axis][lane] = v0[axis];
+				packet.e1[axis][lane] = v1[axis] - v0[axis];
+				packet.e2[axis][lane] = v2[axis] - v0[axis];
+			}
+		}
+		node.first = static_cast<uint32_t>(packets_.size());
+		packets_.push_back(packet);
+	}
+}
+
+// Moller-Trumbore against the four triangles of a packet. Returns a mask of
+// the lanes hit in [0, tMax), with their distances in t.
+int MeshBvh::intersect_packet(const TrianglePacket& p, const BvhRay& ray,
+							  float tMax, float* t)
+{
+#ifdef BVH_SSE
+	auto dot = [](__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by,
+				  __m128 bz)
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+						  _mm_mul_ps(az, bz));
+	};
+	auto cross = [](__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by,
+					__m128 bz, __m128& cx, __m128& cy, __m128& cz)
+	{
+		cx = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+		cy = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+		cz = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+	};
+
+	__m128 dx = _mm_set1_ps(ray.direction[0]);
+	__m128 dy = _mm_set1_ps(ray.direction[1]);
+	__m128 dz = _mm_set1_ps(ray.direction[2]);
+	__m128 e1x = _mm_load_ps(p.e1[0]);
+	__m128 e1y = _mm_load_ps(p.e1[1]);
+	__m128 e1z = _mm_load_ps(p.e1[2]);
+	__m128 e2x = _mm_load_ps(p.e2[0]);
+	__m128 e2y = _mm_load_ps(p.e2[1]);
+	__m128 e2z = _mm_load_ps(p.e2[2]);
+
+	__m128 px, py, pz;
+	cross(dx, dy, dz, e2x, e2y, e2z, px, py, pz);
+	__m128 det = dot(e1x, e1y, e1z, px, py, pz);
+	__m128 zero = _mm_setzero_ps();
+	__m128 absDet = _mm_max_ps(det, _mm_sub_ps(zero, det));
+	__m128 hit = _mm_cmpgt_ps(absDet, _mm_set1_ps(DET_EPSILON));
+	__m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+	__m128 tx = _mm_sub_ps(_mm_set1_ps(ray.origin[0]), _mm_load_ps(p.v0[0]));
+	__m128 ty = _mm_sub_ps(_mm_set1_ps(ray.origin[1]), _mm_load_ps(p.v0[1]));
+	__m128 tz = _mm_sub_ps(_mm_set1_ps(ray.origin[2]), _mm_load_ps(p.v0[2]));
+	__m128 u = _mm_mul_ps(dot(tx, ty, tz, px, py, pz), invDet);
+	__m128 qx, qy, qz;
+	cross(tx, ty, tz, e1x, e1y, e1z, qx, qy, qz);
+	__m128 v = _mm_mul_ps(dot(dx, dy, dz, qx, qy, qz), invDet);
+	__m128 dist = _mm_mul_ps(dot(e2x, e2y, e2z, qx, qy, qz), invDet);
+
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.0f)));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(dist, zero));
+	hit = _mm_and_ps(hit, _mm_cmplt_ps(dist, _mm_set1_ps(tMax)));
+	_mm_storeu_ps(t, dist);
+	return _mm_movemask_ps(hit);
+#else
+	glm::vec3 o(ray.origin[0], ray.origin[1], ray.origin[2]);
+	glm::vec3 d(ray.direction[0], ray.direction[1], ray.direction[2]);
+	int mask = 0;
+	for (uint32_t i = 0; i < LEAF_TRIANGLES; ++i)
+	{
+		glm::vec3 e1(p.e1[0][i], p.e1[1][i], p.e1[2][i]);
+		glm::vec3 e2(p.e2[0][i], p.e2[1][i], p.e2[2][i]);
+		glm::vec3 pv = glm::cross(d, e2);
+		float det = glm::dot(e1, pv);
+		if (std::abs(det) <= DET_EPSILON) continue;
+
+		float invDet = 1.0f / det;
+		glm::vec3 tv = o - glm::vec3(p.v0[0][i], p.v0[1][i], p.v0[2][i]);
+		float u = glm::dot(tv, pv) * invDet;
+		glm::vec3 qv = glm::cross(tv, e1);
+		float v = glm::dot(d, qv) * invDet;
+		t[i] = glm::dot(e2, qv) * invDet;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t[i] >= 0.0f &&
+			t[i] < tMax)
+			mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+bool MeshBvh::intersect(const BvhRay& ray, float& tMax) const
+{
+	bool hit = false;
+	traverse(nodes_, ray, tMax,
+			 [&](const BvhNode& leaf, float& tLimit)
+			 {
+				 float t[LEAF_TRIANGLES];
+				 int mask =
+					 intersect_packet(packets_[leaf.first], ray, tLimit, t);
+				 for (uint32_t i = 0; i < LEAF_TRIANGLES; ++i)
+				 {
+					 if ((mask >> i) & 1 && t[i] < tLimit)
+					 {
+						 tLimit = t[i];
+						 hit = true;
+					 }
+				 }
+			 });
+	return hit;
+}
+
+// =============================================================================
+// SceneBvh
+// =============================================================================
+
+// World AABB of a transformed local box (Arvo): the center moves with the
+// transform, the half extent through its absolute linear part
+static AABB world_bounds(const AABB& local, const glm::mat4& world)
+{
+	glm::vec3 center = (local.min + local.max) * 0.5f;
+	glm::vec3 half = (local.max - local.min) * 0.5f;
+	glm::vec3 c = glm::vec3(world * glm::vec4(center, 1.0f));
+	glm::vec3 e = glm::abs(glm::vec3(world[0])) * half.x +
+				  glm::abs(glm::vec3(world[1])) * half.y +
+				  glm::abs(glm::vec3(world[2])) * half.z;
+	AABB box;
+	box.min = c - e;
+	box.max = c + e;
+	return box;
+}
+
+void SceneBvh::build(const SceneGraph& graph, const std::vector<Mesh>& meshes)
+{
+	leaves_.clear();
+	nodeLeaves_.assign(graph.nodes.size(), NO_NODE);
+
+	std::vector<AABB> boxes;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(graph.nodes.size()); ++i)
+	{
+		const auto& node = graph.nodes[i];
+		if (!node.meshIndex.has_value()) continue;
+		uint32_t mi = node.meshIndex.value();
+		if (mi >= meshes.size()) continue;
+		const AABB& bounds = meshes[mi].localBounds;
+		if (bounds.min.x > bounds.max.x) continue;	// no vertices
+
+		const glm::mat4& world = graph.world_transform(i);
+		leaves_.push_back({i, mi, bounds, world, glm::inverse(world)});
+		boxes.push_back(world_bounds(bounds, world));
+	}
+
+	std::vector<uint32_t> items(leaves_.size());
+	for (uint32_t i = 0; i < items.size(); ++i) items[i] = i;
+	build_nodes(nodes_, items, boxes, 1);
+
+	// One scene node per leaf: point leaves at leaves_ and link parents
+	parents_.assign(nodes_.size(), NO_NODE);
+	for (uint32_t n = 0; n < static_cast<uint32_t>(nodes_.size()); ++n)
+	{
+		BvhNode& node = nodes_[n];
+		if (node.count == 0)
+		{
+			parents_[node.first] = n;
+			parents_[node.first + 1] = n;
+		}
+		else
+		{
+			node.first = items[node.first];
+			nodeLeaves_[leaves_[node.first].node] = n;
+		}
+	}
+}
+
+void SceneBvh::refit(uint32_t nodeIdx, const SceneGraph& graph)
+{
+	if (nodeIdx >= nodeLeaves_.size() || nodeLeaves_[nodeIdx] == NO_NODE)
+		return;
+
+	uint32_t n = nodeLeaves_[nodeIdx];
+	Leaf& leaf = leaves_[nodes_[n].first];
+	const glm::mat4& world = graph.world_transform(nodeIdx);
+	leaf.world = world;
+	leaf.invWorld = glm::inverse(world);
+	AABB box = world_bounds(leaf.localBounds, world);
+	nodes_[n].min = box.min;
+	nodes_[n].max = box.max;
+
+	// Grow or shrink every box above it
+	for (uint32_t p = parents_[n]; p != NO_NODE; p = parents_[p])
+	{
+		const BvhNode& a = nodes_[nodes_[p].first];
+		const BvhNode& b = nodes_[nodes_[p].first + 1];
+		nodes_[p].min = glm::min(a.min, b.min);
+		nodes_[p].max = glm::max(a.max, b.max);
+	}
+}
+
+std::optional<SceneBvh::Hit> SceneBvh::intersect(
+	const glm::vec3& origin, const glm::vec3& direction,
+	const std::vector<MeshBvh>& meshBvhs) const
+{
+	std::optional<Hit> hit;
+	float tMax = std::numeric_limits<float>::max();
+	BvhRay ray(origin, direction);
+	traverse(
+		nodes_, ray, tMax,
+		[&](const BvhNode& node, float& tLimit)
+		{
+			const Leaf& leaf = leaves_[node.first];
+			// Same t in mesh space: the direction is transformed, not
+			// renormalized
+			BvhRay local(glm::vec3(leaf.invWorld * glm::vec4(origin, 1.0f)),
+						 glm::vec3(leaf.invWorld * glm::vec4(direction, 0.0f)));
+
+			if (leaf.mesh < meshBvhs.size() && !meshBvhs[leaf.mesh].empty())
+			{
+				if (meshBvhs[leaf.mesh].intersect(local, tLimit))
+					hit = Hit{leaf.node, tLimit};
+				return;
+			}
+
+			BvhNode box{leaf.localBounds.min, 0, leaf.localBounds.max, 0};
+			float t = 0.0f;
+			if (ray_box(box, local, tLimit, t) && t < tLimit)
+			{
+				tLimit = t;
+				hit = Hit{leaf.node, t};
+			}
+		});
+	return hit;
+}
+
+// Box against the volume: -1 outside a plane, 1 inside all, 0 straddling
+static int classify(const glm::vec3& min, const glm::vec3& max,
+					const BvhFrustum& frustum)
+{
+	int result = 1;
+	for (uint32_t i = 0; i < frustum.planeCount; ++i)
+	{
+		const glm::vec4& p = frustum.planes[i];
+		glm::vec3 n(p);
+		// Corners farthest along and against the normal
+		glm::vec3 far(n.x >= 0.0f ? max.x : min.x, n.y >= 0.0f ? max.y : min.y,
+					  n.z >= 0.0f ? max.z : min.z);
+		glm::vec3 near(n.x >= 0.0f ? min.x : max.x,
+					   n.y >= 0.0f ? min.y : max.y,
+					   n.z >= 0.0f ? min.z : max.z);
+		if (glm::dot(n, far) + p.w < 0.0f) return -1;
+		if (glm::dot(n, near) + p.w < 0.0f) result = 0;
+	}
+	return result;
+}
+
+void SceneBvh::query(const BvhFrustum& frustum,
+					 std::vector<uint32_t>& out) const
+{
+	if (nodes_.empty()) return;
+
+	struct Entry
+	{
+		uint32_t node;
+		bool inside;  // an ancestor was entirely inside
+	};
+	std::vector<Entry> stack{{0, false}};
+	while (!stack.empty())
+	{
+		Entry e = stack.back();
+		stack.pop_back();
+		const BvhNode& node = nodes_[e.node];
+
+		int side = e.inside ? 1 : classify(node.min, node.max, frustum);
+		if (side < 0) continue;
+
+		if (node.count == 0)
+		{
+			stack.push_back({node.first, side > 0});
+			stack.push_back({node.first + 1, side > 0});
+			continue;
+		}
+
+		const Leaf& leaf = leaves_[node.first];
+		if (side == 0)
+		{
+			// The world box is loose for rotated meshes; test the oriented
+			// box with the planes taken to mesh space
+			BvhFrustum local;
+			local.planeCount = frustum.planeCount;
+			for (uint32_t i = 0; i < frustum.planeCount; ++i)
+				for (int c = 0; c < 4; ++c)
+					local.planes[i][c] =
+						glm::dot(leaf.world[c], frustum.planes[i]);
+			if (classify(leaf.localBounds.min, leaf.localBounds.max, local) <
+				0)
+				continue;
+		}
+		out.push_back(leaf.node);
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <optional>
+#include <vector>
+
+#include "graphics/mesh.h"
+
+struct SceneGraph;
+
+// =============================================================================
+// Bounding volume hierarchies for picking
+// =============================================================================
+
+// Node of a binary BVH. Leaves have count > 0; an inner node keeps its two
+// children at `first` and `first + 1`. The layout lets a box load as two
+// 4-wide vectors.
+struct BvhNode
+{
+	glm::vec3 min;
+	uint32_t first = 0;
+	glm::vec3 max;
+	uint32_t count = 0;
+};
+
+// Ray with its reciprocal direction precomputed for slab tests. Distances
+// are in units of `direction`, which need not be normalized, so a hit
+// distance is the same in world and mesh space.
+struct BvhRay
+{
+	BvhRay(const glm::vec3& origin, const glm::vec3& direction);
+
+	alignas(16) float origin[4];
+	alignas(16) float direction[4];
+	alignas(16) float invDirection[4];
+};
+
+// Convex volume bounded by inward-facing planes (xyz = normal, w = offset):
+// p is inside when dot(xyz, p) + w >= 0 for every plane
+struct BvhFrustum
+{
+	static constexpr uint32_t MAX_PLANES = 6;
+	glm::vec4 planes[MAX_PLANES];
+	uint32_t planeCount = 0;
+};
+
+// Bottom level: triangle BVH of one mesh, built from its CPU vertices and
+// indices. Each leaf holds up to four triangles as one structure-of-arrays
+// packet, tested against the ray in a single SIMD pass.
+struct MeshBvh
+{
+	static constexpr uint32_t LEAF_TRIANGLES = 4;
+
+	void build(const std::vector<Vertex>& vertices,
+			   const std::vector<uint32_t>& indices);
+	bool empty() const { return nodes_.empty(); }
+
+	// Nearest triangle closer than tMax (either facing); lowers tMax to it
+	bool intersect(const BvhRay& ray, float& tMax) const;
+
+   private:
+	struct TrianglePacket
+	{
+		alignas(16) float v0[3][LEAF_TRIANGLES];
+		alignas(16) float e1[3][LEAF_TRIANGLES];
+		alignas(16) float e2[3][LEAF_TRIANGLES];
+	};
+	std::vector<BvhNode> nodes_;
+	std::vector<TrianglePacket> packets_;  // one per leaf, at node.first
+
+	static int intersect_packet(const TrianglePacket& packet,
+								const BvhRay& ray, float tMax, float* t);
+};
+
+// Top level: BVH over the world bounds of the scene's mesh nodes. Moving
+// nodes only refits the boxes above them; build() again when nodes or
+// meshes are added or removed. Meshes without CPU triangles (or an empty
+// MeshBvh) are hit on their local AABB instead.
+struct SceneBvh
+{
+	struct Hit
+	{
+		uint32_t node;
+		float t;  // along the ray passed to intersect()
+	};
+
+	void build(const SceneGraph& graph, const std::vector<Mesh>& meshes);
+	// Call for a moved node (each node of a moved subtree)
+	void refit(uint32_t nodeIdx, const SceneGraph& graph);
+
+	std::optional<Hit> intersect(const glm::vec3& origin,
+								 const glm::vec3& direction,
+								 const std::vector<MeshBvh>& meshBvhs) const;
+
+	// Appends the scene nodes whose (oriented) bounds reach into the
+	// volume. Subtrees entirely inside are taken without testing them.
+	void query(const BvhFrustum& frustum, std::vector<uint32_t>& out) const;
+
+   private:
+	struct Leaf
+	{
+		uint32_t node;
+		uint32_t mesh;
+		AABB localBounds;
+		glm::mat4 world;
+		glm::mat4 invWorld;	 // world -> mesh space, cached per refit
+	};
+	std::vector<BvhNode> nodes_;
+	std::vector<uint32_t> parents_;	 // per BVH node, UINT32_MAX at the root
+	std::vector<Leaf> leaves_;		 // a leaf node's `first`
+	std::vector<uint32_t> nodeLeaves_;	// scene node -> BVH leaf node
+};
@@ -5,10 +5,12 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <string>
 
 #include "editor/gizmo.h"
 #include "editor/sceneGraph.h"
 #include "editor/selection.h"
+#include "graphics/framePacer.h"
 #include "graphics/light.h"
 #include "graphics/renderer.h"
 
@@ -17,8 +19,7 @@ static void draw_node_tree(SceneGraph& sceneGraph, uint32_t nodeIdx,
 						   Selection& selection)
 {
 	auto& node = sceneGraph.nodes[nodeIdx];
-	bool isSelected = selection.selectedNode.has_value() &&
-					  selection.selectedNode.value() == nodeIdx;
+	bool isSelected = selection.is_selected(nodeIdx);
 	bool hasChildren = !node.children.empty();
 
 	ImGuiTreeNodeFlags flags =
@@ -31,7 +32,13 @@ static void draw_node_tree(SceneGraph& sceneGraph, uint32_t nodeIdx,
 		node.name.c_str());
 
 	if (ImGui::IsItemClicked() && !ImGui::IsItemToggledOpen())
-		selection.selectedNode = nodeIdx;
+	{
+		const ImGuiIO& io = ImGui::GetIO();
+		Selection::Mode mode = io.KeyCtrl	 ? Selection::Mode::Toggle
+							   : io.KeyShift ? Selection::Mode::Add
+											 : Selection::Mode::Replace;
+		selection.select(nodeIdx, mode);
+	}
 
 	if (open)
 	{
@@ -41,9 +48,37 @@ static void draw_node_tree(SceneGraph& sceneGraph, uint32_t nodeIdx,
 	}
 }
 
-void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
-					   Selection& selection, Gizmo& gizmo,
-					   SceneGraph& sceneGraph)
+// Picks the clip an animation set plays; "(rest)" stops it at the rest pose
+static void draw_clip_combo(AnimationSet& set, size_t setIdx)
+{
+	if (set.clips.empty()) return;
+	auto clip_name = [&](int32_t c)
+	{
+		const std::string& name = set.clips[c].name;
+		return name.empty() ? "Clip " + std::to_string(c) : name;
+	};
+
+	std::string label = "Set " + std::to_string(setIdx);
+	std::string current = set.clip >= 0 ? clip_name(set.clip) : "(rest)";
+	if (!ImGui::BeginCombo(label.c_str(), current.c_str())) return;
+	for (int32_t c = -1; c < static_cast<int32_t>(set.clips.size()); ++c)
+	{
+		std::string name = c >= 0 ? clip_name(c) : "(rest)";
+		ImGui::PushID(c);
+		if (ImGui::Selectable(name.c_str(), c == set.clip) && c != set.clip)
+		{
+			set.clip = c;
+			set.time = 0.0f;
+			set.sample();
+		}
+		ImGui::PopID();
+	}
+	ImGui::EndCombo();
+}
+
+void DebugWindow::draw(Renderer& renderer, FramePacer& framePacer,
+					   LightEnvironment& lights, Selection& selection,
+					   Gizmo& gizmo, SceneGraph& sceneGraph)
 {
 	ImGuiIO& io = ImGui::GetIO();
 	VkExtent2D extent = renderer.swapchain_extent();
@@ -54,17 +89,183 @@ void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
 	ImGui::Begin("Frame Statistics");
 	ImGui::Text("FPS:        %.1f", io.Framerate);
 	ImGui::Text("Frame Time: %.3f ms", 1000.0f / io.Framerate);
+
+	const GpuProfiler& profiler = renderer.gpu_profiler();
+	if (profiler.supported())
+	{
+		const auto& timings = profiler.latest();
+		ImGui::Text("GPU Time:   %.3f ms", timings.frameMs);
+		for (const auto& scope : timings.scopes)
+			ImGui::Text("  %-14s %.3f ms%s", scope.name, scope.durationMs,
+						scope.async ? " (async)" : "");
+		if (renderer.asyncCompute_)
+			ImGui::Text("  Async overlap  %.3f ms", timings.asyncOverlapMs);
+	}
+	ImGui::Text("Latency:    %.2f ms (%s)", renderer.latency_ms(),
+				renderer.present_wait_enabled() ? "to present" : "to GPU done");
+	ImGui::Text("Jitter:     %.3f ms", framePacer.jitter_ms());
+
+	const RenderGraph::Stats& graph = renderer.render_graph_stats();
+	ImGui::Text("Passes:     %u (%u culled)", graph.passes,
+				graph.culledPasses);
+	ImGui::Text("Barriers:   %u in %u batches", graph.barriers,
+				graph.barrierBatches);
+	ImGui::Text("Transients: %.1f MB (%.1f MB unaliased)",
+				graph.transientBytes / (1024.0 * 1024.0),
+				graph.transientRequestedBytes / (1024.0 * 1024.0));
+	ImGui::Separator();
+
+	// --- Frame pacing ---
+	static constexpr VkPresentModeKHR PRESENT_MODES[] = {
+		VK_PRESENT_MODE_FIFO_KHR,
+		VK_PRESENT_MODE_MAILBOX_KHR,
+		VK_PRESENT_MODE_IMMEDIATE_KHR,
+	};
+	static constexpr const char* PRESENT_MODE_NAMES[] = {
+		"FIFO (vsync)",
+		"Mailbox",
+		"Immediate",
+	};
+	int current = 0;
+	for (int i = 0; i < 3; ++i)
+		if (PRESENT_MODES[i] == renderer.present_mode()) current = i;
+	if (ImGui::BeginCombo("Present Mode", PRESENT_MODE_NAMES[current]))
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			// Unsupported modes would silently fall back to FIFO
+			if (!renderer.present_mode_supported(PRESENT_MODES[i])) continue;
+			if (ImGui::Selectable(PRESENT_MODE_NAMES[i], i == current))
+				renderer.set_present_mode(PRESENT_MODES[i]);
+		}
+		ImGui::EndCombo();
+	}
+
+	int framesInFlight = static_cast<int>(renderer.frames_in_flight());
+	if (ImGui::SliderInt("Frames in Flight", &framesInFlight, 1,
+						 Renderer::MAX_FRAMES_IN_FLIGHT))
+		renderer.set_frames_in_flight(static_cast<uint32_t>(framesInFlight));
+
+	ImGui::Checkbox("Low Latency", &renderer.lowLatencyMode_);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip(renderer.present_wait_enabled()
+							  ? "Waits for the previous present before "
+								"sampling input (VK_KHR_present_wait)"
+							  : "Waits for the frame fence before sampling "
+								"input (VK_KHR_present_wait unavailable)");
+	ImGui::DragFloat("FPS Limit", &framePacer.targetFps, 1.0f, 0.0f, 1000.0f,
+					 framePacer.targetFps > 0.0f ? "%.0f" : "off");
 	ImGui::Separator();
 	ImGui::Text("GPU: %s", renderer.gpu_name());
 	ImGui::Text("Resolution: %u x %u", extent.width, extent.height);
 
-	uint32_t tileX = (extent.width + 15) / 16;
-	uint32_t tileY = (extent.height + 15) / 16;
+	// Tiles follow the internal resolution
+	VkExtent2D renderExtent = renderer.render_extent();
+	if (renderer.dynamicResolution_)
+		ImGui::Text("Render:     %u x %u (%.0f%%)", renderExtent.width,
+					renderExtent.height,
+					renderer.resolutionScaler_.scale() * 100.0f);
+	uint32_t tileX = (renderExtent.width + 15) / 16;
+	uint32_t tileY = (renderExtent.height + 15) / 16;
 	ImGui::Text("Tiles: %u x %u (%u total)", tileX, tileY, tileX * tileY);
 	ImGui::Text("Total lights: %u", lights.total_light_count());
 	ImGui::Separator();
+	ImGui::Checkbox("Dynamic Resolution", &renderer.dynamicResolution_);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Renders below the output resolution to meet the "
+						  "GPU time target, upscaled with TAA");
+	if (renderer.dynamicResolution_)
+	{
+		ResolutionScaler& scaler = renderer.resolutionScaler_;
+		ImGui::DragFloat("GPU Target (ms)", &scaler.targetGpuMs, 0.1f, 1.0f,
+						 100.0f, "%.1f");
+		ImGui::SliderFloat("Min Scale", &scaler.minScale, 0.25f, 1.0f,
+						   "%.2f");
+	}
+	ImGui::Checkbox("Texture Streaming", &renderer.textureStreaming_);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Keeps only the mip levels on screen resident, "
+						  "within the budget");
+	if (renderer.textureStreaming_)
+	{
+		TextureResidency& residency = renderer.textureResidency_;
+		int budgetMb = static_cast<int>(residency.budgetBytes >> 20);
+		if (ImGui::DragInt("Budget (MB)", &budgetMb, 4.0f, 16, 16384))
+			residency.budgetBytes = static_cast<uint64_t>(budgetMb) << 20;
+	}
+	ImGui::Text("Texture memory: %.1f MB",
+				static_cast<double>(renderer.texture_memory()) /
+					(1024.0 * 1024.0));
+	if (renderer.skinned_vertex_count() > 0)
+		ImGui::Text("Skinning: %zu skin(s), %u joints, %u vertices",
+					renderer.skins().size(), renderer.joint_count(),
+					renderer.skinned_vertex_count());
+	const Renderer::MorphStats& morph = renderer.morph_stats();
+	if (morph.targets > 0)
+		ImGui::Text("Morph: %u/%u target(s), %u/%u deltas active",
+					morph.activeTargets, morph.targets, morph.activeDeltas,
+					morph.deltas);
+	const Renderer::TransparencyStats& transparency =
+		renderer.transparency_stats();
+	if (transparency.meshes > 0 &&
+		renderer.transparency_mode() == Renderer::TransparencyMode::Sorted)
+		ImGui::Text("Transparency: %u blended mesh(es), sorted in %.3f ms",
+					transparency.meshes, transparency.sortMs);
+	else if (transparency.meshes > 0)
+		ImGui::Text("Transparency: %u blended mesh(es), order-independent",
+					transparency.meshes);
+	if (!renderer.animations().empty())
+	{
+		const Renderer::AnimationStats& anim = renderer.animation_stats();
+		if (anim.nodes > 0)
+			ImGui::Text("Animation: %u node(s), %.3f ms (%.0f ns/node)",
+						anim.nodes, anim.cpuMs, anim.cpuMs * 1e6 / anim.nodes);
+		ImGui::Checkbox("Pause Animation", &renderer.animationPaused_);
+		ImGui::SliderFloat("Animation Speed", &renderer.animationSpeed_, 0.0f,
+						   4.0f, "%.2fx");
+		if (ImGui::TreeNode("Clips"))
+		{
+			auto& sets = renderer.animations();
+			for (size_t i = 0; i < sets.size(); ++i)
+				draw_clip_combo(sets[i], i);
+			ImGui::TreePop();
+		}
+	}
 	ImGui::Checkbox("Show Tile Heatmap", &renderer.showHeatmap_);
 	ImGui::Checkbox("Show Light Wireframes", &renderer.showDebugLines_);
+	ImGui::BeginDisabled(!renderer.async_compute_supported());
+	ImGui::Checkbox("Async Light Culling", &renderer.asyncCompute_);
+	ImGui::EndDisabled();
+	if (!renderer.async_compute_supported() &&
+		ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+		ImGui::SetTooltip("No dedicated compute queue on this GPU");
+	ImGui::Checkbox("GPU Picking", &renderer.gpuPicking_);
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("Picks from an object ID buffer written by the "
+						  "depth prepass instead of ray casting");
+
+	// Compare the Transparent scope with OIT accumulate + OIT resolve
+	static constexpr const char* TRANSPARENCY_NAMES[] = {
+		"Sorted",
+		"Weighted OIT",
+		"Linked-list OIT",
+	};
+	int mode = static_cast<int>(renderer.transparencyMode_);
+	if (ImGui::BeginCombo("Transparency", TRANSPARENCY_NAMES[mode]))
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			auto m = static_cast<Renderer::TransparencyMode>(i);
+			if (!renderer.transparency_mode_supported(m)) continue;
+			if (ImGui::Selectable(TRANSPARENCY_NAMES[i], i == mode))
+				renderer.transparencyMode_ = m;
+		}
+		ImGui::EndCombo();
+	}
+	if (ImGui::IsItemHovered())
+		ImGui::SetTooltip("How blended materials are composited. The "
+						  "linked lists are exact but memory hungry, for "
+						  "checking weighted OIT.");
 	ImGui::Separator();
 	ImGui::Text("WASD + Space/Ctrl: move");
 	ImGui::Text("Right-click + drag: look");
@@ -196,7 +397,7 @@ void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
 
 	if (ImGui::Button("Import Mesh...")) importRequested = true;
 
-	if (selection.selectedNode.has_value())
+	if (!selection.selectedNodes.empty())
 	{
 		ImGui::SameLine();
 		if (ImGui::Button("Delete")) deleteRequested = true;
@@ -215,9 +416,14 @@ void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
 		if (nodeIdx < sceneGraph.nodes.size())
 		{
 			auto& node = sceneGraph.nodes[nodeIdx];
-			ImGui::Text("Selected: %s", node.name.c_str());
+			size_t others = selection.selectedNodes.size() - 1;
+			if (others > 0)
+				ImGui::Text("Selected: %s (+%zu more)", node.name.c_str(),
+							others);
+			else
+				ImGui::Text("Selected: %s", node.name.c_str());
 
-			if (ImGui::Button("Deselect")) selection.selectedNode.reset();
+			if (ImGui::Button("Deselect")) selection.clear();
 
 			ImGui::Separator();
 
@@ -263,8 +469,8 @@ void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
 			ImGui::Separator();
 			float matrixTranslation[3], matrixRotation[3], matrixScale[3];
 			ImGuizmo::DecomposeMatrixToComponents(
-				glm::value_ptr(node.localTransform), matrixTranslation,
-				matrixRotation, matrixScale);
+				glm::value_ptr(sceneGraph.local_transform(nodeIdx)),
+				matrixTranslation, matrixRotation, matrixScale);
 			ImGui::Text("Position: %.2f, %.2f, %.2f", matrixTranslation[0],
 						matrixTranslation[1], matrixTranslation[2]);
 			ImGui::Text("Rotation: %.1f, %.1f, %.1f", matrixRotation[0],
@@ -277,6 +483,7 @@ void DebugWindow::draw(Renderer& renderer, LightEnvironment& lights,
 	{
 		ImGui::Text("No node selected");
 		ImGui::Text("Left-click to select a mesh");
+		ImGui::Text("Drag for a box, Alt+drag for a lasso");
 	}
 
 	ImGui::End();
@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.h>
 
 struct Renderer;
+struct FramePacer;
 struct LightEnvironment;
 struct Selection;
 struct Gizmo;
@@ -10,8 +11,9 @@ struct SceneGraph;
 
 struct DebugWindow
 {
-	void draw(Renderer& renderer, LightEnvironment& lights,
-			  Selection& selection, Gizmo& gizmo, SceneGraph& sceneGraph);
+	void draw(Renderer& renderer, FramePacer& framePacer,
+			  LightEnvironment& lights, Selection& selection, Gizmo& gizmo,
+			  SceneGraph& sceneGraph);
 
 	bool importRequested = false;
 	bool deleteRequested = false;
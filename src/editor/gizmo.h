@@ -30,4 +30,6 @@ struct Gizmo
 					float viewportW, float viewportH);
 
 	bool is_using() const;
+	// Hovering a handle: a click there grabs the gizmo, not the scene
+	bool is_over() const;
 };
@@ -1,10 +1,16 @@
 #include "sceneFile.h"
 
+#include <cstring>
 #include <fstream>
 #include <glm/gtc/type_ptr.hpp>
 #include <nlohmann/json.hpp>
+#include <span>
+#include <string_view>
+#include <unordered_map>
 
+#include "core/mappedFile.h"
 #include "logger.h"
+#include "scenebFormat.h"
 
 using json = nlohmann::json;
 
@@ -38,13 +44,60 @@ static glm::mat4 json_to_mat4(const json& j)
 	return m;
 }
 
+// Front vector from yaw/pitch, which is all the files store
+static void update_camera_front(Camera& camera)
+{
+	glm::vec3 d;
+	d.x = std::cos(glm::radians(camera.yaw)) *
+		  std::cos(glm::radians(camera.pitch));
+	d.y = std::sin(glm::radians(camera.pitch));
+	d.z = std::sin(glm::radians(camera.yaw)) *
+		  std::cos(glm::radians(camera.pitch));
+	camera.front = glm::normalize(d);
+}
+
+bool is_binary_scene_path(const std::string& path)
+{
+	constexpr std::string_view ext = ".sceneb";
+	if (path.size() < ext.size()) return false;
+	for (size_t i = 0; i < ext.size(); ++i)
+	{
+		char c = path[path.size() - ext.size() + i];
+		if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+		if (c != ext[i]) return false;
+	}
+	return true;
+}
+
+bool save_scene_file(const std::string& path, const SceneFileData& data)
+{
+	return is_binary_scene_path(path) ? save_scene_file_binary(path, data)
+									  : save_scene_file_json(path, data);
+}
+
+bool load_scene_file(const std::string& path, SceneFileData& data)
+{
+	uint32_t magic = 0;
+	{
+		std::ifstream f(path, std::ios::binary);
+		if (!f)
+		{
+			LOG_ERROR("load_scene_file: cannot open '%s'", path.c_str());
+			return false;
+		}
+		f.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	}
+	return magic == sceneb::MAGIC ? load_scene_file_binary(path, data)
+								  : load_scene_file_json(path, data);
+}
+
 // =============================================================================
-// Save
+// JSON save
 // =============================================================================
 
-bool save_scene_file(const std::string& path, const SceneFileData& data)
+bool save_scene_file_json(const std::string& path, const SceneFileData& data)
 {
-	LOG_INFO("save_scene_file: writing %zu nodes to '%s'",
+	LOG_INFO("save_scene_file_json: writing %zu nodes to '%s'",
 			 data.sceneGraph.nodes.size(), path.c_str());
 	json root;
 	root["version"] = 1;
@@ -106,11 +159,13 @@ bool save_scene_file(const std::string& path, const SceneFileData& data)
 
 	// Scene graph nodes
 	json nodesArr = json::array();
-	for (const auto& node : data.sceneGraph.nodes)
+	const SceneGraph& graph = data.sceneGraph;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(graph.nodes.size()); ++i)
 	{
+		const auto& node = graph.nodes[i];
 		json n;
 		n["name"] = node.name;
-		n["localTransform"] = mat4_to_json(node.localTransform);
+		n["localTransform"] = mat4_to_json(graph.local_transform(i));
 		n["meshIndex"] = node.meshIndex.has_value()
 							 ? json(node.meshIndex.value())
 							 : json(nullptr);
@@ -130,7 +185,7 @@ bool save_scene_file(const std::string& path, const SceneFileData& data)
 	std::ofstream f(path);
 	if (!f)
 	{
-		LOG_ERROR("save_scene_file: cannot open '%s' for writing",
+		LOG_ERROR("save_scene_file_json: cannot open '%s' for writing",
 				  path.c_str());
 		return false;
 	}
@@ -139,15 +194,15 @@ bool save_scene_file(const std::string& path, const SceneFileData& data)
 }
 
 // =============================================================================
-// Load
+// JSON load
 // =============================================================================
 
-bool load_scene_file(const std::string& path, SceneFileData& data)
+bool load_scene_file_json(const std::string& path, SceneFileData& data)
 {
 	std::ifstream f(path);
 	if (!f)
 	{
-		LOG_ERROR("load_scene_file: cannot open '%s'", path.c_str());
+		LOG_ERROR("load_scene_file_json: cannot open '%s'", path.c_str());
 		return false;
 	}
 
@@ -158,8 +213,8 @@ bool load_scene_file(const std::string& path, SceneFileData& data)
 	}
 	catch (const std::exception& e)
 	{
-		LOG_ERROR("load_scene_file: JSON parse error in '%s': %s", path.c_str(),
-				  e.what());
+		LOG_ERROR("load_scene_file_json: parse error in '%s': %s",
+				  path.c_str(), e.what());
 		return false;
 	}
 
@@ -174,15 +229,7 @@ bool load_scene_file(const std::string& path, SceneFileData& data)
 		data.camera.yaw = cam.value("yaw", -90.0f);
 		data.camera.pitch = cam.value("pitch", 0.0f);
 		data.camera.fov = cam.value("fov", 45.0f);
-
-		// Reconstruct front vector from yaw/pitch
-		glm::vec3 d;
-		d.x = std::cos(glm::radians(data.camera.yaw)) *
-			  std::cos(glm::radians(data.camera.pitch));
-		d.y = std::sin(glm::radians(data.camera.pitch));
-		d.z = std::sin(glm::radians(data.camera.yaw)) *
-			  std::cos(glm::radians(data.camera.pitch));
-		data.camera.front = glm::normalize(d);
+		update_camera_front(data.camera);
 	}
 
 	// Lights
@@ -248,44 +295,327 @@ bool load_scene_file(const std::string& path, SceneFileData& data)
 		}
 	}
 
-	// Scene graph nodes
-	data.sceneGraph.nodes.clear();
-	data.sceneGraph.roots.clear();
+	// Scene graph nodes. Children are rebuilt from the parent links, which
+	// always point at an earlier node in saved files.
+	data.sceneGraph.clear();
 	if (root.contains("nodes"))
 	{
 		for (const auto& n : root["nodes"])
 		{
-			SceneNode node;
-			node.name = n.value("name", std::string{});
+			auto name = n.value("name", std::string{});
+			glm::mat4 localTransform{1.0f};
 			if (n.contains("localTransform"))
-				node.localTransform = json_to_mat4(n["localTransform"]);
-			node.worldTransform = node.localTransform;
+				localTransform = json_to_mat4(n["localTransform"]);
 
+			std::optional<uint32_t> meshIndex;
 			if (n.contains("meshIndex") && !n["meshIndex"].is_null())
-				node.meshIndex = n["meshIndex"].get<uint32_t>();
+				meshIndex = n["meshIndex"].get<uint32_t>();
 
-			node.modelPath = n.value("modelPath", std::string{});
-			node.meshIndexInModel = n.value("meshIndexInModel", 0u);
+			auto modelPath = n.value("modelPath", std::string{});
+			auto meshIndexInModel = n.value("meshIndexInModel", 0u);
 
+			std::optional<uint32_t> parent;
 			if (n.contains("parent") && !n["parent"].is_null())
-				node.parent = n["parent"].get<uint32_t>();
-
-			if (n.contains("children"))
+				parent = n["parent"].get<uint32_t>();
+			if (parent.has_value() &&
+				parent.value() >= data.sceneGraph.nodes.size())
 			{
-				for (const auto& c : n["children"])
-					node.children.push_back(c.get<uint32_t>());
+				LOG_WARN("Node '%s' has invalid parent %u, made a root",
+						 name.c_str(), parent.value());
+				parent.reset();
 			}
 
-			data.sceneGraph.nodes.push_back(std::move(node));
+			data.sceneGraph.add_node(name, localTransform, meshIndex,
+									 modelPath, meshIndexInModel, parent);
+		}
+	}
+
+	return true;
+}
+
+// =============================================================================
+// Binary save
+// =============================================================================
+
+// Strings are interned: a scene's nodes mostly share a few model paths
+struct SceneStringTable
+{
+	std::vector<char> bytes;
+	std::unordered_map<std::string, sceneb::StringRef> refs;
+
+	sceneb::StringRef add(const std::string& s)
+	{
+		auto it = refs.find(s);
+		if (it != refs.end()) return it->second;
+		sceneb::StringRef ref{static_cast<uint32_t>(bytes.size()),
+							  static_cast<uint32_t>(s.size())};
+		bytes.insert(bytes.end(), s.begin(), s.end());
+		refs.emplace(s, ref);
+		return ref;
+	}
+};
+
+// Pads `out` to the section alignment and appends `count` elements
+static sceneb::Section put_section(std::vector<char>& out, const void* elements,
+								   size_t count, size_t elementSize)
+{
+	out.resize((out.size() + sceneb::SECTION_ALIGN - 1) &
+			   ~(sceneb::SECTION_ALIGN - 1));
+	sceneb::Section section{out.size(), count};
+	const char* p = static_cast<const char*>(elements);
+	out.insert(out.end(), p, p + count * elementSize);
+	return section;
+}
+
+static void put_vec3(float* dst, const glm::vec3& v)
+{
+	dst[0] = v.x;
+	dst[1] = v.y;
+	dst[2] = v.z;
+}
+
+bool save_scene_file_binary(const std::string& path,
+							const SceneFileData& data)
+{
+	const SceneGraph& graph = data.sceneGraph;
+	LOG_INFO("save_scene_file_binary: writing %zu nodes to '%s'",
+			 graph.nodes.size(), path.c_str());
+
+	sceneb::FileHeader header{};
+	header.magic = sceneb::MAGIC;
+	header.version = sceneb::VERSION;
+
+	SceneStringTable strings;
+	header.modelPath = strings.add(data.modelPath);
+	put_vec3(header.cameraPosition, data.camera.position);
+	header.cameraYaw = data.camera.yaw;
+	header.cameraPitch = data.camera.pitch;
+	header.cameraFov = data.camera.fov;
+	put_vec3(header.ambientColor, data.lights.ambient.color);
+	header.ambientIntensity = data.lights.ambient.intensity;
+
+	std::vector<sceneb::Node> nodes(graph.nodes.size());
+	std::vector<float> transforms(graph.nodes.size() * 16);
+	for (uint32_t i = 0; i < static_cast<uint32_t>(graph.nodes.size()); ++i)
+	{
+		const SceneNode& node = graph.nodes[i];
+		nodes[i].name = strings.add(node.name);
+		nodes[i].modelPath = strings.add(node.modelPath);
+		nodes[i].meshIndex = node.meshIndex.value_or(sceneb::NONE);
+		nodes[i].meshIndexInModel = node.meshIndexInModel;
+		nodes[i].parent = node.parent.value_or(sceneb::NONE);
+		std::memcpy(&transforms[i * 16],
+					glm::value_ptr(graph.local_transform(i)),
+					16 * sizeof(float));
+	}
+
+	std::vector<sceneb::DirectionalLight> directionals;
+	for (const auto& d : data.lights.directionals)
+	{
+		sceneb::DirectionalLight dl{};
+		put_vec3(dl.direction, d.direction);
+		put_vec3(dl.color, d.color);
+		dl.intensity = d.intensity;
+		directionals.push_back(dl);
+	}
+	std::vector<sceneb::PointLight> points;
+	for (const auto& p : data.lights.points)
+	{
+		sceneb::PointLight pl{};
+		put_vec3(pl.position, p.position);
+		put_vec3(pl.color, p.color);
+		pl.intensity = p.intensity;
+		pl.radius = p.radius;
+		points.push_back(pl);
+	}
+	std::vector<sceneb::SpotLight> spots;
+	for (const auto& s : data.lights.spots)
+	{
+		sceneb::SpotLight sl{};
+		put_vec3(sl.position, s.position);
+		put_vec3(sl.direction, s.direction);
+		put_vec3(sl.color, s.color);
+		sl.intensity = s.intensity;
+		sl.radius = s.radius;
+		sl.innerConeAngle = s.innerConeAngle;
+		sl.outerConeAngle = s.outerConeAngle;
+		spots.push_back(sl);
+	}
+
+	// The header is written last, once the section offsets are known
+	std::vector<char> out(sizeof(sceneb::FileHeader));
+	header.strings =
+		put_section(out, strings.bytes.data(), strings.bytes.size(), 1);
+	header.nodes = put_section(out, nodes.data(), nodes.size(),
+							   sizeof(sceneb::Node));
+	header.transforms = put_section(out, transforms.data(), nodes.size(),
+									16 * sizeof(float));
+	header.directionals =
+		put_section(out, directionals.data(), directionals.size(),
+					sizeof(sceneb::DirectionalLight));
+	header.points = put_section(out, points.data(), points.size(),
+								sizeof(sceneb::PointLight));
+	header.spots = put_section(out, spots.data(), spots.size(),
+							   sizeof(sceneb::SpotLight));
+	std::memcpy(out.data(), &header, sizeof(header));
+
+	std::ofstream f(path, std::ios::binary);
+	if (!f)
+	{
+		LOG_ERROR("save_scene_file_binary: cannot open '%s' for writing",
+				  path.c_str());
+		return false;
+	}
+	f.write(out.data(), static_cast<std::streamsize>(out.size()));
+	return f.good();
+}
+
+// =============================================================================
+// Binary load
+// =============================================================================
+
+// Points `out` at a section of the mapped file, after checking that it is
+// aligned and lies entirely inside the file
+template <typename T>
+static bool get_section(const MappedFile& file, const sceneb::Section& section,
+						size_t elementSize, std::span<const T>& out)
+{
+	if (section.offset % sceneb::SECTION_ALIGN != 0 ||
+		section.offset > file.size() ||
+		section.count > (file.size() - section.offset) / elementSize)
+		return false;
+	out = {reinterpret_cast<const T*>(file.data() + section.offset),
+		   static_cast<size_t>(section.count * elementSize / sizeof(T))};
+	return true;
+}
+
+static bool get_string(std::span<const char> strings, sceneb::StringRef ref,
+					   std::string& out)
+{
+	if (ref.offset > strings.size() ||
+		ref.length > strings.size() - ref.offset)
+		return false;
+	out.assign(strings.data() + ref.offset, ref.length);
+	return true;
+}
+
+bool load_scene_file_binary(const std::string& path, SceneFileData& data)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		LOG_ERROR("load_scene_file_binary: cannot map '%s'", path.c_str());
+		return false;
+	}
+	if (file.size() < sizeof(sceneb::FileHeader))
+	{
+		LOG_ERROR("load_scene_file_binary: '%s' is truncated", path.c_str());
+		return false;
+	}
+	const auto& header =
+		*reinterpret_cast<const sceneb::FileHeader*>(file.data());
+	if (header.magic != sceneb::MAGIC || header.version != sceneb::VERSION)
+	{
+		LOG_ERROR("load_scene_file_binary: '%s' is not a version %u .sceneb",
+				  path.c_str(), sceneb::VERSION);
+		return false;
+	}
+
+	std::span<const char> strings;
+	std::span<const sceneb::Node> nodes;
+	std::span<const float> transforms;
+	std::span<const sceneb::DirectionalLight> directionals;
+	std::span<const sceneb::PointLight> points;
+	std::span<const sceneb::SpotLight> spots;
+	if (!get_section(file, header.strings, 1, strings) ||
+		!get_section(file, header.nodes, sizeof(sceneb::Node), nodes) ||
+		!get_section(file, header.transforms, 16 * sizeof(float),
+					 transforms) ||
+		!get_section(file, header.directionals,
+					 sizeof(sceneb::DirectionalLight), directionals) ||
+		!get_section(file, header.points, sizeof(sceneb::PointLight),
+					 points) ||
+		!get_section(file, header.spots, sizeof(sceneb::SpotLight), spots) ||
+		transforms.size() != nodes.size() * 16 ||
+		!get_string(strings, header.modelPath, data.modelPath))
+	{
+		LOG_ERROR("load_scene_file_binary: '%s' has a bad section table",
+				  path.c_str());
+		return false;
+	}
+
+	data.camera.position = glm::make_vec3(header.cameraPosition);
+	data.camera.yaw = header.cameraYaw;
+	data.camera.pitch = header.cameraPitch;
+	data.camera.fov = header.cameraFov;
+	update_camera_front(data.camera);
+
+	data.lights.ambient.color = glm::make_vec3(header.ambientColor);
+	data.lights.ambient.intensity = header.ambientIntensity;
+	data.lights.directionals.clear();
+	for (const auto& d : directionals)
+	{
+		DirectionalLight dl;
+		dl.direction = glm::make_vec3(d.direction);
+		dl.color = glm::make_vec3(d.color);
+		dl.intensity = d.intensity;
+		data.lights.directionals.push_back(dl);
+	}
+	data.lights.points.clear();
+	for (const auto& p : points)
+	{
+		PointLight pl;
+		pl.position = glm::make_vec3(p.position);
+		pl.color = glm::make_vec3(p.color);
+		pl.intensity = p.intensity;
+		pl.radius = p.radius;
+		data.lights.points.push_back(pl);
+	}
+	data.lights.spots.clear();
+	for (const auto& s : spots)
+	{
+		SpotLight sl;
+		sl.position = glm::make_vec3(s.position);
+		sl.direction = glm::make_vec3(s.direction);
+		sl.color = glm::make_vec3(s.color);
+		sl.intensity = s.intensity;
+		sl.radius = s.radius;
+		sl.innerConeAngle = s.innerConeAngle;
+		sl.outerConeAngle = s.outerConeAngle;
+		data.lights.spots.push_back(sl);
+	}
+
+	// Same rules as the JSON loader: a parent must be an earlier node
+	data.sceneGraph.clear();
+	data.sceneGraph.reserve(nodes.size());
+	std::string name, modelPath;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(nodes.size()); ++i)
+	{
+		const sceneb::Node& n = nodes[i];
+		if (!get_string(strings, n.name, name) ||
+			!get_string(strings, n.modelPath, modelPath))
+		{
+			LOG_ERROR("load_scene_file_binary: node %u of '%s' has a bad "
+					  "string",
+					  i, path.c_str());
+			data.sceneGraph.clear();
+			return false;
 		}
 
-		// Rebuild roots list
-		for (uint32_t i = 0;
-			 i < static_cast<uint32_t>(data.sceneGraph.nodes.size()); ++i)
+		std::optional<uint32_t> meshIndex;
+		if (n.meshIndex != sceneb::NONE) meshIndex = n.meshIndex;
+		std::optional<uint32_t> parent;
+		if (n.parent != sceneb::NONE) parent = n.parent;
+		if (parent.has_value() && parent.value() >= i)
 		{
-			if (!data.sceneGraph.nodes[i].parent.has_value())
-				data.sceneGraph.roots.push_back(i);
+			LOG_WARN("Node '%s' has invalid parent %u, made a root",
+					 name.c_str(), parent.value());
+			parent.reset();
 		}
+
+		data.sceneGraph.add_node(name, glm::make_mat4(&transforms[i * 16]),
+								 meshIndex, modelPath, n.meshIndexInModel,
+								 parent);
 	}
 
 	return true;
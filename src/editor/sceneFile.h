@@ -14,5 +14,19 @@ struct SceneFileData
 	LightEnvironment lights;
 };
 
+// Two formats with the same content:
+//   .sceneb  binary (scenebFormat.h): flat node and light arrays plus a
+//            string table, loaded by memory-mapping the file
+//   .scene   JSON, kept for interchange and hand editing
+// save_scene_file() picks the format from the extension, load_scene_file()
+// from the file's first bytes.
 bool save_scene_file(const std::string& path, const SceneFileData& data);
 bool load_scene_file(const std::string& path, SceneFileData& data);
+
+bool save_scene_file_json(const std::string& path, const SceneFileData& data);
+bool load_scene_file_json(const std::string& path, SceneFileData& data);
+bool save_scene_file_binary(const std::string& path,
+							const SceneFileData& data);
+bool load_scene_file_binary(const std::string& path, SceneFileData& data);
+
+bool is_binary_scene_path(const std::string& path);
@@ -3,6 +3,38 @@
 #include <algorithm>
 #include <functional>
 
+#include "core/threadPool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define SCENE_GRAPH_SSE 1
+#endif
+
+// out = a * b for column-major 4x4 matrices. Each output column is a linear
+// combination of a's columns, four lanes at a time.
+static void mul_mat4(const glm::mat4& a, const glm::mat4& b, glm::mat4& out)
+{
+#ifdef SCENE_GRAPH_SSE
+	const float* pa = &a[0][0];
+	const float* pb = &b[0][0];
+	float* po = &out[0][0];
+	__m128 a0 = _mm_loadu_ps(pa + 0);
+	__m128 a1 = _mm_loadu_ps(pa + 4);
+	__m128 a2 = _mm_loadu_ps(pa + 8);
+	__m128 a3 = _mm_loadu_ps(pa + 12);
+	for (int c = 0; c < 4; ++c)
+	{
+		__m128 col = _mm_mul_ps(a0, _mm_set1_ps(pb[c * 4 + 0]));
+		col = _mm_add_ps(col, _mm_mul_ps(a1, _mm_set1_ps(pb[c * 4 + 1])));
+		col = _mm_add_ps(col, _mm_mul_ps(a2, _mm_set1_ps(pb[c * 4 + 2])));
+		col = _mm_add_ps(col, _mm_mul_ps(a3, _mm_set1_ps(pb[c * 4 + 3])));
+		_mm_storeu_ps(po + c * 4, col);
+	}
+#else
+	out = a * b;
+#endif
+}
+
 uint32_t SceneGraph::add_node(const std::string& name,
 							  const glm::mat4& localTransform,
 							  std::optional<uint32_t> meshIndex,
@@ -14,8 +46,6 @@ uint32_t SceneGraph::add_node(const std::string& name,
 
 	SceneNode node;
 	node.name = name;
-	node.localTransform = localTransform;
-	node.worldTransform = localTransform;
 	node.meshIndex = meshIndex;
 	node.modelPath = modelPath;
 	node.meshIndexInModel = meshIndexInModel;
@@ -28,76 +58,313 @@ uint32_t SceneGraph::add_node(const std::string& name,
 	else
 		roots.push_back(idx);
 
+	// Appended as its own slot so the accessors work right away; levels
+	// and child ranges are rebuilt by the next update
+	uint32_t slot = static_cast<uint32_t>(slotNodes_.size());
+	slotNodes_.push_back(idx);
+	parentSlots_.push_back(parentId.has_value() ? nodeSlots_[parentId.value()]
+											   : NO_INDEX);
+	childBegins_.push_back(0);
+	childEnds_.push_back(0);
+	slotMeshes_.push_back(meshIndex.value_or(NO_INDEX));
+	locals_.push_back(localTransform);
+	worlds_.push_back(localTransform);
+	dirty_.push_back(0);
+	nodeSlots_.push_back(slot);
+	mark_dirty(slot);
+	orderDirty_ = true;
+
 	return idx;
 }
 
 void SceneGraph::remove_node(uint32_t nodeIdx)
 {
-	if (nodeIdx >= nodes.size()) return;
-
-	// Collect this node and all descendants (BFS)
-	std::vector<uint32_t> toRemove;
-	toRemove.push_back(nodeIdx);
-	for (size_t i = 0; i < toRemove.size(); ++i)
-		for (uint32_t child : nodes[toRemove[i]].children)
-			toRemove.push_back(child);
-
-	// Sort descending so we can erase from back to front
-	std::sort(toRemove.begin(), toRemove.end(), std::greater<uint32_t>());
+	remove_nodes(std::span<const uint32_t>(&nodeIdx, 1));
+}
 
-	// Detach the top-level node from its parent or roots
-	auto& topNode = nodes[nodeIdx];
-	if (topNode.parent.has_value())
+void SceneGraph::remove_nodes(std::span<const uint32_t> nodeIdxs)
+{
+	// Mark the nodes and all their descendants (BFS)
+	std::vector<bool> removed(nodes.size(), false);
+	std::vector<uint32_t> queue;
+	for (uint32_t nodeIdx : nodeIdxs)
 	{
-		auto& parentChildren = nodes[topNode.parent.value()].children;
-		parentChildren.erase(
-			std::remove(parentChildren.begin(), parentChildren.end(), nodeIdx),
-			parentChildren.end());
+		if (nodeIdx >= nodes.size() || removed[nodeIdx]) continue;
+		removed[nodeIdx] = true;
+		queue.push_back(nodeIdx);
 	}
-	else
+	if (queue.empty()) return;
+	for (size_t i = 0; i < queue.size(); ++i)
+		for (uint32_t child : nodes[queue[i]].children)
+		{
+			if (removed[child]) continue;
+			removed[child] = true;
+			queue.push_back(child);
+		}
+
+	// Detach the top-level nodes from their parents or roots
+	auto isRemoved = [&](uint32_t n) { return removed[n]; };
+	for (uint32_t n : queue)
 	{
-		roots.erase(std::remove(roots.begin(), roots.end(), nodeIdx),
-					roots.end());
+		const auto& parent = nodes[n].parent;
+		if (!parent.has_value() || removed[parent.value()]) continue;
+		auto& siblings = nodes[parent.value()].children;
+		siblings.erase(
+			std::remove_if(siblings.begin(), siblings.end(), isRemoved),
+			siblings.end());
 	}
+	roots.erase(std::remove_if(roots.begin(), roots.end(), isRemoved),
+				roots.end());
 
-	// Erase nodes from back to front
-	for (uint32_t idx : toRemove) nodes.erase(nodes.begin() + idx);
-
-	// Build a remap table: old index -> new index
-	// Since we removed sorted-descending, we can compute shifts
-	auto compute_new_index = [&](uint32_t oldIdx) -> uint32_t
+	// One compaction pass builds the old -> new remap table as it goes,
+	// keeping the slots of the survivors
+	std::vector<uint32_t> remap(nodes.size(), NO_INDEX);
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(nodes.size()); ++i)
 	{
-		uint32_t shift = 0;
-		for (uint32_t removed : toRemove)
-			if (removed < oldIdx) ++shift;
-		return oldIdx - shift;
-	};
+		if (removed[i]) continue;
+		remap[i] = kept;
+		if (kept != i)
+		{
+			nodes[kept] = std::move(nodes[i]);
+			nodeSlots_[kept] = nodeSlots_[i];
+		}
+		++kept;
+	}
+	nodes.resize(kept);
+	nodeSlots_.resize(kept);
 
-	// Fix up all parent/children indices and roots
+	// Survivors only reference survivors
 	for (auto& node : nodes)
 	{
-		if (node.parent.has_value())
-			node.parent = compute_new_index(node.parent.value());
-		for (auto& child : node.children) child = compute_new_index(child);
+		if (node.parent.has_value()) node.parent = remap[node.parent.value()];
+		for (auto& child : node.children) child = remap[child];
 	}
-	for (auto& root : roots) root = compute_new_index(root);
+	for (auto& root : roots) root = remap[root];
+
+	// World transforms of the survivors are unchanged
+	sort_slots();
 }
 
 void SceneGraph::clear()
 {
 	nodes.clear();
 	roots.clear();
+	slotNodes_.clear();
+	parentSlots_.clear();
+	childBegins_.clear();
+	childEnds_.clear();
+	slotMeshes_.clear();
+	locals_.clear();
+	worlds_.clear();
+	dirty_.clear();
+	nodeSlots_.clear();
+	levelStarts_.clear();
+	pendingSlots_ = 0;
+	orderDirty_ = false;
 }
 
-void SceneGraph::update_world_transforms()
+void SceneGraph::reserve(size_t count)
 {
-	for (uint32_t root : roots) update_node(root, glm::mat4{1.0f});
+	nodes.reserve(count);
+	slotNodes_.reserve(count);
+	parentSlots_.reserve(count);
+	childBegins_.reserve(count);
+	childEnds_.reserve(count);
+	slotMeshes_.reserve(count);
+	locals_.reserve(count);
+	worlds_.reserve(count);
+	dirty_.reserve(count);
+	nodeSlots_.reserve(count);
 }
 
-void SceneGraph::update_node(uint32_t nodeIdx, const glm::mat4& parentWorld)
+const glm::mat4& SceneGraph::local_transform(uint32_t nodeIdx) const
 {
-	auto& node = nodes[nodeIdx];
-	node.worldTransform = parentWorld * node.localTransform;
-	for (uint32_t child : node.children)
-		update_node(child, node.worldTransform);
+	return locals_[nodeSlots_[nodeIdx]];
+}
+
+const glm::mat4& SceneGraph::world_transform(uint32_t nodeIdx) const
+{
+	return worlds_[nodeSlots_[nodeIdx]];
+}
+
+void SceneGraph::set_local_transform(uint32_t nodeIdx,
+									 const glm::mat4& transform)
+{
+	uint32_t slot = nodeSlots_[nodeIdx];
+	locals_[slot] = transform;
+	mark_dirty(slot);
+}
+
+void SceneGraph::set_mesh_index(uint32_t nodeIdx,
+								std::optional<uint32_t> meshIndex)
+{
+	if (nodes[nodeIdx].meshIndex == meshIndex) return;
+	nodes[nodeIdx].meshIndex = meshIndex;
+	uint32_t slot = nodeSlots_[nodeIdx];
+	slotMeshes_[slot] = meshIndex.value_or(NO_INDEX);
+	mark_dirty(slot);
+}
+
+void SceneGraph::transform_nodes(std::span<const uint32_t> nodeIdxs,
+								 const glm::mat4& worldDelta)
+{
+	std::vector<bool> listed(nodes.size(), false);
+	for (uint32_t n : nodeIdxs)
+		if (n < nodes.size()) listed[n] = true;
+
+	std::vector<bool> moved(nodes.size(), false);
+	for (uint32_t n : nodeIdxs)
+	{
+		if (n >= nodes.size() || moved[n]) continue;
+		moved[n] = true;
+		bool ancestorListed = false;
+		for (auto p = nodes[n].parent; p.has_value() && !ancestorListed;
+			 p = nodes[p.value()].parent)
+			ancestorListed = listed[p.value()];
+		if (ancestorListed) continue;
+
+		// Keep the parent, so the new world is parent * local
+		uint32_t slot = nodeSlots_[n];
+		glm::mat4 world = worldDelta * worlds_[slot];
+		uint32_t parent = parentSlots_[slot];
+		locals_[slot] =
+			parent == NO_INDEX ? world : glm::inverse(worlds_[parent]) * world;
+		mark_dirty(slot);
+	}
+}
+
+void SceneGraph::set_frame_slots(uint32_t count)
+{
+	auto mask = static_cast<uint8_t>((1u << count) - 1);
+	if (mask == allSlots_) return;
+	allSlots_ = mask;
+	mark_all_dirty();
+}
+
+void SceneGraph::mark_all_dirty()
+{
+	std::fill(dirty_.begin(), dirty_.end(), allSlots_);
+	pendingSlots_ = dirty_.empty() ? 0 : allSlots_;
+}
+
+void SceneGraph::mark_dirty(uint32_t slot)
+{
+	dirty_[slot] = allSlots_;
+	pendingSlots_ = allSlots_;
+}
+
+void SceneGraph::update_world_transforms(uint32_t frameSlot,
+										 std::span<glm::mat4> instances,
+										 ThreadPool* pool)
+{
+	auto bit = static_cast<uint8_t>(1u << frameSlot);
+	if (!(pendingSlots_ & bit)) return;
+	if (orderDirty_) sort_slots();
+
+	// Level by level: a level only reads world matrices of the one before,
+	// and only writes dirty flags of the one after
+	for (size_t level = 0; level + 1 < levelStarts_.size(); ++level)
+	{
+		uint32_t begin = levelStarts_[level];
+		uint32_t end = levelStarts_[level + 1];
+		if (pool && end - begin >= PARALLEL_MIN_NODES)
+		{
+			pool->parallel_for(end - begin, PARALLEL_MIN_NODES / 4,
+							   [&](uint32_t first, uint32_t last)
+							   {
+								   update_slots(begin + first, begin + last,
+												bit, instances);
+							   });
+		}
+		else
+		{
+			update_slots(begin, end, bit, instances);
+		}
+	}
+	pendingSlots_ &= static_cast<uint8_t>(~bit);
+}
+
+void SceneGraph::update_slots(uint32_t begin, uint32_t end, uint8_t bit,
+							  std::span<glm::mat4> instances)
+{
+	for (uint32_t slot = begin; slot < end; ++slot)
+	{
+		uint8_t mask = dirty_[slot];
+		if (!(mask & bit)) continue;
+
+		uint32_t parent = parentSlots_[slot];
+		if (parent == NO_INDEX)
+			worlds_[slot] = locals_[slot];
+		else
+			mul_mat4(worlds_[parent], locals_[slot], worlds_[slot]);
+		uint32_t mesh = slotMeshes_[slot];
+		if (mesh < instances.size()) instances[mesh] = worlds_[slot];
+
+		// A moved node moves its whole subtree
+		for (uint32_t child = childBegins_[slot]; child < childEnds_[slot];
+			 ++child)
+			dirty_[child] |= mask;
+		dirty_[slot] = static_cast<uint8_t>(mask & ~bit);
+	}
+}
+
+void SceneGraph::sort_slots()
+{
+	// Breadth-first order from the roots. Visiting a node appends all of
+	// its children at once, so they end up adjacent. nodeSlots_ still maps
+	// each node to its slot in the old arrays.
+	std::vector<uint32_t> order(roots.begin(), roots.end());
+	order.reserve(nodes.size());
+	std::vector<uint32_t> begins, ends;
+	begins.reserve(nodes.size());
+	ends.reserve(nodes.size());
+	levelStarts_.assign(1, 0);
+	uint32_t levelEnd = static_cast<uint32_t>(order.size());
+	for (uint32_t slot = 0; slot < order.size(); ++slot)
+	{
+		if (slot == levelEnd)
+		{
+			levelStarts_.push_back(slot);
+			levelEnd = static_cast<uint32_t>(order.size());
+		}
+		const auto& children = nodes[order[slot]].children;
+		begins.push_back(static_cast<uint32_t>(order.size()));
+		order.insert(order.end(), children.begin(), children.end());
+		ends.push_back(static_cast<uint32_t>(order.size()));
+	}
+	uint32_t count = static_cast<uint32_t>(order.size());
+	levelStarts_.push_back(count);
+
+	std::vector<uint32_t> newNodeSlots(nodes.size(), NO_INDEX);
+	std::vector<glm::mat4> locals(count), worlds(count);
+	std::vector<uint8_t> dirty(count);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		uint32_t oldSlot = nodeSlots_[order[slot]];
+		locals[slot] = locals_[oldSlot];
+		worlds[slot] = worlds_[oldSlot];
+		dirty[slot] = dirty_[oldSlot];
+		newNodeSlots[order[slot]] = slot;
+	}
+
+	parentSlots_.resize(count);
+	slotMeshes_.resize(count);
+	for (uint32_t slot = 0; slot < count; ++slot)
+	{
+		const auto& node = nodes[order[slot]];
+		parentSlots_[slot] = node.parent.has_value()
+								 ? newNodeSlots[node.parent.value()]
+								 : NO_INDEX;
+		slotMeshes_[slot] = node.meshIndex.value_or(NO_INDEX);
+	}
+
+	slotNodes_ = std::move(order);
+	childBegins_ = std::move(begins);
+	childEnds_ = std::move(ends);
+	locals_ = std::move(locals);
+	worlds_ = std::move(worlds);
+	dirty_ = std::move(dirty);
+	nodeSlots_ = std::move(newNodeSlots);
+	orderDirty_ = false;
 }
@@ -3,14 +3,17 @@
 #include <cstdint>
 #include <glm/glm.hpp>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+struct ThreadPool;
+
+// Per-node editor data. Transforms are not stored here but in SceneGraph's
+// flat arrays; use local_transform() / world_transform().
 struct SceneNode
 {
 	std::string name;
-	glm::mat4 localTransform{1.0f};
-	glm::mat4 worldTransform{1.0f};
 
 	// Mesh link
 	std::optional<uint32_t> meshIndex;	// runtime index into Renderer::meshes_
@@ -21,8 +24,17 @@ struct SceneNode
 	std::vector<uint32_t> children;
 };
 
+// Nodes are addressed by their index in `nodes`. The transform hierarchy is
+// kept alongside as structure-of-arrays in breadth-first order: each depth
+// level is a contiguous range, every parent sits in the level before its
+// children and the children of a node are adjacent. update_world_transforms()
+// walks the levels in order without recursion; the nodes of one level are
+// independent, so large levels are split across a thread pool. Edit nodes
+// through the methods below (not `nodes` directly) so the two stay in sync.
 struct SceneGraph
 {
+	static constexpr uint32_t NO_INDEX = UINT32_MAX;
+
 	std::vector<SceneNode> nodes;
 	std::vector<uint32_t> roots;  // nodes with no parent
 
@@ -31,10 +43,59 @@ struct SceneGraph
 					  const std::string& modelPath, uint32_t meshIndexInModel,
 					  std::optional<uint32_t> parentId);
 
+	// Removes the nodes with their subtrees in one compaction pass
 	void remove_node(uint32_t nodeIdx);
-	void update_world_transforms();
+	void remove_nodes(std::span<const uint32_t> nodeIdxs);
 	void clear();
+	// Room for `count` nodes, for loaders that know the total up front
+	void reserve(size_t count);
+
+	const glm::mat4& local_transform(uint32_t nodeIdx) const;
+	// As of the last update_world_transforms()
+	const glm::mat4& world_transform(uint32_t nodeIdx) const;
+	void set_local_transform(uint32_t nodeIdx, const glm::mat4& transform);
+	void set_mesh_index(uint32_t nodeIdx, std::optional<uint32_t> meshIndex);
+	// Moves each node by a world-space transform (a gizmo drag of a multi-
+	// selection), as of the last update_world_transforms(). Nodes with an
+	// ancestor in the list just follow it.
+	void transform_nodes(std::span<const uint32_t> nodeIdxs,
+						 const glm::mat4& worldDelta);
+
+	// The renderer keeps one instance buffer per frame in flight, and a
+	// changed transform has to reach each of them. Changing the count
+	// rewrites every node.
+	void set_frame_slots(uint32_t count);
+	void mark_all_dirty();
+
+	// Recomputes the world transforms of dirty subtrees and writes those of
+	// mesh nodes to instances[meshIndex], the instance buffer of frame slot
+	// `frameSlot`. Does nothing when no node changed. Levels of at least
+	// PARALLEL_MIN_NODES nodes are spread over `pool` when one is given.
+	static constexpr uint32_t PARALLEL_MIN_NODES = 4096;
+	void update_world_transforms(uint32_t frameSlot,
+								 std::span<glm::mat4> instances,
+								 ThreadPool* pool = nullptr);
 
    private:
-	void update_node(uint32_t nodeIdx, const glm::mat4& parentWorld);
+	// Indexed by slot (position in breadth-first order)
+	std::vector<uint32_t> slotNodes_;
+	std::vector<uint32_t> parentSlots_;	 // NO_INDEX for roots
+	std::vector<uint32_t> childBegins_;	 // children are [begin, end)
+	std::vector<uint32_t> childEnds_;
+	std::vector<uint32_t> slotMeshes_;	// NO_INDEX without a mesh
+	std::vector<glm::mat4> locals_;
+	std::vector<glm::mat4> worlds_;
+	std::vector<uint8_t> dirty_;  // frame slots still to write, one bit each
+
+	std::vector<uint32_t> nodeSlots_;	 // node index -> slot
+	std::vector<uint32_t> levelStarts_;	 // first slot of each level, + end
+
+	uint8_t allSlots_ = 1;		// one bit per frame slot
+	uint8_t pendingSlots_ = 0;	// union of dirty_
+	bool orderDirty_ = false;	// slots added since the last sort
+
+	void mark_dirty(uint32_t slot);
+	void sort_slots();
+	void update_slots(uint32_t begin, uint32_t end, uint8_t bit,
+					  std::span<glm::mat4> instances);
 };
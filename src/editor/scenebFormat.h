@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Binary scene file (.sceneb). Little-endian, loaded by memory-mapping the
+// file and pointing straight at its sections; every section starts at a
+// multiple of SECTION_ALIGN from the start of the file. Strings live in
+// one table and are referenced by offset and length (not null-terminated);
+// identical strings (model paths) are stored once.
+namespace sceneb
+{
+
+inline constexpr uint32_t MAGIC = 0x424E4353;  // "SCNB"
+inline constexpr uint32_t VERSION = 1;
+inline constexpr uint64_t SECTION_ALIGN = 16;
+inline constexpr uint32_t NONE = UINT32_MAX;  // no mesh / no parent
+
+struct StringRef
+{
+	uint32_t offset;  // into the string table
+	uint32_t length;
+};
+static_assert(sizeof(StringRef) == 8);
+
+struct Section
+{
+	uint64_t offset;  // from start of file
+	uint64_t count;	  // elements (bytes for the string table)
+};
+static_assert(sizeof(Section) == 16);
+
+struct FileHeader
+{
+	uint32_t magic;	   // MAGIC
+	uint32_t version;  // VERSION
+	uint32_t flags;	   // reserved, 0
+	StringRef modelPath;
+
+	float cameraPosition[3];
+	float cameraYaw;
+	float cameraPitch;
+	float cameraFov;
+	float ambientColor[3];
+	float ambientIntensity;
+
+	Section strings;	 // char
+	Section nodes;		 // Node
+	Section transforms;	 // float[16] per node, column-major local
+	Section directionals;
+	Section points;
+	Section spots;
+};
+static_assert(sizeof(FileHeader) == 160);
+
+// Parents always precede their children
+struct Node
+{
+	StringRef name;
+	StringRef modelPath;
+	uint32_t meshIndex;	 // NONE without a mesh
+	uint32_t meshIndexInModel;
+	uint32_t parent;  // NONE for roots
+	uint32_t reserved;
+};
+static_assert(sizeof(Node) == 32);
+
+struct DirectionalLight
+{
+	float direction[3];
+	float color[3];
+	float intensity;
+	float reserved;
+};
+static_assert(sizeof(DirectionalLight) == 32);
+
+struct PointLight
+{
+	float position[3];
+	float color[3];
+	float intensity;
+	float radius;
+};
+static_assert(sizeof(PointLight) == 32);
+
+struct SpotLight
+{
+	float position[3];
+	float direction[3];
+	float color[3];
+	float intensity;
+	float radius;
+	float innerConeAngle;
+	float outerConeAngle;
+	float reserved[3];
+};
+static_assert(sizeof(SpotLight) == 64);
+
+}  // namespace sceneb
@@ -1,9 +1,8 @@
 #include "selection.h"
 
 #include <algorithm>
-#include <cmath>
+#include <iterator>
 #include <glm/gtc/matrix_transform.hpp>
-#include <limits>
 
 #include "graphics/mesh.h"
 #include "sceneGraph.h"
@@ -33,79 +32,271 @@ Ray Selection::screen_to_ray(float mouseX, float mouseY, float screenW,
 	return ray;
 }
 
-bool Selection::ray_aabb(const Ray& ray, const AABB& aabb,
-						 const glm::mat4& transform, float& tOut)
+bool Selection::is_selected(uint32_t nodeIdx) const
 {
-	// Transform ray into local space of the AABB
-	glm::mat4 invTransform = glm::inverse(transform);
-	glm::vec3 localOrigin =
-		glm::vec3(invTransform * glm::vec4(ray.origin, 1.0f));
-	glm::vec3 localDir =
-		glm::vec3(invTransform * glm::vec4(ray.direction, 0.0f));
-
-	// Avoid zero-length direction after transform
-	float dirLen = glm::length(localDir);
-	if (dirLen < 1e-8f) return false;
-	localDir /= dirLen;
-
-	// Slab test
-	float tMin = 0.0f;
-	float tMax = std::numeric_limits<float>::max();
-
-	for (int i = 0; i < 3; ++i)
+	return std::binary_search(selectedNodes.begin(), selectedNodes.end(),
+							  nodeIdx);
+}
+
+void Selection::select(std::optional<uint32_t> nodeIdx, Mode mode)
+{
+	std::vector<uint32_t> nodes;
+	if (nodeIdx.has_value()) nodes.push_back(*nodeIdx);
+	apply(nodes, mode);
+	// A clicked node becomes active even when it was already selected
+	if (nodeIdx.has_value() && is_selected(*nodeIdx)) selectedNode = nodeIdx;
+}
+
+void Selection::clear()
+{
+	selectedNode.reset();
+	selectedNodes.clear();
+}
+
+void Selection::apply(const std::vector<uint32_t>& nodes, Mode mode)
+{
+	std::vector<uint32_t> result;
+	switch (mode)
 	{
-		if (std::abs(localDir[i]) < 1e-8f)
-		{
-			// Ray parallel to slab — miss if origin outside
-			if (localOrigin[i] < aabb.min[i] || localOrigin[i] > aabb.max[i])
-				return false;
-		}
-		else
+		case Mode::Replace:
+			result = nodes;
+			break;
+		case Mode::Add:
+			std::set_union(selectedNodes.begin(), selectedNodes.end(),
+						   nodes.begin(), nodes.end(),
+						   std::back_inserter(result));
+			break;
+		case Mode::Toggle:
+			std::set_symmetric_difference(
+				selectedNodes.begin(), selectedNodes.end(), nodes.begin(),
+				nodes.end(), std::back_inserter(result));
+			break;
+	}
+	selectedNodes = std::move(result);
+
+	// Keep the active node while it survives, else take the first new one
+	if (selectedNode.has_value() && is_selected(*selectedNode)) return;
+	selectedNode.reset();
+	for (uint32_t n : nodes)
+	{
+		if (is_selected(n))
 		{
-			float invD = 1.0f / localDir[i];
-			float t1 = (aabb.min[i] - localOrigin[i]) * invD;
-			float t2 = (aabb.max[i] - localOrigin[i]) * invD;
-			if (t1 > t2) std::swap(t1, t2);
-			tMin = std::max(tMin, t1);
-			tMax = std::min(tMax, t2);
-			if (tMin > tMax) return false;
+			selectedNode = n;
+			return;
 		}
 	}
-
-	// Convert local t back to world t (approximate via direction scale)
-	tOut = tMin / dirLen;
-	return tOut >= 0.0f;
+	if (!selectedNodes.empty()) selectedNode = selectedNodes.front();
 }
 
 void Selection::pick(float mouseX, float mouseY, float screenW, float screenH,
 					 const glm::mat4& view, const glm::mat4& proj,
 					 const SceneGraph& sceneGraph,
-					 const std::vector<Mesh>& meshes)
+					 const std::vector<Mesh>& meshes, Mode mode)
 {
 	Ray ray = screen_to_ray(mouseX, mouseY, screenW, screenH, view, proj);
+	sync(sceneGraph, meshes);
 
-	float closestT = std::numeric_limits<float>::max();
-	std::optional<uint32_t> closestNode;
+	auto hit = sceneBvh_.intersect(ray.origin, ray.direction, meshBvhs_);
+	if (hit.has_value())
+		select(hit->node, mode);
+	else
+		select(std::nullopt, mode);
+}
 
-	for (uint32_t i = 0; i < static_cast<uint32_t>(sceneGraph.nodes.size());
-		 ++i)
+BvhFrustum Selection::screen_frustum(glm::vec2 min, glm::vec2 max,
+									 float screenW, float screenH,
+									 const glm::mat4& view,
+									 const glm::mat4& proj)
+{
+	// At least a pixel wide, so the side planes stay well defined
+	max = glm::max(max, min + glm::vec2(1.0f));
+
+	// Side planes through the rays of adjacent corners, listed around the
+	// rectangle; each plane contains both rays' origins and one direction
+	Ray corners[4] = {
+		screen_to_ray(min.x, min.y, screenW, screenH, view, proj),
+		screen_to_ray(max.x, min.y, screenW, screenH, view, proj),
+		screen_to_ray(max.x, max.y, screenW, screenH, view, proj),
+		screen_to_ray(min.x, max.y, screenW, screenH, view, proj),
+	};
+	glm::vec2 mid = (min + max) * 0.5f;
+	Ray center = screen_to_ray(mid.x, mid.y, screenW, screenH, view, proj);
+	glm::vec3 inside = center.origin + center.direction;
+
+	BvhFrustum frustum;
+	for (uint32_t i = 0; i < 4; ++i)
 	{
-		const auto& node = sceneGraph.nodes[i];
-		if (!node.meshIndex.has_value()) continue;
+		const Ray& a = corners[i];
+		const Ray& b = corners[(i + 1) % 4];
+		glm::vec3 normal = glm::normalize(
+			glm::cross(b.origin - a.origin, a.direction));
+		if (glm::dot(normal, inside - a.origin) < 0.0f) normal = -normal;
+		frustum.planes[frustum.planeCount++] =
+			glm::vec4(normal, -glm::dot(normal, a.origin));
+	}
+
+	// Near plane: nothing behind the camera. The view matrix's third row is
+	// the camera's backward axis.
+	glm::vec3 forward = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+	frustum.planes[frustum.planeCount++] =
+		glm::vec4(forward, -glm::dot(forward, center.origin));
+	return frustum;
+}
+
+void Selection::box_select(glm::vec2 corner0, glm::vec2 corner1,
+						   float screenW, float screenH,
+						   const glm::mat4& view, const glm::mat4& proj,
+						   const SceneGraph& sceneGraph,
+						   const std::vector<Mesh>& meshes, Mode mode)
+{
+	sync(sceneGraph, meshes);
+	BvhFrustum frustum =
+		screen_frustum(glm::min(corner0, corner1), glm::max(corner0, corner1),
+					   screenW, screenH, view, proj);
 
-		uint32_t mi = node.meshIndex.value();
-		if (mi >= meshes.size()) continue;
+	std::vector<uint32_t> nodes;
+	sceneBvh_.query(frustum, nodes);
+	std::sort(nodes.begin(), nodes.end());
+	apply(nodes, mode);
+}
+
+// Even-odd rule: count the polygon edges crossed by a ray towards +x
+static bool point_in_polygon(glm::vec2 p, std::span<const glm::vec2> polygon)
+{
+	bool inside = false;
+	for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+	{
+		glm::vec2 a = polygon[i];
+		glm::vec2 b = polygon[j];
+		if ((a.y > p.y) == (b.y > p.y)) continue;
+		float x = a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x);
+		if (p.x < x) inside = !inside;
+	}
+	return inside;
+}
 
-		float t = 0.0f;
-		if (ray_aabb(ray, meshes[mi].localBounds, node.worldTransform, t))
+void Selection::lasso_select(std::span<const glm::vec2> points, float screenW,
+							 float screenH, const glm::mat4& view,
+							 const glm::mat4& proj,
+							 const SceneGraph& sceneGraph,
+							 const std::vector<Mesh>& meshes, Mode mode)
+{
+	std::vector<uint32_t> nodes;
+	if (points.size() < 3)
+	{
+		apply(nodes, mode);
+		return;
+	}
+
+	glm::vec2 min = points[0];
+	glm::vec2 max = points[0];
+	for (glm::vec2 p : points)
+	{
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	sync(sceneGraph, meshes);
+	std::vector<uint32_t> candidates;
+	sceneBvh_.query(screen_frustum(min, max, screenW, screenH, view, proj),
+					candidates);
+
+	// The rectangle query is conservative; keep the nodes whose bounds'
+	// center lands inside the lasso itself
+	glm::mat4 viewProj = proj * view;
+	for (uint32_t n : candidates)
+	{
+		const AABB& bounds = meshes[*sceneGraph.nodes[n].meshIndex].localBounds;
+		glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+		glm::vec4 clip =
+			viewProj * sceneGraph.world_transform(n) * glm::vec4(center, 1.0f);
+		if (clip.w <= 0.0f) continue;
+		glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		glm::vec2 screen((ndc.x + 1.0f) * 0.5f * screenW,
+						 (1.0f - ndc.y) * 0.5f * screenH);
+		if (point_in_polygon(screen, points)) nodes.push_back(n);
+	}
+	std::sort(nodes.begin(), nodes.end());
+	apply(nodes, mode);
+}
+
+void Selection::select_mesh(std::optional<uint32_t> meshIndex,
+							const SceneGraph& sceneGraph, Mode mode)
+{
+	if (meshIndex.has_value())
+	{
+		for (uint32_t i = 0;
+			 i < static_cast<uint32_t>(sceneGraph.nodes.size()); ++i)
 		{
-			if (t < closestT)
+			if (sceneGraph.nodes[i].meshIndex == meshIndex)
 			{
-				closestT = t;
-				closestNode = i;
+				select(i, mode);
+				return;
 			}
 		}
 	}
+	select(std::nullopt, mode);
+}
+
+void Selection::invalidate()
+{
+	meshBvhs_.clear();
+	sceneBvhValid_ = false;
+	movedNodes_.clear();
+}
+
+void Selection::meshes_removed(const std::vector<uint32_t>& meshRemap)
+{
+	// Remaining meshes keep their order, so their BVHs compact in place
+	uint32_t count =
+		static_cast<uint32_t>(std::min(meshRemap.size(), meshBvhs_.size()));
+	for (uint32_t mi = 0; mi < count; ++mi)
+		if (meshRemap[mi] != SceneGraph::NO_INDEX && meshRemap[mi] != mi)
+			meshBvhs_[meshRemap[mi]] = std::move(meshBvhs_[mi]);
+	uint32_t kept = 0;
+	for (uint32_t mi = 0; mi < count; ++mi)
+		if (meshRemap[mi] != SceneGraph::NO_INDEX) ++kept;
+	meshBvhs_.resize(kept);
+	sceneBvhValid_ = false;
+}
+
+void Selection::sync(const SceneGraph& sceneGraph,
+					 const std::vector<Mesh>& meshes)
+{
+	// Bottom level: build the meshes added since the last pick
+	if (meshBvhs_.size() > meshes.size()) meshBvhs_.clear();
+	if (meshBvhs_.size() < meshes.size())
+	{
+		sceneBvhValid_ = false;
+		size_t first = meshBvhs_.size();
+		meshBvhs_.resize(meshes.size());
+		for (size_t mi = first; mi < meshes.size(); ++mi)
+			meshBvhs_[mi].build(meshes[mi].vertices, meshes[mi].indices);
+	}
+
+	// Top level: a full build when nodes changed, else refit what moved
+	if (!sceneBvhValid_ || sceneNodeCount_ != sceneGraph.nodes.size())
+	{
+		sceneBvh_.build(sceneGraph, meshes);
+		sceneBvhValid_ = true;
+		sceneNodeCount_ = sceneGraph.nodes.size();
+		movedNodes_.clear();
+		return;
+	}
 
-	selectedNode = closestNode;
+	std::vector<uint32_t> stack;
+	for (uint32_t nodeIdx : movedNodes_)
+	{
+		if (nodeIdx >= sceneGraph.nodes.size()) continue;
+		stack.push_back(nodeIdx);
+		while (!stack.empty())
+		{
+			uint32_t n = stack.back();
+			stack.pop_back();
+			sceneBvh_.refit(n, sceneGraph);
+			for (uint32_t child : sceneGraph.nodes[n].children)
+				stack.push_back(child);
+		}
+	}
+	movedNodes_.clear();
 }
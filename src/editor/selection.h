@@ -3,10 +3,11 @@
 #include <cstdint>
 #include <glm/glm.hpp>
 #include <optional>
+#include <span>
 #include <vector>
 
-struct AABB;
-struct Mesh;
+#include "bvh.h"
+
 struct SceneGraph;
 
 struct Ray
@@ -15,18 +16,81 @@ struct Ray
 	glm::vec3 direction;
 };
 
+// Set of selected nodes. Clicks pick the nearest triangle under the cursor;
+// marquee and lasso drags query the scene BVH with the volume under the
+// screen region. The BVHs are built lazily on the first query and kept
+// between queries; tell the selection what changed through the
+// notifications below.
 struct Selection
 {
+	// How a click or drag combines with the current selection
+	enum class Mode
+	{
+		Replace,
+		Add,	 // Shift
+		Toggle,	 // Ctrl
+	};
+
+	// Active node: the gizmo sits on it and the hierarchy panel shows it.
+	// Always one of selectedNodes when set.
 	std::optional<uint32_t> selectedNode;
+	std::vector<uint32_t> selectedNodes;  // sorted
+
+	bool is_selected(uint32_t nodeIdx) const;
+	// An empty nodeIdx (a click on nothing) clears in Replace mode
+	void select(std::optional<uint32_t> nodeIdx, Mode mode = Mode::Replace);
+	void clear();
 
 	static Ray screen_to_ray(float mouseX, float mouseY, float screenW,
 							 float screenH, const glm::mat4& view,
 							 const glm::mat4& proj);
 
-	static bool ray_aabb(const Ray& ray, const AABB& aabb,
-						 const glm::mat4& transform, float& tOut);
-
 	void pick(float mouseX, float mouseY, float screenW, float screenH,
 			  const glm::mat4& view, const glm::mat4& proj,
-			  const SceneGraph& sceneGraph, const std::vector<Mesh>& meshes);
+			  const SceneGraph& sceneGraph, const std::vector<Mesh>& meshes,
+			  Mode mode = Mode::Replace);
+
+	// Marquee: the nodes whose bounds reach into the rectangle between two
+	// screen corners
+	void box_select(glm::vec2 corner0, glm::vec2 corner1, float screenW,
+					float screenH, const glm::mat4& view,
+					const glm::mat4& proj, const SceneGraph& sceneGraph,
+					const std::vector<Mesh>& meshes, Mode mode);
+	// Lasso: the nodes whose bounds' center projects inside the polygon.
+	// The BVH query uses the polygon's bounding rectangle.
+	void lasso_select(std::span<const glm::vec2> points, float screenW,
+					  float screenH, const glm::mat4& view,
+					  const glm::mat4& proj, const SceneGraph& sceneGraph,
+					  const std::vector<Mesh>& meshes, Mode mode);
+
+	// GPU picking backend: selects the node drawing meshIndex, as read back
+	// from the renderer's object ID image (nothing when empty)
+	void select_mesh(std::optional<uint32_t> meshIndex,
+					 const SceneGraph& sceneGraph, Mode mode = Mode::Replace);
+
+	// All meshes were replaced (new or loaded scene)
+	void invalidate();
+	// Nodes or meshes were added, or nodes reparented
+	void scene_changed() { sceneBvhValid_ = false; }
+	// Meshes were deleted; meshRemap maps old to new indices, NO_INDEX
+	// for the deleted ones
+	void meshes_removed(const std::vector<uint32_t>& meshRemap);
+	// The node's transform changed; its subtree is refit on the next pick
+	void node_moved(uint32_t nodeIdx) { movedNodes_.push_back(nodeIdx); }
+
+   private:
+	std::vector<MeshBvh> meshBvhs_;	 // per mesh, same indices as meshes
+	SceneBvh sceneBvh_;
+	bool sceneBvhValid_ = false;
+	size_t sceneNodeCount_ = 0;
+	std::vector<uint32_t> movedNodes_;
+
+	void sync(const SceneGraph& sceneGraph, const std::vector<Mesh>& meshes);
+	// nodes: sorted, no duplicates
+	void apply(const std::vector<uint32_t>& nodes, Mode mode);
+	// Volume under the screen rectangle [min, max], from the near plane on
+	static BvhFrustum screen_frustum(glm::vec2 min, glm::vec2 max,
+									 float screenW, float screenH,
+									 const glm::mat4& view,
+									 const glm::mat4& proj);
 };
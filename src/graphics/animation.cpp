@@ -0,0 +1,410 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "core/threadPool.h"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64)
+#include <xmmintrin.h>
+#define ANIMATION_SSE 1
+#endif
+
+// =============================================================================
+// Sampling helpers
+// =============================================================================
+
+// Key k with times[k] <= t < times[k + 1], tried at the cursor and the key
+// after it before falling back to a binary search. Times before the first
+// key give key 0 and times past the last key give the last key.
+static uint32_t find_key(const float* times, uint32_t count, float t,
+						 uint32_t& cursor)
+{
+	if (count < 2 || t <= times[0]) return cursor = 0;
+	if (t >= times[count - 1]) return cursor = count - 1;
+
+	// Playback moves forward by less than a key per frame almost always
+	uint32_t k = cursor;
+	if (k + 1 < count && times[k] <= t)
+	{
+		if (t < times[k + 1]) return k;
+		if (k + 2 < count && t < times[k + 2]) return cursor = k + 1;
+	}
+	k = static_cast<uint32_t>(std::upper_bound(times, times + count, t) -
+							  times) -
+		1;
+	return cursor = k;
+}
+
+// Cubic Hermite basis for the value and the out-tangent of key k and the
+// value and the in-tangent of key k + 1. Tangents are scaled by the key
+// interval dt (glTF 2.0, appendix C).
+static void hermite_basis(float t, float dt, float h[4])
+{
+	float t2 = t * t, t3 = t2 * t;
+	h[0] = 2.0f * t3 - 3.0f * t2 + 1.0f;
+	h[1] = dt * (t3 - 2.0f * t2 + t);
+	h[2] = -2.0f * t3 + 3.0f * t2;
+	h[3] = dt * (t3 - t2);
+}
+
+static glm::vec4 lerp(const glm::vec4& a, const glm::vec4& b, float t)
+{
+	return a + (b - a) * t;
+}
+
+static glm::vec4 normalize_quat(const glm::vec4& q)
+{
+	float len = std::sqrt(glm::dot(q, q));
+	return len > 0.0f ? q / len : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// Column-major translation * rotation * scale
+static glm::mat4 compose(const glm::vec3& t, const glm::vec4& q,
+						 const glm::vec3& s)
+{
+	float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+	glm::mat4 m(1.0f);
+	m[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz),
+					 2.0f * (xz - wy), 0.0f) *
+		   s.x;
+	m[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz),
+					 2.0f * (yz + wx), 0.0f) *
+		   s.y;
+	m[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx),
+					 1.0f - 2.0f * (xx + yy), 0.0f) *
+		   s.z;
+	m[3] = glm::vec4(t, 1.0f);
+	return m;
+}
+
+// Morph weights of a channel at key k, interpolated one float at a time.
+// Cubic spline keys hold all in-tangents, then all values, then all
+// out-tangents.
+static void sample_weights(const float* times, const float* values,
+						   Interpolation interpolation, uint32_t k,
+						   bool between, float time, std::span<float> out)
+{
+	size_t n = out.size();
+	if (interpolation == Interpolation::CubicSpline)
+	{
+		const float* v0 = values + (k * 3 + 1) * n;
+		if (!between)
+		{
+			std::copy(v0, v0 + n, out.begin());
+			return;
+		}
+		float dt = times[k + 1] - times[k];
+		float h[4];
+		hermite_basis((time - times[k]) / dt, dt, h);
+		const float* out0 = v0 + n;
+		const float* in1 = v0 + 2 * n;
+		const float* v1 = v0 + 3 * n;
+		for (size_t i = 0; i < n; ++i)
+			out[i] = v0[i] * h[0] + out0[i] * h[1] + v1[i] * h[2] +
+					 in1[i] * h[3];
+	}
+	else if (interpolation == Interpolation::Linear && between)
+	{
+		float t = (time - times[k]) / (times[k + 1] - times[k]);
+		const float* v0 = values + k * n;
+		const float* v1 = v0 + n;
+		for (size_t i = 0; i < n; ++i) out[i] = v0[i] + (v1[i] - v0[i]) * t;
+	}
+	else
+	{
+		std::copy(values + k * n, values + (k + 1) * n, out.begin());
+	}
+}
+
+// =============================================================================
+// Quaternion interpolation
+// =============================================================================
+
+// The corrected t bends nlerp's parameter towards slerp's constant angular
+// velocity; the polynomial fits the correction over the angle between the
+// two quaternions (Kapoulkine, "Approximating slerp")
+void slerp4(const glm::vec4 a[4], const glm::vec4 b[4], const float t[4],
+			glm::vec4 out[4])
+{
+#ifdef ANIMATION_SSE
+	// Four quaternions per register, one component each
+	__m128 ax = _mm_loadu_ps(&a[0].x), ay = _mm_loadu_ps(&a[1].x);
+	__m128 az = _mm_loadu_ps(&a[2].x), aw = _mm_loadu_ps(&a[3].x);
+	_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+	__m128 bx = _mm_loadu_ps(&b[0].x), by = _mm_loadu_ps(&b[1].x);
+	__m128 bz = _mm_loadu_ps(&b[2].x), bw = _mm_loadu_ps(&b[3].x);
+	_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+	__m128 tt = _mm_loadu_ps(t);
+
+	// Shortest arc: flip b where the quaternions point apart
+	__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)),
+						  _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+	__m128 sign = _mm_and_ps(d, _mm_set1_ps(-0.0f));
+	d = _mm_xor_ps(d, sign);
+	bx = _mm_xor_ps(bx, sign);
+	by = _mm_xor_ps(by, sign);
+	bz = _mm_xor_ps(bz, sign);
+	bw = _mm_xor_ps(bw, sign);
+
+	auto madd = [](__m128 x, __m128 y, __m128 z)
+	{ return _mm_add_ps(_mm_mul_ps(x, y), z); };
+	__m128 ka = madd(
+		d,
+		madd(d,
+			 madd(d, _mm_set1_ps(-1.43519f), _mm_set1_ps(3.55645f)),
+			 _mm_set1_ps(-3.2452f)),
+		_mm_set1_ps(1.0904f));
+	__m128 kb =
+		madd(d, madd(d, _mm_set1_ps(0.215638f), _mm_set1_ps(-1.06021f)),
+			 _mm_set1_ps(0.848013f));
+	__m128 tc = _mm_sub_ps(tt, _mm_set1_ps(0.5f));
+	__m128 k = madd(_mm_mul_ps(ka, tc), tc, kb);
+	__m128 ot = madd(
+		_mm_mul_ps(_mm_mul_ps(tt, tc), _mm_sub_ps(tt, _mm_set1_ps(1.0f))),
+		k, tt);
+
+	__m128 rx = madd(_mm_sub_ps(bx, ax), ot, ax);
+	__m128 ry = madd(_mm_sub_ps(by, ay), ot, ay);
+	__m128 rz = madd(_mm_sub_ps(bz, az), ot, az);
+	__m128 rw = madd(_mm_sub_ps(bw, aw), ot, aw);
+	__m128 len = _mm_sqrt_ps(
+		_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)),
+				   _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+	__m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), len);
+	rx = _mm_mul_ps(rx, inv);
+	ry = _mm_mul_ps(ry, inv);
+	rz = _mm_mul_ps(rz, inv);
+	rw = _mm_mul_ps(rw, inv);
+
+	_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+	_mm_storeu_ps(&out[0].x, rx);
+	_mm_storeu_ps(&out[1].x, ry);
+	_mm_storeu_ps(&out[2].x, rz);
+	_mm_storeu_ps(&out[3].x, rw);
+#else
+	for (int i = 0; i < 4; ++i)
+	{
+		glm::vec4 to = b[i];
+		float d = glm::dot(a[i], to);
+		if (d < 0.0f)
+		{
+			to = to * -1.0f;
+			d = -d;
+		}
+		float ka = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+		float kb = 0.848013f + d * (-1.06021f + d * 0.215638f);
+		float tc = t[i] - 0.5f;
+		float k = ka * tc * tc + kb;
+		float ot = t[i] + t[i] * tc * (t[i] - 1.0f) * k;
+		out[i] = normalize_quat(lerp(a[i], to, ot));
+	}
+#endif
+}
+
+// =============================================================================
+// AnimationSet
+// =============================================================================
+
+void AnimationSet::sort_nodes()
+{
+	// Depth in the hierarchy; a stable sort by it puts parents first
+	std::vector<uint32_t> depth(nodes.size(), 0);
+	for (size_t i = 0; i < nodes.size(); ++i)
+		for (int32_t p = nodes[i].parent; p >= 0 && depth[i] < nodes.size();
+			 p = nodes[p].parent)
+			++depth[i];
+
+	order.resize(nodes.size());
+	for (uint32_t i = 0; i < static_cast<uint32_t>(order.size()); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+					 [&](uint32_t a, uint32_t b)
+					 { return depth[a] < depth[b]; });
+}
+
+void AnimationSet::advance(float dt)
+{
+	bool playable = clip >= 0 && clip < static_cast<int32_t>(clips.size());
+	if (!playable)
+	{
+		// At rest: one pose is enough
+		if (locals.size() != nodes.size()) sample();
+		return;
+	}
+
+	float duration = clips[clip].duration;
+	time += dt * speed;
+	if (duration > 0.0f)
+	{
+		time = std::fmod(time, duration);
+		if (time < 0.0f) time += duration;
+	}
+	else
+	{
+		time = 0.0f;
+	}
+	sample();
+}
+
+void AnimationSet::sample()
+{
+	size_t count = nodes.size();
+	locals.resize(count);
+	globals.resize(count);
+	translations_.resize(count);
+	rotations_.resize(count);
+	scales_.resize(count);
+	animated_.assign(count, 0);
+	weights = restWeights;
+	changed = true;
+
+	if (clip >= 0 && clip < static_cast<int32_t>(clips.size()))
+	{
+		const AnimationClip& c = clips[clip];
+		if (cursorClip_ != clip)
+		{
+			cursors_.assign(c.channels.size(), 0);
+			cursorClip_ = clip;
+		}
+
+		// Linear rotations are slerped four at a time
+		glm::vec4 batchA[4], batchB[4], batchOut[4];
+		float batchT[4];
+		uint32_t batchNodes[4];
+		uint32_t batched = 0;
+		auto flush = [&]()
+		{
+			for (uint32_t i = batched; i < 4; ++i)
+			{
+				batchA[i] = batchB[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+				batchT[i] = 0.0f;
+			}
+			slerp4(batchA, batchB, batchT, batchOut);
+			for (uint32_t i = 0; i < batched; ++i)
+				rotations_[batchNodes[i]] = batchOut[i];
+			batched = 0;
+		};
+
+		for (size_t ci = 0; ci < c.channels.size(); ++ci)
+		{
+			const AnimationChannel& ch = c.channels[ci];
+			if (ch.keyCount == 0 || ch.node >= count) continue;
+			const float* times = c.times.data() + ch.firstKey;
+			uint32_t k = find_key(times, ch.keyCount, time, cursors_[ci]);
+			bool between = k + 1 < ch.keyCount && time > times[k];
+
+			if (ch.path == AnimationPath::Weights)
+			{
+				const AnimationNode& node = nodes[ch.node];
+				sample_weights(times, c.weights.data() + ch.firstValue,
+							   ch.interpolation, k, between, time,
+							   std::span<float>(weights.data() +
+													node.firstWeight,
+												node.weightCount));
+				continue;
+			}
+
+			if (!animated_[ch.node])
+			{
+				// Properties without a channel keep their rest value
+				const AnimationNode& node = nodes[ch.node];
+				translations_[ch.node] = node.translation;
+				rotations_[ch.node] = node.rotation;
+				scales_[ch.node] = node.scale;
+				animated_[ch.node] = 1;
+			}
+
+			const glm::vec4* values = c.values.data() + ch.firstValue;
+
+			glm::vec4 v;
+			if (ch.interpolation == Interpolation::CubicSpline)
+			{
+				if (!between)
+				{
+					v = values[k * 3 + 1];
+				}
+				else
+				{
+					float dt = times[k + 1] - times[k];
+					float h[4];
+					hermite_basis((time - times[k]) / dt, dt, h);
+					v = values[k * 3 + 1] * h[0] + values[k * 3 + 2] * h[1] +
+						values[k * 3 + 4] * h[2] + values[k * 3 + 3] * h[3];
+				}
+				if (ch.path == AnimationPath::Rotation) v = normalize_quat(v);
+			}
+			else if (ch.interpolation == Interpolation::Linear && between)
+			{
+				float t = (time - times[k]) / (times[k + 1] - times[k]);
+				if (ch.path == AnimationPath::Rotation)
+				{
+					batchA[batched] = values[k];
+					batchB[batched] = values[k + 1];
+					batchT[batched] = t;
+					batchNodes[batched] = ch.node;
+					if (++batched == 4) flush();
+					continue;
+				}
+				v = lerp(values[k], values[k + 1], t);
+			}
+			else
+			{
+				v = values[k];
+			}
+
+			switch (ch.path)
+			{
+				case AnimationPath::Translation:
+					translations_[ch.node] = glm::vec3(v);
+					break;
+				case AnimationPath::Rotation:
+					rotations_[ch.node] = v;
+					break;
+				case AnimationPath::Scale:
+					scales_[ch.node] = glm::vec3(v);
+					break;
+				case AnimationPath::Weights:
+					break;
+			}
+		}
+		if (batched > 0) flush();
+	}
+
+	for (uint32_t i : order)
+	{
+		const AnimationNode& node = nodes[i];
+		locals[i] = animated_[i]
+						? compose(translations_[i], rotations_[i], scales_[i])
+						: node.rest;
+		globals[i] =
+			node.parent >= 0 ? globals[node.parent] * locals[i] : locals[i];
+	}
+}
+
+uint32_t AnimationSet::animated_node_count() const
+{
+	return static_cast<uint32_t>(
+		std::count(animated_.begin(), animated_.end(), uint8_t{1}));
+}
+
+// =============================================================================
+// Playback
+// =============================================================================
+
+void animate(std::span<AnimationSet> sets, float dt, ThreadPool* pool)
+{
+	auto run = [sets, dt](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; ++i) sets[i].advance(dt);
+	};
+
+	auto count = static_cast<uint32_t>(sets.size());
+	if (pool && count >= ANIMATION_PARALLEL_MIN_SETS)
+		pool->parallel_for(count, ANIMATION_PARALLEL_MIN_SETS / 4, run);
+	else
+		run(0, count);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+struct ThreadPool;
+
+// =============================================================================
+// Animation
+// =============================================================================
+
+enum class AnimationPath : uint8_t
+{
+	Translation,
+	Rotation,  // quaternion, xyzw
+	Scale,
+	Weights,  // morph target weights of the node's mesh
+};
+
+enum class Interpolation : uint8_t
+{
+	Step,
+	Linear,
+	CubicSpline,
+};
+
+// One animated property of one node. Keys and values live in the clip's
+// shared arrays; cubic spline channels store three values per key
+// (in-tangent, value, out-tangent) like glTF does. A weights value is the
+// node's AnimationNode::weightCount floats.
+struct AnimationChannel
+{
+	uint32_t node = 0;	// into AnimationSet::nodes
+	AnimationPath path = AnimationPath::Translation;
+	Interpolation interpolation = Interpolation::Linear;
+	uint32_t firstKey = 0;	// into AnimationClip::times
+	uint32_t keyCount = 0;
+	uint32_t firstValue = 0;  // into AnimationClip::values or ::weights
+};
+
+struct AnimationClip
+{
+	std::string name;
+	float duration = 0.0f;
+	std::vector<AnimationChannel> channels;
+	// Every channel's keys back to back, so sampling walks two arrays
+	std::vector<float> times;
+	std::vector<glm::vec4> values;	// translation / scale use xyz
+	std::vector<float> weights;
+};
+
+// A glTF node as animation sees it: its rest pose, split into TRS so
+// channels can replace one property and keep the others
+struct AnimationNode
+{
+	int32_t parent = -1;
+	glm::vec3 translation{0.0f};
+	glm::vec4 rotation{0.0f, 0.0f, 0.0f, 1.0f};
+	glm::vec3 scale{1.0f};
+	glm::mat4 rest{1.0f};  // also covers nodes given as a matrix
+	// Morph target weights, in AnimationSet::weights
+	uint32_t firstWeight = 0;
+	uint32_t weightCount = 0;
+};
+
+// The node hierarchy of one glTF file with its clips and playback state.
+// Nodes keep glTF node order, which is what Mesh::animationNode and
+// SkinJoint::node index.
+struct AnimationSet
+{
+	std::vector<AnimationNode> nodes;
+	std::vector<uint32_t> order;  // node indices, parents before children
+	std::vector<AnimationClip> clips;
+	std::vector<float> restWeights;	 // every node's weights, back to back
+
+	// Playback; time wraps at the clip's duration
+	int32_t clip = 0;  // -1 leaves the nodes at rest
+	float time = 0.0f;
+	float speed = 1.0f;
+
+	// Pose as of the last sample(), one per node
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> globals;	 // model space
+	std::vector<float> weights;		 // laid out like restWeights
+	// Set by sample(); whoever copies the pose out clears it
+	bool changed = false;
+
+	// Fills `order` from the nodes' parents
+	void sort_nodes();
+	// Moves the time on by dt * speed and samples the current clip
+	void advance(float dt);
+	// Poses locals / globals at the current time. The first call after a
+	// clip change searches every channel's keys; later ones start from
+	// the key the channel was last at.
+	void sample();
+	uint32_t animated_node_count() const;
+
+   private:
+	// Key each channel of the current clip was last sampled at
+	std::vector<uint32_t> cursors_;
+	int32_t cursorClip_ = -1;
+	// Scratch TRS, one per node
+	std::vector<glm::vec3> translations_;
+	std::vector<glm::vec4> rotations_;
+	std::vector<glm::vec3> scales_;
+	std::vector<uint8_t> animated_;
+};
+
+// Sets animate() advances before it spreads them over the thread pool
+static constexpr uint32_t ANIMATION_PARALLEL_MIN_SETS = 64;
+
+// Advances and samples every set; sets are independent, so many of them
+// are spread over `pool` when one is given
+void animate(std::span<AnimationSet> sets, float dt,
+			 ThreadPool* pool = nullptr);
+
+// Spherical interpolation of unit quaternions (xyzw), four at a time:
+// out[i] = slerp(a[i], b[i], t[i]). Uses a normalized lerp with a
+// corrected t, which stays within 4e-4 of slerp at a fraction of its cost.
+void slerp4(const glm::vec4 a[4], const glm::vec4 b[4], const float t[4],
+			glm::vec4 out[4]);
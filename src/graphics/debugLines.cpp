@@ -139,3 +139,21 @@ std::vector<LineVertex> generate_light_lines(const LightEnvironment& lights)
 
 	return verts;
 }
+
+void append_box_lines(std::vector<LineVertex>& out, const glm::vec3& min,
+					  const glm::vec3& max, const glm::mat4& transform,
+					  const glm::vec3& color)
+{
+	// Corner i takes max on the axes whose bit is set
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		glm::vec3 local((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y,
+						(i & 4) ? max.z : min.z);
+		corners[i] = glm::vec3(transform * glm::vec4(local, 1.0f));
+	}
+	// Edges join corners that differ in exactly one bit
+	for (int i = 0; i < 8; ++i)
+		for (int bit = 1; bit < 8; bit <<= 1)
+			if (!(i & bit)) add_line(out, corners[i], corners[i | bit], color);
+}
@@ -31,3 +31,8 @@ struct LineVertex
 };
 
 std::vector<LineVertex> generate_light_lines(const LightEnvironment& lights);
+
+// Appends the 12 edges of the box [min, max] under `transform`
+void append_box_lines(std::vector<LineVertex>& out, const glm::vec3& min,
+					  const glm::vec3& max, const glm::mat4& transform,
+					  const glm::vec3& color);
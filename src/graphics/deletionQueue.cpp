@@ -0,0 +1,25 @@
+#include "deletionQueue.h"
+
+#include <utility>
+
+void DeletionQueue::push(uint64_t frame, std::function<void()> destroy)
+{
+	entries_.push_back({frame, std::move(destroy)});
+}
+
+void DeletionQueue::flush(uint64_t completed)
+{
+	// Tags grow but for the odd entry tagged a frame ahead, which only holds
+	// back the entries behind it, so the completed ones are at the front
+	while (!entries_.empty() && entries_.front().frame <= completed)
+	{
+		entries_.front().destroy();
+		entries_.pop_front();
+	}
+}
+
+void DeletionQueue::flush_all()
+{
+	for (auto& e : entries_) e.destroy();
+	entries_.clear();
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// =============================================================================
+// Deletion queue
+// =============================================================================
+
+// Defers destruction of GPU objects until the frame that last used them has
+// finished. Frames are numbered in submission order and retire in that
+// order, so once frame N is known complete every entry tagged <= N can go.
+struct DeletionQueue
+{
+	// `frame` is the last submitted frame that may still reference the
+	// objects destroyed by `destroy` (the next one for work submitted
+	// between frames)
+	void push(uint64_t frame, std::function<void()> destroy);
+
+	// Runs the callbacks of every frame up to and including `completed`
+	void flush(uint64_t completed);
+
+	// Only once the device is idle
+	void flush_all();
+
+	size_t size() const { return entries_.size(); }
+
+   private:
+	struct Entry
+	{
+		uint64_t frame;
+		std::function<void()> destroy;
+	};
+	std::deque<Entry> entries_;
+};
@@ -0,0 +1,197 @@
+#include "frameCapture.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "logger.h"
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+static bool has_extension(const std::string& path, const char* ext)
+{
+	size_t n = std::strlen(ext);
+	if (path.size() < n) return false;
+	for (size_t i = 0; i < n; ++i)
+	{
+		char c = path[path.size() - n + i];
+		if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+		if (c != ext[i]) return false;
+	}
+	return true;
+}
+
+static float srgb_to_linear(uint8_t v)
+{
+	float c = static_cast<float>(v) / 255.0f;
+	if (c <= 0.04045f) return c / 12.92f;
+	return std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// Little-endian writers for the OpenEXR header (all supported hosts are LE)
+template <typename T>
+static void put(std::vector<char>& out, T v)
+{
+	const char* p = reinterpret_cast<const char*>(&v);
+	out.insert(out.end(), p, p + sizeof(T));
+}
+
+static void put_str(std::vector<char>& out, const char* s)
+{
+	out.insert(out.end(), s, s + std::strlen(s) + 1);
+}
+
+static void put_attr(std::vector<char>& out, const char* name,
+					 const char* type, int32_t size)
+{
+	put_str(out, name);
+	put_str(out, type);
+	put(out, size);
+}
+
+// =============================================================================
+// PNG
+// =============================================================================
+
+static bool write_png(const std::string& path, uint32_t width, uint32_t height,
+					  const std::vector<uint8_t>& rgba)
+{
+	int stride = static_cast<int>(width) * 4;
+	return stbi_write_png(path.c_str(), static_cast<int>(width),
+						  static_cast<int>(height), 4, rgba.data(),
+						  stride) != 0;
+}
+
+// =============================================================================
+// OpenEXR (single-part scanline, no compression, FLOAT channels)
+// =============================================================================
+
+static bool write_exr(const std::string& path, uint32_t width, uint32_t height,
+					  const std::vector<uint8_t>& rgba)
+{
+	// Channels must be listed in alphabetical order
+	static constexpr const char* CHANNELS[] = {"A", "B", "G", "R"};
+	static constexpr int CHANNEL_SOURCE[] = {3, 2, 1, 0};
+	static constexpr int32_t PIXEL_TYPE_FLOAT = 2;
+
+	std::vector<char> header;
+	put<int32_t>(header, 20000630);	 // magic
+	put<int32_t>(header, 2);		 // version 2, single-part scanline
+
+	put_attr(header, "channels", "chlist", 4 * 18 + 1);
+	for (const char* ch : CHANNELS)
+	{
+		put_str(header, ch);
+		put<int32_t>(header, PIXEL_TYPE_FLOAT);
+		put<uint8_t>(header, 0);  // pLinear
+		put<uint8_t>(header, 0);  // reserved
+		put<uint8_t>(header, 0);
+		put<uint8_t>(header, 0);
+		put<int32_t>(header, 1);  // xSampling
+		put<int32_t>(header, 1);  // ySampling
+	}
+	put<uint8_t>(header, 0);
+
+	put_attr(header, "compression", "compression", 1);
+	put<uint8_t>(header, 0);  // NO_COMPRESSION
+
+	for (const char* window : {"dataWindow", "displayWindow"})
+	{
+		put_attr(header, window, "box2i", 16);
+		put<int32_t>(header, 0);
+		put<int32_t>(header, 0);
+		put<int32_t>(header, static_cast<int32_t>(width) - 1);
+		put<int32_t>(header, static_cast<int32_t>(height) - 1);
+	}
+
+	put_attr(header, "lineOrder", "lineOrder", 1);
+	put<uint8_t>(header, 0);  // INCREASING_Y
+
+	put_attr(header, "pixelAspectRatio", "float", 4);
+	put<float>(header, 1.0f);
+
+	put_attr(header, "screenWindowCenter", "v2f", 8);
+	put<float>(header, 0.0f);
+	put<float>(header, 0.0f);
+
+	put_attr(header, "screenWindowWidth", "float", 4);
+	put<float>(header, 1.0f);
+
+	put<uint8_t>(header, 0);  // end of header
+
+	// One scanline per block: y (int32), byte count (int32), channel planes
+	uint64_t lineBytes = static_cast<uint64_t>(width) * 4 * sizeof(float);
+	uint64_t blockBytes = 2 * sizeof(int32_t) + lineBytes;
+	uint64_t firstBlock = header.size() + sizeof(uint64_t) * height;
+
+	std::vector<char> offsets;
+	for (uint32_t y = 0; y < height; ++y)
+		put<uint64_t>(offsets, firstBlock + y * blockBytes);
+
+	std::ofstream f(path, std::ios::binary);
+	if (!f) return false;
+	f.write(header.data(), static_cast<std::streamsize>(header.size()));
+	f.write(offsets.data(), static_cast<std::streamsize>(offsets.size()));
+
+	// sRGB decode once per byte value
+	float lut[256];
+	for (int i = 0; i < 256; ++i)
+		lut[i] = srgb_to_linear(static_cast<uint8_t>(i));
+
+	std::vector<char> block;
+	block.reserve(blockBytes);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		block.clear();
+		put<int32_t>(block, static_cast<int32_t>(y));
+		put<int32_t>(block, static_cast<int32_t>(lineBytes));
+		const uint8_t* row = rgba.data() + static_cast<size_t>(y) * width * 4;
+		for (int c = 0; c < 4; ++c)
+		{
+			int src = CHANNEL_SOURCE[c];
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint8_t v = row[x * 4 + src];
+				put<float>(block, src == 3 ? v / 255.0f : lut[v]);
+			}
+		}
+		f.write(block.data(), static_cast<std::streamsize>(block.size()));
+	}
+	return static_cast<bool>(f);
+}
+
+// =============================================================================
+// Public API
+// =============================================================================
+
+bool write_frame_image(const std::string& path, uint32_t width,
+					   uint32_t height, const std::vector<uint8_t>& rgba)
+{
+	if (rgba.size() < static_cast<size_t>(width) * height * 4)
+	{
+		LOG_ERROR("write_frame_image: pixel buffer too small for %ux%u", width,
+				  height);
+		return false;
+	}
+
+	bool ok = false;
+	if (has_extension(path, ".png"))
+		ok = write_png(path, width, height, rgba);
+	else if (has_extension(path, ".exr"))
+		ok = write_exr(path, width, height, rgba);
+	else
+	{
+		LOG_ERROR("write_frame_image: unsupported extension in '%s' "
+				  "(use .png or .exr)",
+				  path.c_str());
+		return false;
+	}
+
+	if (!ok) LOG_ERROR("write_frame_image: failed to write '%s'", path.c_str());
+	return ok;
+}
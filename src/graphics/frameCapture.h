@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Frame capture
+// =============================================================================
+
+// Write a read-back frame to disk. Pixels are tightly packed 8-bit RGBA,
+// sRGB-encoded, top row first. The format is picked from the extension:
+//   .png  8-bit sRGB (stb_image_write)
+//   .exr  32-bit float linear RGBA, uncompressed scanlines
+// Returns false (and logs) on an unknown extension or I/O failure.
+bool write_frame_image(const std::string& path, uint32_t width,
+					   uint32_t height, const std::vector<uint8_t>& rgba);
@@ -0,0 +1,67 @@
+#include "framePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+void FramePacer::wait()
+{
+	if (targetFps > 0.0f)
+	{
+		auto period = std::chrono::duration_cast<Clock::duration>(
+			std::chrono::duration<double>(1.0 / targetFps));
+		auto now = Clock::now();
+
+		// More than a frame late (or just enabled): restart the schedule
+		// rather than rushing several frames out to catch up
+		if (deadline_ == Clock::time_point{} || now > deadline_ + period)
+		{
+			deadline_ = now;
+		}
+		else
+		{
+			auto spinFrom =
+				deadline_ - std::chrono::duration_cast<Clock::duration>(
+								std::chrono::duration<double, std::milli>(
+									SPIN_MS));
+			if (now < spinFrom) std::this_thread::sleep_until(spinFrom);
+			while (Clock::now() < deadline_)
+			{
+			}
+		}
+		deadline_ += period;
+	}
+	else
+	{
+		deadline_ = {};
+	}
+
+	auto now = Clock::now();
+	if (last_ != Clock::time_point{})
+	{
+		intervals_[count_ % HISTORY] =
+			std::chrono::duration<double, std::milli>(now - last_).count();
+		++count_;
+	}
+	last_ = now;
+}
+
+double FramePacer::frame_interval_ms() const
+{
+	uint64_t n = std::min<uint64_t>(count_, HISTORY);
+	if (n == 0) return 0.0;
+	double sum = 0.0;
+	for (uint64_t i = 0; i < n; ++i) sum += intervals_[i];
+	return sum / static_cast<double>(n);
+}
+
+double FramePacer::jitter_ms() const
+{
+	uint64_t n = std::min<uint64_t>(count_, HISTORY);
+	if (n < 2) return 0.0;
+	double mean = frame_interval_ms();
+	double sq = 0.0;
+	for (uint64_t i = 0; i < n; ++i)
+		sq += (intervals_[i] - mean) * (intervals_[i] - mean);
+	return std::sqrt(sq / static_cast<double>(n));
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// =============================================================================
+// Frame pacer
+// =============================================================================
+
+// CPU frame limiter. wait() sleeps through most of the remaining frame
+// budget and spins the last couple of milliseconds, because OS sleeps can
+// overshoot by a scheduler tick. It also records the interval between
+// successive wait() returns; their standard deviation is the pacing jitter.
+struct FramePacer
+{
+	float targetFps = 0.0f;	 // 0 = unlimited
+
+	// Once per frame, before input is sampled
+	void wait();
+
+	// Over the last HISTORY frames
+	double frame_interval_ms() const;
+	double jitter_ms() const;
+
+   private:
+	using Clock = std::chrono::steady_clock;
+	static constexpr uint32_t HISTORY = 120;
+	static constexpr double SPIN_MS = 2.0;
+
+	Clock::time_point deadline_{};	// earliest start of the next frame
+	Clock::time_point last_{};
+	double intervals_[HISTORY] = {};
+	uint64_t count_ = 0;
+};
@@ -0,0 +1,215 @@
+#include "gpuProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+// =============================================================================
+// Lifecycle
+// =============================================================================
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice,
+					   uint32_t queueFamily, uint32_t framesInFlight,
+					   uint32_t asyncFamily)
+{
+	device_ = device;
+
+	uint32_t qfCnt;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qfCnt, nullptr);
+	std::vector<VkQueueFamilyProperties> qfs(qfCnt);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &qfCnt,
+											 qfs.data());
+	uint32_t validBits = qfs[queueFamily].timestampValidBits;
+	if (validBits == 0)
+	{
+		std::fprintf(stderr,
+					 "GpuProfiler: queue family %u has no timestamp support, "
+					 "GPU timings disabled\n",
+					 queueFamily);
+		return;
+	}
+	if (asyncFamily != VK_QUEUE_FAMILY_IGNORED)
+	{
+		uint32_t asyncBits = qfs[asyncFamily].timestampValidBits;
+		asyncSupported_ = asyncBits > 0;
+		if (asyncSupported_) validBits = std::min(validBits, asyncBits);
+	}
+	validMask_ = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkPhysicalDeviceProperties props;
+	vkGetPhysicalDeviceProperties(physicalDevice, &props);
+	periodNs_ = static_cast<double>(props.limits.timestampPeriod);
+
+	// Queries 0/1 time the whole frame, then a begin/end pair per scope
+	queriesPerSlot_ = 2 + 2 * MAX_SCOPES;
+	slots_.assign(framesInFlight, Slot{});
+
+	VkQueryPoolCreateInfo ci{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+	ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	ci.queryCount = queriesPerSlot_ * framesInFlight;
+	if (vkCreateQueryPool(device_, &ci, nullptr, &pool_) != VK_SUCCESS)
+	{
+		std::fprintf(stderr, "GpuProfiler: failed to create query pool\n");
+		pool_ = VK_NULL_HANDLE;
+	}
+}
+
+void GpuProfiler::cleanup()
+{
+	if (pool_) vkDestroyQueryPool(device_, pool_, nullptr);
+	pool_ = VK_NULL_HANDLE;
+	slots_.clear();
+	open_.clear();
+}
+
+// =============================================================================
+// Recording
+// =============================================================================
+
+void GpuProfiler::begin_frame(VkCommandBuffer cmd, uint32_t slot)
+{
+	if (!pool_) return;
+
+	collect(slot, false);
+
+	current_ = slot;
+	Slot& s = slots_[slot];
+	s.frameNumber = frameCounter_++;
+	s.pending = true;
+	s.names.clear();
+	s.asyncMask = 0;
+	open_.clear();
+
+	vkCmdResetQueryPool(cmd, pool_, query_base(slot), queriesPerSlot_);
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_,
+						query_base(slot));
+}
+
+void GpuProfiler::end_frame(VkCommandBuffer cmd)
+{
+	if (!pool_) return;
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_,
+						query_base(current_) + 1);
+}
+
+void GpuProfiler::begin_scope(VkCommandBuffer cmd, const char* name,
+							  bool async)
+{
+	if (!pool_) return;
+
+	Slot& s = slots_[current_];
+	if (s.names.size() >= MAX_SCOPES || (async && !asyncSupported_))
+	{
+		open_.push_back(UINT32_MAX);  // dropped; keeps end_scope balanced
+		return;
+	}
+
+	uint32_t index = static_cast<uint32_t>(s.names.size());
+	s.names.push_back(name);
+	if (async) s.asyncMask |= 1u << index;
+	open_.push_back(index);
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool_,
+						query_base(current_) + 2 + 2 * index);
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer cmd)
+{
+	if (!pool_ || open_.empty()) return;
+
+	uint32_t index = open_.back();
+	open_.pop_back();
+	if (index == UINT32_MAX) return;
+
+	vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pool_,
+						query_base(current_) + 3 + 2 * index);
+}
+
+// =============================================================================
+// Results
+// =============================================================================
+
+// Graphics scopes may nest, so they are merged into disjoint intervals
+// before the async scopes are intersected with them
+static double async_overlap_ms(const std::vector<GpuProfiler::Scope>& scopes)
+{
+	std::vector<std::pair<double, double>> graphics;
+	for (const auto& s : scopes)
+		if (!s.async) graphics.push_back({s.startMs, s.startMs + s.durationMs});
+	std::sort(graphics.begin(), graphics.end());
+
+	std::vector<std::pair<double, double>> merged;
+	for (const auto& g : graphics)
+	{
+		if (!merged.empty() && g.first <= merged.back().second)
+			merged.back().second = std::max(merged.back().second, g.second);
+		else
+			merged.push_back(g);
+	}
+
+	double overlap = 0.0;
+	for (const auto& s : scopes)
+	{
+		if (!s.async) continue;
+		for (const auto& m : merged)
+		{
+			double from = std::max(s.startMs, m.first);
+			double to = std::min(s.startMs + s.durationMs, m.second);
+			if (to > from) overlap += to - from;
+		}
+	}
+	return overlap;
+}
+
+void GpuProfiler::collect(uint32_t slot, bool wait)
+{
+	Slot& s = slots_[slot];
+	if (!s.pending) return;
+
+	uint32_t count = 2 + 2 * static_cast<uint32_t>(s.names.size());
+	uint64_t ticks[2 + 2 * MAX_SCOPES];
+	VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT;
+	if (wait) flags |= VK_QUERY_RESULT_WAIT_BIT;
+	VkResult r = vkGetQueryPoolResults(device_, pool_, query_base(slot), count,
+									   sizeof(ticks), ticks, sizeof(uint64_t),
+									   flags);
+	s.pending = false;
+	if (r != VK_SUCCESS) return;  // frame dropped from the statistics
+
+	auto to_ms = [&](uint64_t from, uint64_t to)
+	{
+		uint64_t delta = ((to & validMask_) - (from & validMask_)) & validMask_;
+		return static_cast<double>(delta) * periodNs_ * 1e-6;
+	};
+
+	FrameTimings t;
+	t.frameNumber = s.frameNumber;
+	t.frameMs = to_ms(ticks[0], ticks[1]);
+	t.scopes.reserve(s.names.size());
+	for (size_t i = 0; i < s.names.size(); ++i)
+	{
+		Scope scope;
+		scope.name = s.names[i];
+		scope.startMs = to_ms(ticks[0], ticks[2 + 2 * i]);
+		scope.durationMs = to_ms(ticks[2 + 2 * i], ticks[3 + 2 * i]);
+		scope.async = (s.asyncMask >> i) & 1u;
+		t.scopes.push_back(scope);
+	}
+	t.asyncOverlapMs = async_overlap_ms(t.scopes);
+
+	if (keepHistory) history.push_back(t);
+	latest_ = std::move(t);
+}
+
+void GpuProfiler::flush()
+{
+	if (!pool_) return;
+
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(slots_.size()); ++i)
+		if (slots_[i].pending) order.push_back(i);
+	std::sort(order.begin(), order.end(),
+			  [&](uint32_t a, uint32_t b)
+			  { return slots_[a].frameNumber < slots_[b].frameNumber; });
+
+	for (uint32_t slot : order) collect(slot, true);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+// =============================================================================
+// GPU profiler
+// =============================================================================
+
+// Timestamp-query scopes recorded into the per-frame command buffer. Every
+// frame-in-flight owns a slice of one query pool. A slot's results are
+// collected when that slot comes round again (after its fence wait), so
+// reading them never stalls the CPU.
+struct GpuProfiler
+{
+	static constexpr uint32_t MAX_SCOPES = 16;
+
+	struct Scope
+	{
+		const char* name = nullptr;
+		double startMs = 0.0;  // relative to the start of the frame
+		double durationMs = 0.0;
+		bool async = false;	 // recorded on the async compute queue
+	};
+
+	struct FrameTimings
+	{
+		uint64_t frameNumber = 0;
+		double frameMs = 0.0;
+		// Time async scopes ran while a graphics scope was also running
+		double asyncOverlapMs = 0.0;
+		std::vector<Scope> scopes;
+	};
+
+	// asyncFamily is the queue family async scopes are recorded for, if
+	// any. Timestamps from both queues share the device timeline.
+	void init(VkDevice device, VkPhysicalDevice physicalDevice,
+			  uint32_t queueFamily, uint32_t framesInFlight,
+			  uint32_t asyncFamily = VK_QUEUE_FAMILY_IGNORED);
+	void cleanup();
+
+	// First command after vkBeginCommandBuffer, once the slot's fence has
+	// been waited on. Collects the slot's previous results, resets its
+	// queries and starts the whole-frame timer.
+	void begin_frame(VkCommandBuffer cmd, uint32_t slot);
+	// Last command before vkEndCommandBuffer
+	void end_frame(VkCommandBuffer cmd);
+
+	// Scopes may nest. The name is stored by pointer, so pass a literal.
+	// Async scopes go into a command buffer for the async compute queue
+	// that executes between this frame's begin_frame and end_frame.
+	void begin_scope(VkCommandBuffer cmd, const char* name,
+					 bool async = false);
+	void end_scope(VkCommandBuffer cmd);
+
+	// Collect every outstanding slot in submission order. Waits for the
+	// results, so only call it once the device is idle.
+	void flush();
+
+	bool supported() const { return pool_ != VK_NULL_HANDLE; }
+
+	// Most recent frame whose results have come back
+	const FrameTimings& latest() const { return latest_; }
+
+	// When set, every collected frame is also appended to history
+	bool keepHistory = false;
+	std::vector<FrameTimings> history;
+
+   private:
+	struct Slot
+	{
+		uint64_t frameNumber = 0;
+		bool pending = false;
+		std::vector<const char*> names;	 // scope i uses queries 2+2i, 3+2i
+		uint32_t asyncMask = 0;			 // bit i: scope i is async
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkQueryPool pool_ = VK_NULL_HANDLE;
+	double periodNs_ = 1.0;
+	uint64_t validMask_ = ~0ull;
+	bool asyncSupported_ = false;
+	uint32_t queriesPerSlot_ = 0;
+
+	std::vector<Slot> slots_;
+	uint32_t current_ = 0;
+	uint64_t frameCounter_ = 0;
+	std::vector<uint32_t> open_;  // scope stack of the frame being recorded
+	FrameTimings latest_;
+
+	uint32_t query_base(uint32_t slot) const { return slot * queriesPerSlot_; }
+	void collect(uint32_t slot, bool wait);
+};
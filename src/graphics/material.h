@@ -14,10 +14,20 @@ struct MaterialFactorsGPU
 	alignas(16) glm::vec4 baseColorFactor;	// 16B
 	alignas(4) float metallicFactor;		//  4B
 	alignas(4) float roughnessFactor;		//  4B
-	alignas(8) glm::vec2 _pad0;				//  8B
+	alignas(4) float alphaCutoff;			//  4B (MASK only)
+	alignas(4) float _pad0;					//  4B
 	alignas(16) glm::vec4 emissiveFactor;	// 16B (vec3 + pad)
 };
 
+// glTF alphaMode. Each mode draws with its own pipelines: opaque first,
+// then masked (alpha-tested), then blended back to front.
+enum class AlphaMode : uint8_t
+{
+	Opaque,
+	Mask,	// discarded below alphaCutoff
+	Blend,
+};
+
 struct Material
 {
 	// Texture indices into scene texture array
@@ -31,6 +41,8 @@ struct Material
 	float metallicFactor = 1.0f;
 	float roughnessFactor = 1.0f;
 	glm::vec3 emissiveFactor{0.0f};
+	AlphaMode alphaMode = AlphaMode::Opaque;
+	float alphaCutoff = 0.5f;
 
 	// GPU handle (set by Renderer::create_material_descriptor)
 	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
@@ -47,6 +47,29 @@ struct Vertex
 	}
 };
 
+// Up to four joints of the mesh's skin per vertex; weights sum to 1
+struct SkinInfluence
+{
+	glm::uvec4 joints{0};
+	glm::vec4 weights{0.0f};
+};
+
+// One vertex moved by a morph target: ten tightly packed 32-bit words,
+// as morph.comp reads them
+struct MorphDelta
+{
+	uint32_t vertex = 0;
+	glm::vec3 position{0.0f};
+	glm::vec3 normal{0.0f};
+	glm::vec3 tangent{0.0f};
+};
+
+// Sparse: only the vertices the target moves
+struct MorphTarget
+{
+	std::vector<MorphDelta> deltas;
+};
+
 struct Mesh
 {
 	// CPU data
@@ -56,12 +79,32 @@ struct Mesh
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 	uint32_t materialIndex = 0;
-	glm::mat4 transform{1.0f};
+	glm::mat4 transform{1.0f};  // as imported; the scene graph places it
 	AABB localBounds;
+	// Skinned meshes: index into the scene's skins and one influence per
+	// vertex. `vertices` and localBounds are then the bind pose, in the
+	// model space the skin's joints are posed in.
+	int32_t skin = -1;
+	std::vector<SkinInfluence> influences;
+	// Animated meshes: index into the scene's animation sets, and the node
+	// of that set whose model-space pose places the mesh (unless skinned)
+	// and whose weights drive its morph targets
+	int32_t animation = -1;
+	int32_t animationNode = -1;
+	// Morph targets with their weights, used unless the animation set
+	// drives them
+	std::vector<MorphTarget> morphTargets;
+	std::vector<float> morphWeights;
 
 	// GPU handles (set by Renderer::upload_mesh)
 	VkBuffer vertexBuffer = VK_NULL_HANDLE;
 	VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
 	VkBuffer indexBuffer = VK_NULL_HANDLE;
 	VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+	// Skinned and morphed meshes draw from the skinned vertex buffer from
+	// this vertex
+	uint32_t skinnedFirstVertex = 0;
+
+	// Posed on the GPU rather than drawn from vertexBuffer
+	bool deformed() const { return skin >= 0 || !morphTargets.empty(); }
 };
@@ -0,0 +1,772 @@
+#include "renderGraph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <stdexcept>
+
+// =============================================================================
+// Usages
+// =============================================================================
+
+namespace
+{
+
+struct UsageInfo
+{
+	VkPipelineStageFlags2 stages = 0;
+	VkAccessFlags2 access = 0;
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	bool write = false;
+	bool keepsContents = true;	// false: previous contents are dropped
+};
+
+constexpr VkPipelineStageFlags2 DEPTH_STAGES =
+	VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+	VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+
+constexpr VkAccessFlags2 WRITE_ACCESS =
+	VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+	VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+UsageInfo usage_info(RenderGraph::Usage usage)
+{
+	using U = RenderGraph::Usage;
+	switch (usage)
+	{
+		case U::DepthWrite:
+			return {DEPTH_STAGES,
+					VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+						VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL, true, true};
+		case U::DepthRead:
+			return {DEPTH_STAGES, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+					VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, false, true};
+		case U::ColorWrite:
+			return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+					VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+						VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+					VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL, true, true};
+		case U::ComputeSample:
+			return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+					VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, false, true};
+		case U::FragmentSample:
+			return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+					VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL, false, true};
+		case U::ComputeStorageRead:
+			return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, false, true};
+		case U::ComputeStorageWrite:
+			return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, true, false};
+		case U::ComputeStorageReadWrite:
+			return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+						VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, true, true};
+		case U::FragmentStorageRead:
+			return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, false, true};
+		case U::FragmentStorageReadWrite:
+			return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+					VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+						VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+					VK_IMAGE_LAYOUT_GENERAL, true, true};
+		case U::VertexRead:
+			return {VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT,
+					VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, false, true};
+		case U::TransferSrc:
+			return {VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					VK_ACCESS_2_TRANSFER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, true};
+		case U::TransferDst:
+			return {VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					VK_ACCESS_2_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, false};
+	}
+	return {};
+}
+
+bool writes(RenderGraph::Usage usage) { return usage_info(usage).write; }
+
+}  // namespace
+
+void RenderGraph::BarrierBatch::record(VkCommandBuffer cmd) const
+{
+	if (empty()) return;
+	VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+	dep.memoryBarrierCount = static_cast<uint32_t>(memory.size());
+	dep.pMemoryBarriers = memory.data();
+	dep.bufferMemoryBarrierCount = static_cast<uint32_t>(buffers.size());
+	dep.pBufferMemoryBarriers = buffers.data();
+	dep.imageMemoryBarrierCount = static_cast<uint32_t>(images.size());
+	dep.pImageMemoryBarriers = images.data();
+	vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+bool RenderGraph::TransientKey::operator==(const TransientKey& o) const
+{
+	return name == o.name && isImage == o.isImage &&
+		   imageDesc.format == o.imageDesc.format &&
+		   imageDesc.extent.width == o.imageDesc.extent.width &&
+		   imageDesc.extent.height == o.imageDesc.extent.height &&
+		   imageDesc.usage == o.imageDesc.usage &&
+		   imageDesc.aspect == o.imageDesc.aspect &&
+		   bufferDesc.size == o.bufferDesc.size &&
+		   bufferDesc.usage == o.bufferDesc.usage && first == o.first &&
+		   last == o.last;
+}
+
+// =============================================================================
+// Lifecycle
+// =============================================================================
+
+void RenderGraph::init(VkDevice device, VkPhysicalDevice physicalDevice,
+					   uint32_t graphicsFamily, uint32_t computeFamily)
+{
+	device_ = device;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps_);
+	families_[static_cast<uint32_t>(Queue::Graphics)] = graphicsFamily;
+	families_[static_cast<uint32_t>(Queue::AsyncCompute)] = computeFamily;
+}
+
+void RenderGraph::cleanup()
+{
+	destroy_transients();
+	reset();
+}
+
+void RenderGraph::reset()
+{
+	nodes_.clear();
+	passes_.clear();
+	segments_.clear();
+	releases_.clear();
+}
+
+// =============================================================================
+// Declaration
+// =============================================================================
+
+RenderGraph::Resource RenderGraph::import_image(const char* name,
+												VkImage image,
+												VkImageAspectFlags aspect,
+												const ImportState& state)
+{
+	Node node;
+	node.name = name;
+	node.isImage = true;
+	node.importState = state;
+	node.aspect = aspect;
+	node.image = image;
+	nodes_.push_back(node);
+	return static_cast<Resource>(nodes_.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::import_buffer(const char* name,
+												 VkBuffer buffer,
+												 const ImportState& state)
+{
+	Node node;
+	node.name = name;
+	node.importState = state;
+	node.buffer = buffer;
+	nodes_.push_back(node);
+	return static_cast<Resource>(nodes_.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::create_image(const char* name,
+												const ImageDesc& desc)
+{
+	Node node;
+	node.name = name;
+	node.isImage = true;
+	node.transient = true;
+	node.imageDesc = desc;
+	node.aspect = desc.aspect;
+	nodes_.push_back(node);
+	return static_cast<Resource>(nodes_.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::create_buffer(const char* name,
+												 const BufferDesc& desc)
+{
+	Node node;
+	node.name = name;
+	node.transient = true;
+	node.bufferDesc = desc;
+	nodes_.push_back(node);
+	return static_cast<Resource>(nodes_.size() - 1);
+}
+
+uint32_t RenderGraph::add_pass(const char* name, Queue queue, Execute execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.queue = queue;
+	pass.execute = std::move(execute);
+	passes_.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes_.size() - 1);
+}
+
+void RenderGraph::use(uint32_t pass, Resource resource, Usage usage)
+{
+	passes_[pass].accesses.push_back({resource, usage});
+}
+
+void RenderGraph::keep(uint32_t pass) { passes_[pass].keep = true; }
+
+VkImage RenderGraph::image(Resource resource) const
+{
+	return nodes_[resource].image;
+}
+
+VkImageView RenderGraph::image_view(Resource resource) const
+{
+	return nodes_[resource].view;
+}
+
+VkBuffer RenderGraph::buffer(Resource resource) const
+{
+	return nodes_[resource].buffer;
+}
+
+// =============================================================================
+// Compilation
+// =============================================================================
+
+void RenderGraph::compile()
+{
+	cull_passes();
+
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(passes_.size()); ++i)
+		if (passes_[i].alive) order.push_back(i);
+
+	build_segments(order);
+	allocate_transients(order);
+	build_barriers(order);
+
+	stats_.passes = static_cast<uint32_t>(passes_.size());
+	stats_.culledPasses = static_cast<uint32_t>(passes_.size() - order.size());
+	stats_.barriers = 0;
+	stats_.barrierBatches = 0;
+	auto count = [&](const BarrierBatch& b)
+	{
+		stats_.barriers += static_cast<uint32_t>(
+			b.memory.size() + b.images.size() + b.buffers.size());
+		if (!b.empty()) ++stats_.barrierBatches;
+	};
+	for (uint32_t p : order) count(passes_[p].barriers);
+	for (const auto& r : releases_) count(r);
+}
+
+// Walks back from the kept passes: a pass stays alive if a live pass reads
+// something it was the last to write
+void RenderGraph::cull_passes()
+{
+	for (auto& p : passes_) p.alive = p.keep;
+
+	for (int i = static_cast<int>(passes_.size()) - 1; i >= 0; --i)
+	{
+		if (!passes_[i].alive) continue;
+		for (const Access& a : passes_[i].accesses)
+		{
+			if (!usage_info(a.usage).keepsContents) continue;
+			for (int j = i - 1; j >= 0; --j)
+			{
+				bool wrote = std::any_of(
+					passes_[j].accesses.begin(), passes_[j].accesses.end(),
+					[&](const Access& w)
+					{ return w.resource == a.resource && writes(w.usage); });
+				if (wrote)
+				{
+					passes_[j].alive = true;
+					break;
+				}
+			}
+		}
+	}
+}
+
+void RenderGraph::build_segments(const std::vector<uint32_t>& order)
+{
+	segments_.clear();
+	for (uint32_t p : order)
+	{
+		if (segments_.empty() || segments_.back().queue != passes_[p].queue)
+		{
+			Segment segment;
+			segment.queue = passes_[p].queue;
+			segments_.push_back(segment);
+		}
+		segments_.back().passes.push_back(p);
+	}
+	releases_.assign(segments_.size(), BarrierBatch{});
+}
+
+// =============================================================================
+// Transient resources
+// =============================================================================
+
+void RenderGraph::destroy_transients()
+{
+	for (auto& t : transients_)
+	{
+		if (t.view) vkDestroyImageView(device_, t.view, nullptr);
+		if (t.image) vkDestroyImage(device_, t.image, nullptr);
+		if (t.buffer) vkDestroyBuffer(device_, t.buffer, nullptr);
+	}
+	for (auto m : transientMemory_) vkFreeMemory(device_, m, nullptr);
+	transients_.clear();
+	transientMemory_.clear();
+	transientKeys_.clear();
+	stats_.transientBytes = 0;
+	stats_.transientRequestedBytes = 0;
+}
+
+void RenderGraph::allocate_transients(const std::vector<uint32_t>& order)
+{
+	for (uint32_t pos = 0; pos < static_cast<uint32_t>(order.size()); ++pos)
+	{
+		for (const Access& a : passes_[order[pos]].accesses)
+		{
+			Node& node = nodes_[a.resource];
+			if (!node.transient) continue;
+			node.first = std::min(node.first, pos);
+			node.last = std::max(node.last, pos);
+		}
+	}
+
+	std::vector<TransientKey> keys;
+	std::vector<Resource> keyNodes;
+	for (Resource r = 0; r < static_cast<Resource>(nodes_.size()); ++r)
+	{
+		Node& node = nodes_[r];
+		if (!node.transient || node.first == UINT32_MAX) continue;
+		node.transientIndex = static_cast<uint32_t>(keys.size());
+		keys.push_back({node.name, node.isImage, node.imageDesc,
+						node.bufferDesc, node.first, node.last});
+		keyNodes.push_back(r);
+	}
+
+	auto assign_handles = [&]()
+	{
+		for (size_t i = 0; i < keyNodes.size(); ++i)
+		{
+			Node& node = nodes_[keyNodes[i]];
+			node.image = transients_[i].image;
+			node.view = transients_[i].view;
+			node.buffer = transients_[i].buffer;
+		}
+	};
+
+	if (keys == transientKeys_)
+	{
+		assign_handles();
+		return;
+	}
+
+	// The caller has waited for this graph's previous frame, so nothing on
+	// the GPU still uses the old allocation
+	destroy_transients();
+	transients_.resize(keys.size());
+	std::vector<VkMemoryRequirements> reqs(keys.size());
+
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		const TransientKey& k = keys[i];
+		Transient& t = transients_[i];
+		if (k.isImage)
+		{
+			VkImageCreateInfo ci{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+			ci.imageType = VK_IMAGE_TYPE_2D;
+			ci.format = k.imageDesc.format;
+			ci.extent = {k.imageDesc.extent.width, k.imageDesc.extent.height,
+						 1};
+			ci.mipLevels = 1;
+			ci.arrayLayers = 1;
+			ci.samples = VK_SAMPLE_COUNT_1_BIT;
+			ci.tiling = VK_IMAGE_TILING_OPTIMAL;
+			ci.usage = k.imageDesc.usage;
+			ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			ci.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			if (vkCreateImage(device_, &ci, nullptr, &t.image) != VK_SUCCESS)
+				throw std::runtime_error(std::string("RenderGraph: failed to "
+													 "create image ") +
+										 k.name);
+			vkGetImageMemoryRequirements(device_, t.image, &reqs[i]);
+		}
+		else
+		{
+			VkBufferCreateInfo ci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+			ci.size = k.bufferDesc.size;
+			ci.usage = k.bufferDesc.usage;
+			ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			if (vkCreateBuffer(device_, &ci, nullptr, &t.buffer) != VK_SUCCESS)
+				throw std::runtime_error(std::string("RenderGraph: failed to "
+													 "create buffer ") +
+										 k.name);
+			vkGetBufferMemoryRequirements(device_, t.buffer, &reqs[i]);
+		}
+		t.size = reqs[i].size;
+	}
+
+	// Largest first, each into the first block whose current occupants are
+	// all dead before it is born (or born after it dies). Images and
+	// buffers get separate blocks to stay clear of bufferImageGranularity.
+	struct Block
+	{
+		VkDeviceSize size = 0;
+		uint32_t typeBits = ~0u;
+		bool images = false;
+		std::vector<uint32_t> members;
+	};
+	std::vector<Block> blocks;
+
+	std::vector<uint32_t> bySize(keys.size());
+	std::iota(bySize.begin(), bySize.end(), 0u);
+	std::sort(bySize.begin(), bySize.end(),
+			  [&](uint32_t a, uint32_t b)
+			  { return reqs[a].size > reqs[b].size; });
+
+	for (uint32_t i : bySize)
+	{
+		auto fits = [&](const Block& b)
+		{
+			if (b.images != keys[i].isImage) return false;
+			if ((b.typeBits & reqs[i].memoryTypeBits) == 0) return false;
+			for (uint32_t m : b.members)
+				if (keys[m].first <= keys[i].last &&
+					keys[i].first <= keys[m].last)
+					return false;
+			return true;
+		};
+		auto it = std::find_if(blocks.begin(), blocks.end(), fits);
+		if (it == blocks.end())
+		{
+			blocks.push_back({});
+			it = blocks.end() - 1;
+			it->images = keys[i].isImage;
+		}
+		it->size = std::max(it->size, reqs[i].size);
+		it->typeBits &= reqs[i].memoryTypeBits;
+		it->members.push_back(i);
+	}
+
+	for (Block& b : blocks)
+	{
+		uint32_t type = UINT32_MAX;
+		for (uint32_t t = 0; t < memProps_.memoryTypeCount; ++t)
+			if ((b.typeBits & (1u << t)) &&
+				(memProps_.memoryTypes[t].propertyFlags &
+				 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			{
+				type = t;
+				break;
+			}
+		if (type == UINT32_MAX)
+			throw std::runtime_error(
+				"RenderGraph: no device-local memory type for transients");
+
+		VkMemoryAllocateInfo ai{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+		ai.allocationSize = b.size;
+		ai.memoryTypeIndex = type;
+		VkDeviceMemory memory;
+		if (vkAllocateMemory(device_, &ai, nullptr, &memory) != VK_SUCCESS)
+			throw std::runtime_error(
+				"RenderGraph: failed to allocate transient memory");
+		transientMemory_.push_back(memory);
+		stats_.transientBytes += b.size;
+
+		// Execution order within the block decides who inherits from whom
+		std::sort(b.members.begin(), b.members.end(),
+				  [&](uint32_t x, uint32_t y)
+				  { return keys[x].first < keys[y].first; });
+		for (size_t m = 0; m < b.members.size(); ++m)
+		{
+			Transient& t = transients_[b.members[m]];
+			if (m > 0) t.aliasOf = b.members[m - 1];
+			stats_.transientRequestedBytes += t.size;
+			if (t.image)
+				vkBindImageMemory(device_, t.image, memory, 0);
+			else
+				vkBindBufferMemory(device_, t.buffer, memory, 0);
+		}
+	}
+
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		if (!keys[i].isImage) continue;
+		VkImageViewCreateInfo vi{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+		vi.image = transients_[i].image;
+		vi.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		vi.format = keys[i].imageDesc.format;
+		vi.subresourceRange = {keys[i].imageDesc.aspect, 0, 1, 0, 1};
+		if (vkCreateImageView(device_, &vi, nullptr, &transients_[i].view) !=
+			VK_SUCCESS)
+			throw std::runtime_error(std::string("RenderGraph: failed to "
+												 "create view for ") +
+									 keys[i].name);
+	}
+
+	transientKeys_ = std::move(keys);
+	assign_handles();
+}
+
+// =============================================================================
+// Barriers
+// =============================================================================
+
+void RenderGraph::build_barriers(const std::vector<uint32_t>& order)
+{
+	// Everything known about a resource since its last write
+	struct State
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 writeStages = 0;
+		VkAccessFlags2 writeAccess = 0;
+		VkPipelineStageFlags2 readStages = 0;
+		VkPipelineStageFlags2 visibleStages = 0;  // may read the last write
+		uint32_t family = 0;
+		int segment = -1;  // -1: last used before this frame
+		bool fresh = false;	 // contents undefined
+		bool started = false;
+	};
+	std::vector<State> states(nodes_.size());
+
+	for (Resource r = 0; r < static_cast<Resource>(nodes_.size()); ++r)
+	{
+		const Node& node = nodes_[r];
+		if (node.transient) continue;  // starts at its first use
+		const ImportState& imp = node.importState;
+		State& s = states[r];
+		s.layout = imp.layout;
+		s.writeAccess = imp.writeAccess;
+		s.writeStages = imp.writeAccess ? imp.stages : 0;
+		s.readStages = imp.writeAccess ? 0 : imp.stages;
+		s.family = family(imp.queue);
+		s.fresh = node.isImage && imp.layout == VK_IMAGE_LAYOUT_UNDEFINED;
+		s.started = true;
+	}
+
+	std::vector<uint32_t> transientNode(transients_.size(), UINT32_MAX);
+	for (Resource r = 0; r < static_cast<Resource>(nodes_.size()); ++r)
+		if (nodes_[r].transientIndex != UINT32_MAX)
+			transientNode[nodes_[r].transientIndex] = r;
+
+	struct Sync
+	{
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		uint32_t family;
+	};
+	auto add = [&](BarrierBatch& batch, const Node& node,
+				   VkImageLayout oldLayout, VkImageLayout newLayout,
+				   const Sync& src, const Sync& dst)
+	{
+		if (node.isImage)
+		{
+			VkImageMemoryBarrier2 b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+			b.srcStageMask = src.stages;
+			b.srcAccessMask = src.access;
+			b.dstStageMask = dst.stages;
+			b.dstAccessMask = dst.access;
+			b.oldLayout = oldLayout;
+			b.newLayout = newLayout;
+			b.srcQueueFamilyIndex = src.family;
+			b.dstQueueFamilyIndex = dst.family;
+			b.image = node.image;
+			b.subresourceRange = {node.aspect, 0, VK_REMAINING_MIP_LEVELS, 0,
+								  VK_REMAINING_ARRAY_LAYERS};
+			batch.images.push_back(b);
+		}
+		else if (src.access == 0 && src.family == dst.family)
+		{
+			// Nothing to flush: an execution dependency is enough
+			VkMemoryBarrier2 b{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+			b.srcStageMask = src.stages;
+			b.dstStageMask = dst.stages;
+			batch.memory.push_back(b);
+		}
+		else
+		{
+			VkBufferMemoryBarrier2 b{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+			b.srcStageMask = src.stages;
+			b.srcAccessMask = src.access;
+			b.dstStageMask = dst.stages;
+			b.dstAccessMask = dst.access;
+			b.srcQueueFamilyIndex = src.family;
+			b.dstQueueFamilyIndex = dst.family;
+			b.buffer = node.buffer;
+			b.offset = 0;
+			b.size = VK_WHOLE_SIZE;
+			batch.buffers.push_back(b);
+		}
+	};
+	constexpr uint32_t IGNORED = VK_QUEUE_FAMILY_IGNORED;
+
+	std::vector<VkPipelineStageFlags2> crossStages(segments_.size(), 0);
+	int seg = -1;
+	for (uint32_t pos = 0; pos < static_cast<uint32_t>(order.size()); ++pos)
+	{
+		uint32_t p = order[pos];
+		while (seg < 0 || segments_[seg].passes.back() < p) ++seg;
+
+		Pass& pass = passes_[p];
+		BarrierBatch& batch = pass.barriers;
+		uint32_t fam = family(pass.queue);
+
+		for (const Access& a : pass.accesses)
+		{
+			const Node& node = nodes_[a.resource];
+			State& s = states[a.resource];
+			UsageInfo u = usage_info(a.usage);
+			VkImageLayout newLayout =
+				node.isImage ? u.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+			if (!s.started)
+			{
+				// Transient: inherit the hazards of the previous user of the
+				// same memory, if any
+				s = State{};
+				s.family = fam;
+				s.segment = seg;
+				s.fresh = true;
+				s.started = true;
+				uint32_t prev = transients_[node.transientIndex].aliasOf;
+				if (prev != UINT32_MAX)
+				{
+					const State& ps = states[transientNode[prev]];
+					s.writeStages = ps.writeStages | ps.readStages;
+					s.writeAccess = ps.writeAccess;
+					s.family = ps.family;
+					s.segment = ps.segment;
+				}
+			}
+
+			bool keepContents = u.keepsContents && !s.fresh;
+
+			if (s.family != fam)
+			{
+				// The acquire's source stages match the semaphore wait, so
+				// it (and any layout transition) runs after the wait
+				if (keepContents && s.segment >= 0)
+				{
+					// Ownership transfer: release at the end of the segment
+					// that used it last, acquire right before this pass
+					add(releases_[s.segment], node, s.layout, newLayout,
+						{s.writeStages | s.readStages, s.writeAccess,
+						 s.family},
+						{VK_PIPELINE_STAGE_2_NONE, 0, fam});
+					add(batch, node, s.layout, newLayout,
+						{u.stages, 0, s.family}, {u.stages, u.access, fam});
+				}
+				else
+				{
+					if (keepContents)
+						std::fprintf(stderr,
+									 "RenderGraph: '%s' enters pass '%s' from "
+									 "another queue family without a "
+									 "release; contents are undefined\n",
+									 node.name, pass.name);
+					if (node.isImage)
+						add(batch, node, VK_IMAGE_LAYOUT_UNDEFINED, newLayout,
+							{u.stages, 0, IGNORED},
+							{u.stages, u.access, IGNORED});
+				}
+				if (s.segment >= 0) crossStages[seg] |= u.stages;
+
+				// Later uses on this queue chain off this pass's stages
+				s.writeStages = u.stages;
+				s.writeAccess = u.write ? (u.access & WRITE_ACCESS) : 0;
+				s.readStages = u.write ? 0 : u.stages;
+				s.visibleStages = u.stages;
+			}
+			else
+			{
+				bool layoutChange = node.isImage && s.layout != newLayout;
+				bool needed = layoutChange;
+				if (s.writeStages &&
+					(u.write || (u.stages & ~s.visibleStages)))
+					needed = true;	// RAW / WAW
+				if (u.write && s.readStages) needed = true;	 // WAR
+
+				if (needed)
+					add(batch, node,
+						s.fresh ? VK_IMAGE_LAYOUT_UNDEFINED : s.layout,
+						newLayout,
+						{s.writeStages | s.readStages, s.writeAccess, IGNORED},
+						{u.stages, u.access, IGNORED});
+
+				if (u.write)
+				{
+					s.writeStages = u.stages;
+					s.writeAccess = u.access & WRITE_ACCESS;
+					s.readStages = 0;
+					s.visibleStages = 0;
+				}
+				else
+				{
+					if (layoutChange)
+					{
+						s.readStages = 0;
+						s.visibleStages = 0;
+					}
+					if (needed) s.visibleStages |= u.stages;
+					s.readStages |= u.stages;
+				}
+			}
+
+			s.layout = newLayout;
+			s.family = fam;
+			s.segment = seg;
+			s.fresh = false;
+		}
+	}
+
+	for (size_t i = 0; i < segments_.size(); ++i)
+		segments_[i].waitStages = crossStages[i]
+									   ? crossStages[i]
+									   : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+}
+
+// =============================================================================
+// Execution
+// =============================================================================
+
+void RenderGraph::execute(uint32_t segment, VkCommandBuffer cmd,
+						  uint32_t stopAfter)
+{
+	record(segment, cmd, 0, stopAfter);
+}
+
+void RenderGraph::resume(uint32_t segment, VkCommandBuffer cmd, uint32_t after)
+{
+	const auto& passes = segments_[segment].passes;
+	auto it = std::find(passes.begin(), passes.end(), after);
+	size_t first = it == passes.end() ? passes.size() : it - passes.begin() + 1;
+	record(segment, cmd, first, NO_PASS);
+}
+
+void RenderGraph::record(uint32_t segment, VkCommandBuffer cmd, size_t first,
+						 uint32_t stopAfter)
+{
+	const auto& passes = segments_[segment].passes;
+	for (size_t i = first; i < passes.size(); ++i)
+	{
+		uint32_t p = passes[i];
+		passes_[p].barriers.record(cmd);
+		if (passes_[p].execute) passes_[p].execute(cmd);
+		if (p == stopAfter) return;
+	}
+	releases_[segment].record(cmd);
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Render graph
+// =============================================================================
+
+// Rebuilt every frame. Passes declare how they use each resource, then
+// compile() culls passes that contribute nothing to a kept pass, derives the
+// barriers between passes (at most one batched vkCmdPipelineBarrier2 before
+// each pass) and places transient resources, aliasing memory between
+// transients whose lifetimes do not overlap.
+//
+// Consecutive passes on the same queue form a segment, recorded into one
+// command buffer. Resources that cross queue families get release/acquire
+// ownership transfers; the caller submits the segments in order, each
+// waiting on the previous one at Segment::waitStages.
+//
+// Barriers are synchronization2 barriers, each with its own stage masks.
+// Depth and color attachments use ATTACHMENT_OPTIMAL; every read-only image
+// use (sampling, read-only depth testing) shares READ_ONLY_OPTIMAL, so a
+// depth buffer that is written once and then only read changes layout once.
+// An image's last use in the frame (e.g. the transition to PRESENT_SRC) is
+// outside the graph and up to the caller.
+struct RenderGraph
+{
+	using Resource = uint32_t;
+	using Execute = std::function<void(VkCommandBuffer)>;
+
+	enum class Queue : uint8_t
+	{
+		Graphics,
+		AsyncCompute,
+	};
+
+	// Each usage implies pipeline stages, access flags and an image layout
+	enum class Usage : uint8_t
+	{
+		DepthWrite,				  // depth attachment, test + write
+		DepthRead,				  // read-only depth attachment, test only
+		ColorWrite,				  // color attachment
+		ComputeSample,			  // sampled image in a compute shader
+		FragmentSample,			  // sampled image in a fragment shader
+		ComputeStorageRead,		  // storage buffer or image
+		ComputeStorageWrite,	  // overwritten; previous contents dropped
+		ComputeStorageReadWrite,  // updated in place, e.g. by atomics
+		FragmentStorageRead,
+		FragmentStorageReadWrite,
+		VertexRead,  // vertex buffer
+		TransferSrc,
+		TransferDst,  // overwritten; previous contents dropped
+	};
+
+	// Where an imported resource was left by its last user. An image
+	// imported as UNDEFINED has no contents worth keeping.
+	struct ImportState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags2 stages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 writeAccess = 0;	 // writes not yet made visible
+		Queue queue = Queue::Graphics;
+	};
+
+	struct ImageDesc
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent{};
+		VkImageUsageFlags usage = 0;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	struct BufferDesc
+	{
+		VkDeviceSize size = 0;
+		VkBufferUsageFlags usage = 0;
+	};
+
+	struct Segment
+	{
+		Queue queue = Queue::Graphics;
+		std::vector<uint32_t> passes;  // execution order
+		// Stages that consume work from earlier segments. ALL_COMMANDS when
+		// nothing crosses queues, so the segments stay in order.
+		VkPipelineStageFlags2 waitStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	};
+
+	struct Stats
+	{
+		uint32_t passes = 0;
+		uint32_t culledPasses = 0;
+		uint32_t barriers = 0;		  // memory + image + buffer barriers
+		uint32_t barrierBatches = 0;  // vkCmdPipelineBarrier2 calls
+		VkDeviceSize transientBytes = 0;  // after aliasing
+		VkDeviceSize transientRequestedBytes = 0;
+	};
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice,
+			  uint32_t graphicsFamily, uint32_t computeFamily);
+	// Frees transient resources; the GPU must be done with them
+	void cleanup();
+
+	// Drops the previous frame's passes and resources. Transient memory is
+	// kept and reused while frames declare the same transients.
+	void reset();
+
+	Resource import_image(const char* name, VkImage image,
+						  VkImageAspectFlags aspect, const ImportState& state);
+	Resource import_buffer(const char* name, VkBuffer buffer,
+						   const ImportState& state);
+	Resource create_image(const char* name, const ImageDesc& desc);
+	Resource create_buffer(const char* name, const BufferDesc& desc);
+
+	uint32_t add_pass(const char* name, Queue queue, Execute execute);
+	void use(uint32_t pass, Resource resource, Usage usage);
+	// Kept passes have effects outside the graph (presenting, read-back)
+	// and are never culled
+	void keep(uint32_t pass);
+
+	void compile();
+
+	const std::vector<Segment>& segments() const { return segments_; }
+	// Records the segment's passes with their barriers, then the release
+	// half of any ownership transfer to a later segment. With stopAfter,
+	// recording pauses once that pass has run so the caller can add to it;
+	// resume() records the rest of the segment.
+	static constexpr uint32_t NO_PASS = UINT32_MAX;
+	void execute(uint32_t segment, VkCommandBuffer cmd,
+				 uint32_t stopAfter = NO_PASS);
+	void resume(uint32_t segment, VkCommandBuffer cmd, uint32_t after);
+
+	// Transient handles are valid after compile() and stay the same from
+	// frame to frame while the declared transients do not change
+	VkImage image(Resource resource) const;
+	VkImageView image_view(Resource resource) const;  // transients only
+	VkBuffer buffer(Resource resource) const;
+
+	const Stats& stats() const { return stats_; }
+
+   private:
+	struct Node
+	{
+		const char* name = nullptr;
+		bool isImage = false;
+		bool transient = false;
+		ImportState importState;
+		ImageDesc imageDesc;
+		BufferDesc bufferDesc;
+		VkImageAspectFlags aspect = 0;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		// Transients: first/last position in the execution order
+		uint32_t first = UINT32_MAX;
+		uint32_t last = 0;
+		uint32_t transientIndex = UINT32_MAX;
+	};
+
+	struct Access
+	{
+		Resource resource;
+		Usage usage;
+	};
+
+	struct BarrierBatch
+	{
+		std::vector<VkMemoryBarrier2> memory;  // execution-only dependencies
+		std::vector<VkImageMemoryBarrier2> images;
+		std::vector<VkBufferMemoryBarrier2> buffers;
+		bool empty() const
+		{
+			return memory.empty() && images.empty() && buffers.empty();
+		}
+		void record(VkCommandBuffer cmd) const;
+	};
+
+	struct Pass
+	{
+		const char* name = nullptr;
+		Queue queue = Queue::Graphics;
+		Execute execute;
+		std::vector<Access> accesses;
+		bool keep = false;
+		bool alive = false;
+		BarrierBatch barriers;	// recorded before the pass
+	};
+
+	// Transient resources outlive a frame; the key decides whether the
+	// previous frame's allocation can be reused
+	struct TransientKey
+	{
+		std::string name;
+		bool isImage = false;
+		ImageDesc imageDesc;
+		BufferDesc bufferDesc;
+		uint32_t first = 0;
+		uint32_t last = 0;
+		bool operator==(const TransientKey& o) const;
+	};
+
+	struct Transient
+	{
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t aliasOf = UINT32_MAX;	// previous user of the same memory
+	};
+
+	VkDevice device_ = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memProps_{};
+	uint32_t families_[2] = {};	 // indexed by Queue
+
+	std::vector<Node> nodes_;
+	std::vector<Pass> passes_;
+	std::vector<Segment> segments_;
+	std::vector<BarrierBatch> releases_;  // per segment, recorded last
+	Stats stats_;
+
+	std::vector<TransientKey> transientKeys_;
+	std::vector<Transient> transients_;
+	std::vector<VkDeviceMemory> transientMemory_;
+
+	uint32_t family(Queue queue) const
+	{
+		return families_[static_cast<uint32_t>(queue)];
+	}
+	void cull_passes();
+	void build_segments(const std::vector<uint32_t>& order);
+	void allocate_transients(const std::vector<uint32_t>& order);
+	void destroy_transients();
+	void build_barriers(const std::vector<uint32_t>& order);
+	void record(uint32_t segment, VkCommandBuffer cmd, size_t first,
+				uint32_t stopAfter);
+};
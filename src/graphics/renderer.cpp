@@ -2,8 +2,11 @@
 
 #include "camera.h"
 #include "config.h"
+#include "core/radixSort.h"
+#include "core/threadPool.h"
 #include "cube.h"
 #include "debugLines.h"
+#include "frameCapture.h"
 #include "loaders/gltfLoader.h"
 
 #define GLM_FORCE_RADIANS
@@ -11,11 +14,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <algorithm>
 #include <array>
+#include <cfloat>
 #include <cmath>
 #include <cstdio>
 #include <cstring>
@@ -74,6 +77,21 @@ static bool check_validation_support()
 	return false;
 }
 
+static bool has_device_extension(VkPhysicalDevice pd, const char* name)
+{
+	uint32_t cnt;
+	vkEnumerateDeviceExtensionProperties(pd, nullptr, &cnt, nullptr);
+	std::vector<VkExtensionProperties> exts(cnt);
+	vkEnumerateDeviceExtensionProperties(pd, nullptr, &cnt, exts.data());
+	for (auto& e : exts)
+		if (std::strcmp(e.extensionName, name) == 0) return true;
+	return false;
+}
+
+// Upper bound on the low-latency present wait, so a minimized or occluded
+// window that never presents cannot stall the main loop
+static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100'000'000;
+
 // =============================================================================
 // Accessors
 // =============================================================================
@@ -92,10 +110,107 @@ uint32_t Renderer::swapchain_image_count() const
 {
 	return static_cast<uint32_t>(swapchainImages_.size());
 }
-VkRenderPass Renderer::vk_render_pass() const { return renderPass_; }
+
+VkPipelineRenderingCreateInfo Renderer::main_pass_formats() const
+{
+	VkPipelineRenderingCreateInfo info{
+		VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+	info.colorAttachmentCount = 1;
+	info.pColorAttachmentFormats = &swapchainFormat_;
+	info.depthAttachmentFormat = depthFormat_;
+	return info;
+}
 
 void Renderer::notify_resize() { framebufferResized_ = true; }
 
+void Renderer::resize_offscreen(uint32_t width, uint32_t height)
+{
+	if (!headless_ || width == 0 || height == 0) return;
+	requestedOffscreenExtent_ = {width, height};
+}
+
+// =============================================================================
+// Frame pacing
+// =============================================================================
+
+void Renderer::set_present_mode(VkPresentModeKHR mode)
+{
+	requestedPresentMode_ = mode;
+	if (swapchain_ && mode != presentMode_) swapchainDirty_ = true;
+}
+
+bool Renderer::present_mode_supported(VkPresentModeKHR mode) const
+{
+	return std::find(supportedPresentModes_.begin(),
+					 supportedPresentModes_.end(),
+					 mode) != supportedPresentModes_.end();
+}
+
+void Renderer::set_frames_in_flight(uint32_t count)
+{
+	count = std::clamp<uint32_t>(count, 1, MAX_FRAMES_IN_FLIGHT);
+	if (count == framesInFlight_) return;
+
+	// Every fence ends up signaled and every acquire semaphore unsignaled,
+	// so cycling can restart from slot 0 with any count
+	if (device_)
+	{
+		vkDeviceWaitIdle(device_);
+		poll_latency();
+		deletionQueue_.flush(submittedFrames_);
+	}
+	framesInFlight_ = count;
+	currentFrame_ = 0;
+}
+
+void Renderer::wait_for_frame()
+{
+	if (lowLatencyMode_)
+	{
+		// Waiting for the previous present keeps the swapchain queue empty,
+		// so this frame's input is not displayed behind queued frames
+		if (presentWaitEnabled_ && presentId_ > 0)
+			vkWaitForPresent_(device_, swapchain_, presentId_,
+							  PRESENT_WAIT_TIMEOUT_NS);
+		vkWaitForFences(device_, 1, &inFlightFences_[currentFrame_], VK_TRUE,
+						UINT64_MAX);
+	}
+	poll_latency();
+	inputTime_ = Clock::now();
+}
+
+void Renderer::poll_latency()
+{
+	while (!latencyQueue_.empty())
+	{
+		const LatencyRecord& r = latencyQueue_.front();
+		bool done;
+		if (r.presentId > 0)
+			done = vkWaitForPresent_(device_, swapchain_, r.presentId, 0) ==
+				   VK_SUCCESS;
+		else
+			done = vkGetFenceStatus(device_, inFlightFences_[r.slot]) ==
+				   VK_SUCCESS;
+		if (!done) break;
+
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() -
+															  r.inputTime)
+						.count();
+		latencySamples_[latencyCount_ % LATENCY_HISTORY] = ms;
+		++latencyCount_;
+		latencyQueue_.pop_front();
+	}
+}
+
+double Renderer::latency_ms() const
+{
+	uint64_t n = std::min<uint64_t>(latencyCount_, LATENCY_HISTORY);
+	if (n == 0) return 0.0;
+	double sum = 0.0;
+	for (uint64_t i = 0; i < n; ++i) sum += latencySamples_[i];
+	return sum / static_cast<double>(n);
+}
+
 // =============================================================================
 // Lifecycle
 // =============================================================================
@@ -103,6 +218,7 @@ void Renderer::notify_resize() { framebufferResized_ = true; }
 void Renderer::init(GLFWwindow* window, const std::string& modelPath)
 {
 	window_ = window;
+	headless_ = false;
 	packFile_.emplace(PAK_FILE);
 	create_instance();
 	setup_debug_messenger();
@@ -110,48 +226,90 @@ void Renderer::init(GLFWwindow* window, const std::string& modelPath)
 	pick_physical_device();
 	create_logical_device();
 	create_swapchain();
+	init_resources(modelPath);
+}
+
+void Renderer::init_headless(uint32_t width, uint32_t height,
+							 const std::string& modelPath)
+{
+	window_ = nullptr;
+	headless_ = true;
+	swapchainExtent_ = {width, height};
+	packFile_.emplace(PAK_FILE);
+	create_instance();
+	setup_debug_messenger();
+	pick_physical_device();
+	create_logical_device();
+	create_offscreen_targets();
+	init_resources(modelPath);
+}
+
+void Renderer::init_resources(const std::string& modelPath)
+{
 	create_image_views();
-	create_render_pass();
 	create_depth_resources();
-	create_framebuffers();
+	create_history_images();
 	create_command_pool();
+	gpuProfiler_.init(device_, physicalDevice_, graphicsFamily_,
+					  MAX_FRAMES_IN_FLIGHT,
+					  asyncComputeSupported_ ? computeFamily_
+											 : VK_QUEUE_FAMILY_IGNORED);
+	for (auto& graph : frameGraphs_)
+		graph.init(device_, physicalDevice_, graphicsFamily_,
+				   asyncComputeSupported_ ? computeFamily_ : graphicsFamily_);
 	create_pbr_sampler();
 	create_default_textures();
 	create_pbr_descriptor_layouts();
 	create_light_data_set_layout();
-	create_depth_only_render_pass();
-	create_depth_only_framebuffer();
+	create_oit_descriptors();
 	create_depth_prepass_pipeline();
 	create_pbr_pipeline();
 	create_compute_pipeline();
+	create_skinning_pipeline();
+	create_morph_pipeline();
 	create_heatmap_pipeline();
 	create_debug_line_pipeline();
 	create_debug_line_buffers();
+	create_taa_descriptors();
+	create_taa_pipelines();
+	create_oit_pipelines();
 	create_uniform_buffers();
+	create_pick_buffers();
 	create_frame_descriptor_pool();
 	create_frame_descriptor_sets();
 	create_light_buffers();
 	create_light_descriptor_pool();
 	create_light_descriptor_sets();
-	load_scene(modelPath);
+	if (modelPath.empty())
+		load_scene_empty();
+	else
+		load_scene(modelPath);
 	create_command_buffers();
 	create_sync_objects();
 }
 
 void Renderer::cleanup()
 {
+	deletionQueue_.flush_all();
 	cleanup_swapchain();
 
-	// Uniform buffers
+	// Uniform and instance buffers
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		vkDestroyBuffer(device_, uniformBuffers_[i], nullptr);
 		vkFreeMemory(device_, uniformBuffersMemory_[i], nullptr);
+		vkDestroyBuffer(device_, instanceBuffers_[i], nullptr);
+		vkFreeMemory(device_, instanceMemory_[i], nullptr);
+		vkDestroyBuffer(device_, pickBuffers_[i], nullptr);
+		vkFreeMemory(device_, pickMemory_[i], nullptr);
 	}
 
 	// Light SSBOs
 	cleanup_light_buffers();
 
+	// Skinning buffers
+	destroy_skinning_buffers();
+
 	// Meshes
 	for (auto& m : meshes_)
 	{
@@ -176,16 +334,26 @@ void Renderer::cleanup()
 	// Samplers
 	vkDestroySampler(device_, pbrSampler_, nullptr);
 	vkDestroySampler(device_, depthSampler_, nullptr);
+	vkDestroySampler(device_, taaSampler_, nullptr);
 
 	// Descriptor pools
 	vkDestroyDescriptorPool(device_, materialDescriptorPool_, nullptr);
 	vkDestroyDescriptorPool(device_, frameDescriptorPool_, nullptr);
 	vkDestroyDescriptorPool(device_, lightDescriptorPool_, nullptr);
+	vkDestroyDescriptorPool(device_, taaDescriptorPool_, nullptr);
+	vkDestroyDescriptorPool(device_, skinningDescriptorPool_, nullptr);
+	vkDestroyDescriptorPool(device_, morphDescriptorPool_, nullptr);
+	vkDestroyDescriptorPool(device_, oitDescriptorPool_, nullptr);
 
 	// Descriptor layouts
 	vkDestroyDescriptorSetLayout(device_, materialSetLayout_, nullptr);
 	vkDestroyDescriptorSetLayout(device_, frameSetLayout_, nullptr);
 	vkDestroyDescriptorSetLayout(device_, lightDataSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, taaSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, skinningSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, morphSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, oitResolveSetLayout_, nullptr);
+	vkDestroyDescriptorSetLayout(device_, oitListSetLayout_, nullptr);
 
 	// Sync
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
@@ -196,7 +364,15 @@ void Renderer::cleanup()
 	for (auto s : renderFinishedSemaphores_)
 		vkDestroySemaphore(device_, s, nullptr);
 
+	if (segmentTimeline_)
+		vkDestroySemaphore(device_, segmentTimeline_, nullptr);
+
+	for (auto& graph : frameGraphs_) graph.cleanup();
+
 	vkDestroyCommandPool(device_, commandPool_, nullptr);
+	if (computeCommandPool_)
+		vkDestroyCommandPool(device_, computeCommandPool_, nullptr);
+	gpuProfiler_.cleanup();
 
 	// Debug line buffers
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
@@ -210,19 +386,34 @@ void Renderer::cleanup()
 
 	// Pipelines
 	vkDestroyPipeline(device_, pbrPipeline_, nullptr);
+	vkDestroyPipeline(device_, pbrMaskPipeline_, nullptr);
+	vkDestroyPipeline(device_, pbrBlendPipeline_, nullptr);
 	vkDestroyPipelineLayout(device_, pbrPipelineLayout_, nullptr);
 	vkDestroyPipeline(device_, depthPrepassPipeline_, nullptr);
+	vkDestroyPipeline(device_, objectIdPipeline_, nullptr);
+	vkDestroyPipeline(device_, depthMaskPipeline_, nullptr);
+	vkDestroyPipeline(device_, objectIdMaskPipeline_, nullptr);
 	vkDestroyPipelineLayout(device_, depthPrepassPipelineLayout_, nullptr);
 	vkDestroyPipeline(device_, lightCullPipeline_, nullptr);
 	vkDestroyPipelineLayout(device_, computePipelineLayout_, nullptr);
+	vkDestroyPipeline(device_, skinningPipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, skinningPipelineLayout_, nullptr);
+	vkDestroyPipeline(device_, morphPipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, morphPipelineLayout_, nullptr);
 	vkDestroyPipeline(device_, heatmapPipeline_, nullptr);
 	vkDestroyPipelineLayout(device_, heatmapPipelineLayout_, nullptr);
 	vkDestroyPipeline(device_, debugLinePipeline_, nullptr);
 	vkDestroyPipelineLayout(device_, debugLinePipelineLayout_, nullptr);
-
-	// Render passes
-	vkDestroyRenderPass(device_, renderPass_, nullptr);
-	vkDestroyRenderPass(device_, depthOnlyRenderPass_, nullptr);
+	vkDestroyPipeline(device_, taaResolvePipeline_, nullptr);
+	vkDestroyPipeline(device_, taaOutputPipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, taaPipelineLayout_, nullptr);
+	vkDestroyPipeline(device_, oitAccumPipeline_, nullptr);
+	vkDestroyPipeline(device_, oitListPipeline_, nullptr);
+	vkDestroyPipeline(device_, oitResolvePipeline_, nullptr);
+	vkDestroyPipeline(device_, oitListResolvePipeline_, nullptr);
+	vkDestroyPipelineLayout(device_, oitListPipelineLayout_, nullptr);
+	vkDestroyPipelineLayout(device_, oitResolvePipelineLayout_, nullptr);
+	vkDestroyPipelineLayout(device_, oitListResolvePipelineLayout_, nullptr);
 
 	vkDestroyDevice(device_, nullptr);
 
@@ -233,7 +424,7 @@ void Renderer::cleanup()
 								  "vkDestroyDebugUtilsMessengerEXT"));
 		if (fn) fn(instance_, debugMessenger_, nullptr);
 	}
-	vkDestroySurfaceKHR(instance_, surface_, nullptr);
+	if (surface_) vkDestroySurfaceKHR(instance_, surface_, nullptr);
 	vkDestroyInstance(instance_, nullptr);
 }
 
@@ -245,132 +436,108 @@ std::optional<Renderer::FrameContext> Renderer::begin_frame()
 {
 	vkWaitForFences(device_, 1, &inFlightFences_[currentFrame_], VK_TRUE,
 					UINT64_MAX);
+	// Before the fence is reset, so the slot's own record can resolve
+	poll_latency();
+	// Everything retired up to this slot's last frame is now unused
+	deletionQueue_.flush(slotFrame_[currentFrame_]);
+	if (pickInFlight_[currentFrame_])
+	{
+		pickValue_ = *pickMapped_[currentFrame_];
+		pickReady_ = true;
+		pickInFlight_[currentFrame_] = false;
+	}
 
-	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(
-		device_, swapchain_, UINT64_MAX,
-		imageAvailableSemaphores_[currentFrame_], VK_NULL_HANDLE, &imageIndex);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	// Headless targets are owned per frame-in-flight, so the fence above
+	// already guarantees the image is free
+	uint32_t imageIndex = currentFrame_;
+	if (!headless_)
 	{
-		recreate_swapchain();
-		return std::nullopt;
+		VkResult result = vkAcquireNextImageKHR(
+			device_, swapchain_, UINT64_MAX,
+			imageAvailableSemaphores_[currentFrame_], VK_NULL_HANDLE,
+			&imageIndex);
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			recreate_swapchain();
+			return std::nullopt;
+		}
+		if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+			throw std::runtime_error("Failed to acquire swapchain image");
 	}
-	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-		throw std::runtime_error("Failed to acquire swapchain image");
 
 	vkResetFences(device_, 1, &inFlightFences_[currentFrame_]);
 
-	VkCommandBuffer cmd = commandBuffers_[currentFrame_];
-	vkResetCommandBuffer(cmd, 0);
-
-	VkCommandBufferBeginInfo beginInfo{
-		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-	VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
-
-	// ---- 1. Depth pre-pass ----
-	if (!debugSkipDepthPrepass_)
-		draw_depth_prepass(cmd);
-	else
+	frameTaa_ = dynamicResolution_;
+	update_render_extent();
+
+	// Per-slot resize work, safe now that this slot's frame has finished
+	ensure_tile_light_capacity(currentFrame_);
+	ensure_instance_capacity(currentFrame_);
+	if (lightSetDirty_[currentFrame_])
+		update_light_descriptor_set(currentFrame_);
+
+	// With async compute the light culling moves to the compute queue and
+	// the graph splits the frame into prepass / cull / main segments
+	frameAsync_ = asyncCompute_ && asyncComputeSupported_;
+	frameSkipPrepass_ = debugSkipDepthPrepass_;
+	frameObjectIds_ = gpuPicking_;
+	frameTransparency_ = transparencyMode_;
+	if (!transparency_mode_supported(frameTransparency_) ||
+		!has_blended_materials())
+		frameTransparency_ = TransparencyMode::Sorted;
+	framePick_.reset();
+	if (frameObjectIds_ && pickRequest_.has_value())
 	{
-		// Still need to transition depth image for compute read
-		// Do a clear + transition via a minimal render pass
-		VkClearValue clear{};
-		clear.depthStencil = {1.0f, 0};
-		VkRenderPassBeginInfo rpInfo{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-		rpInfo.renderPass = depthOnlyRenderPass_;
-		rpInfo.framebuffer = depthOnlyFramebuffer_;
-		rpInfo.renderArea = {{0, 0}, swapchainExtent_};
-		rpInfo.clearValueCount = 1;
-		rpInfo.pClearValues = &clear;
-		vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdEndRenderPass(cmd);
+		// The prepass renders into the top-left render extent
+		auto scale = [](int32_t v, uint32_t from, uint32_t to)
+		{
+			int64_t scaled = static_cast<int64_t>(v) * to / std::max(from, 1u);
+			return static_cast<int32_t>(
+				std::clamp<int64_t>(scaled, 0, static_cast<int64_t>(to) - 1));
+		};
+		framePick_ = VkOffset2D{
+			scale(pickRequest_->x, swapchainExtent_.width, renderExtent_.width),
+			scale(pickRequest_->y, swapchainExtent_.height,
+				  renderExtent_.height)};
+		pickRequest_.reset();
+		pickInFlight_[currentFrame_] = true;
 	}
+	RenderGraph& graph = frameGraphs_[currentFrame_];
+	build_frame_graph(graph, imageIndex);
+	graphStats_ = graph.stats();
 
-	// ---- 2. Barrier: depth attachment -> shader read for compute ----
+	// This frame's resolve output is the next frame's history
+	if (frameTaa_)
 	{
-		VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-		barrier.oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = depthImage_;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-		barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-							 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
-							 nullptr, 0, nullptr, 1, &barrier);
+		historyInitialized_[historyIndex_] = true;
+		historyIndex_ ^= 1;
 	}
+	historyValid_ = frameTaa_;
+	frameSceneOpen_ = frameTaa_;
 
-	// ---- 3. Light culling compute dispatch ----
-	{
-		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
-						  lightCullPipeline_);
-		VkDescriptorSet compSets[] = {frameDescriptorSets_[currentFrame_],
-									  lightDescriptorSets_[currentFrame_]};
-		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
-								computePipelineLayout_, 0, 2, compSets, 0,
-								nullptr);
-		vkCmdDispatch(cmd, tileCountX_, tileCountY_, 1);
-	}
-
-	// ---- 4. Barriers: compute -> fragment (SSBO + depth back) ----
-	{
-		VkMemoryBarrier memBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
-		memBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		memBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		VkImageMemoryBarrier depthBarrier{
-			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
-		depthBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		depthBarrier.newLayout =
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		depthBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		depthBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		depthBarrier.image = depthImage_;
-		depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		depthBarrier.subresourceRange.baseMipLevel = 0;
-		depthBarrier.subresourceRange.levelCount = 1;
-		depthBarrier.subresourceRange.baseArrayLayer = 0;
-		depthBarrier.subresourceRange.layerCount = 1;
-		depthBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-		depthBarrier.dstAccessMask =
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
-
-		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-							 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
-								 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,
-							 0, 1, &memBarrier, 0, nullptr, 1, &depthBarrier);
-	}
-
-	// ---- 5. Begin main shading render pass (depth loadOp=LOAD) ----
-	std::array<VkClearValue, 2> clears{};
-	clears[0].color = {{0.1f, 0.1f, 0.1f, 1.0f}};
-	clears[1].depthStencil = {1.0f, 0};
-
-	VkRenderPassBeginInfo rpInfo{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-	rpInfo.renderPass = renderPass_;
-	rpInfo.framebuffer = framebuffers_[imageIndex];
-	rpInfo.renderArea = {{0, 0}, swapchainExtent_};
-	rpInfo.clearValueCount = static_cast<uint32_t>(clears.size());
-	rpInfo.pClearValues = clears.data();
-
-	vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	VkViewport vp{0,
-				  0,
-				  static_cast<float>(swapchainExtent_.width),
-				  static_cast<float>(swapchainExtent_.height),
-				  0.0f,
-				  1.0f};
-	vkCmdSetViewport(cmd, 0, 1, &vp);
+	const auto& segments = graph.segments();
+	if (segments.size() > MAX_GRAPH_SEGMENTS)
+		throw std::runtime_error("Frame graph has too many queue segments");
 
-	VkRect2D scissor{{0, 0}, swapchainExtent_};
-	vkCmdSetScissor(cmd, 0, 1, &scissor);
+	// Every segment but the last is closed here; the last one holds the
+	// main pass, which stays open for the caller. With TAA the rest of the
+	// last segment is recorded by finish_scene.
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+	VkCommandBuffer cmd = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < segments.size(); ++i)
+	{
+		bool last = i + 1 == segments.size();
+		cmd = last ? commandBuffers_[currentFrame_]
+				   : segment_command_buffer(segments[i].queue, i);
+		vkResetCommandBuffer(cmd, 0);
+		VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
+		if (i == 0) gpuProfiler_.begin_frame(cmd, currentFrame_);
+		uint32_t stopAfter =
+			last && frameTaa_ ? frameMainPass_ : RenderGraph::NO_PASS;
+		graph.execute(i, cmd, stopAfter);
+		if (!last) VK_CHECK(vkEndCommandBuffer(cmd));
+	}
 
 	return FrameContext{cmd, imageIndex};
 }
@@ -390,6 +557,35 @@ void Renderer::update_uniforms(const Camera& camera, float time,
 	lastView_ = ubo.view;
 	lastProj_ =
 		glm::perspective(glm::radians(camera.fov), aspect, 0.1f, 100.0f);
+
+	if (frameTaa_)
+	{
+		// Reprojection uses the unjittered matrices, so history lines up
+		// with the jitter-corrected current sample
+		glm::mat4 viewProj = ubo.proj * ubo.view;
+		taaReprojection_ = prevViewProj_ * glm::inverse(viewProj);
+		prevViewProj_ = viewProj;
+
+		// Sub-pixel offsets from the Halton (2, 3) sequence, so successive
+		// frames sample different points of each render pixel
+		auto halton = [](uint32_t index, uint32_t base)
+		{
+			float f = 1.0f, r = 0.0f;
+			for (; index > 0; index /= base)
+			{
+				f /= static_cast<float>(base);
+				r += f * static_cast<float>(index % base);
+			}
+			return r;
+		};
+		uint32_t phase = taaJitterIndex_++ % TAA_JITTER_PHASES + 1;
+		glm::vec2 pixels{halton(phase, 2) - 0.5f, halton(phase, 3) - 0.5f};
+		taaJitter_ = 2.0f * pixels /
+					 glm::vec2(renderExtent_.width, renderExtent_.height);
+		ubo.proj = glm::translate(glm::mat4(1.0f),
+								  glm::vec3(taaJitter_, 0.0f)) *
+				   ubo.proj;
+	}
 	ubo.invProj = glm::inverse(ubo.proj);
 
 	ubo.cameraPos = camera.position;
@@ -397,8 +593,8 @@ void Renderer::update_uniforms(const Camera& camera, float time,
 	ubo.ambientColor = lights.ambient.color * lights.ambient.intensity;
 	ubo.tileCountX = tileCountX_;
 	ubo.tileCountY = tileCountY_;
-	ubo.screenWidth = swapchainExtent_.width;
-	ubo.screenHeight = swapchainExtent_.height;
+	ubo.screenWidth = renderExtent_.width;
+	ubo.screenHeight = renderExtent_.height;
 
 	std::memcpy(uniformBuffersMapped_[currentFrame_], &ubo, sizeof(ubo));
 
@@ -413,6 +609,61 @@ void Renderer::update_uniforms(const Camera& camera, float time,
 	}
 }
 
+bool Renderer::transparency_mode_supported(TransparencyMode mode) const
+{
+	switch (mode)
+	{
+		case TransparencyMode::Sorted:
+			return true;
+		case TransparencyMode::WeightedOit:
+			return oitWeightedSupported_;
+		case TransparencyMode::LinkedListOit:
+			return oitListSupported_;
+	}
+	return false;
+}
+
+bool Renderer::has_blended_materials() const
+{
+	return std::any_of(materials_.begin(), materials_.end(),
+					   [](const Material& m)
+					   { return m.alphaMode == AlphaMode::Blend; });
+}
+
+bool Renderer::blended(uint32_t meshIndex) const
+{
+	return meshIndex < meshes_.size() &&
+		   alpha_mode(meshes_[meshIndex]) == AlphaMode::Blend;
+}
+
+void Renderer::sort_transparent(std::span<const uint32_t> meshes,
+								std::span<const glm::mat4> worlds,
+								const glm::mat4& view)
+{
+	// The order-independent modes draw every blended mesh unsorted
+	if (frameTransparency_ != TransparencyMode::Sorted) return;
+
+	auto start = Clock::now();
+	size_t count = std::min(meshes.size(), worlds.size());
+	transparentOrder_.assign(meshes.begin(), meshes.begin() + count);
+	transparentKeys_.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const AABB& bounds = meshes_[meshes[i]].localBounds;
+		glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+		// The camera looks down -Z: the farthest mesh has the smallest z,
+		// so ascending z is back to front
+		float z = (view * worlds[i] * glm::vec4(center, 1.0f)).z;
+		transparentKeys_[i] = float_sort_key(z);
+	}
+	radix_sort(transparentKeys_, transparentOrder_, sortScratch_);
+
+	transparencyStats_.meshes = static_cast<uint32_t>(count);
+	transparencyStats_.sortMs =
+		std::chrono::duration<double, std::milli>(Clock::now() - start)
+			.count();
+}
+
 void Renderer::draw_scene(VkCommandBuffer cmd)
 {
 	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pbrPipeline_);
@@ -423,6 +674,10 @@ void Renderer::draw_scene(VkCommandBuffer cmd)
 	vkCmdSetFrontFace(cmd, debugFrontFace_ == 1
 							   ? VK_FRONT_FACE_CLOCKWISE
 							   : VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	vkCmdSetDepthWriteEnable(cmd, frameSkipPrepass_ ? VK_TRUE : VK_FALSE);
+	vkCmdSetDepthCompareOp(cmd, frameSkipPrepass_
+									? VK_COMPARE_OP_LESS
+									: VK_COMPARE_OP_LESS_OR_EQUAL);
 
 	// Bind frame descriptor set (set 0)
 	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -434,11 +689,11 @@ void Renderer::draw_scene(VkCommandBuffer cmd)
 							pbrPipelineLayout_, 2, 1,
 							&lightDescriptorSets_[currentFrame_], 0, nullptr);
 
-	for (const auto& mesh : meshes_)
+	// The model matrix comes from the instance buffer (set 0 binding 1),
+	// selected by firstInstance
+	auto draw = [&](uint32_t i)
 	{
-		// Push model matrix
-		vkCmdPushConstants(cmd, pbrPipelineLayout_, VK_SHADER_STAGE_VERTEX_BIT,
-						   0, sizeof(glm::mat4), &mesh.transform);
+		const Mesh& mesh = meshes_[i];
 
 		// Bind material descriptor set (set 1)
 		if (mesh.materialIndex < materials_.size())
@@ -448,12 +703,58 @@ void Renderer::draw_scene(VkCommandBuffer cmd)
 				&materials_[mesh.materialIndex].descriptorSet, 0, nullptr);
 		}
 
-		VkBuffer vbufs[] = {mesh.vertexBuffer};
-		VkDeviceSize offs[] = {0};
-		vkCmdBindVertexBuffers(cmd, 0, 1, vbufs, offs);
-		vkCmdBindIndexBuffer(cmd, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+		bind_mesh_buffers(cmd, mesh);
 		vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices.size()), 1, 0,
-						 0, 0);
+						 0, i);
+	};
+
+	// Opaque meshes, then alpha-tested ones on their own pipeline so only
+	// those lose early-Z
+	bool masked = false;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(meshes_.size()); ++i)
+	{
+		AlphaMode mode = alpha_mode(meshes_[i]);
+		masked = masked || mode == AlphaMode::Mask;
+		if (mode == AlphaMode::Opaque) draw(i);
+	}
+	if (masked)
+	{
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						  pbrMaskPipeline_);
+		for (uint32_t i = 0; i < static_cast<uint32_t>(meshes_.size()); ++i)
+			if (alpha_mode(meshes_[i]) == AlphaMode::Mask) draw(i);
+	}
+
+	// Blended meshes last: the OIT targets composited over the opaque
+	// scene, or the meshes back to front, testing depth without writing it
+	if (frameTransparency_ != TransparencyMode::Sorted)
+	{
+		bool list = frameTransparency_ == TransparencyMode::LinkedListOit;
+		VkPipelineLayout layout =
+			list ? oitListResolvePipelineLayout_ : oitResolvePipelineLayout_;
+		gpuProfiler_.begin_scope(cmd, "OIT resolve");
+		vkCmdBindPipeline(
+			cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+			list ? oitListResolvePipeline_ : oitResolvePipeline_);
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+								0, 1,
+								list ? &oitListSets_[currentFrame_]
+									 : &oitResolveSets_[currentFrame_],
+								0, nullptr);
+		vkCmdDraw(cmd, 3, 1, 0, 0);
+		gpuProfiler_.end_scope(cmd);
+	}
+	else if (!transparentOrder_.empty())
+	{
+		gpuProfiler_.begin_scope(cmd, "Transparent");
+		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+						  pbrBlendPipeline_);
+		vkCmdSetDepthWriteEnable(cmd, VK_FALSE);
+		for (uint32_t i : transparentOrder_)
+			if (i < meshes_.size() &&
+				alpha_mode(meshes_[i]) == AlphaMode::Blend)
+				draw(i);
+		gpuProfiler_.end_scope(cmd);
 	}
 
 	// Heatmap debug overlay
@@ -470,8 +771,8 @@ void Renderer::draw_scene(VkCommandBuffer cmd)
 		vkCmdDraw(cmd, 3, 1, 0, 0);
 	}
 
-	// Debug light wireframes
-	if (showDebugLines_ && debugLineVertexCount_ > 0)
+	// Debug light wireframes and load placeholders
+	if (debugLineVertexCount_ > 0)
 	{
 		vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
 						  debugLinePipeline_);
@@ -485,40 +786,90 @@ void Renderer::draw_scene(VkCommandBuffer cmd)
 	}
 }
 
+void Renderer::finish_scene(const FrameContext& ctx)
+{
+	// Without TAA the main pass stays open for the overlay
+	if (!frameSceneOpen_) return;
+	frameSceneOpen_ = false;
+
+	vkCmdEndRendering(ctx.cmd);
+	gpuProfiler_.end_scope(ctx.cmd);
+	RenderGraph& graph = frameGraphs_[currentFrame_];
+	uint32_t last = static_cast<uint32_t>(graph.segments().size()) - 1;
+	graph.resume(last, ctx.cmd, frameMainPass_);
+}
+
 void Renderer::end_frame(const FrameContext& ctx)
 {
-	vkCmdEndRenderPass(ctx.cmd);
+	finish_scene(ctx);
+	vkCmdEndRendering(ctx.cmd);
+	gpuProfiler_.end_scope(ctx.cmd);
+
+	// The target's last use in the frame, outside the graph: present, or
+	// stay in TRANSFER_SRC for read-back
+	VkImageMemoryBarrier2 toFinal{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+	toFinal.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	toFinal.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+	toFinal.dstStageMask = headless_ ? VK_PIPELINE_STAGE_2_TRANSFER_BIT
+									 : VK_PIPELINE_STAGE_2_NONE;
+	toFinal.dstAccessMask = headless_ ? VK_ACCESS_2_TRANSFER_READ_BIT : 0;
+	toFinal.oldLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+	toFinal.newLayout = headless_ ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+								  : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	toFinal.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toFinal.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toFinal.image = swapchainImages_[ctx.imageIndex];
+	toFinal.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+	VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+	dep.imageMemoryBarrierCount = 1;
+	dep.pImageMemoryBarriers = &toFinal;
+	vkCmdPipelineBarrier2(ctx.cmd, &dep);
+
+	gpuProfiler_.end_frame(ctx.cmd);
 	VK_CHECK(vkEndCommandBuffer(ctx.cmd));
 
-	VkSemaphore waitSems[] = {imageAvailableSemaphores_[currentFrame_]};
-	VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-	VkSemaphore sigSems[] = {renderFinishedSemaphores_[ctx.imageIndex]};
+	submit_frame_graph(ctx.imageIndex);
 
-	VkSubmitInfo si{VK_STRUCTURE_TYPE_SUBMIT_INFO};
-	si.waitSemaphoreCount = 1;
-	si.pWaitSemaphores = waitSems;
-	si.pWaitDstStageMask = waitStages;
-	si.commandBufferCount = 1;
-	si.pCommandBuffers = &ctx.cmd;
-	si.signalSemaphoreCount = 1;
-	si.pSignalSemaphores = sigSems;
-	VK_CHECK(
-		vkQueueSubmit(graphicsQueue_, 1, &si, inFlightFences_[currentFrame_]));
+	// A stalled consumer must not grow the queue without bound
+	if (latencyQueue_.size() >= 2 * MAX_FRAMES_IN_FLIGHT)
+		latencyQueue_.pop_front();
+	LatencyRecord record{inputTime_, 0, currentFrame_};
+
+	if (headless_)
+	{
+		// Nothing to present; the target stays in TRANSFER_SRC for read-back
+		lastImageIndex_ = ctx.imageIndex;
+		latencyQueue_.push_back(record);
+		if (requestedOffscreenExtent_.width != 0) recreate_swapchain();
+		currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+		return;
+	}
 
 	VkSwapchainKHR swapchains[] = {swapchain_};
 	VkPresentInfoKHR pi{VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
 	pi.waitSemaphoreCount = 1;
-	pi.pWaitSemaphores = sigSems;
+	pi.pWaitSemaphores = &renderFinishedSemaphores_[ctx.imageIndex];
 	pi.swapchainCount = 1;
 	pi.pSwapchains = swapchains;
 	pi.pImageIndices = &ctx.imageIndex;
 
+	VkPresentIdKHR presentIdInfo{VK_STRUCTURE_TYPE_PRESENT_ID_KHR};
+	if (presentWaitEnabled_)
+	{
+		record.presentId = ++presentId_;
+		presentIdInfo.swapchainCount = 1;
+		presentIdInfo.pPresentIds = &record.presentId;
+		pi.pNext = &presentIdInfo;
+	}
+	latencyQueue_.push_back(record);
+
 	VkResult result = vkQueuePresentKHR(presentQueue_, &pi);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
-		framebufferResized_)
+		framebufferResized_ || swapchainDirty_)
 	{
 		framebufferResized_ = false;
+		swapchainDirty_ = false;
 		recreate_swapchain();
 	}
 	else if (result != VK_SUCCESS)
@@ -526,7 +877,127 @@ void Renderer::end_frame(const FrameContext& ctx)
 		throw std::runtime_error("Failed to present");
 	}
 
-	currentFrame_ = (currentFrame_ + 1) % MAX_FRAMES_IN_FLIGHT;
+	currentFrame_ = (currentFrame_ + 1) % framesInFlight_;
+}
+
+// =============================================================================
+// Frame capture
+// =============================================================================
+
+bool Renderer::read_back_frame(std::vector<uint8_t>& rgba)
+{
+	if (!headless_ || !lastImageIndex_.has_value())
+	{
+		std::fprintf(stderr,
+					 "read_back_frame: only available in headless mode after "
+					 "a frame has been submitted\n");
+		return false;
+	}
+
+	vkDeviceWaitIdle(device_);
+
+	VkImage image = swapchainImages_[lastImageIndex_.value()];
+	VkDeviceSize size = static_cast<VkDeviceSize>(swapchainExtent_.width) *
+						swapchainExtent_.height * 4;
+
+	VkBuffer readback;
+	VkDeviceMemory readbackMemory;
+	create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+					  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				  readback, readbackMemory);
+
+	VkCommandBuffer cmd = begin_single_time_commands();
+
+	// end_frame already left the image in TRANSFER_SRC; this only keeps
+	// read-back independent of how the frame was recorded
+	VkImageMemoryBarrier barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+						 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0,
+						 nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	region.imageExtent = {swapchainExtent_.width, swapchainExtent_.height, 1};
+	vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						   readback, 1, &region);
+
+	VkMemoryBarrier hostBarrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+						 VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &hostBarrier, 0,
+						 nullptr, 0, nullptr);
+
+	end_single_time_commands(cmd);
+
+	void* data;
+	vkMapMemory(device_, readbackMemory, 0, size, 0, &data);
+	rgba.resize(static_cast<size_t>(size));
+	std::memcpy(rgba.data(), data, static_cast<size_t>(size));
+	vkUnmapMemory(device_, readbackMemory);
+
+	vkDestroyBuffer(device_, readback, nullptr);
+	vkFreeMemory(device_, readbackMemory, nullptr);
+	return true;
+}
+
+bool Renderer::save_frame(const std::string& path)
+{
+	std::vector<uint8_t> rgba;
+	if (!read_back_frame(rgba)) return false;
+	return write_frame_image(path, swapchainExtent_.width,
+							 swapchainExtent_.height, rgba);
+}
+
+// =============================================================================
+// GPU picking
+// =============================================================================
+
+void Renderer::request_pick(uint32_t x, uint32_t y)
+{
+	pickRequest_ = VkOffset2D{static_cast<int32_t>(x), static_cast<int32_t>(y)};
+}
+
+bool Renderer::pick_result(std::optional<uint32_t>& meshIndex)
+{
+	if (!pickReady_) return false;
+	pickReady_ = false;
+	meshIndex.reset();
+	if (pickValue_ != 0 && pickValue_ - 1 < meshes_.size())
+		meshIndex = pickValue_ - 1;
+	return true;
+}
+
+// Mesh indices shift on deletes, so results taken before one are stale
+void Renderer::drop_picks()
+{
+	pickRequest_.reset();
+	pickReady_ = false;
+	for (bool& inFlight : pickInFlight_) inFlight = false;
+}
+
+void Renderer::create_pick_buffers()
+{
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		create_buffer(sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					  pickBuffers_[i], pickMemory_[i]);
+		void* mapped = nullptr;
+		vkMapMemory(device_, pickMemory_[i], 0, sizeof(uint32_t), 0, &mapped);
+		pickMapped_[i] = static_cast<uint32_t*>(mapped);
+		*pickMapped_[i] = 0;
+	}
 }
 
 // =============================================================================
@@ -546,9 +1017,14 @@ void Renderer::create_instance()
 	appInfo.pEngineName = "none";
 	appInfo.apiVersion = VK_API_VERSION_1_3;
 
-	uint32_t glfwExtCnt;
-	const char** glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCnt);
-	std::vector<const char*> exts(glfwExts, glfwExts + glfwExtCnt);
+	// Headless mode never touches GLFW, so it needs no surface extensions
+	std::vector<const char*> exts;
+	if (!headless_)
+	{
+		uint32_t glfwExtCnt;
+		const char** glfwExts = glfwGetRequiredInstanceExtensions(&glfwExtCnt);
+		exts.assign(glfwExts, glfwExts + glfwExtCnt);
+	}
 	if (useValidation) exts.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 
 	VkInstanceCreateInfo ci{VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO};
@@ -610,33 +1086,54 @@ void Renderer::pick_physical_device()
 		{
 			if (qfs[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
 				gf = static_cast<int>(i);
+			if (headless_) continue;
 			VkBool32 present = VK_FALSE;
 			vkGetPhysicalDeviceSurfaceSupportKHR(pd, i, surface_, &present);
 			if (present) pf = static_cast<int>(i);
 		}
+		if (headless_) pf = gf;	 // no presentation, any graphics queue will do
 		if (gf < 0 || pf < 0) continue;
 
-		uint32_t extCnt;
-		vkEnumerateDeviceExtensionProperties(pd, nullptr, &extCnt, nullptr);
-		std::vector<VkExtensionProperties> exts(extCnt);
-		vkEnumerateDeviceExtensionProperties(pd, nullptr, &extCnt, exts.data());
-		bool hasSwapchain = false;
-		for (auto& e : exts)
-			if (std::strcmp(e.extensionName, VK_KHR_SWAPCHAIN_EXTENSION_NAME) ==
-				0)
-				hasSwapchain = true;
-		if (!hasSwapchain) continue;
-
-		uint32_t fmtCnt, pmCnt;
-		vkGetPhysicalDeviceSurfaceFormatsKHR(pd, surface_, &fmtCnt, nullptr);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(pd, surface_, &pmCnt,
-												  nullptr);
-		if (fmtCnt == 0 || pmCnt == 0) continue;
+		// Every pass uses dynamic rendering and synchronization2 barriers
+		VkPhysicalDeviceVulkan13Features features13{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+		VkPhysicalDeviceFeatures2 features2{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+		features2.pNext = &features13;
+		vkGetPhysicalDeviceFeatures2(pd, &features2);
+		if (!features13.dynamicRendering || !features13.synchronization2)
+			continue;
+
+		if (!headless_)
+		{
+			if (!has_device_extension(pd, VK_KHR_SWAPCHAIN_EXTENSION_NAME))
+				continue;
+
+			uint32_t fmtCnt, pmCnt;
+			vkGetPhysicalDeviceSurfaceFormatsKHR(pd, surface_, &fmtCnt,
+												 nullptr);
+			vkGetPhysicalDeviceSurfacePresentModesKHR(pd, surface_, &pmCnt,
+													  nullptr);
+			if (fmtCnt == 0 || pmCnt == 0) continue;
+		}
 
 		physicalDevice_ = pd;
 		graphicsFamily_ = static_cast<uint32_t>(gf);
 		presentFamily_ = static_cast<uint32_t>(pf);
 
+		// A compute-only family can run light culling next to graphics
+		asyncComputeSupported_ = false;
+		for (uint32_t i = 0; i < qfCnt; ++i)
+		{
+			if ((qfs[i].queueFlags & VK_QUEUE_COMPUTE_BIT) &&
+				!(qfs[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			{
+				computeFamily_ = i;
+				asyncComputeSupported_ = true;
+				break;
+			}
+		}
+
 		VkPhysicalDeviceProperties props;
 		vkGetPhysicalDeviceProperties(pd, &props);
 		std::strncpy(gpuName_, props.deviceName, sizeof(gpuName_) - 1);
@@ -649,7 +1146,22 @@ void Renderer::pick_physical_device()
 
 void Renderer::create_logical_device()
 {
+	// Timeline semaphores chain the async light culling submissions
+	VkPhysicalDeviceVulkan12Features features12{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+	if (asyncComputeSupported_)
+	{
+		VkPhysicalDeviceFeatures2 query{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+		query.pNext = &features12;
+		vkGetPhysicalDeviceFeatures2(physicalDevice_, &query);
+		asyncComputeSupported_ = features12.timelineSemaphore == VK_TRUE;
+		features12 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+		features12.timelineSemaphore = asyncComputeSupported_;
+	}
+
 	std::set<uint32_t> uniqueFamilies = {graphicsFamily_, presentFamily_};
+	if (asyncComputeSupported_) uniqueFamilies.insert(computeFamily_);
 	float prio = 1.0f;
 	std::vector<VkDeviceQueueCreateInfo> queueCIs;
 	for (uint32_t fam : uniqueFamilies)
@@ -661,21 +1173,78 @@ void Renderer::create_logical_device()
 		queueCIs.push_back(qi);
 	}
 
+	// Software rasterizers may not expose anisotropic filtering
+	VkPhysicalDeviceFeatures supported;
+	vkGetPhysicalDeviceFeatures(physicalDevice_, &supported);
+	anisotropySupported_ = supported.samplerAnisotropy == VK_TRUE;
+
 	VkPhysicalDeviceFeatures features{};
-	features.samplerAnisotropy = VK_TRUE;
+	features.samplerAnisotropy = anisotropySupported_ ? VK_TRUE : VK_FALSE;
+
+	// Order-independent transparency: the weighted mode blends its two
+	// targets differently, and the linked lists are built with stores and
+	// atomics in a fragment shader
+	oitWeightedSupported_ = supported.independentBlend == VK_TRUE;
+	oitListSupported_ = supported.fragmentStoresAndAtomics == VK_TRUE;
+	features.independentBlend = supported.independentBlend;
+	features.fragmentStoresAndAtomics = supported.fragmentStoresAndAtomics;
+
+	std::vector<const char*> devExts;
+	if (!headless_) devExts.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+
+	// Present wait lets the low-latency mode block on the display rather
+	// than on the GPU; it needs both extensions and both features
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR};
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR};
+	presentIdFeatures.pNext = &presentWaitFeatures;
+	if (!headless_ &&
+		has_device_extension(physicalDevice_,
+							 VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+		has_device_extension(physicalDevice_,
+							 VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		VkPhysicalDeviceFeatures2 features2{
+			VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+		features2.pNext = &presentIdFeatures;
+		vkGetPhysicalDeviceFeatures2(physicalDevice_, &features2);
+		presentWaitEnabled_ = presentIdFeatures.presentId == VK_TRUE &&
+							  presentWaitFeatures.presentWait == VK_TRUE;
+	}
+	if (presentWaitEnabled_)
+	{
+		devExts.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		devExts.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+	}
 
-	const char* devExts[] = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+	VkPhysicalDeviceVulkan13Features features13{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES};
+	features13.dynamicRendering = VK_TRUE;
+	features13.synchronization2 = VK_TRUE;
+	features13.pNext = &features12;
 
 	VkDeviceCreateInfo ci{VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
+	ci.pNext = &features13;
+	if (presentWaitEnabled_) features12.pNext = &presentIdFeatures;
 	ci.queueCreateInfoCount = static_cast<uint32_t>(queueCIs.size());
 	ci.pQueueCreateInfos = queueCIs.data();
 	ci.pEnabledFeatures = &features;
-	ci.enabledExtensionCount = 1;
-	ci.ppEnabledExtensionNames = devExts;
+	ci.enabledExtensionCount = static_cast<uint32_t>(devExts.size());
+	ci.ppEnabledExtensionNames = devExts.data();
 
 	VK_CHECK(vkCreateDevice(physicalDevice_, &ci, nullptr, &device_));
 	vkGetDeviceQueue(device_, graphicsFamily_, 0, &graphicsQueue_);
 	vkGetDeviceQueue(device_, presentFamily_, 0, &presentQueue_);
+	if (asyncComputeSupported_)
+		vkGetDeviceQueue(device_, computeFamily_, 0, &computeQueue_);
+
+	if (presentWaitEnabled_)
+	{
+		vkWaitForPresent_ = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+			vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+		presentWaitEnabled_ = vkWaitForPresent_ != nullptr;
+	}
 }
 
 // =============================================================================
@@ -697,9 +1266,9 @@ void Renderer::create_swapchain()
 	uint32_t pmCnt;
 	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice_, surface_, &pmCnt,
 											  nullptr);
-	std::vector<VkPresentModeKHR> pms(pmCnt);
+	supportedPresentModes_.resize(pmCnt);
 	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice_, surface_, &pmCnt,
-											  pms.data());
+											  supportedPresentModes_.data());
 
 	VkSurfaceFormatKHR fmt = fmts[0];
 	for (auto& f : fmts)
@@ -710,13 +1279,15 @@ void Renderer::create_swapchain()
 			break;
 		}
 
+	// FIFO is the only mode every surface must support
 	VkPresentModeKHR pm = VK_PRESENT_MODE_FIFO_KHR;
-	for (auto m : pms)
-		if (m == VK_PRESENT_MODE_MAILBOX_KHR)
-		{
-			pm = m;
-			break;
-		}
+	if (present_mode_supported(requestedPresentMode_))
+		pm = requestedPresentMode_;
+	else if (requestedPresentMode_ != VK_PRESENT_MODE_MAILBOX_KHR)
+		std::fprintf(stderr,
+					 "Present mode %d not supported by the surface, using "
+					 "FIFO\n",
+					 static_cast<int>(requestedPresentMode_));
 
 	VkExtent2D extent;
 	if (caps.currentExtent.width != std::numeric_limits<uint32_t>::max())
@@ -765,7 +1336,17 @@ void Renderer::create_swapchain()
 	ci.presentMode = pm;
 	ci.clipped = VK_TRUE;
 
+	// On resize the old swapchain is handed over so the presentation engine
+	// can recycle its resources; frames in flight may still present from
+	// it, so it is only destroyed once they have finished
+	VkSwapchainKHR oldSwapchain = swapchain_;
+	ci.oldSwapchain = oldSwapchain;
+
 	VK_CHECK(vkCreateSwapchainKHR(device_, &ci, nullptr, &swapchain_));
+	if (oldSwapchain)
+		deletionQueue_.push(
+			submittedFrames_, [device = device_, oldSwapchain]()
+			{ vkDestroySwapchainKHR(device, oldSwapchain, nullptr); });
 
 	vkGetSwapchainImagesKHR(device_, swapchain_, &imgCount, nullptr);
 	swapchainImages_.resize(imgCount);
@@ -773,6 +1354,44 @@ void Renderer::create_swapchain()
 							swapchainImages_.data());
 	swapchainFormat_ = fmt.format;
 	swapchainExtent_ = extent;
+	presentMode_ = pm;
+}
+
+void Renderer::create_offscreen_targets()
+{
+	// RGBA8 sRGB is guaranteed to support color attachment + transfer, and
+	// reads back in the byte order PNG/EXR writers expect
+	swapchainFormat_ = VK_FORMAT_R8G8B8A8_SRGB;
+	swapchainImages_.resize(MAX_FRAMES_IN_FLIGHT);
+	offscreenMemory_.resize(MAX_FRAMES_IN_FLIGHT);
+
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+		imgCI.imageType = VK_IMAGE_TYPE_2D;
+		imgCI.format = swapchainFormat_;
+		imgCI.extent = {swapchainExtent_.width, swapchainExtent_.height, 1};
+		imgCI.mipLevels = 1;
+		imgCI.arrayLayers = 1;
+		imgCI.samples = VK_SAMPLE_COUNT_1_BIT;
+		imgCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imgCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+					  VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imgCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imgCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VK_CHECK(vkCreateImage(device_, &imgCI, nullptr, &swapchainImages_[i]));
+
+		VkMemoryRequirements memReq;
+		vkGetImageMemoryRequirements(device_, swapchainImages_[i], &memReq);
+		VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+		allocInfo.allocationSize = memReq.size;
+		allocInfo.memoryTypeIndex = find_memory_type(
+			memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK(vkAllocateMemory(device_, &allocInfo, nullptr,
+								  &offscreenMemory_[i]));
+		vkBindImageMemory(device_, swapchainImages_[i], offscreenMemory_[i], 0);
+	}
+	lastImageIndex_.reset();
 }
 
 void Renderer::create_image_views()
@@ -785,135 +1404,147 @@ void Renderer::create_image_views()
 
 void Renderer::recreate_swapchain()
 {
-	int w = 0, h = 0;
-	glfwGetFramebufferSize(window_, &w, &h);
-	while (w == 0 || h == 0)
+	if (!headless_)
 	{
+		int w = 0, h = 0;
 		glfwGetFramebufferSize(window_, &w, &h);
-		glfwWaitEvents();
+		while (w == 0 || h == 0)
+		{
+			glfwGetFramebufferSize(window_, &w, &h);
+			glfwWaitEvents();
+		}
 	}
-	vkDeviceWaitIdle(device_);
 
-	cleanup_swapchain();
+	// No device idle: frames in flight keep the old objects alive through
+	// the deletion queue. Present IDs belong to the old swapchain, so its
+	// pending latency records are dropped.
+	poll_latency();
+	latencyQueue_.clear();
+	presentId_ = 0;
 
-	for (auto s : renderFinishedSemaphores_)
-		vkDestroySemaphore(device_, s, nullptr);
-	renderFinishedSemaphores_.clear();
+	retire_swapchain_resources();
 
-	create_swapchain();
+	if (headless_)
+	{
+		if (requestedOffscreenExtent_.width != 0)
+			swapchainExtent_ = requestedOffscreenExtent_;
+		requestedOffscreenExtent_ = {};
+		create_offscreen_targets();
+	}
+	else
+	{
+		create_swapchain();
+	}
 	create_image_views();
 	create_depth_resources();
-	create_depth_only_framebuffer();
-	create_framebuffers();
-
-	// Recreate tile light SSBOs (size depends on resolution)
-	cleanup_light_buffers();
-	create_light_buffers();
-	create_light_descriptor_pool();
-	create_light_descriptor_sets();
+	create_history_images();
 
 	VkSemaphoreCreateInfo sci{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
 	renderFinishedSemaphores_.resize(swapchainImages_.size());
 	for (size_t i = 0; i < swapchainImages_.size(); ++i)
 		VK_CHECK(vkCreateSemaphore(device_, &sci, nullptr,
 								   &renderFinishedSemaphores_[i]));
+
+	// Tile counts follow the render extent and the tile buffers grow
+	// lazily per slot in begin_frame; every slot's light set still points
+	// at the retired depth view
+	for (bool& dirty : lightSetDirty_) dirty = true;
+	++swapchainRecreations_;
 }
 
-void Renderer::cleanup_swapchain()
+void Renderer::retire_swapchain_resources()
 {
-	if (depthOnlyFramebuffer_)
-		vkDestroyFramebuffer(device_, depthOnlyFramebuffer_, nullptr);
-	depthOnlyFramebuffer_ = VK_NULL_HANDLE;
+	// Tagged with the newest submitted frame, the last that can use them.
+	// The swapchain handle itself is retired by create_swapchain once its
+	// replacement exists.
+	std::vector<VkImage> offscreenImages;
+	if (!offscreenMemory_.empty()) offscreenImages = swapchainImages_;
+	deletionQueue_.push(
+		submittedFrames_,
+		[device = device_, views = swapchainImageViews_,
+		 semaphores = renderFinishedSemaphores_, depthView = depthView_,
+		 depthImage = depthImage_, depthMemory = depthMemory_,
+		 offscreenImages, offscreenMemory = offscreenMemory_,
+		 historyViews = std::to_array(historyViews_),
+		 historyImages = std::to_array(historyImages_),
+		 historyMemory = std::to_array(historyMemory_)]()
+		{
+			vkDestroyImageView(device, depthView, nullptr);
+			vkDestroyImage(device, depthImage, nullptr);
+			vkFreeMemory(device, depthMemory, nullptr);
+			for (int i = 0; i < 2; ++i)
+			{
+				vkDestroyImageView(device, historyViews[i], nullptr);
+				vkDestroyImage(device, historyImages[i], nullptr);
+				vkFreeMemory(device, historyMemory[i], nullptr);
+			}
+			for (auto iv : views) vkDestroyImageView(device, iv, nullptr);
+			for (auto sem : semaphores)
+				vkDestroySemaphore(device, sem, nullptr);
+			for (auto img : offscreenImages)
+				vkDestroyImage(device, img, nullptr);
+			for (auto mem : offscreenMemory) vkFreeMemory(device, mem, nullptr);
+		});
+
+	swapchainImages_.clear();
+	swapchainImageViews_.clear();
+	renderFinishedSemaphores_.clear();
+	offscreenMemory_.clear();
+	depthView_ = VK_NULL_HANDLE;
+	depthImage_ = VK_NULL_HANDLE;
+	depthMemory_ = VK_NULL_HANDLE;
+}
 
+void Renderer::cleanup_swapchain()
+{
 	vkDestroyImageView(device_, depthView_, nullptr);
 	vkDestroyImage(device_, depthImage_, nullptr);
 	vkFreeMemory(device_, depthMemory_, nullptr);
-	for (auto fb : framebuffers_) vkDestroyFramebuffer(device_, fb, nullptr);
+	for (int i = 0; i < 2; ++i)
+	{
+		vkDestroyImageView(device_, historyViews_[i], nullptr);
+		vkDestroyImage(device_, historyImages_[i], nullptr);
+		vkFreeMemory(device_, historyMemory_[i], nullptr);
+	}
 	for (auto iv : swapchainImageViews_)
 		vkDestroyImageView(device_, iv, nullptr);
-	vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+	if (swapchain_) vkDestroySwapchainKHR(device_, swapchain_, nullptr);
+	swapchain_ = VK_NULL_HANDLE;
+
+	// Headless targets are owned by us rather than by a swapchain
+	for (size_t i = 0; i < offscreenMemory_.size(); ++i)
+	{
+		vkDestroyImage(device_, swapchainImages_[i], nullptr);
+		vkFreeMemory(device_, offscreenMemory_[i], nullptr);
+	}
+	offscreenMemory_.clear();
 }
 
 // =============================================================================
-// Render pass
-// =============================================================================
-
-void Renderer::create_render_pass()
-{
-	VkAttachmentDescription colorAtt{};
-	colorAtt.format = swapchainFormat_;
-	colorAtt.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAtt.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentDescription depthAtt{};
-	depthAtt.format = find_depth_format();
-	depthAtt.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAtt.loadOp =
-		VK_ATTACHMENT_LOAD_OP_CLEAR;  // main pass does its own depth test
-	depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAtt.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	depthAtt.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference colorRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
-	VkAttachmentReference depthRef{
-		1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorRef;
-	subpass.pDepthStencilAttachment = &depthRef;
-
-	VkSubpassDependency dep{};
-	dep.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dep.dstSubpass = 0;
-	dep.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-					   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dep.srcAccessMask = 0;
-	dep.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
-					   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dep.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
-						VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	std::array<VkAttachmentDescription, 2> attachments = {colorAtt, depthAtt};
-
-	VkRenderPassCreateInfo ci{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
-	ci.attachmentCount = static_cast<uint32_t>(attachments.size());
-	ci.pAttachments = attachments.data();
-	ci.subpassCount = 1;
-	ci.pSubpasses = &subpass;
-	ci.dependencyCount = 1;
-	ci.pDependencies = &dep;
-
-	VK_CHECK(vkCreateRenderPass(device_, &ci, nullptr, &renderPass_));
-}
-
-// =============================================================================
-// PBR descriptor layouts
+// PBR descriptor layouts
 // =============================================================================
 
 void Renderer::create_pbr_descriptor_layouts()
 {
-	// Set 0: per-frame (UBO with view, proj, cameraPos, lightDir, lightColor)
+	// Set 0: per-frame (UBO with view, proj, cameraPos, lightDir, lightColor,
+	// plus the per-mesh model matrices)
 	{
-		VkDescriptorSetLayoutBinding uboBinding{};
-		uboBinding.binding = 0;
-		uboBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		uboBinding.descriptorCount = 1;
-		uboBinding.stageFlags =
+		std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags =
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		// Binding 1: instance SSBO, indexed by gl_InstanceIndex
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
 		VkDescriptorSetLayoutCreateInfo ci{
 			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
-		ci.bindingCount = 1;
-		ci.pBindings = &uboBinding;
+		ci.bindingCount = static_cast<uint32_t>(bindings.size());
+		ci.pBindings = bindings.data();
 		VK_CHECK(vkCreateDescriptorSetLayout(device_, &ci, nullptr,
 											 &frameSetLayout_));
 	}
@@ -999,9 +1630,12 @@ void Renderer::create_pbr_pipeline()
 
 	VkPipelineDepthStencilStateCreateInfo ds{
 		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+	// Depth comes from the prepass: test against it without writing. Both
+	// are dynamic so the main pass can lay depth down itself when the
+	// prepass is skipped.
 	ds.depthTestEnable = VK_TRUE;
-	ds.depthWriteEnable = VK_TRUE;
-	ds.depthCompareOp = VK_COMPARE_OP_LESS;
+	ds.depthWriteEnable = VK_FALSE;
+	ds.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
 
 	VkPipelineColorBlendAttachmentState blendAtt{};
 	blendAtt.colorWriteMask =
@@ -1014,31 +1648,39 @@ void Renderer::create_pbr_pipeline()
 	blend.pAttachments = &blendAtt;
 
 	VkDynamicState dynStates[] = {
-		VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR,
-		VK_DYNAMIC_STATE_CULL_MODE, VK_DYNAMIC_STATE_FRONT_FACE};
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+		VK_DYNAMIC_STATE_CULL_MODE,
+		VK_DYNAMIC_STATE_FRONT_FACE,
+		VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE,
+		VK_DYNAMIC_STATE_DEPTH_COMPARE_OP,
+	};
 	VkPipelineDynamicStateCreateInfo dyn{
 		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
-	dyn.dynamicStateCount = 4;
+	dyn.dynamicStateCount = 6;
 	dyn.pDynamicStates = dynStates;
 
-	// Pipeline layout: set 0=frame, set 1=material, set 2=lightData, push=model
+	// Pipeline layout: set 0=frame (+instances), set 1=material,
+	// set 2=lightData
 	VkDescriptorSetLayout setLayouts[] = {frameSetLayout_, materialSetLayout_,
 										  lightDataSetLayout_};
 
-	VkPushConstantRange pushRange{};
-	pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	pushRange.offset = 0;
-	pushRange.size = sizeof(glm::mat4);
-
 	VkPipelineLayoutCreateInfo layoutCI{
 		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
 	layoutCI.setLayoutCount = 3;
 	layoutCI.pSetLayouts = setLayouts;
-	layoutCI.pushConstantRangeCount = 1;
-	layoutCI.pPushConstantRanges = &pushRange;
 	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
 									&pbrPipelineLayout_));
 
+	// The linked-list OIT variant adds its heads and nodes as set 3
+	VkDescriptorSetLayout listSetLayouts[] = {
+		frameSetLayout_, materialSetLayout_, lightDataSetLayout_,
+		oitListSetLayout_};
+	layoutCI.setLayoutCount = 4;
+	layoutCI.pSetLayouts = listSetLayouts;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&oitListPipelineLayout_));
+
 	VkGraphicsPipelineCreateInfo ci{
 		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
 	ci.stageCount = 2;
@@ -1051,13 +1693,94 @@ void Renderer::create_pbr_pipeline()
 	ci.pDepthStencilState = &ds;
 	ci.pColorBlendState = &blend;
 	ci.pDynamicState = &dyn;
+	VkPipelineRenderingCreateInfo rendering = main_pass_formats();
+	ci.pNext = &rendering;
 	ci.layout = pbrPipelineLayout_;
-	ci.renderPass = renderPass_;
-	ci.subpass = 0;
 
 	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
 									   &pbrPipeline_));
 
+	// Alpha-tested and blended variants: ALPHA_MODE specialized, and the
+	// blended one composites over what is already drawn (premultiplied
+	// by its own alpha)
+	auto alphaMode = static_cast<uint32_t>(AlphaMode::Mask);
+	VkSpecializationMapEntry specEntry{0, 0, sizeof(uint32_t)};
+	VkSpecializationInfo spec{1, &specEntry, sizeof(uint32_t), &alphaMode};
+	stages[1].pSpecializationInfo = &spec;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &pbrMaskPipeline_));
+
+	alphaMode = static_cast<uint32_t>(AlphaMode::Blend);
+	blendAtt.blendEnable = VK_TRUE;
+	blendAtt.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	blendAtt.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAtt.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAtt.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAtt.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAtt.alphaBlendOp = VK_BLEND_OP_ADD;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &pbrBlendPipeline_));
+
+	// Order-independent variants of the blended pipeline. Weighted OIT
+	// sums into its accumulation target and scales its revealage target
+	// by 1 - alpha; the linked lists are written to storage only, so that
+	// pipeline has no color attachments.
+	stages[1].pSpecializationInfo = nullptr;
+	if (oitWeightedSupported_)
+	{
+		auto accumCode = packFile_->read("shaders/oit_accum.frag.spv");
+		VkShaderModule accumMod = create_shader_module(accumCode);
+		stages[1].module = accumMod;
+
+		std::array<VkPipelineColorBlendAttachmentState, 2> oitBlend{};
+		oitBlend[0].blendEnable = VK_TRUE;
+		oitBlend[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		oitBlend[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+		oitBlend[0].colorBlendOp = VK_BLEND_OP_ADD;
+		oitBlend[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		oitBlend[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		oitBlend[0].alphaBlendOp = VK_BLEND_OP_ADD;
+		oitBlend[0].colorWriteMask = blendAtt.colorWriteMask;
+		oitBlend[1].blendEnable = VK_TRUE;
+		oitBlend[1].srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+		oitBlend[1].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+		oitBlend[1].colorBlendOp = VK_BLEND_OP_ADD;
+		oitBlend[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		oitBlend[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		oitBlend[1].alphaBlendOp = VK_BLEND_OP_ADD;
+		oitBlend[1].colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+		blend.attachmentCount = static_cast<uint32_t>(oitBlend.size());
+		blend.pAttachments = oitBlend.data();
+
+		VkFormat oitFormats[] = {OIT_ACCUM_FORMAT, OIT_REVEALAGE_FORMAT};
+		VkPipelineRenderingCreateInfo oitRendering{
+			VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+		oitRendering.colorAttachmentCount = 2;
+		oitRendering.pColorAttachmentFormats = oitFormats;
+		oitRendering.depthAttachmentFormat = depthFormat_;
+		ci.pNext = &oitRendering;
+		VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci,
+										   nullptr, &oitAccumPipeline_));
+		vkDestroyShaderModule(device_, accumMod, nullptr);
+	}
+	if (oitListSupported_)
+	{
+		auto listCode = packFile_->read("shaders/oit_list.frag.spv");
+		VkShaderModule listMod = create_shader_module(listCode);
+		stages[1].module = listMod;
+		blend.attachmentCount = 0;
+		blend.pAttachments = nullptr;
+
+		VkPipelineRenderingCreateInfo listRendering{
+			VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+		listRendering.depthAttachmentFormat = depthFormat_;
+		ci.pNext = &listRendering;
+		ci.layout = oitListPipelineLayout_;
+		VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci,
+										   nullptr, &oitListPipeline_));
+		vkDestroyShaderModule(device_, listMod, nullptr);
+	}
+
 	vkDestroyShaderModule(device_, fragMod, nullptr);
 	vkDestroyShaderModule(device_, vertMod, nullptr);
 }
@@ -1077,8 +1800,9 @@ void Renderer::create_pbr_sampler()
 	ci.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	ci.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
 	ci.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	ci.anisotropyEnable = VK_TRUE;
-	ci.maxAnisotropy = props.limits.maxSamplerAnisotropy;
+	ci.anisotropyEnable = anisotropySupported_ ? VK_TRUE : VK_FALSE;
+	ci.maxAnisotropy =
+		anisotropySupported_ ? props.limits.maxSamplerAnisotropy : 1.0f;
 	ci.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
 	ci.unnormalizedCoordinates = VK_FALSE;
 	ci.compareEnable = VK_FALSE;
@@ -1107,8 +1831,23 @@ void Renderer::create_default_textures()
 // Texture upload with mipmaps
 // =============================================================================
 
-void Renderer::upload_texture(Texture& tex)
+void Renderer::upload_texture(Texture& tex, uint32_t baseMip)
 {
+	baseMip = std::min(baseMip, tex.mip_count() - 1);
+	if (baseMip > 0)
+	{
+		// The GPU image comes from the smaller copy; tex keeps its pixels
+		Texture level = tex.mip(baseMip);
+		upload_texture(level);
+		tex.image = level.image;
+		tex.memory = level.memory;
+		tex.view = level.view;
+		tex.mipLevels = level.mipLevels;
+		tex.residentMip = baseMip;
+		return;
+	}
+	tex.residentMip = 0;
+
 	uint32_t mipLevels = static_cast<uint32_t>(std::floor(
 							 std::log2(std::max(tex.width, tex.height)))) +
 						 1;
@@ -1192,8 +1931,7 @@ void Renderer::upload_texture(Texture& tex)
 		end_single_time_commands(cmd);
 	}
 
-	vkDestroyBuffer(device_, stagingBuffer, nullptr);
-	vkFreeMemory(device_, stagingMemory, nullptr);
+	destroy_staging(stagingBuffer, stagingMemory);
 
 	generate_mipmaps(tex.image, format, tex.width, tex.height, mipLevels);
 
@@ -1317,7 +2055,9 @@ void Renderer::generate_mipmaps(VkImage image, VkFormat format, uint32_t width,
 
 void Renderer::upload_mesh(Mesh& mesh)
 {
-	// Vertex buffer
+	// Vertex buffer. Skinned and morphed meshes draw from the skinned
+	// vertex buffers, posed from the bind pose rebuild_skinning() packs.
+	if (!mesh.deformed())
 	{
 		VkDeviceSize sz = sizeof(Vertex) * mesh.vertices.size();
 		VkBuffer staging;
@@ -1336,8 +2076,7 @@ void Renderer::upload_mesh(Mesh& mesh)
 					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer,
 					  mesh.vertexMemory);
 		copy_buffer(staging, mesh.vertexBuffer, sz);
-		vkDestroyBuffer(device_, staging, nullptr);
-		vkFreeMemory(device_, stagingMem, nullptr);
+		destroy_staging(staging, stagingMem);
 	}
 
 	// Index buffer
@@ -1359,8 +2098,7 @@ void Renderer::upload_mesh(Mesh& mesh)
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer,
 			mesh.indexMemory);
 		copy_buffer(staging, mesh.indexBuffer, sz);
-		vkDestroyBuffer(device_, staging, nullptr);
-		vkFreeMemory(device_, stagingMem, nullptr);
+		destroy_staging(staging, stagingMem);
 	}
 }
 
@@ -1371,37 +2109,58 @@ void Renderer::upload_mesh(Mesh& mesh)
 void Renderer::create_material_descriptor_pool(uint32_t materialCount)
 {
 	if (materialCount == 0) materialCount = 1;
+	// Texture streaming replaces sets while frames in flight still use the
+	// old ones: room for those, plus the replacement being written
+	uint32_t setCount = materialCount * (MAX_FRAMES_IN_FLIGHT + 2);
 
 	std::array<VkDescriptorPoolSize, 2> poolSizes{};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[0].descriptorCount =
-		materialCount * 4;	// 4 samplers per material
+	poolSizes[0].descriptorCount = setCount * 4;  // 4 samplers per set
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[1].descriptorCount = materialCount;  // 1 factor UBO per material
+	poolSizes[1].descriptorCount = setCount;  // 1 factor UBO per set
 
 	VkDescriptorPoolCreateInfo ci{
 		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+	ci.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
 	ci.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	ci.pPoolSizes = poolSizes.data();
-	ci.maxSets = materialCount;
+	ci.maxSets = setCount;
 	VK_CHECK(vkCreateDescriptorPool(device_, &ci, nullptr,
 									&materialDescriptorPool_));
 }
 
-void Renderer::create_material_descriptor(Material& mat)
+VkDescriptorSet Renderer::allocate_material_set()
 {
 	VkDescriptorSetAllocateInfo ai{
 		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
 	ai.descriptorPool = materialDescriptorPool_;
 	ai.descriptorSetCount = 1;
 	ai.pSetLayouts = &materialSetLayout_;
-	VK_CHECK(vkAllocateDescriptorSets(device_, &ai, &mat.descriptorSet));
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	VkResult result = vkAllocateDescriptorSets(device_, &ai, &set);
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY ||
+		result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		// More replacements pending than the pool was sized for: wait for
+		// them to retire rather than fail
+		vkDeviceWaitIdle(device_);
+		deletionQueue_.flush_all();
+		result = vkAllocateDescriptorSets(device_, &ai, &set);
+	}
+	VK_CHECK(result);
+	return set;
+}
+
+void Renderer::create_material_descriptor(Material& mat)
+{
+	mat.descriptorSet = allocate_material_set();
 
 	// Create factor UBO
 	MaterialFactorsGPU factors{};
 	factors.baseColorFactor = mat.baseColorFactor;
 	factors.metallicFactor = mat.metallicFactor;
 	factors.roughnessFactor = mat.roughnessFactor;
+	factors.alphaCutoff = mat.alphaCutoff;
 	factors.emissiveFactor = glm::vec4(mat.emissiveFactor, 0.0f);
 
 	create_buffer(sizeof(MaterialFactorsGPU),
@@ -1416,6 +2175,22 @@ void Renderer::create_material_descriptor(Material& mat)
 	std::memcpy(data, &factors, sizeof(MaterialFactorsGPU));
 	vkUnmapMemory(device_, mat.factorMemory);
 
+	write_material_set(mat);
+}
+
+void Renderer::write_material_set(const Material& mat)
+{
+	// Binding 4: material factors UBO
+	VkDescriptorBufferInfo factorBufInfo{mat.factorBuffer, 0,
+										 sizeof(MaterialFactorsGPU)};
+	VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+	write.dstSet = mat.descriptorSet;
+	write.dstBinding = 4;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &factorBufInfo;
+	vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+
 	auto get_view = [&](int32_t texIndex,
 						const Texture& fallback) -> VkImageView
 	{
@@ -1443,10 +2218,7 @@ void Renderer::create_material_descriptor(Material& mat)
 	imageInfos[3].imageView = get_view(mat.emissiveTexture, defaultWhite_);
 	imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-	VkDescriptorBufferInfo factorBufInfo{mat.factorBuffer, 0,
-										 sizeof(MaterialFactorsGPU)};
-
-	std::array<VkWriteDescriptorSet, 5> writes{};
+	std::array<VkWriteDescriptorSet, 4> writes{};
 	for (uint32_t i = 0; i < 4; ++i)
 	{
 		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -1456,14 +2228,6 @@ void Renderer::create_material_descriptor(Material& mat)
 		writes[i].descriptorCount = 1;
 		writes[i].pImageInfo = &imageInfos[i];
 	}
-	// Binding 4: material factors UBO
-	writes[4].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	writes[4].dstSet = mat.descriptorSet;
-	writes[4].dstBinding = 4;
-	writes[4].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	writes[4].descriptorCount = 1;
-	writes[4].pBufferInfo = &factorBufInfo;
-
 	vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
 						   writes.data(), 0, nullptr);
 }
@@ -1484,7 +2248,7 @@ void Renderer::create_uniform_buffers()
 		create_buffer(sz, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
 					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					  uniformBuffers_[i], uniformBuffersMemory_[i]);
+					  uniformBuffers_[i], uniformBuffersMemory_[i], true);
 		vkMapMemory(device_, uniformBuffersMemory_[i], 0, sz, 0,
 					&uniformBuffersMapped_[i]);
 	}
@@ -1492,14 +2256,16 @@ void Renderer::create_uniform_buffers()
 
 void Renderer::create_frame_descriptor_pool()
 {
-	VkDescriptorPoolSize poolSize{};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	VkDescriptorPoolSize poolSizes[2]{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 
 	VkDescriptorPoolCreateInfo ci{
 		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-	ci.poolSizeCount = 1;
-	ci.pPoolSizes = &poolSize;
+	ci.poolSizeCount = 2;
+	ci.pPoolSizes = poolSizes;
 	ci.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
 	VK_CHECK(
 		vkCreateDescriptorPool(device_, &ci, nullptr, &frameDescriptorPool_));
@@ -1530,9 +2296,74 @@ void Renderer::create_frame_descriptor_sets()
 		write.pBufferInfo = &bufInfo;
 
 		vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+
+		create_instance_buffer(i, INSTANCE_CAPACITY_STEP);
+		update_instance_descriptor(i);
 	}
 }
 
+// =============================================================================
+// Instance buffers
+// =============================================================================
+
+std::span<glm::mat4> Renderer::instance_transforms()
+{
+	return {instanceMapped_[currentFrame_], meshes_.size()};
+}
+
+void Renderer::create_instance_buffer(uint32_t slot, uint32_t capacity)
+{
+	VkDeviceSize size =
+		static_cast<VkDeviceSize>(capacity) * sizeof(glm::mat4);
+	create_buffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+					  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				  instanceBuffers_[slot], instanceMemory_[slot]);
+	void* mapped = nullptr;
+	vkMapMemory(device_, instanceMemory_[slot], 0, size, 0, &mapped);
+	instanceMapped_[slot] = static_cast<glm::mat4*>(mapped);
+	instanceCapacity_[slot] = capacity;
+	// Meshes without a scene node draw untransformed
+	std::fill_n(instanceMapped_[slot], capacity, glm::mat4{1.0f});
+}
+
+void Renderer::ensure_instance_capacity(uint32_t slot)
+{
+	auto count = static_cast<uint32_t>(meshes_.size());
+	if (count <= instanceCapacity_[slot]) return;
+
+	// Only this slot's frames use its buffer, and its fence has signalled.
+	// The old matrices are carried over: the scene graph only rewrites
+	// the nodes that changed.
+	VkBuffer oldBuffer = instanceBuffers_[slot];
+	VkDeviceMemory oldMemory = instanceMemory_[slot];
+	const glm::mat4* oldMapped = instanceMapped_[slot];
+	uint32_t oldCapacity = instanceCapacity_[slot];
+
+	uint32_t capacity = (count + INSTANCE_CAPACITY_STEP - 1) /
+						INSTANCE_CAPACITY_STEP * INSTANCE_CAPACITY_STEP;
+	create_instance_buffer(slot, capacity);
+	std::memcpy(instanceMapped_[slot], oldMapped,
+				oldCapacity * sizeof(glm::mat4));
+	update_instance_descriptor(slot);
+
+	vkDestroyBuffer(device_, oldBuffer, nullptr);
+	vkFreeMemory(device_, oldMemory, nullptr);
+}
+
+void Renderer::update_instance_descriptor(uint32_t slot)
+{
+	VkDescriptorBufferInfo bufInfo{instanceBuffers_[slot], 0, VK_WHOLE_SIZE};
+
+	VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+	write.dstSet = frameDescriptorSets_[slot];
+	write.dstBinding = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.descriptorCount = 1;
+	write.pBufferInfo = &bufInfo;
+	vkUpdateDescriptorSets(device_, 1, &write, 0, nullptr);
+}
+
 // =============================================================================
 // Scene loading
 // =============================================================================
@@ -1600,6 +2431,9 @@ void Renderer::load_scene(const std::string& modelPath)
 	// Move scene data into renderer members
 	textures_ = std::move(scene.textures);
 	meshes_ = std::move(scene.meshes);
+	skins_ = std::move(scene.skins);
+	animations_ = std::move(scene.animations);
+	rebuild_skinning();
 
 	// Create material descriptors (includes the cube's material)
 	create_material_descriptor_pool(
@@ -1611,6 +2445,7 @@ void Renderer::load_scene(const std::string& modelPath)
 void Renderer::unload_scene()
 {
 	vkDeviceWaitIdle(device_);
+	drop_picks();
 
 	// Free mesh GPU buffers
 	for (auto& m : meshes_)
@@ -1621,6 +2456,12 @@ void Renderer::unload_scene()
 		vkFreeMemory(device_, m.indexMemory, nullptr);
 	}
 	meshes_.clear();
+	transparentOrder_.clear();
+
+	// Free skinning buffers
+	destroy_skinning_buffers();
+	skins_.clear();
+	animations_.clear();
 
 	// Free material factor buffers
 	for (auto& m : materials_)
@@ -1637,6 +2478,9 @@ void Renderer::unload_scene()
 	// Destroy material descriptor pool
 	if (materialDescriptorPool_)
 	{
+		// Callers have idled the device; sets retired by texture streaming
+		// are freed before their pool goes
+		deletionQueue_.flush_all();
 		vkDestroyDescriptorPool(device_, materialDescriptorPool_, nullptr);
 		materialDescriptorPool_ = VK_NULL_HANDLE;
 	}
@@ -1665,161 +2509,354 @@ void Renderer::load_scene_empty()
 // =============================================================================
 
 void Renderer::import_gltf(const std::string& path)
+{
+	Scene scene = load_gltf(path);
+	import_scenes(std::span<Scene>(&scene, 1),
+				  std::span<const std::string>(&path, 1));
+}
+
+void Renderer::import_scenes(std::span<Scene> scenes,
+							 std::span<const std::string> paths,
+							 uint32_t textureSizeLimit)
 {
 	vkDeviceWaitIdle(device_);
+	begin_upload_batch();
 
-	Scene scene = load_gltf(path);
+	bool skinned = false;
+	for (size_t si = 0; si < scenes.size(); ++si)
+	{
+		Scene& scene = scenes[si];
+		uint32_t texOffset = static_cast<uint32_t>(textures_.size());
+		uint32_t matOffset = static_cast<uint32_t>(materials_.size());
+		auto skinOffset = static_cast<int32_t>(skins_.size());
+		auto animationOffset = static_cast<int32_t>(animations_.size());
+
+		// Upload and append textures
+		for (auto& tex : scene.textures)
+			upload_texture(tex, textureSizeLimit > 0
+									? tex.mip_for_size(textureSizeLimit)
+									: 0);
+		textures_.insert(textures_.end(),
+						 std::make_move_iterator(scene.textures.begin()),
+						 std::make_move_iterator(scene.textures.end()));
+
+		// Offset material texture indices, then append
+		for (auto& mat : scene.materials)
+		{
+			if (mat.baseColorTexture >= 0)
+				mat.baseColorTexture += static_cast<int32_t>(texOffset);
+			if (mat.metallicRoughnessTexture >= 0)
+				mat.metallicRoughnessTexture +=
+					static_cast<int32_t>(texOffset);
+			if (mat.normalTexture >= 0)
+				mat.normalTexture += static_cast<int32_t>(texOffset);
+			if (mat.emissiveTexture >= 0)
+				mat.emissiveTexture += static_cast<int32_t>(texOffset);
+		}
 
-	uint32_t texOffset = static_cast<uint32_t>(textures_.size());
-	uint32_t matOffset = static_cast<uint32_t>(materials_.size());
+		// Offset mesh material indices, upload, then append
+		for (size_t i = 0; i < scene.meshes.size(); ++i)
+		{
+			scene.meshes[i].sourcePath = paths[si];
+			scene.meshes[i].sourceMeshIndex = static_cast<uint32_t>(i);
+			scene.meshes[i].materialIndex += matOffset;
+			if (scene.meshes[i].skin >= 0)
+				scene.meshes[i].skin += skinOffset;
+			if (scene.meshes[i].animation >= 0)
+				scene.meshes[i].animation += animationOffset;
+			skinned = skinned || scene.meshes[i].deformed();
+			upload_mesh(scene.meshes[i]);
+		}
+		meshes_.insert(meshes_.end(),
+					   std::make_move_iterator(scene.meshes.begin()),
+					   std::make_move_iterator(scene.meshes.end()));
+
+		// Append materials (without GPU descriptors yet)
+		materials_.insert(materials_.end(),
+						  std::make_move_iterator(scene.materials.begin()),
+						  std::make_move_iterator(scene.materials.end()));
+		skinned = skinned || !scene.skins.empty();
+		for (auto& skin : scene.skins)
+			if (skin.animation >= 0) skin.animation += animationOffset;
+		skins_.insert(skins_.end(),
+					  std::make_move_iterator(scene.skins.begin()),
+					  std::make_move_iterator(scene.skins.end()));
+		animations_.insert(
+			animations_.end(),
+			std::make_move_iterator(scene.animations.begin()),
+			std::make_move_iterator(scene.animations.end()));
+	}
 
-	// Upload and append textures
-	for (auto& tex : scene.textures) upload_texture(tex);
-	textures_.insert(textures_.end(),
-					 std::make_move_iterator(scene.textures.begin()),
-					 std::make_move_iterator(scene.textures.end()));
+	// Repacked only when skinned or morphed meshes arrived
+	if (skinned) rebuild_skinning();
+	end_upload_batch();
+	rebuild_material_descriptors();
+}
 
-	// Offset material texture indices, then append
-	for (auto& mat : scene.materials)
+uint32_t Renderer::upgrade_textures(uint32_t maxCount)
+{
+	std::vector<TextureResidency::Change> upgrades;
+	uint32_t previews = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(textures_.size()); ++i)
 	{
-		if (mat.baseColorTexture >= 0)
-			mat.baseColorTexture += static_cast<int32_t>(texOffset);
-		if (mat.metallicRoughnessTexture >= 0)
-			mat.metallicRoughnessTexture += static_cast<int32_t>(texOffset);
-		if (mat.normalTexture >= 0)
-			mat.normalTexture += static_cast<int32_t>(texOffset);
-		if (mat.emissiveTexture >= 0)
-			mat.emissiveTexture += static_cast<int32_t>(texOffset);
+		if (textures_[i].residentMip == 0) continue;
+		++previews;
+		if (upgrades.size() < maxCount) upgrades.push_back({i, 0});
 	}
+	apply_texture_changes(upgrades);
+	return previews - static_cast<uint32_t>(upgrades.size());
+}
 
-	// Offset mesh material indices, upload, then append
-	for (size_t i = 0; i < scene.meshes.size(); ++i)
+void Renderer::apply_texture_changes(
+	std::span<const TextureResidency::Change> changes)
+{
+	if (changes.empty()) return;
+
+	// Frames in flight keep sampling the old images through the old
+	// material sets, so neither is touched: both retire with the newest
+	// submitted frame, and the frames recorded from now on use new ones
+	begin_upload_batch();
+	for (const auto& change : changes)
 	{
-		scene.meshes[i].sourcePath = path;
-		scene.meshes[i].sourceMeshIndex = static_cast<uint32_t>(i);
-		scene.meshes[i].materialIndex += matOffset;
-		upload_mesh(scene.meshes[i]);
+		retire_texture(textures_[change.texture]);
+		upload_texture(textures_[change.texture], change.baseMip);
 	}
-	meshes_.insert(meshes_.end(), std::make_move_iterator(scene.meshes.begin()),
-				   std::make_move_iterator(scene.meshes.end()));
-
-	// Append materials (without GPU descriptors yet)
-	materials_.insert(materials_.end(),
-					  std::make_move_iterator(scene.materials.begin()),
-					  std::make_move_iterator(scene.materials.end()));
 
-	rebuild_material_descriptors();
+	for (auto& mat : materials_)
+	{
+		auto changed = [&](int32_t texIndex)
+		{
+			return std::any_of(changes.begin(), changes.end(),
+							   [&](const TextureResidency::Change& c)
+							   {
+								   return static_cast<int32_t>(c.texture) ==
+										  texIndex;
+							   });
+		};
+		if (mat.descriptorSet &&
+			(changed(mat.baseColorTexture) ||
+			 changed(mat.metallicRoughnessTexture) ||
+			 changed(mat.normalTexture) || changed(mat.emissiveTexture)))
+		{
+			deletionQueue_.push(
+				submittedFrames_,
+				[device = device_, pool = materialDescriptorPool_,
+				 set = mat.descriptorSet]()
+				{ vkFreeDescriptorSets(device, pool, 1, &set); });
+			mat.descriptorSet = allocate_material_set();
+			write_material_set(mat);
+		}
+	}
+	submit_upload_batch();
 }
 
-void Renderer::delete_mesh(uint32_t meshIdx)
-{
-	if (meshIdx >= meshes_.size()) return;
-
-	vkDeviceWaitIdle(device_);
+// =============================================================================
+// Texture streaming
+// =============================================================================
 
-	// 1. Destroy mesh GPU buffers and erase
-	auto& mesh = meshes_[meshIdx];
-	vkDestroyBuffer(device_, mesh.vertexBuffer, nullptr);
-	vkFreeMemory(device_, mesh.vertexMemory, nullptr);
-	vkDestroyBuffer(device_, mesh.indexBuffer, nullptr);
-	vkFreeMemory(device_, mesh.indexMemory, nullptr);
+// Frustum planes (inside: dot(xyz, p) + w >= 0) of a view-projection
+static std::array<glm::vec4, 6> frustum_planes(const glm::mat4& viewProj)
+{
+	glm::mat4 m = glm::transpose(viewProj);
+	std::array<glm::vec4, 6> planes = {m[3] + m[0], m[3] - m[0], m[3] + m[1],
+									   m[3] - m[1], m[2],		 m[3] - m[2]};
+	for (auto& p : planes) p /= glm::length(glm::vec3(p));
+	return planes;
+}
 
-	uint32_t deletedMatIdx = mesh.materialIndex;
-	meshes_.erase(meshes_.begin() + meshIdx);
+void Renderer::update_texture_streaming(std::span<const glm::mat4> meshWorlds)
+{
+	if (!textureStreaming_)
+	{
+		// Back to full residency, a few textures per frame
+		upgrade_textures(textureResidency_.maxChanges);
+		return;
+	}
+	if (!meshWorlds.empty()) request_texture_mips(meshWorlds);
+	apply_texture_changes(textureResidency_.plan(textures_));
+}
 
-	// 2. Fix up remaining mesh materialIndex for the erased mesh's shift
-	//    (materialIndex doesn't shift yet — we handle that after removing mats)
+void Renderer::request_texture_mips(std::span<const glm::mat4> meshWorlds)
+{
+	textureResidency_.begin_round();
 
-	// 3. Collect unreferenced material indices
-	std::vector<bool> matReferenced(materials_.size(), false);
-	for (const auto& m : meshes_) matReferenced[m.materialIndex] = true;
+	auto planes = frustum_planes(lastProj_ * lastView_);
+	glm::vec3 eye = glm::vec3(glm::inverse(lastView_)[3]);
+	// Screen pixels spanned by a unit length at unit distance
+	float pixelsPerUnit =
+		lastProj_[1][1] * 0.5f * static_cast<float>(renderExtent_.height);
 
-	// Collect unreferenced texture indices from unreferenced materials
-	std::vector<bool> texReferencedByUnrefMat(textures_.size(), false);
-	for (uint32_t i = 0; i < materials_.size(); ++i)
+	size_t count = std::min(meshWorlds.size(), meshes_.size());
+	for (size_t i = 0; i < count; ++i)
 	{
-		if (!matReferenced[i])
+		const glm::mat4& world = meshWorlds[i];
+		const AABB& bounds = meshes_[i].localBounds;
+		// Meshes without an instance, or without vertices
+		if (world[3][3] == 0.0f || bounds.min.x > bounds.max.x) continue;
+
+		// Bounding sphere of the transformed box
+		glm::vec3 center = glm::vec3(
+			world * glm::vec4((bounds.min + bounds.max) * 0.5f, 1.0f));
+		float scale = std::max({glm::length(glm::vec3(world[0])),
+								glm::length(glm::vec3(world[1])),
+								glm::length(glm::vec3(world[2]))});
+		float radius = glm::length(bounds.max - bounds.min) * 0.5f * scale;
+		bool visible = true;
+		for (const auto& p : planes)
+			if (glm::dot(glm::vec3(p), center) + p.w < -radius) visible = false;
+		if (!visible || meshes_[i].materialIndex >= materials_.size())
+			continue;
+
+		// Inside the sphere the surface can fill the screen
+		float distance = glm::length(center - eye);
+		float pixels = distance > radius
+						   ? 2.0f * radius * pixelsPerUnit / distance
+						   : FLT_MAX;
+
+		const Material& mat = materials_[meshes_[i].materialIndex];
+		for (int32_t t : {mat.baseColorTexture, mat.metallicRoughnessTexture,
+						  mat.normalTexture, mat.emissiveTexture})
 		{
-			auto markTex = [&](int32_t idx)
-			{
-				if (idx >= 0 && idx < static_cast<int32_t>(textures_.size()))
-					texReferencedByUnrefMat[idx] = true;
-			};
-			markTex(materials_[i].baseColorTexture);
-			markTex(materials_[i].metallicRoughnessTexture);
-			markTex(materials_[i].normalTexture);
-			markTex(materials_[i].emissiveTexture);
+			if (t < 0 || t >= static_cast<int32_t>(textures_.size())) continue;
+			Texture& tex = textures_[t];
+			textureResidency_.request(
+				tex, TextureResidency::mip_for_coverage(tex, pixels));
 		}
 	}
+}
+
+void Renderer::delete_meshes(const std::vector<uint32_t>& meshRemap)
+{
+	constexpr uint32_t REMOVED = UINT32_MAX;
+	uint32_t count =
+		static_cast<uint32_t>(std::min(meshRemap.size(), meshes_.size()));
+	if (std::none_of(meshRemap.begin(), meshRemap.begin() + count,
+					 [](uint32_t m) { return m == REMOVED; }))
+		return;
 
-	// 4. Destroy unreferenced materials (reverse order to keep indices valid)
-	std::vector<uint32_t> removedMatIndices;
-	for (int32_t i = static_cast<int32_t>(materials_.size()) - 1; i >= 0; --i)
+	vkDeviceWaitIdle(device_);
+	drop_picks();
+	transparentOrder_.clear();	// indices shift; re-sorted next frame
+
+	// 1. Destroy the removed meshes and compact the rest in order, noting
+	//    the skins they used and whether any was skinned or morphed
+	std::vector<bool> skinDropped(skins_.size(), false);
+	bool deformedDeleted = false;
+	uint32_t keptMeshes = 0;
+	for (uint32_t i = 0; i < meshes_.size(); ++i)
 	{
-		if (!matReferenced[i])
+		Mesh& mesh = meshes_[i];
+		if (i < count && meshRemap[i] == REMOVED)
 		{
-			if (materials_[i].factorBuffer)
-				vkDestroyBuffer(device_, materials_[i].factorBuffer, nullptr);
-			if (materials_[i].factorMemory)
-				vkFreeMemory(device_, materials_[i].factorMemory, nullptr);
-			materials_.erase(materials_.begin() + i);
-			removedMatIndices.push_back(static_cast<uint32_t>(i));
+			vkDestroyBuffer(device_, mesh.vertexBuffer, nullptr);
+			vkFreeMemory(device_, mesh.vertexMemory, nullptr);
+			vkDestroyBuffer(device_, mesh.indexBuffer, nullptr);
+			vkFreeMemory(device_, mesh.indexMemory, nullptr);
+			if (mesh.skin >= 0) skinDropped[mesh.skin] = true;
+			deformedDeleted |= mesh.deformed();
+			continue;
 		}
+		if (keptMeshes != i) meshes_[keptMeshes] = std::move(mesh);
+		++keptMeshes;
 	}
+	meshes_.resize(keptMeshes);
 
-	// 5. Check which textures referenced by removed materials are truly
-	//    unreferenced (not used by any remaining material)
-	std::vector<bool> texReferenced(texReferencedByUnrefMat.size(), false);
-	for (const auto& mat : materials_)
+	// 2. Drop the materials no mesh uses any more, noting their textures
+	std::vector<uint32_t> matRemap(materials_.size(), REMOVED);
+	for (const auto& m : meshes_) matRemap[m.materialIndex] = 0;
+	std::vector<bool> texDropped(textures_.size(), false);
+	auto mark = [](std::vector<bool>& marks, int32_t tex)
+	{
+		if (tex >= 0 && tex < static_cast<int32_t>(marks.size()))
+			marks[tex] = true;
+	};
+	uint32_t keptMats = 0;
+	for (uint32_t i = 0; i < materials_.size(); ++i)
 	{
-		auto markTex = [&](int32_t idx)
+		Material& mat = materials_[i];
+		if (matRemap[i] == REMOVED)
 		{
-			if (idx >= 0 && idx < static_cast<int32_t>(texReferenced.size()))
-				texReferenced[idx] = true;
-		};
-		markTex(mat.baseColorTexture);
-		markTex(mat.metallicRoughnessTexture);
-		markTex(mat.normalTexture);
-		markTex(mat.emissiveTexture);
+			if (mat.factorBuffer)
+				vkDestroyBuffer(device_, mat.factorBuffer, nullptr);
+			if (mat.factorMemory)
+				vkFreeMemory(device_, mat.factorMemory, nullptr);
+			for (int32_t t :
+				 {mat.baseColorTexture, mat.metallicRoughnessTexture,
+				  mat.normalTexture, mat.emissiveTexture})
+				mark(texDropped, t);
+			continue;
+		}
+		if (keptMats != i) materials_[keptMats] = std::move(mat);
+		matRemap[i] = keptMats++;
 	}
+	materials_.resize(keptMats);
+	for (auto& m : meshes_) m.materialIndex = matRemap[m.materialIndex];
 
-	// Destroy unreferenced textures (reverse order)
-	std::vector<uint32_t> removedTexIndices;
-	for (int32_t i = static_cast<int32_t>(texReferencedByUnrefMat.size()) - 1;
-		 i >= 0; --i)
+	// 3. Of those textures, destroy the ones no remaining material shares
+	std::vector<bool> texUsed(textures_.size(), false);
+	for (const auto& mat : materials_)
+		for (int32_t t : {mat.baseColorTexture, mat.metallicRoughnessTexture,
+						  mat.normalTexture, mat.emissiveTexture})
+			mark(texUsed, t);
+	std::vector<int32_t> texRemap(textures_.size(), -1);
+	int32_t keptTex = 0;
+	for (size_t i = 0; i < textures_.size(); ++i)
 	{
-		if (texReferencedByUnrefMat[i] && !texReferenced[i])
+		if (texDropped[i] && !texUsed[i])
 		{
 			destroy_texture(textures_[i]);
-			textures_.erase(textures_.begin() + i);
-			removedTexIndices.push_back(static_cast<uint32_t>(i));
+			continue;
 		}
+		if (keptTex != static_cast<int32_t>(i))
+			textures_[keptTex] = std::move(textures_[i]);
+		texRemap[i] = keptTex++;
 	}
-
-	// 6. Fix up material indices in remaining meshes
-	for (auto& m : meshes_)
+	textures_.resize(keptTex);
+	for (auto& mat : materials_)
+		for (int32_t* t : {&mat.baseColorTexture, &mat.metallicRoughnessTexture,
+						   &mat.normalTexture, &mat.emissiveTexture})
+			if (*t >= 0 && *t < static_cast<int32_t>(texRemap.size()))
+				*t = texRemap[*t];
+
+	// 4. Drop the skins of removed meshes that no other mesh uses, and
+	//    repack the skinned and morphed meshes left
+	for (const auto& m : meshes_)
+		if (m.skin >= 0) skinDropped[m.skin] = false;
+	std::vector<int32_t> skinRemap(skins_.size(), -1);
+	int32_t keptSkins = 0;
+	for (size_t i = 0; i < skins_.size(); ++i)
 	{
-		uint32_t shift = 0;
-		for (uint32_t removed : removedMatIndices)
-			if (removed <= m.materialIndex) ++shift;
-		m.materialIndex -= shift;
+		if (skinDropped[i]) continue;
+		if (keptSkins != static_cast<int32_t>(i))
+			skins_[keptSkins] = std::move(skins_[i]);
+		skinRemap[i] = keptSkins++;
 	}
+	skins_.resize(keptSkins);
+	for (auto& m : meshes_)
+		if (m.skin >= 0) m.skin = skinRemap[m.skin];
+	if (deformedDeleted) rebuild_skinning();
 
-	// 7. Fix up texture indices in remaining materials
-	for (auto& mat : materials_)
+	// 5. Drop animation sets no mesh or skin follows any more
+	if (!animations_.empty())
 	{
-		auto fixTex = [&](int32_t& idx)
+		std::vector<int32_t> remap(animations_.size(), -1);
+		for (const auto& m : meshes_)
+			if (m.animation >= 0) remap[m.animation] = 0;
+		for (const auto& skin : skins_)
+			if (skin.animation >= 0) remap[skin.animation] = 0;
+		int32_t kept = 0;
+		for (size_t i = 0; i < animations_.size(); ++i)
 		{
-			if (idx < 0) return;
-			uint32_t shift = 0;
-			for (uint32_t removed : removedTexIndices)
-				if (removed <= static_cast<uint32_t>(idx)) ++shift;
-			idx -= static_cast<int32_t>(shift);
-		};
-		fixTex(mat.baseColorTexture);
-		fixTex(mat.metallicRoughnessTexture);
-		fixTex(mat.normalTexture);
-		fixTex(mat.emissiveTexture);
+			if (remap[i] < 0) continue;
+			if (kept != static_cast<int32_t>(i))
+				animations_[kept] = std::move(animations_[i]);
+			remap[i] = kept++;
+		}
+		animations_.resize(kept);
+		for (auto& m : meshes_)
+			if (m.animation >= 0) m.animation = remap[m.animation];
+		for (auto& skin : skins_)
+			if (skin.animation >= 0) skin.animation = remap[skin.animation];
 	}
 
 	rebuild_material_descriptors();
@@ -1845,6 +2882,9 @@ void Renderer::rebuild_material_descriptors()
 
 	if (materialDescriptorPool_)
 	{
+		// Callers have idled the device; sets retired by texture streaming
+		// are freed before their pool goes
+		deletionQueue_.flush_all();
 		vkDestroyDescriptorPool(device_, materialDescriptorPool_, nullptr);
 		materialDescriptorPool_ = VK_NULL_HANDLE;
 	}
@@ -1861,11 +2901,11 @@ void Renderer::rebuild_material_descriptors()
 
 void Renderer::create_depth_resources()
 {
-	VkFormat depthFmt = find_depth_format();
+	depthFormat_ = find_depth_format();
 
 	VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
 	imgCI.imageType = VK_IMAGE_TYPE_2D;
-	imgCI.format = depthFmt;
+	imgCI.format = depthFormat_;
 	imgCI.extent = {swapchainExtent_.width, swapchainExtent_.height, 1};
 	imgCI.mipLevels = 1;
 	imgCI.arrayLayers = 1;
@@ -1885,7 +2925,7 @@ void Renderer::create_depth_resources()
 	vkBindImageMemory(device_, depthImage_, depthMemory_, 0);
 
 	depthView_ =
-		create_image_view(depthImage_, depthFmt, VK_IMAGE_ASPECT_DEPTH_BIT);
+		create_image_view(depthImage_, depthFormat_, VK_IMAGE_ASPECT_DEPTH_BIT);
 
 	// Depth sampler (nearest, clamp-to-edge) for compute light culling
 	if (depthSampler_ == VK_NULL_HANDLE)
@@ -1901,27 +2941,6 @@ void Renderer::create_depth_resources()
 	}
 }
 
-// =============================================================================
-// Framebuffers
-// =============================================================================
-
-void Renderer::create_framebuffers()
-{
-	framebuffers_.resize(swapchainImageViews_.size());
-	for (size_t i = 0; i < swapchainImageViews_.size(); ++i)
-	{
-		std::array<VkImageView, 2> att = {swapchainImageViews_[i], depthView_};
-		VkFramebufferCreateInfo ci{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-		ci.renderPass = renderPass_;
-		ci.attachmentCount = static_cast<uint32_t>(att.size());
-		ci.pAttachments = att.data();
-		ci.width = swapchainExtent_.width;
-		ci.height = swapchainExtent_.height;
-		ci.layers = 1;
-		VK_CHECK(vkCreateFramebuffer(device_, &ci, nullptr, &framebuffers_[i]));
-	}
-}
-
 // =============================================================================
 // Command pool & buffers
 // =============================================================================
@@ -1932,6 +2951,13 @@ void Renderer::create_command_pool()
 	ci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 	ci.queueFamilyIndex = graphicsFamily_;
 	VK_CHECK(vkCreateCommandPool(device_, &ci, nullptr, &commandPool_));
+
+	if (asyncComputeSupported_)
+	{
+		ci.queueFamilyIndex = computeFamily_;
+		VK_CHECK(
+			vkCreateCommandPool(device_, &ci, nullptr, &computeCommandPool_));
+	}
 }
 
 void Renderer::create_command_buffers()
@@ -1943,6 +2969,21 @@ void Renderer::create_command_buffers()
 	ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 	ai.commandBufferCount = static_cast<uint32_t>(commandBuffers_.size());
 	VK_CHECK(vkAllocateCommandBuffers(device_, &ai, commandBuffers_.data()));
+
+	// Without a compute family the graph never splits, so there is only
+	// ever one segment per frame
+	if (asyncComputeSupported_)
+	{
+		ai.commandBufferCount = MAX_FRAMES_IN_FLIGHT * MAX_GRAPH_SEGMENTS;
+		graphicsSegmentBuffers_.resize(ai.commandBufferCount);
+		VK_CHECK(vkAllocateCommandBuffers(device_, &ai,
+										  graphicsSegmentBuffers_.data()));
+
+		computeSegmentBuffers_.resize(ai.commandBufferCount);
+		ai.commandPool = computeCommandPool_;
+		VK_CHECK(vkAllocateCommandBuffers(device_, &ai,
+										  computeSegmentBuffers_.data()));
+	}
 }
 
 // =============================================================================
@@ -1968,6 +3009,17 @@ void Renderer::create_sync_objects()
 	for (size_t i = 0; i < swapchainImages_.size(); ++i)
 		VK_CHECK(vkCreateSemaphore(device_, &sci, nullptr,
 								   &renderFinishedSemaphores_[i]));
+
+	if (asyncComputeSupported_)
+	{
+		VkSemaphoreTypeCreateInfo typeCI{
+			VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+		typeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeCI.initialValue = 0;
+		sci.pNext = &typeCI;
+		VK_CHECK(
+			vkCreateSemaphore(device_, &sci, nullptr, &segmentTimeline_));
+	}
 }
 
 // =============================================================================
@@ -1988,12 +3040,19 @@ uint32_t Renderer::find_memory_type(uint32_t filter,
 
 void Renderer::create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
 							 VkMemoryPropertyFlags props, VkBuffer& buffer,
-							 VkDeviceMemory& memory)
+							 VkDeviceMemory& memory, bool computeShared)
 {
 	VkBufferCreateInfo ci{VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
 	ci.size = size;
 	ci.usage = usage;
 	ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	uint32_t families[] = {graphicsFamily_, computeFamily_};
+	if (computeShared && asyncComputeSupported_)
+	{
+		ci.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		ci.queueFamilyIndexCount = 2;
+		ci.pQueueFamilyIndices = families;
+	}
 	VK_CHECK(vkCreateBuffer(device_, &ci, nullptr, &buffer));
 
 	VkMemoryRequirements req;
@@ -2015,6 +3074,8 @@ void Renderer::copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size)
 
 VkCommandBuffer Renderer::begin_single_time_commands()
 {
+	if (uploadBatchCmd_) return uploadBatchCmd_;
+
 	VkCommandBufferAllocateInfo ai{
 		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
 	ai.commandPool = commandPool_;
@@ -2030,6 +3091,20 @@ VkCommandBuffer Renderer::begin_single_time_commands()
 
 void Renderer::end_single_time_commands(VkCommandBuffer cmd)
 {
+	if (cmd == uploadBatchCmd_)
+	{
+		// Stands in for the queue wait: later commands see all earlier
+		// writes, as if they had been submitted separately
+		VkMemoryBarrier barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+		barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+		barrier.dstAccessMask =
+			VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+							 VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1,
+							 &barrier, 0, nullptr, 0, nullptr);
+		return;
+	}
+
 	vkEndCommandBuffer(cmd);
 	VkSubmitInfo si{VK_STRUCTURE_TYPE_SUBMIT_INFO};
 	si.commandBufferCount = 1;
@@ -2039,6 +3114,67 @@ void Renderer::end_single_time_commands(VkCommandBuffer cmd)
 	vkFreeCommandBuffers(device_, commandPool_, 1, &cmd);
 }
 
+void Renderer::begin_upload_batch()
+{
+	uploadBatchCmd_ = begin_single_time_commands();
+}
+
+void Renderer::end_upload_batch()
+{
+	VkCommandBuffer cmd = uploadBatchCmd_;
+	uploadBatchCmd_ = VK_NULL_HANDLE;
+	end_single_time_commands(cmd);
+
+	for (auto [buffer, memory] : uploadBatchStaging_)
+	{
+		vkDestroyBuffer(device_, buffer, nullptr);
+		vkFreeMemory(device_, memory, nullptr);
+	}
+	uploadBatchStaging_.clear();
+}
+
+void Renderer::submit_upload_batch()
+{
+	// Closing barrier: its second scope covers every later submission to
+	// the queue, so the next frame reads the uploads without a wait
+	VkCommandBuffer cmd = uploadBatchCmd_;
+	end_single_time_commands(cmd);
+	uploadBatchCmd_ = VK_NULL_HANDLE;
+
+	vkEndCommandBuffer(cmd);
+	VkSubmitInfo si{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+	si.commandBufferCount = 1;
+	si.pCommandBuffers = &cmd;
+	VK_CHECK(vkQueueSubmit(graphicsQueue_, 1, &si, VK_NULL_HANDLE));
+
+	// Queued behind the frames already submitted, and finished before the
+	// next one is through the barrier
+	deletionQueue_.push(
+		submittedFrames_ + 1,
+		[device = device_, pool = commandPool_, cmd,
+		 staging = std::move(uploadBatchStaging_)]()
+		{
+			vkFreeCommandBuffers(device, pool, 1, &cmd);
+			for (auto [buffer, memory] : staging)
+			{
+				vkDestroyBuffer(device, buffer, nullptr);
+				vkFreeMemory(device, memory, nullptr);
+			}
+		});
+	uploadBatchStaging_.clear();
+}
+
+void Renderer::destroy_staging(VkBuffer buffer, VkDeviceMemory memory)
+{
+	if (uploadBatchCmd_)
+	{
+		uploadBatchStaging_.emplace_back(buffer, memory);
+		return;
+	}
+	vkDestroyBuffer(device_, buffer, nullptr);
+	vkFreeMemory(device_, memory, nullptr);
+}
+
 VkImageView Renderer::create_image_view(VkImage image, VkFormat format,
 										VkImageAspectFlags aspect,
 										uint32_t mipLevels)
@@ -2096,63 +3232,9 @@ VkShaderModule Renderer::create_shader_module(const std::vector<char>& code)
 }
 
 // =============================================================================
-// Forward+ : Depth-only render pass
+// Forward+ : Depth pre-pass
 // =============================================================================
 
-void Renderer::create_depth_only_render_pass()
-{
-	VkAttachmentDescription depthAtt{};
-	depthAtt.format = find_depth_format();
-	depthAtt.samples = VK_SAMPLE_COUNT_1_BIT;
-	depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	depthAtt.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	depthAtt.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	depthAtt.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	depthAtt.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-	VkAttachmentReference depthRef{
-		0, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 0;
-	subpass.pDepthStencilAttachment = &depthRef;
-
-	VkSubpassDependency dep{};
-	dep.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dep.dstSubpass = 0;
-	dep.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
-					   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	dep.srcAccessMask = 0;
-	dep.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
-					   VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
-	dep.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-	VkRenderPassCreateInfo ci{VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO};
-	ci.attachmentCount = 1;
-	ci.pAttachments = &depthAtt;
-	ci.subpassCount = 1;
-	ci.pSubpasses = &subpass;
-	ci.dependencyCount = 1;
-	ci.pDependencies = &dep;
-
-	VK_CHECK(vkCreateRenderPass(device_, &ci, nullptr, &depthOnlyRenderPass_));
-}
-
-void Renderer::create_depth_only_framebuffer()
-{
-	VkFramebufferCreateInfo ci{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-	ci.renderPass = depthOnlyRenderPass_;
-	ci.attachmentCount = 1;
-	ci.pAttachments = &depthView_;
-	ci.width = swapchainExtent_.width;
-	ci.height = swapchainExtent_.height;
-	ci.layers = 1;
-	VK_CHECK(
-		vkCreateFramebuffer(device_, &ci, nullptr, &depthOnlyFramebuffer_));
-}
-
 void Renderer::create_depth_prepass_pipeline()
 {
 	auto vertCode = packFile_->read("shaders/pbr.vert.spv");
@@ -2213,18 +3295,14 @@ void Renderer::create_depth_prepass_pipeline()
 	dyn.dynamicStateCount = 4;
 	dyn.pDynamicStates = dynStates;
 
-	// Layout: set 0 = frame UBO, push constant = model matrix
-	VkPushConstantRange pushRange{};
-	pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	pushRange.offset = 0;
-	pushRange.size = sizeof(glm::mat4);
-
+	// Layout: set 0 = frame UBO + instance matrices, set 1 = material
+	// (read by the mask variants only)
+	VkDescriptorSetLayout setLayouts[] = {frameSetLayout_,
+										  materialSetLayout_};
 	VkPipelineLayoutCreateInfo layoutCI{
 		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
-	layoutCI.setLayoutCount = 1;
-	layoutCI.pSetLayouts = &frameSetLayout_;
-	layoutCI.pushConstantRangeCount = 1;
-	layoutCI.pPushConstantRanges = &pushRange;
+	layoutCI.setLayoutCount = 2;
+	layoutCI.pSetLayouts = setLayouts;
 	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
 									&depthPrepassPipelineLayout_));
 
@@ -2240,44 +3318,88 @@ void Renderer::create_depth_prepass_pipeline()
 	ci.pDepthStencilState = &ds;
 	ci.pColorBlendState = &blend;
 	ci.pDynamicState = &dyn;
+	VkPipelineRenderingCreateInfo rendering{
+		VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+	rendering.depthAttachmentFormat = depthFormat_;
+	ci.pNext = &rendering;
 	ci.layout = depthPrepassPipelineLayout_;
-	ci.renderPass = depthOnlyRenderPass_;
-	ci.subpass = 0;
 
 	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
 									   &depthPrepassPipeline_));
 
+	// Object ID variant for GPU picking: same vertex stage and depth state,
+	// so it produces the same depth, plus the ID attachment
+	auto fragCode = packFile_->read("shaders/object_id.frag.spv");
+	VkShaderModule fragMod = create_shader_module(fragCode);
+
+	VkPipelineShaderStageCreateInfo stages[2] = {stage, stage};
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].module = fragMod;
+
+	VkPipelineColorBlendAttachmentState idBlend{};
+	idBlend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+	blend.attachmentCount = 1;
+	blend.pAttachments = &idBlend;
+
+	VkFormat idFormat = OBJECT_ID_FORMAT;
+	rendering.colorAttachmentCount = 1;
+	rendering.pColorAttachmentFormats = &idFormat;
+
+	ci.stageCount = 2;
+	ci.pStages = stages;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &objectIdPipeline_));
+
+	// Mask variants of both, with the alpha test in the fragment shader
+	auto maskCode = packFile_->read("shaders/alpha_mask.frag.spv");
+	VkShaderModule maskMod = create_shader_module(maskCode);
+	stages[1].module = maskMod;
+
+	VkBool32 writeId = VK_TRUE;
+	VkSpecializationMapEntry specEntry{0, 0, sizeof(VkBool32)};
+	VkSpecializationInfo spec{1, &specEntry, sizeof(VkBool32), &writeId};
+	stages[1].pSpecializationInfo = &spec;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &objectIdMaskPipeline_));
+
+	writeId = VK_FALSE;
+	blend.attachmentCount = 0;
+	rendering.colorAttachmentCount = 0;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &depthMaskPipeline_));
+
+	vkDestroyShaderModule(device_, maskMod, nullptr);
+	vkDestroyShaderModule(device_, fragMod, nullptr);
 	vkDestroyShaderModule(device_, vertMod, nullptr);
 }
 
-void Renderer::draw_depth_prepass(VkCommandBuffer cmd)
+void Renderer::bind_mesh_buffers(VkCommandBuffer cmd, const Mesh& mesh)
 {
-	VkClearValue clear{};
-	clear.depthStencil = {1.0f, 0};
-
-	VkRenderPassBeginInfo rpInfo{VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
-	rpInfo.renderPass = depthOnlyRenderPass_;
-	rpInfo.framebuffer = depthOnlyFramebuffer_;
-	rpInfo.renderArea = {{0, 0}, swapchainExtent_};
-	rpInfo.clearValueCount = 1;
-	rpInfo.pClearValues = &clear;
-
-	vkCmdBeginRenderPass(cmd, &rpInfo, VK_SUBPASS_CONTENTS_INLINE);
+	VkBuffer vbufs[] = {mesh.vertexBuffer};
+	VkDeviceSize offs[] = {0};
+	if (mesh.deformed())
+	{
+		vbufs[0] = skinnedVertexBuffers_[currentFrame_];
+		offs[0] = static_cast<VkDeviceSize>(mesh.skinnedFirstVertex) *
+				  sizeof(Vertex);
+	}
+	vkCmdBindVertexBuffers(cmd, 0, 1, vbufs, offs);
+	vkCmdBindIndexBuffer(cmd, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+}
 
+void Renderer::draw_depth_prepass(VkCommandBuffer cmd, bool objectIds)
+{
 	VkViewport vp{0,
 				  0,
-				  static_cast<float>(swapchainExtent_.width),
-				  static_cast<float>(swapchainExtent_.height),
+				  static_cast<float>(renderExtent_.width),
+				  static_cast<float>(renderExtent_.height),
 				  0.0f,
 				  1.0f};
 	vkCmdSetViewport(cmd, 0, 1, &vp);
 
-	VkRect2D scissor{{0, 0}, swapchainExtent_};
+	VkRect2D scissor{{0, 0}, renderExtent_};
 	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
-					  depthPrepassPipeline_);
-
 	// Dynamic rasterizer state (debug toggles)
 	vkCmdSetCullMode(
 		cmd, debugDisableCulling_ ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
@@ -2289,21 +3411,669 @@ void Renderer::draw_depth_prepass(VkCommandBuffer cmd)
 							depthPrepassPipelineLayout_, 0, 1,
 							&frameDescriptorSets_[currentFrame_], 0, nullptr);
 
-	for (const auto& mesh : meshes_)
+	// Opaque meshes, then alpha-tested ones with their material bound.
+	// Blended meshes write no depth.
+	for (AlphaMode mode : {AlphaMode::Opaque, AlphaMode::Mask})
 	{
-		vkCmdPushConstants(cmd, depthPrepassPipelineLayout_,
-						   VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4),
-						   &mesh.transform);
+		bool mask = mode == AlphaMode::Mask;
+		bool bound = false;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(meshes_.size()); ++i)
+		{
+			const Mesh& mesh = meshes_[i];
+			if (alpha_mode(mesh) != mode) continue;
+			if (!bound)
+			{
+				VkPipeline pipeline =
+					mask ? (objectIds ? objectIdMaskPipeline_
+									  : depthMaskPipeline_)
+						 : (objectIds ? objectIdPipeline_
+									  : depthPrepassPipeline_);
+				vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+								  pipeline);
+				bound = true;
+			}
+			if (mask)
+				vkCmdBindDescriptorSets(
+					cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					depthPrepassPipelineLayout_, 1, 1,
+					&materials_[mesh.materialIndex].descriptorSet, 0, nullptr);
+			bind_mesh_buffers(cmd, mesh);
+			vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices.size()),
+							 1, 0, 0, i);
+		}
+	}
+}
 
-		VkBuffer vbufs[] = {mesh.vertexBuffer};
-		VkDeviceSize offs[] = {0};
-		vkCmdBindVertexBuffers(cmd, 0, 1, vbufs, offs);
-		vkCmdBindIndexBuffer(cmd, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices.size()), 1, 0,
-						 0, 0);
+AlphaMode Renderer::alpha_mode(const Mesh& mesh) const
+{
+	if (mesh.materialIndex >= materials_.size()) return AlphaMode::Opaque;
+	return materials_[mesh.materialIndex].alphaMode;
+}
+
+void Renderer::dispatch_light_cull(VkCommandBuffer cmd, bool async)
+{
+	gpuProfiler_.begin_scope(cmd, "Light cull", async);
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, lightCullPipeline_);
+	VkDescriptorSet compSets[] = {frameDescriptorSets_[currentFrame_],
+								  lightDescriptorSets_[currentFrame_]};
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+							computePipelineLayout_, 0, 2, compSets, 0, nullptr);
+	vkCmdDispatch(cmd, tileCountX_, tileCountY_, 1);
+	gpuProfiler_.end_scope(cmd);
+}
+
+// =============================================================================
+// Frame graph
+// =============================================================================
+
+// [Skinning ->] depth prepass -> light cull -> main pass. The main pass is
+// left open so the caller can add draws (scene, debug lines, ImGui) until
+// end_frame.
+// With dynamic resolution the main pass renders into a scene color image at
+// the render extent, and temporal resolve -> output passes follow; the
+// output pass is then the one left open, for ImGui.
+void Renderer::build_frame_graph(RenderGraph& graph, uint32_t imageIndex)
+{
+	using Usage = RenderGraph::Usage;
+	using Queue = RenderGraph::Queue;
+
+	graph.reset();
+	bool taa = frameTaa_;
+
+	// The prepass clears depth, so last frame's contents are not needed
+	RenderGraph::ImportState depthState;
+	depthState.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+						VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+	depthState.writeAccess = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	auto depth = graph.import_image("Depth", depthImage_,
+									VK_IMAGE_ASPECT_DEPTH_BIT, depthState);
+
+	// Read by the previous main pass in this slot
+	RenderGraph::ImportState tileState;
+	tileState.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+	auto tiles = graph.import_buffer(
+		"Tile lights", tileLightSSBOs_[currentFrame_], tileState);
+
+	RenderGraph::ImportState targetState;
+	targetState.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	auto target =
+		graph.import_image("Target", swapchainImages_[imageIndex],
+						   VK_IMAGE_ASPECT_COLOR_BIT, targetState);
+
+	// Same format as the target, so the scene pipelines work with either
+	auto sceneColor = target;
+	if (taa)
+	{
+		RenderGraph::ImageDesc desc;
+		desc.format = swapchainFormat_;
+		desc.extent = swapchainExtent_;
+		desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+					 VK_IMAGE_USAGE_SAMPLED_BIT;
+		sceneColor = graph.create_image("Scene color", desc);
+	}
+
+	// Mesh index + 1 per pixel, declared on every frame while GPU picking
+	// is enabled so the transient allocation stays the same
+	bool objectIds = frameObjectIds_;
+	RenderGraph::Resource ids = 0;
+	if (objectIds)
+	{
+		RenderGraph::ImageDesc desc;
+		desc.format = OBJECT_ID_FORMAT;
+		desc.extent = swapchainExtent_;
+		desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+					 VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		ids = graph.create_image("Object IDs", desc);
+	}
+
+	// ---- Morph + skinning ----
+	// Blends the active morph targets, then poses every skinned and
+	// morphed mesh into this slot's skinned vertex buffer, which the
+	// prepass and the main pass then draw from
+	bool skinning = skinnedVertexCount_ > 0;
+	RenderGraph::Resource skinned = 0;
+	if (skinning)
+	{
+		// Read by the previous prepass and main pass in this slot
+		RenderGraph::ImportState skinnedState;
+		skinnedState.stages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+		skinned = graph.import_buffer(
+			"Skinned vertices", skinnedVertexBuffers_[currentFrame_],
+			skinnedState);
+
+		RenderGraph::Resource accum = 0;
+		bool morphing = activeMorphCount_ > 0;
+		if (morphing)
+		{
+			// Cleared by the last skinning pass in this slot
+			RenderGraph::ImportState accumState;
+			accumState.stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+			accumState.writeAccess = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+			accum = graph.import_buffer("Morph accumulator",
+										morphAccumBuffers_[currentFrame_],
+										accumState);
+			uint32_t morph = graph.add_pass("Morph", Queue::Graphics,
+											[this](VkCommandBuffer cmd)
+											{ dispatch_morph(cmd); });
+			graph.use(morph, accum, Usage::ComputeStorageReadWrite);
+		}
+
+		uint32_t skin = graph.add_pass("Skinning", Queue::Graphics,
+									   [this](VkCommandBuffer cmd)
+									   { dispatch_skinning(cmd); });
+		graph.use(skin, skinned, Usage::ComputeStorageWrite);
+		if (morphing) graph.use(skin, accum, Usage::ComputeStorageReadWrite);
+	}
+
+	// ---- Depth pre-pass ----
+	bool oit = frameTransparency_ != TransparencyMode::Sorted;
+	uint32_t prepass = graph.add_pass(
+		"Depth prepass", Queue::Graphics,
+		[this, &graph, ids, objectIds, oit](VkCommandBuffer cmd)
+		{
+			VkRenderingAttachmentInfo idAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			if (objectIds)
+			{
+				idAtt.imageView = graph.image_view(ids);
+				idAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+				idAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				idAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				idAtt.clearValue.color.uint32[0] = 0;
+			}
+
+			VkRenderingAttachmentInfo depthAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			depthAtt.imageView = depthView_;
+			depthAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+			depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			depthAtt.clearValue.depthStencil = {1.0f, 0};
+
+			VkRenderingInfo info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+			info.renderArea = {{0, 0}, renderExtent_};
+			info.layerCount = 1;
+			info.pDepthAttachment = &depthAtt;
+			if (objectIds)
+			{
+				info.colorAttachmentCount = 1;
+				info.pColorAttachments = &idAtt;
+			}
+
+			// When skipped, depth is still cleared to the far plane since
+			// light culling reads it. Object IDs are drawn regardless, and
+			// so is depth when the OIT targets are tested against it.
+			gpuProfiler_.begin_scope(cmd, "Depth prepass");
+			vkCmdBeginRendering(cmd, &info);
+			if (!frameSkipPrepass_ || objectIds || oit)
+				draw_depth_prepass(cmd, objectIds);
+			vkCmdEndRendering(cmd);
+			gpuProfiler_.end_scope(cmd);
+		});
+	graph.use(prepass, depth, Usage::DepthWrite);
+	if (skinning) graph.use(prepass, skinned, Usage::VertexRead);
+
+	// ---- Pick read-back ----
+	// Copies one ID into this slot's pick buffer on frames with a request;
+	// begin_frame reads it once the slot's fence has signalled
+	if (objectIds)
+	{
+		graph.use(prepass, ids, Usage::ColorWrite);
+
+		RenderGraph::ImportState pickState;
+		pickState.stages = VK_PIPELINE_STAGE_2_HOST_BIT;
+		auto pickBuffer = graph.import_buffer(
+			"Pick", pickBuffers_[currentFrame_], pickState);
+
+		std::optional<VkOffset2D> pick = framePick_;
+		uint32_t readback = graph.add_pass(
+			"Pick read-back", Queue::Graphics,
+			[this, &graph, ids, pick](VkCommandBuffer cmd)
+			{
+				if (!pick.has_value()) return;
+
+				VkBufferImageCopy region{};
+				region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0,
+										   1};
+				region.imageOffset = {pick->x, pick->y, 0};
+				region.imageExtent = {1, 1, 1};
+				vkCmdCopyImageToBuffer(cmd, graph.image(ids),
+									   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+									   pickBuffers_[currentFrame_], 1,
+									   &region);
+
+				VkMemoryBarrier2 hostBarrier{
+					VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+				hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+				hostBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+				hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+				hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+				VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+				dep.memoryBarrierCount = 1;
+				dep.pMemoryBarriers = &hostBarrier;
+				vkCmdPipelineBarrier2(cmd, &dep);
+			});
+		graph.use(readback, ids, Usage::TransferSrc);
+		graph.use(readback, pickBuffer, Usage::TransferDst);
+		graph.keep(readback);
+	}
+
+	// ---- Light culling ----
+	bool async = frameAsync_;
+	uint32_t cull = graph.add_pass(
+		"Light cull", async ? Queue::AsyncCompute : Queue::Graphics,
+		[this, async](VkCommandBuffer cmd)
+		{ dispatch_light_cull(cmd, async); });
+	graph.use(cull, depth, Usage::ComputeSample);
+	graph.use(cull, tiles, Usage::ComputeStorageWrite);
+
+	// ---- Order-independent transparency ----
+	// Every blended mesh, lit like in the main pass, into the OIT targets
+	// at the render extent, tested against the prepass depth. The main
+	// pass composites them in draw_scene.
+	bool list = frameTransparency_ == TransparencyMode::LinkedListOit;
+	std::array<RenderGraph::Resource, 2> oitTargets{};
+	if (oit)
+	{
+		if (list)
+		{
+			RenderGraph::ImageDesc headDesc;
+			headDesc.format = OIT_HEADS_FORMAT;
+			headDesc.extent = swapchainExtent_;
+			headDesc.usage = VK_IMAGE_USAGE_STORAGE_BIT |
+							 VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			RenderGraph::BufferDesc nodeDesc;
+			nodeDesc.size =
+				OIT_LIST_HEADER_SIZE +
+				OIT_LIST_NODE_SIZE * OIT_LIST_NODES_PER_PIXEL *
+					swapchainExtent_.width * swapchainExtent_.height;
+			nodeDesc.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+							 VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			oitTargets = {graph.create_image("OIT heads", headDesc),
+						  graph.create_buffer("OIT nodes", nodeDesc)};
+
+			// Empty lists, and no nodes handed out yet
+			uint32_t clear = graph.add_pass(
+				"OIT clear", Queue::Graphics,
+				[&graph, oitTargets](VkCommandBuffer cmd)
+				{
+					VkClearColorValue empty{};
+					empty.uint32[0] = UINT32_MAX;
+					VkImageSubresourceRange range{VK_IMAGE_ASPECT_COLOR_BIT,
+												  0, 1, 0, 1};
+					vkCmdClearColorImage(cmd, graph.image(oitTargets[0]),
+										 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										 &empty, 1, &range);
+					vkCmdFillBuffer(cmd, graph.buffer(oitTargets[1]), 0,
+									OIT_LIST_HEADER_SIZE, 0);
+				});
+			graph.use(clear, oitTargets[0], Usage::TransferDst);
+			graph.use(clear, oitTargets[1], Usage::TransferDst);
+		}
+		else
+		{
+			RenderGraph::ImageDesc accumDesc;
+			accumDesc.format = OIT_ACCUM_FORMAT;
+			accumDesc.extent = swapchainExtent_;
+			accumDesc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+							  VK_IMAGE_USAGE_SAMPLED_BIT;
+			RenderGraph::ImageDesc revealageDesc = accumDesc;
+			revealageDesc.format = OIT_REVEALAGE_FORMAT;
+			oitTargets = {graph.create_image("OIT accumulation", accumDesc),
+						  graph.create_image("OIT revealage", revealageDesc)};
+		}
+
+		uint32_t accumulate = graph.add_pass(
+			"OIT accumulate", Queue::Graphics,
+			[this, &graph, oitTargets, list](VkCommandBuffer cmd)
+			{
+				// Weighted: nothing summed yet, everything behind fully
+				// revealed. The lists have no color attachments.
+				std::array<VkRenderingAttachmentInfo, 2> colorAtts{};
+				for (uint32_t i = 0; i < colorAtts.size() && !list; ++i)
+				{
+					colorAtts[i].sType =
+						VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+					colorAtts[i].imageView = graph.image_view(oitTargets[i]);
+					colorAtts[i].imageLayout =
+						VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+					colorAtts[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+					colorAtts[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+				}
+				colorAtts[1].clearValue.color.float32[0] = 1.0f;
+
+				VkRenderingAttachmentInfo depthAtt{
+					VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+				depthAtt.imageView = depthView_;
+				depthAtt.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+				depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+
+				VkRenderingInfo info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+				info.renderArea = {{0, 0}, renderExtent_};
+				info.layerCount = 1;
+				if (!list)
+				{
+					info.colorAttachmentCount =
+						static_cast<uint32_t>(colorAtts.size());
+					info.pColorAttachments = colorAtts.data();
+				}
+				info.pDepthAttachment = &depthAtt;
+
+				gpuProfiler_.begin_scope(cmd, "OIT accumulate");
+				vkCmdBeginRendering(cmd, &info);
+				draw_transparent_oit(cmd);
+				vkCmdEndRendering(cmd);
+				gpuProfiler_.end_scope(cmd);
+			});
+		graph.use(accumulate, depth, Usage::DepthRead);
+		graph.use(accumulate, tiles, Usage::FragmentStorageRead);
+		if (skinning) graph.use(accumulate, skinned, Usage::VertexRead);
+		for (auto target : oitTargets)
+			graph.use(accumulate, target,
+					  list ? Usage::FragmentStorageReadWrite
+						   : Usage::ColorWrite);
+	}
+
+	// ---- Main shading pass ----
+	// Tests against the prepass depth in the read-only layout the culling
+	// already sampled it in. Without a prepass it clears and writes depth
+	// (kept when the temporal resolve reprojects with it).
+	bool writeDepth = frameSkipPrepass_;
+	uint32_t main = graph.add_pass(
+		"Main pass", Queue::Graphics,
+		[this, &graph, sceneColor, imageIndex, writeDepth,
+		 taa](VkCommandBuffer cmd)
+		{
+			VkRenderingAttachmentInfo colorAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			colorAtt.imageView = taa ? graph.image_view(sceneColor)
+									 : swapchainImageViews_[imageIndex];
+			colorAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+			colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAtt.clearValue.color = {{0.1f, 0.1f, 0.1f, 1.0f}};
+
+			VkRenderingAttachmentInfo depthAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			depthAtt.imageView = depthView_;
+			if (writeDepth)
+			{
+				depthAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+				depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+				depthAtt.storeOp = taa ? VK_ATTACHMENT_STORE_OP_STORE
+									   : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				depthAtt.clearValue.depthStencil = {1.0f, 0};
+			}
+			else
+			{
+				depthAtt.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+				depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+				depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+			}
+
+			VkRenderingInfo info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+			info.renderArea = {{0, 0}, renderExtent_};
+			info.layerCount = 1;
+			info.colorAttachmentCount = 1;
+			info.pColorAttachments = &colorAtt;
+			info.pDepthAttachment = &depthAtt;
+
+			// Closed in finish_scene with TAA, else in end_frame so ImGui
+			// is included
+			gpuProfiler_.begin_scope(cmd, "Main pass");
+			vkCmdBeginRendering(cmd, &info);
+
+			VkViewport vp{0,
+						  0,
+						  static_cast<float>(renderExtent_.width),
+						  static_cast<float>(renderExtent_.height),
+						  0.0f,
+						  1.0f};
+			vkCmdSetViewport(cmd, 0, 1, &vp);
+
+			VkRect2D scissor{{0, 0}, renderExtent_};
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+		});
+	graph.use(main, depth,
+			  writeDepth ? Usage::DepthWrite : Usage::DepthRead);
+	graph.use(main, tiles, Usage::FragmentStorageRead);
+	graph.use(main, sceneColor, Usage::ColorWrite);
+	if (skinning) graph.use(main, skinned, Usage::VertexRead);
+	if (oit)
+	{
+		for (auto target : oitTargets)
+			graph.use(main, target,
+					  list ? Usage::FragmentStorageRead
+						   : Usage::FragmentSample);
+	}
+	frameMainPass_ = main;
+
+	if (!taa)
+	{
+		graph.keep(main);
+		graph.compile();
+		if (oit) update_oit_descriptor_sets(graph, oitTargets);
+		return;
+	}
+
+	// ---- Temporal resolve ----
+	// Both history images were last sampled by a fragment shader, or have
+	// never been written
+	uint32_t cur = historyIndex_;
+	uint32_t prev = cur ^ 1;
+	auto history_state = [this](uint32_t i)
+	{
+		RenderGraph::ImportState state;
+		if (historyInitialized_[i])
+		{
+			state.layout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+			state.stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+		}
+		return state;
+	};
+	auto history =
+		graph.import_image("History", historyImages_[prev],
+						   VK_IMAGE_ASPECT_COLOR_BIT, history_state(prev));
+	auto resolved =
+		graph.import_image("Resolved", historyImages_[cur],
+						   VK_IMAGE_ASPECT_COLOR_BIT, history_state(cur));
+
+	float historyWeight =
+		historyValid_ && historyInitialized_[prev] ? TAA_HISTORY_WEIGHT : 0.0f;
+	uint32_t resolve = graph.add_pass(
+		"Temporal resolve", Queue::Graphics,
+		[this, cur, historyWeight](VkCommandBuffer cmd)
+		{
+			VkRenderingAttachmentInfo colorAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			colorAtt.imageView = historyViews_[cur];
+			colorAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+			colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingInfo info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+			info.renderArea = {{0, 0}, swapchainExtent_};
+			info.layerCount = 1;
+			info.colorAttachmentCount = 1;
+			info.pColorAttachments = &colorAtt;
+
+			gpuProfiler_.begin_scope(cmd, "Temporal resolve");
+			vkCmdBeginRendering(cmd, &info);
+
+			VkViewport vp{0,
+						  0,
+						  static_cast<float>(swapchainExtent_.width),
+						  static_cast<float>(swapchainExtent_.height),
+						  0.0f,
+						  1.0f};
+			vkCmdSetViewport(cmd, 0, 1, &vp);
+			VkRect2D scissor{{0, 0}, swapchainExtent_};
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+			// Recorded after update_uniforms, so this frame's matrices
+			glm::vec2 full(swapchainExtent_.width, swapchainExtent_.height);
+			glm::vec2 render(renderExtent_.width, renderExtent_.height);
+			TaaPushConstants pc{};
+			pc.reprojection = taaReprojection_;
+			pc.jitterUV = taaJitter_ * 0.5f;
+			pc.renderScale = render / full;
+			pc.renderTexel = 1.0f / full;
+			pc.historyWeight = historyWeight;
+
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+							  taaResolvePipeline_);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+									taaPipelineLayout_, 0, 1,
+									&taaResolveSets_[currentFrame_], 0,
+									nullptr);
+			vkCmdPushConstants(cmd, taaPipelineLayout_,
+							   VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(pc),
+							   &pc);
+			vkCmdDraw(cmd, 3, 1, 0, 0);
+
+			vkCmdEndRendering(cmd);
+			gpuProfiler_.end_scope(cmd);
+		});
+	graph.use(resolve, sceneColor, Usage::FragmentSample);
+	graph.use(resolve, depth, Usage::FragmentSample);
+	graph.use(resolve, history, Usage::FragmentSample);
+	graph.use(resolve, resolved, Usage::ColorWrite);
+
+	// ---- Output ----
+	// Depth is attached read-only only so the pass has the main pass's
+	// attachment formats, which ImGui's pipeline was created for
+	uint32_t output = graph.add_pass(
+		"Output", Queue::Graphics,
+		[this, imageIndex](VkCommandBuffer cmd)
+		{
+			VkRenderingAttachmentInfo colorAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			colorAtt.imageView = swapchainImageViews_[imageIndex];
+			colorAtt.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL;
+			colorAtt.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			colorAtt.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+			VkRenderingAttachmentInfo depthAtt{
+				VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+			depthAtt.imageView = depthView_;
+			depthAtt.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+			depthAtt.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			depthAtt.storeOp = VK_ATTACHMENT_STORE_OP_NONE;
+
+			VkRenderingInfo info{VK_STRUCTURE_TYPE_RENDERING_INFO};
+			info.renderArea = {{0, 0}, swapchainExtent_};
+			info.layerCount = 1;
+			info.colorAttachmentCount = 1;
+			info.pColorAttachments = &colorAtt;
+			info.pDepthAttachment = &depthAtt;
+
+			// Closed in end_frame so ImGui is included
+			gpuProfiler_.begin_scope(cmd, "Output");
+			vkCmdBeginRendering(cmd, &info);
+
+			VkViewport vp{0,
+						  0,
+						  static_cast<float>(swapchainExtent_.width),
+						  static_cast<float>(swapchainExtent_.height),
+						  0.0f,
+						  1.0f};
+			vkCmdSetViewport(cmd, 0, 1, &vp);
+			VkRect2D scissor{{0, 0}, swapchainExtent_};
+			vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+			vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+							  taaOutputPipeline_);
+			vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+									taaPipelineLayout_, 0, 1,
+									&taaOutputSets_[currentFrame_], 0,
+									nullptr);
+			vkCmdDraw(cmd, 3, 1, 0, 0);
+		});
+	graph.use(output, resolved, Usage::FragmentSample);
+	graph.use(output, depth, Usage::DepthRead);
+	graph.use(output, target, Usage::ColorWrite);
+	graph.keep(output);
+
+	graph.compile();
+	update_taa_descriptor_sets(graph.image_view(sceneColor));
+	if (oit) update_oit_descriptor_sets(graph, oitTargets);
+}
+
+VkCommandBuffer Renderer::segment_command_buffer(RenderGraph::Queue queue,
+												 uint32_t segment)
+{
+	auto& buffers = queue == RenderGraph::Queue::AsyncCompute
+						? computeSegmentBuffers_
+						: graphicsSegmentBuffers_;
+	return buffers[currentFrame_ * MAX_GRAPH_SEGMENTS + segment];
+}
+
+// One submission per segment, in order. Each waits on the previous one
+// through segmentTimeline_; the last also waits on the acquired image and
+// signals the present semaphore and the frame fence.
+void Renderer::submit_frame_graph(uint32_t imageIndex)
+{
+	const auto& segments = frameGraphs_[currentFrame_].segments();
+	uint64_t base = segmentTimelineValue_;
+
+	for (uint32_t i = 0; i < segments.size(); ++i)
+	{
+		bool last = i + 1 == segments.size();
+
+		VkSemaphoreSubmitInfo waits[2];
+		uint32_t waitCount = 0;
+		if (i > 0)
+		{
+			VkSemaphoreSubmitInfo& w = waits[waitCount++];
+			w = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+			w.semaphore = segmentTimeline_;
+			w.value = base + i;
+			w.stageMask = segments[i].waitStages;
+		}
+		if (last && !headless_)
+		{
+			VkSemaphoreSubmitInfo& w = waits[waitCount++];
+			w = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+			w.semaphore = imageAvailableSemaphores_[currentFrame_];
+			w.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		}
+
+		VkSemaphoreSubmitInfo signal{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+		signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		if (!last)
+		{
+			signal.semaphore = segmentTimeline_;
+			signal.value = base + i + 1;
+		}
+		else if (!headless_)
+			signal.semaphore = renderFinishedSemaphores_[imageIndex];
+
+		VkCommandBufferSubmitInfo cmdInfo{
+			VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+		cmdInfo.commandBuffer =
+			last ? commandBuffers_[currentFrame_]
+				 : segment_command_buffer(segments[i].queue, i);
+
+		VkSubmitInfo2 si{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+		si.waitSemaphoreInfoCount = waitCount;
+		si.pWaitSemaphoreInfos = waits;
+		si.commandBufferInfoCount = 1;
+		si.pCommandBufferInfos = &cmdInfo;
+		si.signalSemaphoreInfoCount = signal.semaphore ? 1 : 0;
+		si.pSignalSemaphoreInfos = &signal;
+
+		VkQueue queue = segments[i].queue == RenderGraph::Queue::AsyncCompute
+							? computeQueue_
+							: graphicsQueue_;
+		VK_CHECK(vkQueueSubmit2(queue, 1, &si,
+								last ? inFlightFences_[currentFrame_]
+									 : VK_NULL_HANDLE));
 	}
 
-	vkCmdEndRenderPass(cmd);
+	if (!segments.empty())
+		segmentTimelineValue_ = base + segments.size() - 1;
+	slotFrame_[currentFrame_] = ++submittedFrames_;
 }
 
 // =============================================================================
@@ -2347,12 +4117,9 @@ void Renderer::create_light_buffers()
 {
 	tileCountX_ = (swapchainExtent_.width + TILE_SIZE - 1) / TILE_SIZE;
 	tileCountY_ = (swapchainExtent_.height + TILE_SIZE - 1) / TILE_SIZE;
-	uint32_t numTiles = tileCountX_ * tileCountY_;
 
 	VkDeviceSize lightBufSize =
 		static_cast<VkDeviceSize>(MAX_LIGHTS) * sizeof(GPULight);
-	VkDeviceSize tileBufSize = static_cast<VkDeviceSize>(numTiles) *
-							   (1 + MAX_LIGHTS_PER_TILE) * sizeof(uint32_t);
 
 	lightSSBOs_.resize(MAX_FRAMES_IN_FLIGHT);
 	lightSSBOMemory_.resize(MAX_FRAMES_IN_FLIGHT);
@@ -2360,23 +4127,52 @@ void Renderer::create_light_buffers()
 	tileLightSSBOs_.resize(MAX_FRAMES_IN_FLIGHT);
 	tileLightSSBOMemory_.resize(MAX_FRAMES_IN_FLIGHT);
 
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		// Light SSBO: host-visible mapped for CPU write
 		create_buffer(lightBufSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					  lightSSBOs_[i], lightSSBOMemory_[i]);
+					  lightSSBOs_[i], lightSSBOMemory_[i], true);
 		vkMapMemory(device_, lightSSBOMemory_[i], 0, lightBufSize, 0,
 					&lightSSBOMapped_[i]);
 
-		// Tile light SSBO: device-local for compute write / fragment read
-		create_buffer(tileBufSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tileLightSSBOs_[i],
-					  tileLightSSBOMemory_[i]);
+		create_tile_light_buffer(i);
 	}
 }
 
+void Renderer::create_tile_light_buffer(uint32_t slot)
+{
+	// Rounded up to whole steps per axis, so dragging a window edge only
+	// reallocates every 256 px instead of on every resize
+	auto round_up = [](uint32_t n)
+	{
+		return (n + TILE_CAPACITY_STEP - 1) / TILE_CAPACITY_STEP *
+			   TILE_CAPACITY_STEP;
+	};
+	uint32_t capacity = round_up(tileCountX_) * round_up(tileCountY_);
+	VkDeviceSize tileBufSize = static_cast<VkDeviceSize>(capacity) *
+							   (1 + MAX_LIGHTS_PER_TILE) * sizeof(uint32_t);
+
+	// Tile light SSBO: device-local for compute write / fragment read
+	create_buffer(tileBufSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tileLightSSBOs_[slot],
+				  tileLightSSBOMemory_[slot]);
+	tileLightCapacity_[slot] = capacity;
+}
+
+void Renderer::ensure_tile_light_capacity(uint32_t slot)
+{
+	if (tileCountX_ * tileCountY_ <= tileLightCapacity_[slot]) return;
+
+	// Only this slot's frames use its buffer, and its fence has signalled
+	vkDestroyBuffer(device_, tileLightSSBOs_[slot], nullptr);
+	vkFreeMemory(device_, tileLightSSBOMemory_[slot], nullptr);
+	create_tile_light_buffer(slot);
+	lightSetDirty_[slot] = true;
+	++tileBufferReallocations_;
+}
+
 void Renderer::cleanup_light_buffers()
 {
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
@@ -2393,6 +4189,7 @@ void Renderer::cleanup_light_buffers()
 			vkDestroyBuffer(device_, tileLightSSBOs_[i], nullptr);
 			vkFreeMemory(device_, tileLightSSBOMemory_[i], nullptr);
 		}
+		tileLightCapacity_[i] = 0;
 	}
 	lightSSBOs_.clear();
 	lightSSBOMemory_.clear();
@@ -2444,46 +4241,49 @@ void Renderer::create_light_descriptor_sets()
 	VK_CHECK(
 		vkAllocateDescriptorSets(device_, &ai, lightDescriptorSets_.data()));
 
-	uint32_t numTiles = tileCountX_ * tileCountY_;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		update_light_descriptor_set(i);
+}
+
+void Renderer::update_light_descriptor_set(uint32_t slot)
+{
 	VkDeviceSize lightBufSize =
 		static_cast<VkDeviceSize>(MAX_LIGHTS) * sizeof(GPULight);
-	VkDeviceSize tileBufSize = static_cast<VkDeviceSize>(numTiles) *
-							   (1 + MAX_LIGHTS_PER_TILE) * sizeof(uint32_t);
-
-	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
-	{
-		VkDescriptorBufferInfo lightBufInfo{lightSSBOs_[i], 0, lightBufSize};
-		VkDescriptorBufferInfo tileBufInfo{tileLightSSBOs_[i], 0, tileBufSize};
-		VkDescriptorImageInfo depthImgInfo{};
-		depthImgInfo.sampler = depthSampler_;
-		depthImgInfo.imageView = depthView_;
-		depthImgInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
-		std::array<VkWriteDescriptorSet, 3> writes{};
-		writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[0].dstSet = lightDescriptorSets_[i];
-		writes[0].dstBinding = 0;
-		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		writes[0].descriptorCount = 1;
-		writes[0].pBufferInfo = &lightBufInfo;
-
-		writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[1].dstSet = lightDescriptorSets_[i];
-		writes[1].dstBinding = 1;
-		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		writes[1].descriptorCount = 1;
-		writes[1].pBufferInfo = &tileBufInfo;
 
-		writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		writes[2].dstSet = lightDescriptorSets_[i];
-		writes[2].dstBinding = 2;
-		writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		writes[2].descriptorCount = 1;
-		writes[2].pImageInfo = &depthImgInfo;
+	// Whole range: the tile buffer may be larger than the current tile grid
+	VkDescriptorBufferInfo lightBufInfo{lightSSBOs_[slot], 0, lightBufSize};
+	VkDescriptorBufferInfo tileBufInfo{tileLightSSBOs_[slot], 0,
+									   VK_WHOLE_SIZE};
+	VkDescriptorImageInfo depthImgInfo{};
+	depthImgInfo.sampler = depthSampler_;
+	depthImgInfo.imageView = depthView_;
+	depthImgInfo.imageLayout = VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL;
+
+	std::array<VkWriteDescriptorSet, 3> writes{};
+	writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[0].dstSet = lightDescriptorSets_[slot];
+	writes[0].dstBinding = 0;
+	writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	writes[0].descriptorCount = 1;
+	writes[0].pBufferInfo = &lightBufInfo;
+
+	writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[1].dstSet = lightDescriptorSets_[slot];
+	writes[1].dstBinding = 1;
+	writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	writes[1].descriptorCount = 1;
+	writes[1].pBufferInfo = &tileBufInfo;
+
+	writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	writes[2].dstSet = lightDescriptorSets_[slot];
+	writes[2].dstBinding = 2;
+	writes[2].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	writes[2].descriptorCount = 1;
+	writes[2].pImageInfo = &depthImgInfo;
 
-		vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
-							   writes.data(), 0, nullptr);
-	}
+	vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+						   writes.data(), 0, nullptr);
+	lightSetDirty_[slot] = false;
 }
 
 // =============================================================================
@@ -2520,6 +4320,486 @@ void Renderer::create_compute_pipeline()
 	vkDestroyShaderModule(device_, compMod, nullptr);
 }
 
+// =============================================================================
+// GPU skinning
+// =============================================================================
+
+void Renderer::create_skinning_pipeline()
+{
+	// Bind pose, influences, joint matrices, skinned vertices, morph
+	// accumulator
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo setCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+	setCI.bindingCount = static_cast<uint32_t>(bindings.size());
+	setCI.pBindings = bindings.data();
+	VK_CHECK(vkCreateDescriptorSetLayout(device_, &setCI, nullptr,
+										 &skinningSetLayout_));
+
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		static_cast<uint32_t>(bindings.size() * MAX_FRAMES_IN_FLIGHT)};
+	VkDescriptorPoolCreateInfo poolCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+	poolCI.poolSizeCount = 1;
+	poolCI.pPoolSizes = &poolSize;
+	poolCI.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	VK_CHECK(vkCreateDescriptorPool(device_, &poolCI, nullptr,
+									&skinningDescriptorPool_));
+
+	// Written by rebuild_skinning once there are skinned meshes
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(skinningSetLayout_);
+	VkDescriptorSetAllocateInfo ai{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+	ai.descriptorPool = skinningDescriptorPool_;
+	ai.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	ai.pSetLayouts = layouts.data();
+	VK_CHECK(vkAllocateDescriptorSets(device_, &ai, skinningSets_));
+
+	// Vertex count, morphed vertex count
+	VkPushConstantRange push{VK_SHADER_STAGE_COMPUTE_BIT, 0,
+							 2 * sizeof(uint32_t)};
+	VkPipelineLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+	layoutCI.setLayoutCount = 1;
+	layoutCI.pSetLayouts = &skinningSetLayout_;
+	layoutCI.pushConstantRangeCount = 1;
+	layoutCI.pPushConstantRanges = &push;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&skinningPipelineLayout_));
+
+	auto compCode = packFile_->read("shaders/skinning.comp.spv");
+	VkShaderModule compMod = create_shader_module(compCode);
+
+	VkComputePipelineCreateInfo ci{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+	ci.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	ci.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	ci.stage.module = compMod;
+	ci.stage.pName = "main";
+	ci.layout = skinningPipelineLayout_;
+	VK_CHECK(vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									  &skinningPipeline_));
+
+	vkDestroyShaderModule(device_, compMod, nullptr);
+}
+
+void Renderer::create_morph_pipeline()
+{
+	// Deltas, active targets, accumulator
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo setCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+	setCI.bindingCount = static_cast<uint32_t>(bindings.size());
+	setCI.pBindings = bindings.data();
+	VK_CHECK(vkCreateDescriptorSetLayout(device_, &setCI, nullptr,
+										 &morphSetLayout_));
+
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		static_cast<uint32_t>(bindings.size() * MAX_FRAMES_IN_FLIGHT)};
+	VkDescriptorPoolCreateInfo poolCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+	poolCI.poolSizeCount = 1;
+	poolCI.pPoolSizes = &poolSize;
+	poolCI.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	VK_CHECK(vkCreateDescriptorPool(device_, &poolCI, nullptr,
+									&morphDescriptorPool_));
+
+	// Written by rebuild_skinning once there are morphed meshes
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(morphSetLayout_);
+	VkDescriptorSetAllocateInfo ai{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+	ai.descriptorPool = morphDescriptorPool_;
+	ai.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
+	ai.pSetLayouts = layouts.data();
+	VK_CHECK(vkAllocateDescriptorSets(device_, &ai, morphSets_));
+
+	// Active target count, active delta count
+	VkPushConstantRange push{VK_SHADER_STAGE_COMPUTE_BIT, 0,
+							 2 * sizeof(uint32_t)};
+	VkPipelineLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+	layoutCI.setLayoutCount = 1;
+	layoutCI.pSetLayouts = &morphSetLayout_;
+	layoutCI.pushConstantRangeCount = 1;
+	layoutCI.pPushConstantRanges = &push;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&morphPipelineLayout_));
+
+	auto compCode = packFile_->read("shaders/morph.comp.spv");
+	VkShaderModule compMod = create_shader_module(compCode);
+
+	VkComputePipelineCreateInfo ci{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+	ci.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	ci.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	ci.stage.module = compMod;
+	ci.stage.pName = "main";
+	ci.layout = morphPipelineLayout_;
+	VK_CHECK(vkCreateComputePipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									  &morphPipeline_));
+
+	vkDestroyShaderModule(device_, compMod, nullptr);
+}
+
+void Renderer::destroy_skinning_buffers()
+{
+	vkDestroyBuffer(device_, bindPoseBuffer_, nullptr);
+	vkFreeMemory(device_, bindPoseMemory_, nullptr);
+	vkDestroyBuffer(device_, influenceBuffer_, nullptr);
+	vkFreeMemory(device_, influenceMemory_, nullptr);
+	bindPoseBuffer_ = VK_NULL_HANDLE;
+	bindPoseMemory_ = VK_NULL_HANDLE;
+	influenceBuffer_ = VK_NULL_HANDLE;
+	influenceMemory_ = VK_NULL_HANDLE;
+	vkDestroyBuffer(device_, morphDeltaBuffer_, nullptr);
+	vkFreeMemory(device_, morphDeltaMemory_, nullptr);
+	morphDeltaBuffer_ = VK_NULL_HANDLE;
+	morphDeltaMemory_ = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		vkDestroyBuffer(device_, jointBuffers_[i], nullptr);
+		vkFreeMemory(device_, jointMemory_[i], nullptr);
+		vkDestroyBuffer(device_, skinnedVertexBuffers_[i], nullptr);
+		vkFreeMemory(device_, skinnedVertexMemory_[i], nullptr);
+		vkDestroyBuffer(device_, morphActiveBuffers_[i], nullptr);
+		vkFreeMemory(device_, morphActiveMemory_[i], nullptr);
+		vkDestroyBuffer(device_, morphAccumBuffers_[i], nullptr);
+		vkFreeMemory(device_, morphAccumMemory_[i], nullptr);
+		jointBuffers_[i] = VK_NULL_HANDLE;
+		jointMemory_[i] = VK_NULL_HANDLE;
+		jointMapped_[i] = nullptr;
+		skinnedVertexBuffers_[i] = VK_NULL_HANDLE;
+		skinnedVertexMemory_[i] = VK_NULL_HANDLE;
+		morphActiveBuffers_[i] = VK_NULL_HANDLE;
+		morphActiveMemory_[i] = VK_NULL_HANDLE;
+		morphActiveMapped_[i] = nullptr;
+		morphAccumBuffers_[i] = VK_NULL_HANDLE;
+		morphAccumMemory_[i] = VK_NULL_HANDLE;
+	}
+	skinnedVertexCount_ = 0;
+	jointCount_ = 0;
+	morphRanges_.clear();
+	morphVertexCount_ = 0;
+	activeMorphCount_ = 0;
+	morphStats_ = {};
+}
+
+void Renderer::rebuild_skinning()
+{
+	destroy_skinning_buffers();
+
+	// Every skin's joint matrices, back to back
+	skinJointOffsets_.clear();
+	for (const Skin& skin : skins_)
+	{
+		skinJointOffsets_.push_back(jointCount_);
+		jointCount_ += static_cast<uint32_t>(skin.joints.size());
+	}
+
+	// Morphed meshes first, so the accumulator covers a prefix of the
+	// bind pose
+	std::vector<Vertex> bindPose;
+	std::vector<SkinInfluence> influences;
+	std::vector<MorphDelta> deltas;
+	auto pack = [&](uint32_t meshIndex)
+	{
+		Mesh& mesh = meshes_[meshIndex];
+		auto first = static_cast<uint32_t>(bindPose.size());
+		mesh.skinnedFirstVertex = first;
+		bindPose.insert(bindPose.end(), mesh.vertices.begin(),
+						mesh.vertices.end());
+
+		for (uint32_t t = 0; t < mesh.morphTargets.size(); ++t)
+		{
+			MorphRange range;
+			range.mesh = meshIndex;
+			range.target = t;
+			range.firstDelta = static_cast<uint32_t>(deltas.size());
+			for (MorphDelta d : mesh.morphTargets[t].deltas)
+			{
+				if (d.vertex >= mesh.vertices.size()) continue;
+				d.vertex += first;
+				deltas.push_back(d);
+			}
+			range.deltaCount =
+				static_cast<uint32_t>(deltas.size()) - range.firstDelta;
+			if (range.deltaCount > 0) morphRanges_.push_back(range);
+		}
+
+		if (mesh.skin < 0)
+		{
+			influences.resize(bindPose.size());
+			return;
+		}
+
+		// Out-of-range joints (malformed files) fall back to the last one
+		uint32_t offset = skinJointOffsets_[mesh.skin];
+		auto last =
+			static_cast<uint32_t>(skins_[mesh.skin].joints.size()) - 1;
+		for (SkinInfluence inf : mesh.influences)
+		{
+			for (int c = 0; c < 4; ++c)
+				inf.joints[c] = offset + std::min(inf.joints[c], last);
+			influences.push_back(inf);
+		}
+	};
+	auto meshCount = static_cast<uint32_t>(meshes_.size());
+	for (uint32_t m = 0; m < meshCount; ++m)
+		if (!meshes_[m].morphTargets.empty()) pack(m);
+	morphVertexCount_ = static_cast<uint32_t>(bindPose.size());
+	for (uint32_t m = 0; m < meshCount; ++m)
+		if (meshes_[m].skin >= 0 && meshes_[m].morphTargets.empty())
+			pack(m);
+	if (bindPose.empty())
+	{
+		jointCount_ = 0;
+		morphVertexCount_ = 0;
+		return;
+	}
+	skinnedVertexCount_ = static_cast<uint32_t>(bindPose.size());
+	morphStats_.targets = static_cast<uint32_t>(morphRanges_.size());
+	morphStats_.deltas = static_cast<uint32_t>(deltas.size());
+
+	auto upload = [this](const void* src, VkDeviceSize size, VkBuffer& buffer,
+						 VkDeviceMemory& memory)
+	{
+		VkBuffer staging;
+		VkDeviceMemory stagingMem;
+		create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					  staging, stagingMem);
+		void* data;
+		vkMapMemory(device_, stagingMem, 0, size, 0, &data);
+		std::memcpy(data, src, size);
+		vkUnmapMemory(device_, stagingMem);
+		create_buffer(size,
+					  VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+						  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer, memory);
+		copy_buffer(staging, buffer, size);
+		destroy_staging(staging, stagingMem);
+	};
+	VkDeviceSize vertexBytes =
+		static_cast<VkDeviceSize>(skinnedVertexCount_) * sizeof(Vertex);
+	VkDeviceSize influenceBytes =
+		static_cast<VkDeviceSize>(skinnedVertexCount_) * sizeof(SkinInfluence);
+	// Morph-only scenes have no joints, and buffers cannot be empty
+	VkDeviceSize jointBytes =
+		static_cast<VkDeviceSize>(std::max(jointCount_, 1u)) *
+		sizeof(glm::mat4);
+	upload(bindPose.data(), vertexBytes, bindPoseBuffer_, bindPoseMemory_);
+	upload(influences.data(), influenceBytes, influenceBuffer_,
+		   influenceMemory_);
+
+	// Without morphs the skinning pass still binds a (never read)
+	// accumulator
+	if (deltas.empty()) deltas.emplace_back();
+	std::vector<int32_t> accum(std::max(morphVertexCount_ * 9u, 4u), 0);
+	VkDeviceSize deltaBytes = deltas.size() * sizeof(MorphDelta);
+	VkDeviceSize activeBytes =
+		std::max<size_t>(morphRanges_.size(), 1) * sizeof(MorphActive);
+	VkDeviceSize accumBytes = accum.size() * sizeof(int32_t);
+	upload(deltas.data(), deltaBytes, morphDeltaBuffer_, morphDeltaMemory_);
+
+	for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		create_buffer(jointBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					  jointBuffers_[i], jointMemory_[i]);
+		void* mapped = nullptr;
+		vkMapMemory(device_, jointMemory_[i], 0, jointBytes, 0, &mapped);
+		jointMapped_[i] = static_cast<glm::mat4*>(mapped);
+
+		create_buffer(vertexBytes,
+					  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+						  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+					  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+					  skinnedVertexBuffers_[i], skinnedVertexMemory_[i]);
+
+		create_buffer(activeBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+					  VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+						  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					  morphActiveBuffers_[i], morphActiveMemory_[i]);
+		vkMapMemory(device_, morphActiveMemory_[i], 0, activeBytes, 0,
+					&mapped);
+		morphActiveMapped_[i] = static_cast<MorphActive*>(mapped);
+		// Starts at zero; the skinning pass clears what it reads
+		upload(accum.data(), accumBytes, morphAccumBuffers_[i],
+			   morphAccumMemory_[i]);
+
+		VkDescriptorBufferInfo infos[] = {
+			{bindPoseBuffer_, 0, VK_WHOLE_SIZE},
+			{influenceBuffer_, 0, VK_WHOLE_SIZE},
+			{jointBuffers_[i], 0, VK_WHOLE_SIZE},
+			{skinnedVertexBuffers_[i], 0, VK_WHOLE_SIZE},
+			{morphAccumBuffers_[i], 0, VK_WHOLE_SIZE},
+			{morphDeltaBuffer_, 0, VK_WHOLE_SIZE},
+			{morphActiveBuffers_[i], 0, VK_WHOLE_SIZE},
+			{morphAccumBuffers_[i], 0, VK_WHOLE_SIZE},
+		};
+		std::array<VkWriteDescriptorSet, 8> writes{};
+		for (uint32_t b = 0; b < writes.size(); ++b)
+		{
+			bool morph = b >= 5;
+			writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[b].dstSet = morph ? morphSets_[i] : skinningSets_[i];
+			writes[b].dstBinding = morph ? b - 5 : b;
+			writes[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[b].descriptorCount = 1;
+			writes[b].pBufferInfo = &infos[b];
+		}
+		vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+							   writes.data(), 0, nullptr);
+	}
+
+	// Rest pose in every slot, for frames that do not call
+	// update_skinning
+	for (uint32_t s = 0; s < static_cast<uint32_t>(skins_.size()); ++s)
+	{
+		std::span<glm::mat4> out(jointMapped_[0] + skinJointOffsets_[s],
+								 skins_[s].joints.size());
+		skins_[s].joint_matrices({}, out);
+	}
+	for (uint32_t i = 1; i < MAX_FRAMES_IN_FLIGHT; ++i)
+		std::memcpy(jointMapped_[i], jointMapped_[0], jointBytes);
+}
+
+void Renderer::update_skinning(ThreadPool* pool)
+{
+	if (skinnedVertexCount_ == 0) return;
+	update_morph_weights();
+
+	// Posed in cached memory, then copied: the hierarchy walk reads parent
+	// matrices back, which is slow from a write-combined mapping
+	glm::mat4* mapped = jointMapped_[currentFrame_];
+	auto pose = [this, mapped](uint32_t begin, uint32_t end)
+	{
+		std::vector<glm::mat4> scratch;
+		for (uint32_t s = begin; s < end; ++s)
+		{
+			const Skin& skin = skins_[s];
+			scratch.resize(skin.joints.size());
+			if (skin.animation >= 0)
+				skin.animated_joint_matrices(
+					animations_[skin.animation].globals, scratch);
+			else
+				skin.joint_matrices({}, scratch);
+			std::memcpy(mapped + skinJointOffsets_[s], scratch.data(),
+						scratch.size() * sizeof(glm::mat4));
+		}
+	};
+
+	auto count = static_cast<uint32_t>(skins_.size());
+	if (pool && count >= SKINNING_PARALLEL_MIN_SKINS)
+		pool->parallel_for(count, SKINNING_PARALLEL_MIN_SKINS / 4, pose);
+	else
+		pose(0, count);
+}
+
+// Lists this frame's targets with a non-zero weight, so the morph pass
+// only walks their deltas
+void Renderer::update_morph_weights()
+{
+	MorphActive* active = morphActiveMapped_[currentFrame_];
+	activeMorphCount_ = 0;
+	morphStats_.activeTargets = 0;
+	morphStats_.activeDeltas = 0;
+	for (const MorphRange& range : morphRanges_)
+	{
+		const Mesh& mesh = meshes_[range.mesh];
+		float weight = range.target < mesh.morphWeights.size()
+						   ? mesh.morphWeights[range.target]
+						   : 0.0f;
+		if (mesh.animation >= 0)
+		{
+			const AnimationSet& set = animations_[mesh.animation];
+			const AnimationNode& node = set.nodes[mesh.animationNode];
+			if (range.target < node.weightCount)
+				weight = set.weights[node.firstWeight + range.target];
+		}
+		if (weight == 0.0f) continue;
+
+		MorphActive& a = active[activeMorphCount_++];
+		a.firstDelta = range.firstDelta;
+		a.deltaCount = range.deltaCount;
+		a.start = morphStats_.activeDeltas;
+		a.weight = weight;
+		morphStats_.activeDeltas += range.deltaCount;
+	}
+	morphStats_.activeTargets = activeMorphCount_;
+}
+
+void Renderer::update_animation(float dt, ThreadPool* pool)
+{
+	animationStats_ = {};
+	if (animations_.empty() || animationPaused_) return;
+
+	auto start = Clock::now();
+	animate(animations_, dt * animationSpeed_, pool);
+	animationStats_.cpuMs =
+		std::chrono::duration<double, std::milli>(Clock::now() - start)
+			.count();
+	animationStats_.sets = static_cast<uint32_t>(animations_.size());
+	for (const AnimationSet& set : animations_)
+		animationStats_.nodes += set.animated_node_count();
+}
+
+void Renderer::dispatch_skinning(VkCommandBuffer cmd)
+{
+	gpuProfiler_.begin_scope(cmd, "Skinning");
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, skinningPipeline_);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+							skinningPipelineLayout_, 0, 1,
+							&skinningSets_[currentFrame_], 0, nullptr);
+	// The accumulator is only read (and cleared) after a morph pass
+	uint32_t push[] = {skinnedVertexCount_,
+					   activeMorphCount_ > 0 ? morphVertexCount_ : 0};
+	vkCmdPushConstants(cmd, skinningPipelineLayout_,
+					   VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(push), push);
+	vkCmdDispatch(cmd,
+				  (skinnedVertexCount_ + SKINNING_GROUP_SIZE - 1) /
+					  SKINNING_GROUP_SIZE,
+				  1, 1);
+	gpuProfiler_.end_scope(cmd);
+}
+
+void Renderer::dispatch_morph(VkCommandBuffer cmd)
+{
+	gpuProfiler_.begin_scope(cmd, "Morph");
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, morphPipeline_);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+							morphPipelineLayout_, 0, 1,
+							&morphSets_[currentFrame_], 0, nullptr);
+	uint32_t push[] = {activeMorphCount_, morphStats_.activeDeltas};
+	vkCmdPushConstants(cmd, morphPipelineLayout_, VK_SHADER_STAGE_COMPUTE_BIT,
+					   0, sizeof(push), push);
+	vkCmdDispatch(cmd,
+				  (morphStats_.activeDeltas + MORPH_GROUP_SIZE - 1) /
+					  MORPH_GROUP_SIZE,
+				  1, 1);
+	gpuProfiler_.end_scope(cmd);
+}
+
 // =============================================================================
 // Forward+ : Heatmap debug pipeline
 // =============================================================================
@@ -2614,9 +4894,9 @@ void Renderer::create_heatmap_pipeline()
 	ci.pDepthStencilState = &ds;
 	ci.pColorBlendState = &blend;
 	ci.pDynamicState = &dyn;
+	VkPipelineRenderingCreateInfo rendering = main_pass_formats();
+	ci.pNext = &rendering;
 	ci.layout = heatmapPipelineLayout_;
-	ci.renderPass = renderPass_;
-	ci.subpass = 0;
 
 	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
 									   &heatmapPipeline_));
@@ -2718,9 +4998,9 @@ void Renderer::create_debug_line_pipeline()
 	ci.pDepthStencilState = &ds;
 	ci.pColorBlendState = &blend;
 	ci.pDynamicState = &dyn;
+	VkPipelineRenderingCreateInfo rendering = main_pass_formats();
+	ci.pNext = &rendering;
 	ci.layout = debugLinePipelineLayout_;
-	ci.renderPass = renderPass_;
-	ci.subpass = 0;
 
 	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
 									   &debugLinePipeline_));
@@ -2731,8 +5011,7 @@ void Renderer::create_debug_line_pipeline()
 
 void Renderer::create_debug_line_buffers()
 {
-	// 64KB per frame — enough for ~1300 line segments (2 vertices each)
-	constexpr VkDeviceSize bufSize = 64 * 1024;
+	constexpr VkDeviceSize bufSize = DEBUG_LINE_BUFFER_SIZE;
 	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
 	{
 		create_buffer(bufSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
@@ -2744,24 +5023,606 @@ void Renderer::create_debug_line_buffers()
 	}
 }
 
-void Renderer::update_debug_lines(const LightEnvironment& lights)
+void Renderer::update_debug_lines(const LightEnvironment& lights,
+								  std::span<const LineVertex> extra)
 {
-	auto verts = generate_light_lines(lights);
-	constexpr VkDeviceSize bufSize = 64 * 1024;
-	uint32_t maxVerts = static_cast<uint32_t>(bufSize / sizeof(LineVertex));
-	debugLineVertexCount_ = static_cast<uint32_t>(
+	std::vector<LineVertex> verts;
+	if (showDebugLines_) verts = generate_light_lines(lights);
+	uint32_t maxVerts = static_cast<uint32_t>(DEBUG_LINE_BUFFER_SIZE /
+											  sizeof(LineVertex));
+	uint32_t lightVerts = static_cast<uint32_t>(
 		std::min(static_cast<uint32_t>(verts.size()), maxVerts));
-	if (debugLineVertexCount_ > 0)
-	{
-		std::memcpy(debugLineVertexMapped_[currentFrame_], verts.data(),
-					debugLineVertexCount_ * sizeof(LineVertex));
-	}
+	uint32_t extraVerts = static_cast<uint32_t>(
+		std::min<size_t>(extra.size(), maxVerts - lightVerts));
+	auto* mapped =
+		static_cast<LineVertex*>(debugLineVertexMapped_[currentFrame_]);
+	if (lightVerts > 0)
+		std::memcpy(mapped, verts.data(), lightVerts * sizeof(LineVertex));
+	if (extraVerts > 0)
+		std::memcpy(mapped + lightVerts, extra.data(),
+					extraVerts * sizeof(LineVertex));
+	debugLineVertexCount_ = lightVerts + extraVerts;
 }
 
 // =============================================================================
-// Cleanup helpers
+// Dynamic resolution & temporal upscaling
 // =============================================================================
 
+void Renderer::update_render_extent()
+{
+	float scale = 1.0f;
+	if (frameTaa_)
+	{
+		// One update per GPU timing that comes back
+		const auto& timing = gpuProfiler_.latest();
+		if (timing.frameNumber != lastScaledGpuFrame_ && timing.frameMs > 0.0)
+		{
+			resolutionScaler_.update(timing.frameMs);
+			lastScaledGpuFrame_ = timing.frameNumber;
+		}
+		scale = resolutionScaler_.scale();
+	}
+	else
+	{
+		resolutionScaler_.reset();
+	}
+
+	auto scaled = [scale](uint32_t size)
+	{
+		float s = std::round(static_cast<float>(size) * scale);
+		return std::clamp(static_cast<uint32_t>(s), 1u, size);
+	};
+	renderExtent_ = {scaled(swapchainExtent_.width),
+					 scaled(swapchainExtent_.height)};
+	tileCountX_ = (renderExtent_.width + TILE_SIZE - 1) / TILE_SIZE;
+	tileCountY_ = (renderExtent_.height + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+void Renderer::create_history_images()
+{
+	for (int i = 0; i < 2; ++i)
+	{
+		VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+		imgCI.imageType = VK_IMAGE_TYPE_2D;
+		imgCI.format = HISTORY_FORMAT;
+		imgCI.extent = {swapchainExtent_.width, swapchainExtent_.height, 1};
+		imgCI.mipLevels = 1;
+		imgCI.arrayLayers = 1;
+		imgCI.samples = VK_SAMPLE_COUNT_1_BIT;
+		imgCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imgCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+					  VK_IMAGE_USAGE_SAMPLED_BIT;
+		VK_CHECK(vkCreateImage(device_, &imgCI, nullptr, &historyImages_[i]));
+
+		VkMemoryRequirements memReq;
+		vkGetImageMemoryRequirements(device_, historyImages_[i], &memReq);
+		VkMemoryAllocateInfo allocInfo{VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO};
+		allocInfo.allocationSize = memReq.size;
+		allocInfo.memoryTypeIndex = find_memory_type(
+			memReq.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VK_CHECK(vkAllocateMemory(device_, &allocInfo, nullptr,
+								  &historyMemory_[i]));
+		vkBindImageMemory(device_, historyImages_[i], historyMemory_[i], 0);
+
+		historyViews_[i] = create_image_view(historyImages_[i], HISTORY_FORMAT,
+											 VK_IMAGE_ASPECT_COLOR_BIT);
+		historyInitialized_[i] = false;
+	}
+	historyValid_ = false;
+}
+
+void Renderer::create_taa_descriptors()
+{
+	// Bilinear, clamped: the scene color is sampled between render pixels
+	VkSamplerCreateInfo sci{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+	sci.magFilter = VK_FILTER_LINEAR;
+	sci.minFilter = VK_FILTER_LINEAR;
+	sci.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sci.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sci.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	sci.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	sci.maxLod = 0.0f;
+	VK_CHECK(vkCreateSampler(device_, &sci, nullptr, &taaSampler_));
+
+	// 0: scene color, 1: depth, 2: history. The output pass only uses 0.
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+	layoutCI.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCI.pBindings = bindings.data();
+	VK_CHECK(vkCreateDescriptorSetLayout(device_, &layoutCI, nullptr,
+										 &taaSetLayout_));
+
+	// A resolve and an output set per frame in flight
+	constexpr uint32_t setCount = 2 * MAX_FRAMES_IN_FLIGHT;
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = setCount * 3;
+
+	VkDescriptorPoolCreateInfo poolCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+	poolCI.poolSizeCount = 1;
+	poolCI.pPoolSizes = &poolSize;
+	poolCI.maxSets = setCount;
+	VK_CHECK(
+		vkCreateDescriptorPool(device_, &poolCI, nullptr, &taaDescriptorPool_));
+
+	std::array<VkDescriptorSetLayout, setCount> layouts;
+	layouts.fill(taaSetLayout_);
+	std::array<VkDescriptorSet, setCount> sets{};
+	VkDescriptorSetAllocateInfo ai{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+	ai.descriptorPool = taaDescriptorPool_;
+	ai.descriptorSetCount = setCount;
+	ai.pSetLayouts = layouts.data();
+	VK_CHECK(vkAllocateDescriptorSets(device_, &ai, sets.data()));
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		taaResolveSets_[i] = sets[2 * i];
+		taaOutputSets_[i] = sets[2 * i + 1];
+	}
+}
+
+// The scene color is a graph transient and the history images swap roles
+// every frame, so the slot's sets are rewritten each frame, once its fence
+// has signalled
+void Renderer::update_taa_descriptor_sets(VkImageView sceneColor)
+{
+	uint32_t cur = historyIndex_;
+	VkDescriptorImageInfo images[4] = {
+		{taaSampler_, sceneColor, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL},
+		{depthSampler_, depthView_, VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL},
+		{taaSampler_, historyViews_[cur ^ 1],
+		 VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL},
+		{taaSampler_, historyViews_[cur], VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL},
+	};
+
+	std::array<VkWriteDescriptorSet, 4> writes{};
+	for (uint32_t i = 0; i < writes.size(); ++i)
+	{
+		bool output = i == 3;
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = output ? taaOutputSets_[currentFrame_]
+								  : taaResolveSets_[currentFrame_];
+		writes[i].dstBinding = output ? 0 : i;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[i].descriptorCount = 1;
+		writes[i].pImageInfo = &images[i];
+	}
+	vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+						   writes.data(), 0, nullptr);
+}
+
+void Renderer::create_taa_pipelines()
+{
+	VkPushConstantRange pushRange{};
+	pushRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushRange.size = sizeof(TaaPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+	layoutCI.setLayoutCount = 1;
+	layoutCI.pSetLayouts = &taaSetLayout_;
+	layoutCI.pushConstantRangeCount = 1;
+	layoutCI.pPushConstantRanges = &pushRange;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&taaPipelineLayout_));
+
+	auto vertCode = packFile_->read("shaders/fullscreen.vert.spv");
+	auto resolveCode = packFile_->read("shaders/taa_resolve.frag.spv");
+	auto outputCode = packFile_->read("shaders/taa_output.frag.spv");
+	VkShaderModule vertMod = create_shader_module(vertCode);
+	VkShaderModule resolveMod = create_shader_module(resolveCode);
+	VkShaderModule outputMod = create_shader_module(outputCode);
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertMod;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertInput{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAsm{
+		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+	inputAsm.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo vpState{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+	vpState.viewportCount = 1;
+	vpState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo raster{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+	raster.polygonMode = VK_POLYGON_MODE_FILL;
+	raster.lineWidth = 1.0f;
+	raster.cullMode = VK_CULL_MODE_NONE;
+
+	VkPipelineMultisampleStateCreateInfo ms{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+	ms.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo ds{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+	ds.depthTestEnable = VK_FALSE;
+	ds.depthWriteEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState blendAtt{};
+	blendAtt.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo blend{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+	blend.attachmentCount = 1;
+	blend.pAttachments = &blendAtt;
+
+	VkDynamicState dynStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+								  VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dyn{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+	dyn.dynamicStateCount = 2;
+	dyn.pDynamicStates = dynStates;
+
+	VkGraphicsPipelineCreateInfo ci{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+	ci.stageCount = 2;
+	ci.pStages = stages;
+	ci.pVertexInputState = &vertInput;
+	ci.pInputAssemblyState = &inputAsm;
+	ci.pViewportState = &vpState;
+	ci.pRasterizationState = &raster;
+	ci.pMultisampleState = &ms;
+	ci.pDepthStencilState = &ds;
+	ci.pColorBlendState = &blend;
+	ci.pDynamicState = &dyn;
+	ci.layout = taaPipelineLayout_;
+
+	// Resolve: into a history image
+	VkFormat historyFormat = HISTORY_FORMAT;
+	VkPipelineRenderingCreateInfo resolveRendering{
+		VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+	resolveRendering.colorAttachmentCount = 1;
+	resolveRendering.pColorAttachmentFormats = &historyFormat;
+	stages[1].module = resolveMod;
+	ci.pNext = &resolveRendering;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &taaResolvePipeline_));
+
+	// Output: into the target, with the main pass's formats
+	VkPipelineRenderingCreateInfo outputRendering = main_pass_formats();
+	stages[1].module = outputMod;
+	ci.pNext = &outputRendering;
+	VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci, nullptr,
+									   &taaOutputPipeline_));
+
+	vkDestroyShaderModule(device_, outputMod, nullptr);
+	vkDestroyShaderModule(device_, resolveMod, nullptr);
+	vkDestroyShaderModule(device_, vertMod, nullptr);
+}
+
+// =============================================================================
+// Order-independent transparency
+// =============================================================================
+
+void Renderer::create_oit_descriptors()
+{
+	// Weighted resolve: 0 = accumulation, 1 = revealage
+	std::array<VkDescriptorSetLayoutBinding, 2> resolveBindings{};
+	for (uint32_t i = 0; i < resolveBindings.size(); ++i)
+	{
+		resolveBindings[i].binding = i;
+		resolveBindings[i].descriptorType =
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		resolveBindings[i].descriptorCount = 1;
+		resolveBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+	layoutCI.bindingCount = static_cast<uint32_t>(resolveBindings.size());
+	layoutCI.pBindings = resolveBindings.data();
+	VK_CHECK(vkCreateDescriptorSetLayout(device_, &layoutCI, nullptr,
+										 &oitResolveSetLayout_));
+
+	// Linked lists, built and resolved: 0 = heads, 1 = nodes
+	std::array<VkDescriptorSetLayoutBinding, 2> listBindings{};
+	listBindings[0].binding = 0;
+	listBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	listBindings[0].descriptorCount = 1;
+	listBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	listBindings[1].binding = 1;
+	listBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	listBindings[1].descriptorCount = 1;
+	listBindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	layoutCI.bindingCount = static_cast<uint32_t>(listBindings.size());
+	layoutCI.pBindings = listBindings.data();
+	VK_CHECK(vkCreateDescriptorSetLayout(device_, &layoutCI, nullptr,
+										 &oitListSetLayout_));
+
+	// A resolve and a list set per frame in flight
+	constexpr uint32_t setCount = 2 * MAX_FRAMES_IN_FLIGHT;
+	std::array<VkDescriptorPoolSize, 3> poolSizes{};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = 2 * MAX_FRAMES_IN_FLIGHT;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+
+	VkDescriptorPoolCreateInfo poolCI{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+	poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCI.pPoolSizes = poolSizes.data();
+	poolCI.maxSets = setCount;
+	VK_CHECK(
+		vkCreateDescriptorPool(device_, &poolCI, nullptr, &oitDescriptorPool_));
+
+	std::array<VkDescriptorSetLayout, setCount> layouts;
+	std::array<VkDescriptorSet, setCount> sets{};
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		layouts[2 * i] = oitResolveSetLayout_;
+		layouts[2 * i + 1] = oitListSetLayout_;
+	}
+	VkDescriptorSetAllocateInfo ai{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+	ai.descriptorPool = oitDescriptorPool_;
+	ai.descriptorSetCount = setCount;
+	ai.pSetLayouts = layouts.data();
+	VK_CHECK(vkAllocateDescriptorSets(device_, &ai, sets.data()));
+	for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+	{
+		oitResolveSets_[i] = sets[2 * i];
+		oitListSets_[i] = sets[2 * i + 1];
+	}
+}
+
+// The targets are graph transients, so the slot's set for this frame's mode
+// is rewritten every frame, once its fence has signalled
+void Renderer::update_oit_descriptor_sets(
+	const RenderGraph& graph,
+	const std::array<RenderGraph::Resource, 2>& targets)
+{
+	std::array<VkWriteDescriptorSet, 2> writes{};
+	for (uint32_t i = 0; i < writes.size(); ++i)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+	}
+
+	VkDescriptorImageInfo images[2] = {};
+	VkDescriptorBufferInfo nodes{};
+	if (frameTransparency_ == TransparencyMode::LinkedListOit)
+	{
+		images[0] = {VK_NULL_HANDLE, graph.image_view(targets[0]),
+					 VK_IMAGE_LAYOUT_GENERAL};
+		nodes = {graph.buffer(targets[1]), 0, VK_WHOLE_SIZE};
+		writes[0].dstSet = oitListSets_[currentFrame_];
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		writes[0].pImageInfo = &images[0];
+		writes[1].dstSet = oitListSets_[currentFrame_];
+		writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[1].pBufferInfo = &nodes;
+	}
+	else
+	{
+		// Read with texelFetch, so any sampler will do
+		for (uint32_t i = 0; i < writes.size(); ++i)
+		{
+			images[i] = {taaSampler_, graph.image_view(targets[i]),
+						 VK_IMAGE_LAYOUT_READ_ONLY_OPTIMAL};
+			writes[i].dstSet = oitResolveSets_[currentFrame_];
+			writes[i].descriptorType =
+				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[i].pImageInfo = &images[i];
+		}
+	}
+	vkUpdateDescriptorSets(device_, static_cast<uint32_t>(writes.size()),
+						   writes.data(), 0, nullptr);
+}
+
+// Fullscreen composites over the main pass, one per supported mode. Both
+// write premultiplied color, hence ONE / ONE_MINUS_SRC_ALPHA.
+void Renderer::create_oit_pipelines()
+{
+	VkPipelineLayoutCreateInfo layoutCI{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+	layoutCI.setLayoutCount = 1;
+	layoutCI.pSetLayouts = &oitResolveSetLayout_;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&oitResolvePipelineLayout_));
+	layoutCI.pSetLayouts = &oitListSetLayout_;
+	VK_CHECK(vkCreatePipelineLayout(device_, &layoutCI, nullptr,
+									&oitListResolvePipelineLayout_));
+
+	auto vertCode = packFile_->read("shaders/fullscreen.vert.spv");
+	VkShaderModule vertMod = create_shader_module(vertCode);
+
+	VkPipelineShaderStageCreateInfo stages[2]{};
+	stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	stages[0].module = vertMod;
+	stages[0].pName = "main";
+	stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	stages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vertInput{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAsm{
+		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO};
+	inputAsm.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPipelineViewportStateCreateInfo vpState{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO};
+	vpState.viewportCount = 1;
+	vpState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo raster{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO};
+	raster.polygonMode = VK_POLYGON_MODE_FILL;
+	raster.lineWidth = 1.0f;
+	raster.cullMode = VK_CULL_MODE_NONE;
+
+	VkPipelineMultisampleStateCreateInfo ms{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO};
+	ms.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo ds{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO};
+	ds.depthTestEnable = VK_FALSE;
+	ds.depthWriteEnable = VK_FALSE;
+
+	VkPipelineColorBlendAttachmentState blendAtt{};
+	blendAtt.blendEnable = VK_TRUE;
+	blendAtt.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAtt.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAtt.colorBlendOp = VK_BLEND_OP_ADD;
+	blendAtt.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	blendAtt.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	blendAtt.alphaBlendOp = VK_BLEND_OP_ADD;
+	blendAtt.colorWriteMask =
+		VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+	VkPipelineColorBlendStateCreateInfo blend{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO};
+	blend.attachmentCount = 1;
+	blend.pAttachments = &blendAtt;
+
+	VkDynamicState dynStates[] = {VK_DYNAMIC_STATE_VIEWPORT,
+								  VK_DYNAMIC_STATE_SCISSOR};
+	VkPipelineDynamicStateCreateInfo dyn{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO};
+	dyn.dynamicStateCount = 2;
+	dyn.pDynamicStates = dynStates;
+
+	VkPipelineRenderingCreateInfo rendering = main_pass_formats();
+	VkGraphicsPipelineCreateInfo ci{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
+	ci.pNext = &rendering;
+	ci.stageCount = 2;
+	ci.pStages = stages;
+	ci.pVertexInputState = &vertInput;
+	ci.pInputAssemblyState = &inputAsm;
+	ci.pViewportState = &vpState;
+	ci.pRasterizationState = &raster;
+	ci.pMultisampleState = &ms;
+	ci.pDepthStencilState = &ds;
+	ci.pColorBlendState = &blend;
+	ci.pDynamicState = &dyn;
+
+	auto create = [&](const char* fragPath, VkPipelineLayout layout,
+					  VkPipeline& pipeline)
+	{
+		auto fragCode = packFile_->read(fragPath);
+		VkShaderModule fragMod = create_shader_module(fragCode);
+		stages[1].module = fragMod;
+		ci.layout = layout;
+		VK_CHECK(vkCreateGraphicsPipelines(device_, VK_NULL_HANDLE, 1, &ci,
+										   nullptr, &pipeline));
+		vkDestroyShaderModule(device_, fragMod, nullptr);
+	};
+	if (oitWeightedSupported_)
+		create("shaders/oit_resolve.frag.spv", oitResolvePipelineLayout_,
+			   oitResolvePipeline_);
+	if (oitListSupported_)
+		create("shaders/oit_list_resolve.frag.spv",
+			   oitListResolvePipelineLayout_, oitListResolvePipeline_);
+
+	vkDestroyShaderModule(device_, vertMod, nullptr);
+}
+
+// Every blended mesh in mesh order, into the weighted targets or the
+// linked lists. Called inside the OIT accumulate pass.
+void Renderer::draw_transparent_oit(VkCommandBuffer cmd)
+{
+	bool list = frameTransparency_ == TransparencyMode::LinkedListOit;
+	VkPipelineLayout layout =
+		list ? oitListPipelineLayout_ : pbrPipelineLayout_;
+
+	VkViewport vp{0,
+				  0,
+				  static_cast<float>(renderExtent_.width),
+				  static_cast<float>(renderExtent_.height),
+				  0.0f,
+				  1.0f};
+	vkCmdSetViewport(cmd, 0, 1, &vp);
+
+	VkRect2D scissor{{0, 0}, renderExtent_};
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					  list ? oitListPipeline_ : oitAccumPipeline_);
+
+	// Dynamic rasterizer state (debug toggles); depth is only tested
+	vkCmdSetCullMode(
+		cmd, debugDisableCulling_ ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+	vkCmdSetFrontFace(cmd, debugFrontFace_ == 1
+							   ? VK_FRONT_FACE_CLOCKWISE
+							   : VK_FRONT_FACE_COUNTER_CLOCKWISE);
+	vkCmdSetDepthWriteEnable(cmd, VK_FALSE);
+	vkCmdSetDepthCompareOp(cmd, VK_COMPARE_OP_LESS_OR_EQUAL);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0,
+							1, &frameDescriptorSets_[currentFrame_], 0,
+							nullptr);
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 2,
+							1, &lightDescriptorSets_[currentFrame_], 0,
+							nullptr);
+	if (list)
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout,
+								3, 1, &oitListSets_[currentFrame_], 0,
+								nullptr);
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < static_cast<uint32_t>(meshes_.size()); ++i)
+	{
+		const Mesh& mesh = meshes_[i];
+		if (alpha_mode(mesh) != AlphaMode::Blend) continue;
+		vkCmdBindDescriptorSets(
+			cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1,
+			&materials_[mesh.materialIndex].descriptorSet, 0, nullptr);
+		bind_mesh_buffers(cmd, mesh);
+		vkCmdDrawIndexed(cmd, static_cast<uint32_t>(mesh.indices.size()), 1,
+						 0, 0, i);
+		++count;
+	}
+	transparencyStats_ = {count, 0.0};
+}
+
+// =============================================================================
+// Cleanup helpers
+// =============================================================================
+
+void Renderer::retire_texture(Texture& tex)
+{
+	deletionQueue_.push(submittedFrames_,
+						[device = device_, view = tex.view, image = tex.image,
+						 memory = tex.memory]()
+						{
+							if (view) vkDestroyImageView(device, view, nullptr);
+							if (image) vkDestroyImage(device, image, nullptr);
+							if (memory) vkFreeMemory(device, memory, nullptr);
+						});
+	tex.image = VK_NULL_HANDLE;
+	tex.memory = VK_NULL_HANDLE;
+	tex.view = VK_NULL_HANDLE;
+}
+
 void Renderer::destroy_texture(Texture& tex)
 {
 	if (tex.view) vkDestroyImageView(device_, tex.view, nullptr);
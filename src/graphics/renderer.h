@@ -4,19 +4,29 @@
 #include <GLFW/glfw3.h>
 
 #include <array>
+#include <chrono>
+#include <deque>
 #include <glm/glm.hpp>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "debugLines.h"
+#include "deletionQueue.h"
+#include "gpuProfiler.h"
 #include "light.h"
 #include "material.h"
 #include "mesh.h"
 #include "pak/packfile.h"
+#include "renderGraph.h"
+#include "resolutionScaler.h"
 #include "scene.h"
 #include "texture.h"
+#include "textureResidency.h"
 
 struct Camera;
+struct ThreadPool;
 
 // =============================================================================
 // Forward+ rendering constants
@@ -25,6 +35,17 @@ struct Camera;
 static constexpr uint32_t TILE_SIZE = 16;
 static constexpr uint32_t MAX_LIGHTS_PER_TILE = 256;
 static constexpr uint32_t MAX_LIGHTS = 1024;
+// Tile buffers grow in steps of this many tiles per axis (256 px), so most
+// resizes fit in the existing allocation
+static constexpr uint32_t TILE_CAPACITY_STEP = 16;
+// Instance buffers grow in steps of this many model matrices
+static constexpr uint32_t INSTANCE_CAPACITY_STEP = 256;
+// Skinning compute workgroup size (skinning.comp local_size_x)
+static constexpr uint32_t SKINNING_GROUP_SIZE = 64;
+// Skins posed before update_skinning spreads over the thread pool
+static constexpr uint32_t SKINNING_PARALLEL_MIN_SKINS = 64;
+// Morph compute workgroup size (morph.comp local_size_x)
+static constexpr uint32_t MORPH_GROUP_SIZE = 64;
 
 // =============================================================================
 // Renderer
@@ -32,10 +53,17 @@ static constexpr uint32_t MAX_LIGHTS = 1024;
 
 struct Renderer
 {
-	static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+	// Per-frame resources are allocated for the maximum; how many are
+	// actually cycled through is set at runtime with set_frames_in_flight()
+	static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-	// Lifecycle
+	// Lifecycle. An empty modelPath starts with just the default cube.
 	void init(GLFWwindow* window, const std::string& modelPath);
+	// Offscreen mode: no window, surface or swapchain. Frames render into
+	// MAX_FRAMES_IN_FLIGHT color images that can be read back with
+	// save_frame(). Works on software rasterizers (lavapipe, SwiftShader).
+	void init_headless(uint32_t width, uint32_t height,
+					   const std::string& modelPath);
 	void cleanup();
 
 	// Per-frame rendering
@@ -47,12 +75,53 @@ struct Renderer
 	std::optional<FrameContext> begin_frame();
 	void update_uniforms(const Camera& camera, float time,
 						 const LightEnvironment& lights);
-	void update_debug_lines(const LightEnvironment& lights);
+	// Light wireframes (when showDebugLines_) plus `extra` lines, which are
+	// always drawn (scene load placeholders)
+	void update_debug_lines(const LightEnvironment& lights,
+							std::span<const LineVertex> extra = {});
 	void draw_scene(VkCommandBuffer cmd);
+	// Ends the scene drawing. With dynamic resolution this closes the
+	// low-resolution main pass and upscales, leaving a full-resolution pass
+	// open for overlays (ImGui); otherwise the main pass simply stays open.
+	// end_frame calls it if the caller has not.
+	void finish_scene(const FrameContext& ctx);
 	void end_frame(const FrameContext& ctx);
 
-	// Swapchain
+	// Call before sampling input; marks the start of the latency
+	// measurement. With lowLatencyMode_ it first blocks until the GPU can
+	// take the next frame (the previous present has completed with
+	// VK_KHR_present_wait, or the slot's fence otherwise), so the input
+	// that drives the frame is as fresh as possible.
+	void wait_for_frame();
+
+	// Swapchain. Resizing does not idle the device: the old swapchain is
+	// handed to its replacement and retired objects are destroyed once the
+	// last frame that used them has finished.
 	void notify_resize();
+	// Headless only: render at a new size from the next frame
+	void resize_offscreen(uint32_t width, uint32_t height);
+	uint64_t swapchain_recreations() const { return swapchainRecreations_; }
+	uint64_t tile_buffer_reallocations() const
+	{
+		return tileBufferReallocations_;
+	}
+
+	// Frame pacing. The present mode falls back to FIFO when the surface
+	// does not support the request; it takes effect on the next frame.
+	void set_present_mode(VkPresentModeKHR mode);
+	VkPresentModeKHR present_mode() const { return presentMode_; }
+	bool present_mode_supported(VkPresentModeKHR mode) const;
+	void set_frames_in_flight(uint32_t count);	// 1..MAX_FRAMES_IN_FLIGHT
+	uint32_t frames_in_flight() const { return framesInFlight_; }
+	bool present_wait_enabled() const { return presentWaitEnabled_; }
+	// Input-to-present latency averaged over recent frames, in ms (0 until
+	// measured). Without present_wait the end point is GPU completion.
+	double latency_ms() const;
+
+	// Frame capture (headless only): read back the most recently submitted
+	// frame as tightly packed sRGB RGBA8, or write it to a .png / .exr file.
+	bool read_back_frame(std::vector<uint8_t>& rgba);
+	bool save_frame(const std::string& path);
 
 	// Accessors for App/ImGui
 	const char* gpu_name() const;
@@ -63,7 +132,20 @@ struct Renderer
 	uint32_t vk_graphics_family() const;
 	VkQueue vk_graphics_queue() const;
 	uint32_t swapchain_image_count() const;
-	VkRenderPass vk_render_pass() const;
+	// Attachment formats of the main pass, for pipelines drawn inside it
+	// (dynamic rendering has no render pass object to be compatible with)
+	VkPipelineRenderingCreateInfo main_pass_formats() const;
+	bool headless() const { return headless_; }
+
+	// GPU timings (timestamp queries, a few frames behind)
+	const GpuProfiler& gpu_profiler() const { return gpuProfiler_; }
+	GpuProfiler& gpu_profiler() { return gpuProfiler_; }
+
+	// Pass/barrier/transient counts of the last recorded frame
+	const RenderGraph::Stats& render_graph_stats() const
+	{
+		return graphStats_;
+	}
 
 	// Heatmap toggle (controlled from ImGui)
 	bool showHeatmap_ = false;
@@ -71,14 +153,141 @@ struct Renderer
 	// Debug line visualization toggle (controlled from ImGui)
 	bool showDebugLines_ = true;
 
+	// Low-latency wait toggle (controlled from ImGui)
+	bool lowLatencyMode_ = false;
+
+	// Light culling on the async compute queue (controlled from ImGui).
+	// Ignored when the device has no separate compute queue family.
+	bool asyncCompute_ = false;
+	bool async_compute_supported() const { return asyncComputeSupported_; }
+
+	// GPU picking (controlled from ImGui). While enabled, the depth prepass
+	// also writes each pixel's mesh index to an object ID image, and
+	// request_pick() copies one pixel of it back. The result arrives once
+	// that frame has finished on the GPU, a frame or more later, so the
+	// cost does not grow with the scene.
+	bool gpuPicking_ = false;
+	// Window pixel coordinates; replaces a request not yet recorded
+	void request_pick(uint32_t x, uint32_t y);
+	// True once per completed request; meshIndex is empty on background
+	bool pick_result(std::optional<uint32_t>& meshIndex);
+
+	// Dynamic resolution (controlled from ImGui). Depth prepass, light
+	// culling and shading run at render_extent(), chosen by the scaler from
+	// GPU frame times, and a temporal (TAA) pass reconstructs the output
+	// resolution from jittered frames. Needs timestamp support to scale;
+	// without it the scale stays at resolutionScaler_.maxScale.
+	bool dynamicResolution_ = false;
+	ResolutionScaler resolutionScaler_;
+	VkExtent2D render_extent() const { return renderExtent_; }
+
+	// Texture streaming (controlled from ImGui). Only the mip levels the
+	// screen needs stay resident, within textureResidency_.budgetBytes.
+	// The need is estimated from the screen size of each mesh's bounds,
+	// placed by meshWorlds (indexed like meshes(); a zero matrix skips the
+	// mesh), which may be empty to keep the last estimate. Call before
+	// begin_frame. Switched off, textures return to full residency.
+	bool textureStreaming_ = false;
+	TextureResidency textureResidency_;
+	void update_texture_streaming(std::span<const glm::mat4> meshWorlds);
+	uint64_t texture_memory() const
+	{
+		return TextureResidency::resident_bytes(textures_);
+	}
+
+	// Animation playback (controlled from ImGui). update_animation()
+	// advances and samples every animation set; the caller then copies
+	// the poses of animated meshes into its scene graph, and
+	// update_skinning() poses animated skins from them. Call before
+	// update_skinning.
+	struct AnimationStats
+	{
+		uint32_t sets = 0;
+		uint32_t nodes = 0;	 // driven by a channel of the playing clip
+		double cpuMs = 0.0;
+	};
+	bool animationPaused_ = false;
+	float animationSpeed_ = 1.0f;
+	void update_animation(float dt, ThreadPool* pool = nullptr);
+	std::vector<AnimationSet>& animations() { return animations_; }
+	// Of the last update_animation(); zero while paused
+	const AnimationStats& animation_stats() const { return animationStats_; }
+
 	// Debug toggles (controlled from ImGui)
 	bool debugSkipDepthPrepass_ = false;
 	bool debugDisableCulling_ = false;
 	int debugFrontFace_ = 0;  // 0=CCW, 1=CW
 
+	// Model matrices of this frame, one per mesh and indexed like meshes().
+	// The vertex shaders fetch them with gl_InstanceIndex, so write them
+	// between begin_frame and end_frame; entries not written keep the
+	// value last written to this frame slot's buffer.
+	std::span<glm::mat4> instance_transforms();
+	uint32_t frame_slot() const { return currentFrame_; }
+
 	// Scene accessors (for selection / gizmo)
 	const std::vector<Mesh>& meshes() const { return meshes_; }
 	std::vector<Mesh>& meshes() { return meshes_; }
+	const std::vector<Skin>& skins() const { return skins_; }
+
+	// GPU skinning. Writes this frame's joint matrices for every skin
+	// (spread over the pool when there are many) and lists the morph
+	// targets with a non-zero weight; compute passes before the depth
+	// prepass then blend those targets and pose all skinned and morphed
+	// meshes at once. Call between begin_frame and end_frame.
+	void update_skinning(ThreadPool* pool = nullptr);
+	uint32_t skinned_vertex_count() const { return skinnedVertexCount_; }
+	uint32_t joint_count() const { return jointCount_; }
+	struct MorphStats
+	{
+		uint32_t targets = 0;
+		uint32_t deltas = 0;  // moved vertices, summed over targets
+		uint32_t activeTargets = 0;
+		uint32_t activeDeltas = 0;
+	};
+	// Of the last update_skinning()
+	const MorphStats& morph_stats() const { return morphStats_; }
+
+	// Transparency (mode controlled from ImGui). Sorted draws blended
+	// (glTF BLEND) meshes after the opaque and alpha-tested ones, back to
+	// front: each frame the caller passes the world transform of every
+	// blended mesh it places, and they are radix sorted on the view depth
+	// of their bounds' center. Blended meshes the caller does not pass are
+	// not drawn. Call between begin_frame and draw_scene.
+	// The order-independent modes need no sort and no call: every blended
+	// mesh is drawn in any order into targets of its own after light
+	// culling, and the main pass composites them over the opaque scene.
+	// WeightedOit is weighted blended OIT, an approximation that holds up
+	// for intersecting surfaces. LinkedListOit keeps per-pixel lists of
+	// fragments and sorts them on the GPU, exact up to 16 layers per pixel;
+	// its node buffer is large, so it is meant for checking the former.
+	// Unsupported modes, and all of them while no material blends, fall
+	// back to Sorted.
+	enum class TransparencyMode : uint8_t
+	{
+		Sorted,
+		WeightedOit,
+		LinkedListOit,
+	};
+	TransparencyMode transparencyMode_ = TransparencyMode::Sorted;
+	bool transparency_mode_supported(TransparencyMode mode) const;
+	// The mode of the frame being recorded, after fallbacks
+	TransparencyMode transparency_mode() const { return frameTransparency_; }
+	bool has_blended_materials() const;
+	bool blended(uint32_t meshIndex) const;
+	void sort_transparent(std::span<const uint32_t> meshes,
+						  std::span<const glm::mat4> worlds,
+						  const glm::mat4& view);
+	struct TransparencyStats
+	{
+		uint32_t meshes = 0;
+		double sortMs = 0.0;  // zero in the order-independent modes
+	};
+	// Of the last frame's blended draws
+	const TransparencyStats& transparency_stats() const
+	{
+		return transparencyStats_;
+	}
 	const glm::mat4& last_view() const { return lastView_; }
 	const glm::mat4& last_proj() const { return lastProj_; }
 
@@ -87,14 +296,30 @@ struct Renderer
 	void unload_scene();
 	void load_scene_empty();
 	void import_gltf(const std::string& path);
-	void delete_mesh(uint32_t meshIdx);
+	// Appends scenes already parsed by load_gltf (on any thread), in order:
+	// one device wait, one upload submission and one descriptor rebuild
+	// for all of them. paths[i] is recorded as scenes[i]'s mesh source.
+	// With a textureSizeLimit, larger textures start with only the mip
+	// levels that fit; upgrade_textures() or streaming adds the rest.
+	void import_scenes(std::span<Scene> scenes,
+					   std::span<const std::string> paths,
+					   uint32_t textureSizeLimit = 0);
+	// Uploads up to maxCount textures that lack their finer levels at full
+	// size in one batch; returns how many are left
+	uint32_t upgrade_textures(uint32_t maxCount);
+	// Removes every mesh whose meshRemap entry is UINT32_MAX (the old ->
+	// new index table of a multi-delete; the others keep their order),
+	// with the materials, textures, skins and animations only they used.
+	// One device wait and one descriptor rebuild for the whole batch.
+	void delete_meshes(const std::vector<uint32_t>& meshRemap);
 
    private:
 	// Asset pack
 	std::optional<pak::PackFile> packFile_;
 
-	// Window (non-owning)
+	// Window (non-owning, null in headless mode)
 	GLFWwindow* window_ = nullptr;
+	bool headless_ = false;
 
 	// Core Vulkan
 	VkInstance instance_ = VK_NULL_HANDLE;
@@ -107,39 +332,214 @@ struct Renderer
 	uint32_t graphicsFamily_ = 0;
 	uint32_t presentFamily_ = 0;
 
+	// Async compute: a compute-only queue family plus timeline semaphores
+	bool asyncComputeSupported_ = false;
+	uint32_t computeFamily_ = 0;
+	VkQueue computeQueue_ = VK_NULL_HANDLE;
+
 	// Swapchain
 	VkSwapchainKHR swapchain_ = VK_NULL_HANDLE;
+	VkPresentModeKHR requestedPresentMode_ = VK_PRESENT_MODE_MAILBOX_KHR;
+	VkPresentModeKHR presentMode_ = VK_PRESENT_MODE_FIFO_KHR;
+	std::vector<VkPresentModeKHR> supportedPresentModes_;
+	bool swapchainDirty_ = false;  // present mode changed
 	VkFormat swapchainFormat_{};
 	VkExtent2D swapchainExtent_{};
 	std::vector<VkImage> swapchainImages_;
 	std::vector<VkImageView> swapchainImageViews_;
 
+	// Headless render targets (stand in for the swapchain images)
+	std::vector<VkDeviceMemory> offscreenMemory_;
+	std::optional<uint32_t> lastImageIndex_;
+
 	// Depth
 	VkImage depthImage_ = VK_NULL_HANDLE;
 	VkDeviceMemory depthMemory_ = VK_NULL_HANDLE;
 	VkImageView depthView_ = VK_NULL_HANDLE;
+	VkFormat depthFormat_ = VK_FORMAT_UNDEFINED;
 	VkSampler depthSampler_ = VK_NULL_HANDLE;
 
-	// Render passes
-	VkRenderPass renderPass_ = VK_NULL_HANDLE;
-	VkRenderPass depthOnlyRenderPass_ = VK_NULL_HANDLE;
+	// Dynamic resolution. Depth and the scene color are allocated at the
+	// output size and rendered into their top-left renderExtent_ part, so a
+	// new scale never reallocates.
+	VkExtent2D renderExtent_{};
+	uint64_t lastScaledGpuFrame_ = 0;  // GPU timing the scaler last saw
+
+	// Temporal upscaling. The resolve writes historyImages_[historyIndex_]
+	// from the scene color and the other history image, then the output
+	// pass copies it to the target.
+	static constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	static constexpr float TAA_HISTORY_WEIGHT = 0.9f;
+	static constexpr uint32_t TAA_JITTER_PHASES = 8;
+	VkImage historyImages_[2] = {};
+	VkDeviceMemory historyMemory_[2] = {};
+	VkImageView historyViews_[2] = {};
+	bool historyInitialized_[2] = {};  // written at least once
+	bool historyValid_ = false;	 // holds the previous frame's output
+	uint32_t historyIndex_ = 0;
+	uint32_t taaJitterIndex_ = 0;
+	glm::vec2 taaJitter_{0.0f};	 // NDC offset of this frame's projection
+	glm::mat4 prevViewProj_{1.0f};
+	glm::mat4 taaReprojection_{1.0f};  // clip -> previous frame's clip
+	VkSampler taaSampler_ = VK_NULL_HANDLE;
+	VkDescriptorSetLayout taaSetLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout taaPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline taaResolvePipeline_ = VK_NULL_HANDLE;
+	VkPipeline taaOutputPipeline_ = VK_NULL_HANDLE;
+	VkDescriptorPool taaDescriptorPool_ = VK_NULL_HANDLE;
+	VkDescriptorSet taaResolveSets_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDescriptorSet taaOutputSets_[MAX_FRAMES_IN_FLIGHT] = {};
+	struct TaaPushConstants
+	{
+		glm::mat4 reprojection;
+		glm::vec2 jitterUV;
+		glm::vec2 renderScale;
+		glm::vec2 renderTexel;
+		float historyWeight;
+	};
 
-	// Depth pre-pass
-	VkFramebuffer depthOnlyFramebuffer_ = VK_NULL_HANDLE;
+	// Depth pre-pass. The object ID variant adds a fragment shader writing
+	// mesh index + 1 (0 = background) to an R32_UINT attachment. The mask
+	// variants of both discard alpha-tested texels (alpha_mask.frag);
+	// opaque meshes stay on the vertex-only pipeline and keep early-Z.
+	// Blended meshes are left out.
 	VkPipelineLayout depthPrepassPipelineLayout_ = VK_NULL_HANDLE;
 	VkPipeline depthPrepassPipeline_ = VK_NULL_HANDLE;
+	VkPipeline objectIdPipeline_ = VK_NULL_HANDLE;
+	VkPipeline depthMaskPipeline_ = VK_NULL_HANDLE;
+	VkPipeline objectIdMaskPipeline_ = VK_NULL_HANDLE;
+	static constexpr VkFormat OBJECT_ID_FORMAT = VK_FORMAT_R32_UINT;
+
+	// GPU picking: one host-visible texel per frame slot, read once the
+	// slot's fence has signalled
+	VkBuffer pickBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory pickMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	uint32_t* pickMapped_[MAX_FRAMES_IN_FLIGHT] = {};
+	bool pickInFlight_[MAX_FRAMES_IN_FLIGHT] = {};
+	std::optional<VkOffset2D> pickRequest_;	 // window pixels
+	bool pickReady_ = false;
+	uint32_t pickValue_ = 0;  // as written by the shader
 
 	// PBR pipeline
 	VkDescriptorSetLayout frameSetLayout_ = VK_NULL_HANDLE;
 	VkDescriptorSetLayout materialSetLayout_ = VK_NULL_HANDLE;
 	VkDescriptorSetLayout lightDataSetLayout_ = VK_NULL_HANDLE;
 	VkPipelineLayout pbrPipelineLayout_ = VK_NULL_HANDLE;
+	// One per AlphaMode, from pbr.frag's ALPHA_MODE specialization
 	VkPipeline pbrPipeline_ = VK_NULL_HANDLE;
+	VkPipeline pbrMaskPipeline_ = VK_NULL_HANDLE;
+	VkPipeline pbrBlendPipeline_ = VK_NULL_HANDLE;
+
+	// Blended meshes of this frame, back to front (sort_transparent)
+	std::vector<uint32_t> transparentOrder_;
+	std::vector<uint32_t> transparentKeys_;
+	std::vector<uint32_t> sortScratch_;
+	TransparencyStats transparencyStats_;
+
+	// Order-independent transparency. The targets are graph transients
+	// at the output size: accumulation + revealage for the weighted mode,
+	// list heads + nodes for the linked lists. Their sets are rewritten
+	// every frame, and the list pipeline adds its set as set 3 to the PBR
+	// sets. Each mode has an accumulation pipeline (pbr.vert with
+	// oit_accum.frag / oit_list.frag) and a fullscreen resolve pipeline
+	// that composites in the main pass.
+	static constexpr VkFormat OIT_ACCUM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+	static constexpr VkFormat OIT_REVEALAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
+	static constexpr VkFormat OIT_HEADS_FORMAT = VK_FORMAT_R32_UINT;
+	// Nodes per output pixel, and the sizes of a node and of the counter
+	// in front of them (oit_list.frag)
+	static constexpr uint32_t OIT_LIST_NODES_PER_PIXEL = 4;
+	static constexpr VkDeviceSize OIT_LIST_NODE_SIZE = 16;
+	static constexpr VkDeviceSize OIT_LIST_HEADER_SIZE = 16;
+	bool oitWeightedSupported_ = false;	 // independentBlend
+	bool oitListSupported_ = false;		 // fragmentStoresAndAtomics
+	VkDescriptorSetLayout oitResolveSetLayout_ = VK_NULL_HANDLE;
+	VkDescriptorSetLayout oitListSetLayout_ = VK_NULL_HANDLE;
+	VkDescriptorPool oitDescriptorPool_ = VK_NULL_HANDLE;
+	VkDescriptorSet oitResolveSets_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDescriptorSet oitListSets_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkPipelineLayout oitListPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout oitResolvePipelineLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout oitListResolvePipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline oitAccumPipeline_ = VK_NULL_HANDLE;
+	VkPipeline oitListPipeline_ = VK_NULL_HANDLE;
+	VkPipeline oitResolvePipeline_ = VK_NULL_HANDLE;
+	VkPipeline oitListResolvePipeline_ = VK_NULL_HANDLE;
 
 	// Light culling compute
 	VkPipelineLayout computePipelineLayout_ = VK_NULL_HANDLE;
 	VkPipeline lightCullPipeline_ = VK_NULL_HANDLE;
 
+	// GPU skinning. The bind-pose vertices and influences of all skinned
+	// and morphed meshes are packed into two buffers, their joint indices
+	// rebased onto one array holding every skin's joint matrices, so one
+	// dispatch poses them all into the frame slot's skinned vertex buffer.
+	// Morph-only meshes get no influences, which the shader takes as the
+	// identity. Rebuilt with the device idle whenever such meshes come or
+	// go.
+	std::vector<Skin> skins_;
+	std::vector<uint32_t> skinJointOffsets_;  // per skin, in joints
+	uint32_t jointCount_ = 0;
+	uint32_t skinnedVertexCount_ = 0;
+	VkBuffer bindPoseBuffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory bindPoseMemory_ = VK_NULL_HANDLE;
+	VkBuffer influenceBuffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory influenceMemory_ = VK_NULL_HANDLE;
+	VkBuffer jointBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory jointMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	glm::mat4* jointMapped_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkBuffer skinnedVertexBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory skinnedVertexMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDescriptorSetLayout skinningSetLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout skinningPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline skinningPipeline_ = VK_NULL_HANDLE;
+	VkDescriptorPool skinningDescriptorPool_ = VK_NULL_HANDLE;
+	VkDescriptorSet skinningSets_[MAX_FRAMES_IN_FLIGHT] = {};
+
+	// Morph targets. Morphed meshes are packed first, so their vertices
+	// are the first morphVertexCount_ of the bind pose; every target's
+	// deltas sit back to back in one buffer, rebased onto those vertices.
+	// Each frame the targets with a non-zero weight are listed in the
+	// slot's active buffer, and one dispatch over just their deltas adds
+	// them up in the slot's accumulator (9 fixed-point ints per vertex:
+	// position, normal, tangent), which the skinning pass reads and clears.
+	struct MorphRange
+	{
+		uint32_t mesh = 0;
+		uint32_t target = 0;
+		uint32_t firstDelta = 0;
+		uint32_t deltaCount = 0;
+	};
+	// As morph.comp reads it; `start` is the sum of earlier deltaCounts
+	struct MorphActive
+	{
+		uint32_t firstDelta = 0;
+		uint32_t deltaCount = 0;
+		uint32_t start = 0;
+		float weight = 0.0f;
+	};
+	std::vector<MorphRange> morphRanges_;
+	uint32_t morphVertexCount_ = 0;
+	uint32_t activeMorphCount_ = 0;	 // this frame's active targets
+	MorphStats morphStats_;
+	VkBuffer morphDeltaBuffer_ = VK_NULL_HANDLE;
+	VkDeviceMemory morphDeltaMemory_ = VK_NULL_HANDLE;
+	VkBuffer morphActiveBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory morphActiveMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	MorphActive* morphActiveMapped_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkBuffer morphAccumBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory morphAccumMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDescriptorSetLayout morphSetLayout_ = VK_NULL_HANDLE;
+	VkPipelineLayout morphPipelineLayout_ = VK_NULL_HANDLE;
+	VkPipeline morphPipeline_ = VK_NULL_HANDLE;
+	VkDescriptorPool morphDescriptorPool_ = VK_NULL_HANDLE;
+	VkDescriptorSet morphSets_[MAX_FRAMES_IN_FLIGHT] = {};
+
+	// Animation sets of the loaded glTF files, indexed by Mesh::animation
+	// and Skin::animation
+	std::vector<AnimationSet> animations_;
+	AnimationStats animationStats_;
+
 	// Heatmap debug overlay
 	VkPipelineLayout heatmapPipelineLayout_ = VK_NULL_HANDLE;
 	VkPipeline heatmapPipeline_ = VK_NULL_HANDLE;
@@ -151,6 +551,8 @@ struct Renderer
 	VkDeviceMemory debugLineVertexMemory_[MAX_FRAMES_IN_FLIGHT] = {};
 	void* debugLineVertexMapped_[MAX_FRAMES_IN_FLIGHT] = {};
 	uint32_t debugLineVertexCount_ = 0;
+	// Per frame: ~43k line vertices, room for lights plus load placeholders
+	static constexpr VkDeviceSize DEBUG_LINE_BUFFER_SIZE = 1024 * 1024;
 
 	// Light / tile SSBOs (per frame-in-flight)
 	std::vector<VkBuffer> lightSSBOs_;
@@ -158,20 +560,52 @@ struct Renderer
 	std::vector<void*> lightSSBOMapped_;
 	std::vector<VkBuffer> tileLightSSBOs_;
 	std::vector<VkDeviceMemory> tileLightSSBOMemory_;
+	uint32_t tileLightCapacity_[MAX_FRAMES_IN_FLIGHT] = {};	 // in tiles
 	uint32_t tileCountX_ = 0;
 	uint32_t tileCountY_ = 0;
+	uint64_t tileBufferReallocations_ = 0;
 
-	// Light data descriptors (per frame-in-flight)
+	// Instance SSBOs (per frame-in-flight): one model matrix per mesh, at
+	// set 0 binding 1
+	VkBuffer instanceBuffers_[MAX_FRAMES_IN_FLIGHT] = {};
+	VkDeviceMemory instanceMemory_[MAX_FRAMES_IN_FLIGHT] = {};
+	glm::mat4* instanceMapped_[MAX_FRAMES_IN_FLIGHT] = {};
+	uint32_t instanceCapacity_[MAX_FRAMES_IN_FLIGHT] = {};	// in matrices
+
+	// Light data descriptors (per frame-in-flight). A slot's set is only
+	// rewritten once its fence has signalled, so a resize marks it dirty.
 	VkDescriptorPool lightDescriptorPool_ = VK_NULL_HANDLE;
 	std::vector<VkDescriptorSet> lightDescriptorSets_;
-
-	// Framebuffers
-	std::vector<VkFramebuffer> framebuffers_;
+	bool lightSetDirty_[MAX_FRAMES_IN_FLIGHT] = {};
 
 	// Commands
 	VkCommandPool commandPool_ = VK_NULL_HANDLE;
 	std::vector<VkCommandBuffer> commandBuffers_;
 
+	// Frame graph, one per frame in flight so transients are only touched
+	// once that slot's fence has signalled
+	RenderGraph frameGraphs_[MAX_FRAMES_IN_FLIGHT];
+	RenderGraph::Stats graphStats_;
+
+	// Each graph segment but the last (which records into commandBuffers_)
+	// gets its own command buffer on its queue, indexed
+	// [slot * MAX_GRAPH_SEGMENTS + segment]. Segments are submitted in
+	// order, chained through one timeline semaphore.
+	static constexpr uint32_t MAX_GRAPH_SEGMENTS = 4;
+	VkCommandPool computeCommandPool_ = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> graphicsSegmentBuffers_;
+	std::vector<VkCommandBuffer> computeSegmentBuffers_;
+	VkSemaphore segmentTimeline_ = VK_NULL_HANDLE;
+	uint64_t segmentTimelineValue_ = 0;
+	bool frameAsync_ = false;  // asyncCompute_, latched in begin_frame
+	bool frameSkipPrepass_ = false;	 // debugSkipDepthPrepass_, likewise
+	bool frameTaa_ = false;			 // dynamicResolution_, likewise
+	bool frameObjectIds_ = false;	 // gpuPicking_, likewise
+	TransparencyMode frameTransparency_ = TransparencyMode::Sorted;
+	std::optional<VkOffset2D> framePick_;  // render pixels to copy back
+	bool frameSceneOpen_ = false;	 // finish_scene still to run
+	uint32_t frameMainPass_ = RenderGraph::NO_PASS;
+
 	// PBR sampler
 	VkSampler pbrSampler_ = VK_NULL_HANDLE;
 
@@ -212,26 +646,60 @@ struct Renderer
 	std::vector<VkSemaphore> renderFinishedSemaphores_;
 	std::vector<VkFence> inFlightFences_;
 
+	// GPU timestamp scopes
+	GpuProfiler gpuProfiler_;
+
 	// Cached view/proj for picking/gizmo
 	glm::mat4 lastView_{1.0f};
 	glm::mat4 lastProj_{1.0f};
 
+	// Present wait (VK_KHR_present_id + VK_KHR_present_wait)
+	bool presentWaitEnabled_ = false;
+	PFN_vkWaitForPresentKHR vkWaitForPresent_ = nullptr;
+	uint64_t presentId_ = 0;
+
+	// Latency tracking. Records are resolved oldest-first: on present
+	// completion when present wait is enabled, else on the frame's fence.
+	using Clock = std::chrono::steady_clock;
+	struct LatencyRecord
+	{
+		Clock::time_point inputTime;
+		uint64_t presentId = 0;	 // 0 = resolve on the fence of `slot`
+		uint32_t slot = 0;
+	};
+	std::deque<LatencyRecord> latencyQueue_;
+	Clock::time_point inputTime_ = Clock::now();
+	static constexpr uint32_t LATENCY_HISTORY = 64;
+	double latencySamples_[LATENCY_HISTORY] = {};
+	uint64_t latencyCount_ = 0;
+	void poll_latency();
+
 	// State
 	uint32_t currentFrame_ = 0;
+	uint32_t framesInFlight_ = 2;
 	bool framebufferResized_ = false;
+	VkExtent2D requestedOffscreenExtent_{};	 // headless resize, 0 = none
+	uint64_t swapchainRecreations_ = 0;
+
+	// Frames are numbered in submission order; slotFrame_ is the last one
+	// submitted in each slot, complete once that slot's fence signals
+	uint64_t submittedFrames_ = 0;
+	uint64_t slotFrame_[MAX_FRAMES_IN_FLIGHT] = {};
+	DeletionQueue deletionQueue_;
+	bool anisotropySupported_ = false;
 	char gpuName_[256] = {};
 
 	// Vulkan setup
+	void init_resources(const std::string& modelPath);
 	void create_instance();
 	void setup_debug_messenger();
 	void create_surface();
 	void pick_physical_device();
 	void create_logical_device();
 	void create_swapchain();
+	void create_offscreen_targets();
 	void create_image_views();
-	void create_render_pass();
 	void create_depth_resources();
-	void create_framebuffers();
 	void create_command_pool();
 	void create_command_buffers();
 	void create_sync_objects();
@@ -244,28 +712,76 @@ struct Renderer
 	void create_uniform_buffers();
 	void create_frame_descriptor_pool();
 	void create_frame_descriptor_sets();
+	void create_instance_buffer(uint32_t slot, uint32_t capacity);
+	void create_pick_buffers();
+	void drop_picks();
+	void ensure_instance_capacity(uint32_t slot);
+	void update_instance_descriptor(uint32_t slot);
 
 	// Forward+ setup
-	void create_depth_only_render_pass();
-	void create_depth_only_framebuffer();
 	void create_depth_prepass_pipeline();
 	void create_light_data_set_layout();
 	void create_light_buffers();
 	void create_light_descriptor_pool();
 	void create_light_descriptor_sets();
+	void update_light_descriptor_set(uint32_t slot);
+	void create_tile_light_buffer(uint32_t slot);
+	void ensure_tile_light_capacity(uint32_t slot);
 	void create_compute_pipeline();
+	void create_skinning_pipeline();
+	void create_morph_pipeline();
 	void create_heatmap_pipeline();
 	void create_debug_line_pipeline();
 	void create_debug_line_buffers();
 
+	// Dynamic resolution / temporal upscaling
+	void create_history_images();
+	void create_taa_descriptors();
+	void create_taa_pipelines();
+	void update_render_extent();
+	void update_taa_descriptor_sets(VkImageView sceneColor);
+
+	// Order-independent transparency
+	void create_oit_descriptors();
+	void create_oit_pipelines();
+	// Targets: accumulation + revealage, or list heads + nodes
+	void update_oit_descriptor_sets(
+		const RenderGraph& graph,
+		const std::array<RenderGraph::Resource, 2>& targets);
+	void draw_transparent_oit(VkCommandBuffer cmd);
+
+	// GPU skinning
+	void rebuild_skinning();
+	void destroy_skinning_buffers();
+	void dispatch_skinning(VkCommandBuffer cmd);
+	void update_morph_weights();
+	void dispatch_morph(VkCommandBuffer cmd);
+
 	// Forward+ per-frame
-	void draw_depth_prepass(VkCommandBuffer cmd);
+	// Vertex and index buffers of a mesh; skinned meshes read this frame
+	// slot's skinned vertex buffer
+	void bind_mesh_buffers(VkCommandBuffer cmd, const Mesh& mesh);
+	// Opaque for meshes without a valid material
+	AlphaMode alpha_mode(const Mesh& mesh) const;
+	void draw_depth_prepass(VkCommandBuffer cmd, bool objectIds);
+	void dispatch_light_cull(VkCommandBuffer cmd, bool async);
+	void build_frame_graph(RenderGraph& graph, uint32_t imageIndex);
+	VkCommandBuffer segment_command_buffer(RenderGraph::Queue queue,
+										   uint32_t segment);
+	void submit_frame_graph(uint32_t imageIndex);
 
 	// Scene helpers
 	void add_cube_to_scene(Scene& scene);
 
 	// Texture upload
-	void upload_texture(Texture& tex);
+	// baseMip: upload only levels [baseMip, mip_count()), from a CPU copy
+	// of that level
+	void upload_texture(Texture& tex, uint32_t baseMip = 0);
+	// Re-uploads textures at new base levels and gives the materials that
+	// sample them new sets, without waiting for frames in flight
+	void apply_texture_changes(
+		std::span<const TextureResidency::Change> changes);
+	void request_texture_mips(std::span<const glm::mat4> meshWorlds);
 	void generate_mipmaps(VkImage image, VkFormat format, uint32_t width,
 						  uint32_t height, uint32_t mipLevels);
 
@@ -275,20 +791,37 @@ struct Renderer
 	// Material descriptors
 	void create_material_descriptor_pool(uint32_t materialCount);
 	void create_material_descriptor(Material& mat);
+	VkDescriptorSet allocate_material_set();
+	// Factor and image bindings; the set must not be in use by the GPU
+	void write_material_set(const Material& mat);
 	void rebuild_material_descriptors();
 
 	// Swapchain management
 	void recreate_swapchain();
 	void cleanup_swapchain();
+	void retire_swapchain_resources();
 
 	// Helpers
 	uint32_t find_memory_type(uint32_t filter, VkMemoryPropertyFlags props);
+	// computeShared: also read on the async compute queue (concurrent
+	// sharing, so host-written data needs no ownership transfers)
 	void create_buffer(VkDeviceSize size, VkBufferUsageFlags usage,
 					   VkMemoryPropertyFlags props, VkBuffer& buffer,
-					   VkDeviceMemory& memory);
+					   VkDeviceMemory& memory, bool computeShared = false);
 	void copy_buffer(VkBuffer src, VkBuffer dst, VkDeviceSize size);
 	VkCommandBuffer begin_single_time_commands();
 	void end_single_time_commands(VkCommandBuffer cmd);
+	// While an upload batch is open, single-time commands all record into
+	// one command buffer (separated by barriers) and staging buffers are
+	// freed once it has run, so a whole import costs one submit and wait
+	VkCommandBuffer uploadBatchCmd_ = VK_NULL_HANDLE;
+	std::vector<std::pair<VkBuffer, VkDeviceMemory>> uploadBatchStaging_;
+	void begin_upload_batch();
+	void end_upload_batch();
+	// Submits the batch without waiting; its command buffer and staging
+	// buffers retire with the next frame
+	void submit_upload_batch();
+	void destroy_staging(VkBuffer buffer, VkDeviceMemory memory);
 	VkImageView create_image_view(VkImage image, VkFormat format,
 								  VkImageAspectFlags aspect,
 								  uint32_t mipLevels = 1);
@@ -298,5 +831,7 @@ struct Renderer
 	VkFormat find_depth_format();
 	VkShaderModule create_shader_module(const std::vector<char>& code);
 	void destroy_texture(Texture& tex);
+	// Destroyed once the frames submitted so far have finished
+	void retire_texture(Texture& tex);
 	void cleanup_light_buffers();
 };
@@ -0,0 +1,32 @@
+#include "resolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+float ResolutionScaler::update(double gpuMs)
+{
+	if (gpuMs <= 0.0 || targetGpuMs <= 0.0f) return scale_;
+
+	filteredMs_ = filteredMs_ > 0.0
+					  ? filteredMs_ + SMOOTHING * (gpuMs - filteredMs_)
+					  : gpuMs;
+
+	double ratio = targetGpuMs / filteredMs_;
+	if (std::abs(ratio - 1.0) > DEAD_BAND)
+	{
+		float ideal = scale_ * static_cast<float>(std::sqrt(ratio));
+		float next = scale_ + RESPONSE * (ideal - scale_);
+		next = std::round(next / QUANTUM) * QUANTUM;
+		// Outside the dead band it always moves at least one quantum
+		if (next == scale_) next += ideal > scale_ ? QUANTUM : -QUANTUM;
+		scale_ = next;
+	}
+	scale_ = std::clamp(scale_, minScale, maxScale);
+	return scale_;
+}
+
+void ResolutionScaler::reset()
+{
+	scale_ = maxScale;
+	filteredMs_ = 0.0;
+}
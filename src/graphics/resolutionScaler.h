@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+// =============================================================================
+// Resolution scaler
+// =============================================================================
+
+// Picks the internal render scale (per axis, relative to the output) from
+// measured GPU frame times. Fragment cost is roughly proportional to pixel
+// count, so the scale that meets the target is the current one times
+// sqrt(target / measured). The measurement is smoothed and the scale only
+// moves part of the way each update, with a dead band around the target, so
+// it settles instead of oscillating on noisy timings that arrive a few
+// frames late.
+struct ResolutionScaler
+{
+	float targetGpuMs = 16.6f;
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+
+	// One completed frame's GPU time. Returns the new scale.
+	float update(double gpuMs);
+	// Back to full resolution with no timing history
+	void reset();
+
+	float scale() const { return scale_; }
+	double filtered_gpu_ms() const { return filteredMs_; }
+
+   private:
+	static constexpr double SMOOTHING = 0.15;	// weight of a new sample
+	static constexpr double DEAD_BAND = 0.05;	// +-5% of the target
+	static constexpr float RESPONSE = 0.25f;	// share of the step taken
+	static constexpr float QUANTUM = 1.0f / 64;	 // avoids tiny rescales
+
+	float scale_ = 1.0f;
+	double filteredMs_ = 0.0;
+};
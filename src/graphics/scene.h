@@ -2,9 +2,11 @@
 
 #include <vector>
 
+#include "animation.h"
 #include "light.h"
 #include "material.h"
 #include "mesh.h"
+#include "skin.h"
 #include "texture.h"
 
 struct Scene
@@ -12,5 +14,8 @@ struct Scene
 	std::vector<Mesh> meshes;
 	std::vector<Material> materials;
 	std::vector<Texture> textures;
+	std::vector<Skin> skins;
+	// One per glTF file with animations
+	std::vector<AnimationSet> animations;
 	LightEnvironment lights;
 };
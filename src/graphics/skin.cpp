@@ -0,0 +1,46 @@
+#include "skin.h"
+
+#include <algorithm>
+
+void Skin::sort_joints()
+{
+	// Depth in the hierarchy; a stable sort by it puts parents first
+	std::vector<uint32_t> depth(joints.size(), 0);
+	for (size_t i = 0; i < joints.size(); ++i)
+		for (int32_t p = joints[i].parent;
+			 p >= 0 && depth[i] < joints.size(); p = joints[p].parent)
+			++depth[i];
+
+	order.resize(joints.size());
+	for (uint32_t i = 0; i < static_cast<uint32_t>(order.size()); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(),
+					 [&](uint32_t a, uint32_t b)
+					 { return depth[a] < depth[b]; });
+}
+
+void Skin::joint_matrices(std::span<const glm::mat4> locals,
+						  std::span<glm::mat4> out) const
+{
+	// Model-space poses first, so children can read their parent's ...
+	for (uint32_t j : order)
+	{
+		const SkinJoint& joint = joints[j];
+		const glm::mat4& local =
+			locals.empty() ? joint.localTransform : locals[j];
+		out[j] = (joint.parent >= 0 ? out[joint.parent]
+									: joint.parentTransform) *
+				 local;
+	}
+	// ... then the bind pose is removed from each
+	for (size_t j = 0; j < joints.size(); ++j)
+		out[j] = out[j] * joints[j].inverseBind;
+}
+
+void Skin::animated_joint_matrices(std::span<const glm::mat4> globals,
+								   std::span<glm::mat4> out) const
+{
+	// The set already walked the hierarchy, joints or not
+	for (size_t j = 0; j < joints.size(); ++j)
+		out[j] = globals[joints[j].node] * joints[j].inverseBind;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// =============================================================================
+// Skin
+// =============================================================================
+
+// A glTF skin: the joint hierarchy that deforms skinned meshes. Joints keep
+// the order of the glTF skin, which is what Mesh::influences index.
+struct SkinJoint
+{
+	std::string name;
+	int32_t parent = -1;  // joint index, -1 for a root
+	// Roots only: model-space transform of the glTF node above the joint
+	glm::mat4 parentTransform{1.0f};
+	glm::mat4 localTransform{1.0f};	 // rest pose, relative to the parent
+	glm::mat4 inverseBind{1.0f};
+	int32_t node = -1;	// into the skin's AnimationSet::nodes
+};
+
+struct Skin
+{
+	std::string name;
+	std::vector<SkinJoint> joints;
+	std::vector<uint32_t> order;  // joint indices, parents before children
+	int32_t animation = -1;		  // animation set posing the joints
+
+	// Fills `order` from the joints' parents
+	void sort_joints();
+
+	// Writes one skinning matrix (model-space pose * inverse bind) per
+	// joint to out, posed by `locals` (one per joint), or at rest when
+	// locals is empty
+	void joint_matrices(std::span<const glm::mat4> locals,
+						std::span<glm::mat4> out) const;
+	// Same, from the model-space pose of every node of the animation set
+	void animated_joint_matrices(std::span<const glm::mat4> globals,
+								 std::span<glm::mat4> out) const;
+};
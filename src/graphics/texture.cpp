@@ -1,5 +1,7 @@
 #include "texture.h"
 
+#include <algorithm>
+
 bool Texture::uploaded() const { return image != VK_NULL_HANDLE; }
 
 Texture Texture::solid_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a,
@@ -12,3 +14,73 @@ Texture Texture::solid_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a,
 	tex.isSrgb = srgb;
 	return tex;
 }
+
+uint32_t Texture::mip_count() const
+{
+	uint32_t count = 1;
+	for (uint32_t size = std::max(width, height); size > 1; size /= 2)
+		++count;
+	return count;
+}
+
+uint32_t Texture::mip_for_size(uint32_t maxSize) const
+{
+	uint32_t level = 0;
+	for (uint32_t size = std::max(width, height);
+		 size > std::max(maxSize, 1u); size /= 2)
+		++level;
+	return level;
+}
+
+uint64_t Texture::chain_bytes(uint32_t baseMip) const
+{
+	uint64_t bytes = 0;
+	for (uint32_t level = baseMip; level < mip_count(); ++level)
+		bytes += static_cast<uint64_t>(std::max(width >> level, 1u)) *
+				 std::max(height >> level, 1u) * 4;
+	return bytes;
+}
+
+Texture Texture::mip(uint32_t level) const
+{
+	Texture out;
+	out.width = width;
+	out.height = height;
+	out.pixels = pixels;
+	out.isSrgb = isSrgb;
+	for (; level > 0 && std::max(out.width, out.height) > 1; --level)
+	{
+		// Odd sizes round down like GPU mips; the last row / column is
+		// clamped
+		uint32_t w = std::max(out.width / 2, 1u);
+		uint32_t h = std::max(out.height / 2, 1u);
+		std::vector<uint8_t> half(static_cast<size_t>(w) * h * 4);
+		for (uint32_t y = 0; y < h; ++y)
+		{
+			uint32_t y0 = std::min(y * 2, out.height - 1);
+			uint32_t y1 = std::min(y * 2 + 1, out.height - 1);
+			for (uint32_t x = 0; x < w; ++x)
+			{
+				uint32_t x0 = std::min(x * 2, out.width - 1);
+				uint32_t x1 = std::min(x * 2 + 1, out.width - 1);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					auto at = [&](uint32_t px, uint32_t py)
+					{
+						return static_cast<uint32_t>(
+							out.pixels[(static_cast<size_t>(py) * out.width +
+										px) * 4 + c]);
+					};
+					uint32_t sum =
+						at(x0, y0) + at(x1, y0) + at(x0, y1) + at(x1, y1);
+					half[(static_cast<size_t>(y) * w + x) * 4 + c] =
+						static_cast<uint8_t>((sum + 2) / 4);
+				}
+			}
+		}
+		out.width = w;
+		out.height = h;
+		out.pixels = std::move(half);
+	}
+	return out;
+}
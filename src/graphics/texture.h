@@ -17,9 +17,23 @@ struct Texture
 	VkImage image = VK_NULL_HANDLE;
 	VkDeviceMemory memory = VK_NULL_HANDLE;
 	VkImageView view = VK_NULL_HANDLE;
-	uint32_t mipLevels = 1;
+	uint32_t mipLevels = 1;	 // on the GPU
+
+	// The GPU image holds levels [residentMip, mip_count()) of the full
+	// chain; `pixels` always keeps level 0 to upload finer levels from.
+	// Texture streaming (TextureResidency) moves residentMip.
+	uint32_t residentMip = 0;
+	uint32_t requestedMip = 0;	// finest level sampled in round lastUsed
+	uint64_t lastUsed = 0;		// feedback round, 0 = never
 
 	bool uploaded() const;
+	uint32_t mip_count() const;
+	// Coarsest level whose larger side is at most maxSize
+	uint32_t mip_for_size(uint32_t maxSize) const;
+	// Bytes of levels [baseMip, mip_count())
+	uint64_t chain_bytes(uint32_t baseMip) const;
+	// CPU copy of one level of the chain (repeated 2x2 box filter)
+	Texture mip(uint32_t level) const;
 	static Texture solid_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a,
 							   bool srgb);
 };
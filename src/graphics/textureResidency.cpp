@@ -0,0 +1,112 @@
+#include "textureResidency.h"
+
+#include <algorithm>
+#include <cmath>
+
+void TextureResidency::request(Texture& tex, uint32_t mip) const
+{
+	if (tex.lastUsed != round_)
+	{
+		tex.lastUsed = round_;
+		tex.requestedMip = mip;
+	}
+	else
+	{
+		tex.requestedMip = std::min(tex.requestedMip, mip);
+	}
+}
+
+uint32_t TextureResidency::mip_for_coverage(const Texture& tex, float pixels)
+{
+	float texels = static_cast<float>(std::max(tex.width, tex.height));
+	if (!(pixels > 0.0f)) return tex.mip_count() - 1;
+	if (pixels >= texels) return 0;
+	auto level = static_cast<uint32_t>(std::floor(std::log2(texels / pixels)));
+	return std::min(level, tex.mip_count() - 1);
+}
+
+uint64_t TextureResidency::resident_bytes(std::span<const Texture> textures)
+{
+	uint64_t bytes = 0;
+	for (const auto& tex : textures) bytes += tex.chain_bytes(tex.residentMip);
+	return bytes;
+}
+
+std::vector<TextureResidency::Change> TextureResidency::plan(
+	std::span<const Texture> textures) const
+{
+	uint32_t count = static_cast<uint32_t>(textures.size());
+	uint64_t resident = resident_bytes(textures);
+
+	// Loads: requested finer than resident, biggest shortfall first
+	std::vector<uint32_t> loads;
+	// Evictions: unused textures above their tail, least recently used
+	// first; then used ones resident finer than requested
+	std::vector<uint32_t> stale, surplus;
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const Texture& tex = textures[i];
+		if (tex.lastUsed == round_)
+		{
+			if (tex.requestedMip < tex.residentMip)
+				loads.push_back(i);
+			else if (tex.requestedMip > tex.residentMip)
+				surplus.push_back(i);
+		}
+		else if (tex.residentMip < tail_mip(tex))
+		{
+			stale.push_back(i);
+		}
+	}
+	std::sort(loads.begin(), loads.end(),
+			  [&](uint32_t a, uint32_t b)
+			  {
+				  return textures[a].residentMip - textures[a].requestedMip >
+						 textures[b].residentMip - textures[b].requestedMip;
+			  });
+	std::sort(stale.begin(), stale.end(),
+			  [&](uint32_t a, uint32_t b)
+			  { return textures[a].lastUsed < textures[b].lastUsed; });
+	stale.insert(stale.end(), surplus.begin(), surplus.end());
+
+	std::vector<Change> changes;
+	size_t nextEviction = 0;
+	// Evicts until `extra` more bytes fit; false if they cannot
+	auto make_room = [&](uint64_t extra)
+	{
+		while (resident + extra > budgetBytes &&
+			   nextEviction < stale.size() && changes.size() < maxChanges)
+		{
+			uint32_t i = stale[nextEviction++];
+			const Texture& tex = textures[i];
+			uint32_t target =
+				tex.lastUsed == round_ ? tex.requestedMip : tail_mip(tex);
+			resident -=
+				tex.chain_bytes(tex.residentMip) - tex.chain_bytes(target);
+			changes.push_back({i, target});
+		}
+		return resident + extra <= budgetBytes;
+	};
+
+	// A lowered budget is enforced even with nothing to load
+	make_room(0);
+
+	for (uint32_t i : loads)
+	{
+		if (changes.size() >= maxChanges) break;
+		const Texture& tex = textures[i];
+		uint64_t current = tex.chain_bytes(tex.residentMip);
+
+		// Settle for a coarser level than requested when the finest
+		// does not fit
+		uint32_t target = tex.requestedMip;
+		for (; target < tex.residentMip; ++target)
+			if (make_room(tex.chain_bytes(target) - current)) break;
+		if (target >= tex.residentMip || changes.size() >= maxChanges)
+			continue;
+
+		resident += tex.chain_bytes(target) - current;
+		changes.push_back({i, target});
+	}
+	return changes;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "texture.h"
+
+// =============================================================================
+// Texture residency
+// =============================================================================
+
+// Decides which mip levels of each texture stay on the GPU. Each feedback
+// round the renderer reports the finest level every on-screen texture is
+// sampled at (request()); plan() then returns re-uploads that bring the
+// requested levels in, within the byte budget. To make room, textures not
+// requested for the longest time drop to their mip tail first (LRU), then
+// textures that are resident finer than they are sampled. Tail levels of
+// TAIL_SIZE and below always stay resident, so every texture can be sampled.
+struct TextureResidency
+{
+	static constexpr uint32_t TAIL_SIZE = 64;
+
+	uint64_t budgetBytes = 512ull << 20;
+	// Re-uploads per plan(). Nothing waits on them; the cap bounds the
+	// upload bandwidth and staging memory one planning round can use.
+	uint32_t maxChanges = 4;
+
+	struct Change
+	{
+		uint32_t texture;
+		uint32_t baseMip;  // new residentMip
+	};
+
+	void begin_round() { ++round_; }
+	uint64_t round() const { return round_; }
+	// `mip` is the finest level `tex` is sampled at somewhere this round
+	void request(Texture& tex, uint32_t mip) const;
+
+	std::vector<Change> plan(std::span<const Texture> textures) const;
+
+	// Finest level that covers `pixels` screen pixels across the larger
+	// side, for a texture mapped once across a surface
+	static uint32_t mip_for_coverage(const Texture& tex, float pixels);
+	static uint32_t tail_mip(const Texture& tex)
+	{
+		return tex.mip_for_size(TAIL_SIZE);
+	}
+	static uint64_t resident_bytes(std::span<const Texture> textures);
+
+   private:
+	uint64_t round_ = 0;
+};
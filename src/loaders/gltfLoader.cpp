@@ -6,10 +6,12 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #define TINYGLTF_NO_INCLUDE_STB_IMAGE
 #define TINYGLTF_NO_INCLUDE_STB_IMAGE_WRITE
+#define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 #define TINYGLTF_IMPLEMENTATION
 #include <tiny_gltf.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -142,8 +144,8 @@ static int accessor_stride(const tinygltf::Model& model,
 	return compSize * numComps;
 }
 
-static void compute_tangents(std::vector<Vertex>& verts,
-							 const std::vector<uint32_t>& indices)
+void compute_tangents(std::vector<Vertex>& verts,
+					  const std::vector<uint32_t>& indices)
 {
 	std::vector<glm::vec3> tan1(verts.size(), glm::vec3(0));
 	std::vector<glm::vec3> tan2(verts.size(), glm::vec3(0));
@@ -187,6 +189,418 @@ static void compute_tangents(std::vector<Vertex>& verts,
 	}
 }
 
+// Reads a VEC4 accessor of the given integer or float component type as
+// floats; integer types are normalized when the accessor says so
+static glm::vec4 read_vec4(const uint8_t* p, int componentType,
+						   bool normalized)
+{
+	glm::vec4 v{0.0f};
+	for (int c = 0; c < 4; ++c)
+	{
+		switch (componentType)
+		{
+			case TINYGLTF_COMPONENT_TYPE_FLOAT:
+				v[c] = reinterpret_cast<const float*>(p)[c];
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				v[c] = p[c] / (normalized ? 255.0f : 1.0f);
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+				v[c] = reinterpret_cast<const uint16_t*>(p)[c] /
+					   (normalized ? 65535.0f : 1.0f);
+				break;
+			default:
+				throw std::runtime_error("Unsupported skin component type");
+		}
+	}
+	return v;
+}
+
+// JOINTS_0 / WEIGHTS_0 of a primitive; false when it has none
+static bool extract_influences(const tinygltf::Model& model,
+							   const tinygltf::Primitive& prim,
+							   size_t vertexCount,
+							   std::vector<SkinInfluence>& out)
+{
+	auto jointIt = prim.attributes.find("JOINTS_0");
+	auto weightIt = prim.attributes.find("WEIGHTS_0");
+	if (jointIt == prim.attributes.end() ||
+		weightIt == prim.attributes.end())
+		return false;
+
+	const auto& jointAcc = model.accessors[jointIt->second];
+	const auto& weightAcc = model.accessors[weightIt->second];
+	if (jointAcc.count < vertexCount || weightAcc.count < vertexCount)
+		return false;
+	int jointStride = accessor_stride(model, jointAcc);
+	int weightStride = accessor_stride(model, weightAcc);
+	const uint8_t* joints = accessor_data<uint8_t>(model, jointAcc);
+	const uint8_t* weights = accessor_data<uint8_t>(model, weightAcc);
+
+	out.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		glm::vec4 j = read_vec4(joints + i * jointStride,
+								jointAcc.componentType, false);
+		glm::vec4 w = read_vec4(weights + i * weightStride,
+								weightAcc.componentType, weightAcc.normalized);
+		// Quantized weights rarely sum to exactly 1
+		float sum = w.x + w.y + w.z + w.w;
+		out[i].joints = glm::uvec4(j);
+		out[i].weights =
+			sum > 0.0f ? w / sum : glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+	}
+	return true;
+}
+
+// =============================================================================
+// Extract skins
+// =============================================================================
+
+// Parent and model-space transform of every node under the scene roots
+static void extract_hierarchy(const tinygltf::Model& model, int nodeIdx,
+							  int parent, const glm::mat4& parentTransform,
+							  std::vector<int>& parents,
+							  std::vector<glm::mat4>& globals)
+{
+	parents[nodeIdx] = parent;
+	globals[nodeIdx] = parentTransform * node_transform(model.nodes[nodeIdx]);
+	for (int child : model.nodes[nodeIdx].children)
+		extract_hierarchy(model, child, nodeIdx, globals[nodeIdx], parents,
+						  globals);
+}
+
+static void extract_skins(const tinygltf::Model& model,
+						  const std::vector<int>& parents,
+						  const std::vector<glm::mat4>& globals, Scene& scene)
+{
+	std::vector<int> jointOfNode(model.nodes.size(), -1);
+	for (const auto& gltfSkin : model.skins)
+	{
+		Skin skin;
+		skin.name = gltfSkin.name;
+		for (size_t j = 0; j < gltfSkin.joints.size(); ++j)
+			jointOfNode[gltfSkin.joints[j]] = static_cast<int>(j);
+
+		const uint8_t* inverseBinds = nullptr;
+		int inverseBindStride = 0;
+		if (gltfSkin.inverseBindMatrices >= 0)
+		{
+			const auto& acc = model.accessors[gltfSkin.inverseBindMatrices];
+			if (acc.type == TINYGLTF_TYPE_MAT4 &&
+				acc.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT &&
+				acc.count >= gltfSkin.joints.size())
+			{
+				inverseBinds = accessor_data<uint8_t>(model, acc);
+				inverseBindStride = accessor_stride(model, acc);
+			}
+		}
+
+		for (size_t j = 0; j < gltfSkin.joints.size(); ++j)
+		{
+			int nodeIdx = gltfSkin.joints[j];
+			const auto& node = model.nodes[nodeIdx];
+
+			SkinJoint joint;
+			joint.name = node.name;
+			joint.node = nodeIdx;
+			joint.localTransform = node_transform(node);
+			int parentNode = parents[nodeIdx];
+			if (parentNode >= 0) joint.parent = jointOfNode[parentNode];
+			if (joint.parent < 0 && parentNode >= 0)
+				joint.parentTransform = globals[parentNode];
+			if (inverseBinds)
+				joint.inverseBind =
+					glm::make_mat4(reinterpret_cast<const float*>(
+						inverseBinds + j * inverseBindStride));
+			skin.joints.push_back(std::move(joint));
+		}
+		for (int nodeIdx : gltfSkin.joints) jointOfNode[nodeIdx] = -1;
+
+		skin.sort_joints();
+		scene.skins.push_back(std::move(skin));
+	}
+}
+
+// =============================================================================
+// Extract morph targets
+// =============================================================================
+
+// A float VEC3 accessor with any sparse substitution applied. Without a
+// buffer view the values start out as zeros (glTF 2.0, 3.6.2.3).
+static std::vector<glm::vec3> read_vec3s(const tinygltf::Model& model,
+										 const tinygltf::Accessor& acc)
+{
+	std::vector<glm::vec3> out(acc.count, glm::vec3(0.0f));
+	if (acc.bufferView >= 0)
+	{
+		const uint8_t* base = accessor_data<uint8_t>(model, acc);
+		int stride = accessor_stride(model, acc);
+		for (size_t i = 0; i < acc.count; ++i)
+		{
+			const float* p = reinterpret_cast<const float*>(base + i * stride);
+			out[i] = {p[0], p[1], p[2]};
+		}
+	}
+	if (!acc.sparse.isSparse) return out;
+
+	const auto& indexView = model.bufferViews[acc.sparse.indices.bufferView];
+	const auto& valueView = model.bufferViews[acc.sparse.values.bufferView];
+	const uint8_t* indices = model.buffers[indexView.buffer].data.data() +
+							 indexView.byteOffset +
+							 acc.sparse.indices.byteOffset;
+	const float* values = reinterpret_cast<const float*>(
+		model.buffers[valueView.buffer].data.data() + valueView.byteOffset +
+		acc.sparse.values.byteOffset);
+	for (int i = 0; i < acc.sparse.count; ++i)
+	{
+		size_t index = 0;
+		switch (acc.sparse.indices.componentType)
+		{
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+				index = indices[i];
+				break;
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+				index = reinterpret_cast<const uint16_t*>(indices)[i];
+				break;
+			default:
+				index = reinterpret_cast<const uint32_t*>(indices)[i];
+				break;
+		}
+		if (index < out.size())
+			out[index] = {values[i * 3], values[i * 3 + 1], values[i * 3 + 2]};
+	}
+	return out;
+}
+
+// Keeps only the vertices the target moves, which for most targets is a
+// small part of the mesh
+static MorphTarget extract_morph_target(
+	const tinygltf::Model& model,
+	const std::map<std::string, int>& attributes, size_t vertexCount)
+{
+	static constexpr const char* NAMES[] = {"POSITION", "NORMAL", "TANGENT"};
+	std::vector<glm::vec3> deltas[3];
+	for (int a = 0; a < 3; ++a)
+	{
+		auto it = attributes.find(NAMES[a]);
+		if (it == attributes.end()) continue;
+		const auto& acc = model.accessors[it->second];
+		if (acc.type != TINYGLTF_TYPE_VEC3 ||
+			acc.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+			acc.count != vertexCount)
+			continue;
+		deltas[a] = read_vec3s(model, acc);
+	}
+
+	MorphTarget target;
+	glm::vec3 zero{0.0f};
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		MorphDelta d;
+		d.vertex = static_cast<uint32_t>(v);
+		if (!deltas[0].empty()) d.position = deltas[0][v];
+		if (!deltas[1].empty()) d.normal = deltas[1][v];
+		if (!deltas[2].empty()) d.tangent = deltas[2][v];
+		if (d.position == zero && d.normal == zero && d.tangent == zero)
+			continue;
+		target.deltas.push_back(d);
+	}
+	return target;
+}
+
+// Default morph weights of a node's mesh: the node's own, else the
+// mesh's, else zero
+static std::vector<float> morph_weights(const tinygltf::Model& model,
+										const tinygltf::Node& node)
+{
+	const auto& mesh = model.meshes[node.mesh];
+	size_t count =
+		mesh.primitives.empty() ? 0 : mesh.primitives[0].targets.size();
+	const std::vector<double>& source =
+		node.weights.size() == count ? node.weights : mesh.weights;
+	std::vector<float> weights(count, 0.0f);
+	for (size_t i = 0; i < count && i < source.size(); ++i)
+		weights[i] = static_cast<float>(source[i]);
+	return weights;
+}
+
+// =============================================================================
+// Extract animations
+// =============================================================================
+
+// Keys of one sampler output, `components` floats each, as vec4s
+static void read_keys(const tinygltf::Model& model,
+					  const tinygltf::Accessor& acc, size_t count,
+					  int components, std::vector<glm::vec4>& out)
+{
+	const uint8_t* base = accessor_data<uint8_t>(model, acc);
+	int stride = accessor_stride(model, acc);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const float* p = reinterpret_cast<const float*>(base + i * stride);
+		glm::vec4 v{0.0f};
+		for (int c = 0; c < components; ++c) v[c] = p[c];
+		out.push_back(v);
+	}
+}
+
+static AnimationClip extract_clip(const tinygltf::Model& model,
+								  const tinygltf::Animation& gltfAnim,
+								  const AnimationSet& set)
+{
+	AnimationClip clip;
+	clip.name = gltfAnim.name;
+	for (const auto& gltfChannel : gltfAnim.channels)
+	{
+		AnimationChannel ch;
+		if (gltfChannel.target_node < 0 ||
+			gltfChannel.target_node >= static_cast<int>(model.nodes.size()) ||
+			gltfChannel.sampler < 0 ||
+			gltfChannel.sampler >= static_cast<int>(gltfAnim.samplers.size()))
+			continue;
+		if (gltfChannel.target_path == "translation")
+			ch.path = AnimationPath::Translation;
+		else if (gltfChannel.target_path == "rotation")
+			ch.path = AnimationPath::Rotation;
+		else if (gltfChannel.target_path == "scale")
+			ch.path = AnimationPath::Scale;
+		else if (gltfChannel.target_path == "weights")
+			ch.path = AnimationPath::Weights;
+		else
+			continue;
+		ch.node = static_cast<uint32_t>(gltfChannel.target_node);
+		uint32_t weightCount = set.nodes[ch.node].weightCount;
+		if (ch.path == AnimationPath::Weights && weightCount == 0) continue;
+
+		const auto& sampler = gltfAnim.samplers[gltfChannel.sampler];
+		if (sampler.interpolation == "STEP")
+			ch.interpolation = Interpolation::Step;
+		else if (sampler.interpolation == "CUBICSPLINE")
+			ch.interpolation = Interpolation::CubicSpline;
+
+		// Float keys only; quantized rotations (KHR_mesh_quantization)
+		// are skipped
+		const auto& input = model.accessors[sampler.input];
+		const auto& output = model.accessors[sampler.output];
+		size_t valuesPerKey =
+			ch.interpolation == Interpolation::CubicSpline ? 3 : 1;
+		// Weights are scalars, one per morph target and value
+		int components = ch.path == AnimationPath::Rotation ? 4
+						 : ch.path == AnimationPath::Weights ? 1
+															 : 3;
+		if (ch.path == AnimationPath::Weights) valuesPerKey *= weightCount;
+		int type = components == 4	 ? TINYGLTF_TYPE_VEC4
+				   : components == 1 ? TINYGLTF_TYPE_SCALAR
+									 : TINYGLTF_TYPE_VEC3;
+		if (input.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+			output.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+			output.type != type || input.count == 0 ||
+			output.count < input.count * valuesPerKey)
+			continue;
+
+		ch.firstKey = static_cast<uint32_t>(clip.times.size());
+		ch.keyCount = static_cast<uint32_t>(input.count);
+		ch.firstValue = static_cast<uint32_t>(
+			ch.path == AnimationPath::Weights ? clip.weights.size()
+											  : clip.values.size());
+
+		const uint8_t* times = accessor_data<uint8_t>(model, input);
+		int timeStride = accessor_stride(model, input);
+		for (size_t i = 0; i < input.count; ++i)
+			clip.times.push_back(
+				*reinterpret_cast<const float*>(times + i * timeStride));
+		clip.duration = std::max(clip.duration, clip.times.back());
+
+		if (ch.path == AnimationPath::Weights)
+		{
+			const uint8_t* weights = accessor_data<uint8_t>(model, output);
+			int weightStride = accessor_stride(model, output);
+			for (size_t i = 0; i < input.count * valuesPerKey; ++i)
+				clip.weights.push_back(*reinterpret_cast<const float*>(
+					weights + i * weightStride));
+		}
+		else
+		{
+			read_keys(model, output, input.count * valuesPerKey, components,
+					  clip.values);
+		}
+		clip.channels.push_back(ch);
+	}
+	return clip;
+}
+
+// One AnimationSet for the whole file; meshes under an animated node and
+// every skin are linked to it
+static void extract_animations(const tinygltf::Model& model,
+							   const std::vector<int>& parents, Scene& scene)
+{
+	AnimationSet set;
+	set.nodes.resize(model.nodes.size());
+	for (size_t i = 0; i < model.nodes.size(); ++i)
+	{
+		const auto& node = model.nodes[i];
+		AnimationNode& animNode = set.nodes[i];
+		animNode.parent = parents[i];
+		animNode.rest = node_transform(node);
+		if (node.translation.size() == 3)
+			animNode.translation =
+				glm::vec3(static_cast<float>(node.translation[0]),
+						  static_cast<float>(node.translation[1]),
+						  static_cast<float>(node.translation[2]));
+		if (node.rotation.size() == 4)
+			animNode.rotation = glm::vec4(static_cast<float>(node.rotation[0]),
+										  static_cast<float>(node.rotation[1]),
+										  static_cast<float>(node.rotation[2]),
+										  static_cast<float>(node.rotation[3]));
+		if (node.scale.size() == 3)
+			animNode.scale = glm::vec3(static_cast<float>(node.scale[0]),
+									   static_cast<float>(node.scale[1]),
+									   static_cast<float>(node.scale[2]));
+
+		// Nodes with a morphed mesh carry its weights
+		if (node.mesh >= 0)
+		{
+			std::vector<float> weights = morph_weights(model, node);
+			animNode.firstWeight =
+				static_cast<uint32_t>(set.restWeights.size());
+			animNode.weightCount = static_cast<uint32_t>(weights.size());
+			set.restWeights.insert(set.restWeights.end(), weights.begin(),
+								   weights.end());
+		}
+	}
+	set.sort_nodes();
+
+	for (const auto& gltfAnim : model.animations)
+		set.clips.push_back(extract_clip(model, gltfAnim, set));
+
+	// A node moves when a channel targets it or one of its ancestors
+	std::vector<uint8_t> moves(model.nodes.size(), 0);
+	std::vector<uint8_t> morphs(model.nodes.size(), 0);
+	for (const auto& clip : set.clips)
+		for (const auto& ch : clip.channels)
+			(ch.path == AnimationPath::Weights ? morphs : moves)[ch.node] = 1;
+	for (uint32_t i : set.order)
+		if (set.nodes[i].parent >= 0 && moves[set.nodes[i].parent])
+			moves[i] = 1;
+
+	auto animation = static_cast<int32_t>(scene.animations.size());
+	for (auto& mesh : scene.meshes)
+	{
+		if (mesh.animationNode < 0) continue;
+		bool moved = mesh.skin < 0 && moves[mesh.animationNode];
+		bool morphed = !mesh.morphTargets.empty() &&
+					   morphs[mesh.animationNode] &&
+					   set.nodes[mesh.animationNode].weightCount ==
+						   mesh.morphTargets.size();
+		if (moved || morphed) mesh.animation = animation;
+	}
+	for (auto& skin : scene.skins) skin.animation = animation;
+
+	set.sample();
+	scene.animations.push_back(std::move(set));
+}
+
 // =============================================================================
 // Extract mesh primitives from a glTF node
 // =============================================================================
@@ -211,6 +625,7 @@ static void extract_node(const tinygltf::Model& model, int nodeIdx,
 			cpuMesh.sourceMeshIndex =
 				static_cast<uint32_t>(scene.meshes.size());
 			cpuMesh.transform = transform;
+			cpuMesh.animationNode = nodeIdx;
 			cpuMesh.materialIndex =
 				(prim.material >= 0) ? static_cast<uint32_t>(prim.material) : 0;
 
@@ -326,6 +741,25 @@ static void extract_node(const tinygltf::Model& model, int nodeIdx,
 				compute_tangents(cpuMesh.vertices, cpuMesh.indices);
 			}
 
+			// A skinned mesh is posed by its joints alone; the transform
+			// of the node it hangs off does not apply (glTF 2.0, 3.7.3)
+			if (node.skin >= 0 &&
+				node.skin < static_cast<int>(model.skins.size()) &&
+				!model.skins[node.skin].joints.empty() &&
+				extract_influences(model, prim, vertexCount,
+								   cpuMesh.influences))
+			{
+				cpuMesh.skin = node.skin;
+				cpuMesh.transform = glm::mat4{1.0f};
+			}
+
+			// --- Morph targets ---
+			for (const auto& target : prim.targets)
+				cpuMesh.morphTargets.push_back(
+					extract_morph_target(model, target, vertexCount));
+			if (!cpuMesh.morphTargets.empty())
+				cpuMesh.morphWeights = morph_weights(model, node);
+
 			// Compute local AABB from vertex positions
 			for (const auto& v : cpuMesh.vertices)
 				cpuMesh.localBounds.expand(v.pos);
@@ -385,6 +819,12 @@ static void extract_materials(const tinygltf::Model& model, Scene& scene)
 					  static_cast<float>(mat.emissiveFactor[1]),
 					  static_cast<float>(mat.emissiveFactor[2]));
 
+		if (mat.alphaMode == "MASK")
+			pbr.alphaMode = AlphaMode::Mask;
+		else if (mat.alphaMode == "BLEND")
+			pbr.alphaMode = AlphaMode::Blend;
+		pbr.alphaCutoff = static_cast<float>(mat.alphaCutoff);
+
 		scene.materials.push_back(pbr);
 	}
 
@@ -488,9 +928,23 @@ Scene load_gltf(const std::string& path)
 	for (int nodeIdx : gltfScene.nodes)
 		extract_node(model, nodeIdx, glm::mat4{1.0f}, scene, path);
 
-	LOG_INFO("Loaded glTF '%s': %zu mesh(es), %zu material(s), %zu texture(s)",
+	if (!model.skins.empty() || !model.animations.empty())
+	{
+		std::vector<int> parents(model.nodes.size(), -1);
+		std::vector<glm::mat4> globals(model.nodes.size(), glm::mat4{1.0f});
+		for (int nodeIdx : gltfScene.nodes)
+			extract_hierarchy(model, nodeIdx, -1, glm::mat4{1.0f}, parents,
+							  globals);
+		extract_skins(model, parents, globals, scene);
+		if (!model.animations.empty())
+			extract_animations(model, parents, scene);
+	}
+
+	LOG_INFO("Loaded glTF '%s': %zu mesh(es), %zu material(s), %zu "
+			 "texture(s), %zu skin(s), %zu animation(s)",
 			 path.c_str(), scene.meshes.size(), scene.materials.size(),
-			 scene.textures.size());
+			 scene.textures.size(), scene.skins.size(),
+			 model.animations.size());
 
 	return scene;
 }
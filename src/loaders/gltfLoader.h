@@ -1,7 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "graphics/scene.h"
 
 Scene load_gltf(const std::string& path);
+
+// Per-vertex tangents (xyz + handedness in w) from positions, normals and
+// UVs, for primitives that ship without a TANGENT attribute
+void compute_tangents(std::vector<Vertex>& verts,
+					  const std::vector<uint32_t>& indices);
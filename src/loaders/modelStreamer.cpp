@@ -0,0 +1,139 @@
+#include "modelStreamer.h"
+
+#include <algorithm>
+#include <exception>
+
+#include "gltfLoader.h"
+
+ModelStreamer::ModelStreamer(uint32_t threadCount)
+{
+	threadCount = std::max(threadCount, 1u);
+	workers_.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+		workers_.emplace_back([this] { worker_main(); });
+}
+
+ModelStreamer::~ModelStreamer()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (auto& t : workers_) t.join();
+}
+
+void ModelStreamer::start(std::vector<std::string> paths)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++generation_;
+		jobs_.clear();
+		jobs_.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); ++i)
+			jobs_[i].path = std::move(paths[i]);
+		results_.clear();
+		outstanding_ = static_cast<uint32_t>(jobs_.size());
+	}
+	wake_.notify_all();
+	// wait_result() callers re-check against the new load
+	finished_.notify_all();
+}
+
+void ModelStreamer::cancel()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++generation_;
+		jobs_.clear();
+		results_.clear();
+		outstanding_ = 0;
+	}
+	// Models still decoding are discarded without a result, so this is the
+	// only wake-up wait_result() callers get
+	finished_.notify_all();
+}
+
+void ModelStreamer::set_priority(uint32_t model, float priority)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (model < jobs_.size()) jobs_[model].priority = priority;
+}
+
+bool ModelStreamer::pop_result(Result& out)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (results_.empty()) return false;
+	out = std::move(results_.front());
+	results_.pop_front();
+	--outstanding_;
+	return true;
+}
+
+bool ModelStreamer::wait_result(Result& out)
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	finished_.wait(lock,
+				   [this] { return outstanding_ == 0 || !results_.empty(); });
+	if (results_.empty()) return false;
+	out = std::move(results_.front());
+	results_.pop_front();
+	--outstanding_;
+	return true;
+}
+
+uint32_t ModelStreamer::outstanding() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return outstanding_;
+}
+
+void ModelStreamer::worker_main()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	for (;;)
+	{
+		// Highest-priority queued job; a linear scan is nothing next to
+		// decoding a model
+		Job* job = nullptr;
+		uint32_t model = 0;
+		wake_.wait(lock, [&] {
+			if (stop_) return true;
+			job = nullptr;
+			for (uint32_t i = 0; i < jobs_.size(); ++i)
+			{
+				Job& j = jobs_[i];
+				if (j.state != State::Queued) continue;
+				if (!job || j.priority > job->priority)
+				{
+					job = &j;
+					model = i;
+				}
+			}
+			return job != nullptr;
+		});
+		if (stop_) return;
+
+		job->state = State::Running;
+		std::string path = job->path;
+		uint64_t generation = generation_;
+		lock.unlock();
+
+		Result result{model, {}, {}};
+		try
+		{
+			result.scene = load_gltf(path);
+		}
+		catch (const std::exception& e)
+		{
+			result.error = e.what();
+		}
+
+		lock.lock();
+		// Dropped by start() / cancel() while decoding
+		if (generation != generation_) continue;
+		jobs_[model].state = State::Done;
+		results_.push_back(std::move(result));
+		finished_.notify_all();
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "graphics/scene.h"
+
+// =============================================================================
+// Model streamer
+// =============================================================================
+
+// Decodes glTF models (load_gltf) on its own worker threads while the
+// caller keeps running. Queued models are taken highest priority first;
+// priorities can change while they wait. Finished models are collected
+// with pop_result(). Nothing here touches the GPU.
+struct ModelStreamer
+{
+	explicit ModelStreamer(uint32_t threadCount);
+	~ModelStreamer();
+
+	ModelStreamer(const ModelStreamer&) = delete;
+	ModelStreamer& operator=(const ModelStreamer&) = delete;
+
+	struct Result
+	{
+		uint32_t model;	 // index into the paths given to start()
+		Scene scene;
+		std::string error;	// set when loading failed
+	};
+
+	// Replaces any previous load: queued models are dropped and models
+	// still decoding are discarded when they finish
+	void start(std::vector<std::string> paths);
+	void cancel();
+
+	// Higher goes first; only matters while the model is still queued
+	void set_priority(uint32_t model, float priority);
+
+	// A finished model, if any
+	bool pop_result(Result& out);
+	// Blocks until a model finishes; false when none are left
+	bool wait_result(Result& out);
+
+	// Models not yet collected with pop_result / wait_result
+	uint32_t outstanding() const;
+
+   private:
+	enum class State : uint8_t
+	{
+		Queued,
+		Running,
+		Done
+	};
+	struct Job
+	{
+		std::string path;
+		float priority = 0.0f;
+		State state = State::Queued;
+	};
+
+	std::vector<std::thread> workers_;
+	mutable std::mutex mutex_;
+	std::condition_variable wake_;	  // a job was queued, or stop
+	std::condition_variable finished_;	// a result arrived, or reset
+	bool stop_ = false;
+	uint64_t generation_ = 0;  // bumped by start() / cancel()
+	std::vector<Job> jobs_;
+	std::deque<Result> results_;
+	uint32_t outstanding_ = 0;
+
+	void worker_main();
+};
@@ -60,6 +60,10 @@ class Logger
 		if (file_) std::fclose(file_);
 	}
 
+	// Echo messages to stderr (on by default). The benchmark tool turns it
+	// off so log calls inside measured code do not flood the console.
+	void set_console_enabled(bool enabled) { console_ = enabled; }
+
 	void log(const char* level, const char* fmt, ...)
 	{
 		char buf[2048];
@@ -73,7 +77,7 @@ class Logger
 			std::fprintf(file_, "[%s] %s\n", level, buf);
 			std::fflush(file_);
 		}
-		std::fprintf(stderr, "[%s] %s\n", level, buf);
+		if (console_) std::fprintf(stderr, "[%s] %s\n", level, buf);
 	}
 
    private:
@@ -130,6 +134,7 @@ class Logger
 
 	Logger() = default;
 	FILE* file_ = nullptr;
+	bool console_ = true;
 };
 
 // NOLINTBEGIN(cppcoreguidelines-macro-usage)
@@ -1,6 +1,8 @@
 // Force Github Linguist Refresh
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <optional>
 #include <stdexcept>
 #include <string>
 
@@ -8,17 +10,282 @@
 #include "config.h"
 #include "logger.h"
 
+static void print_usage(const char* argv0)
+{
+	std::fprintf(
+		stderr,
+		"Usage: %s [options] [model.gltf|model.glb]\n"
+		"\n"
+		"Options:\n"
+		"  --scene <file.scene>  load a scene file after startup\n"
+		"  --headless            render offscreen with no window or surface\n"
+		"  --size <W>x<H>        headless render size (default: 1280x720)\n"
+		"  --frames <N>          frames to render (default: 1 headless,\n"
+		"                        1000 measured frames with --bench)\n"
+		"  --output <file>       write the last headless frame (.png or .exr)\n"
+		"  --bench <file.scene>  benchmark a scene and report frame times\n"
+		"  --path <camera.json>  camera path to play back during --bench\n"
+		"  --warmup <N>          warm-up frames to skip (default: 60)\n"
+		"  --report <file.json>  write the benchmark report (default: stdout)\n"
+		"  --resize-stress       resize the target every few frames during\n"
+		"                        --bench\n"
+		"  --present-mode <m>    fifo, mailbox (default) or immediate\n"
+		"  --frames-in-flight <N> frames the CPU may run ahead, 1-3 "
+		"(default: 2)\n"
+		"  --fps-limit <N>       cap the frame rate on the CPU (default: off)\n"
+		"  --low-latency         sample input as late as possible\n"
+		"  --async-compute       cull lights on the async compute queue\n"
+		"  --dynamic-resolution <ms>  scale the render resolution to meet a\n"
+		"                        GPU frame time, upscaled with TAA\n"
+		"  --texture-budget <MB> stream texture mip levels within a GPU\n"
+		"                        memory budget\n"
+		"  --transparency <m>    how blended materials are composited:\n"
+		"                        sorted (default), weighted or list\n"
+		"  -h, --help            show this help\n",
+		argv0);
+}
+
+// Returns false on a malformed command line (usage has not been printed yet)
+static bool parse_args(int argc, char* argv[], App& app, bool& showHelp)
+{
+	std::optional<uint32_t> frames;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		auto value = [&]() -> const char*
+		{
+			if (i + 1 >= argc)
+			{
+				std::fprintf(stderr, "Error: %s requires a value\n", arg);
+				return nullptr;
+			}
+			return argv[++i];
+		};
+
+		if (std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+		{
+			showHelp = true;
+			return true;
+		}
+		else if (std::strcmp(arg, "--headless") == 0)
+		{
+			app.headless = true;
+		}
+		else if (std::strcmp(arg, "--scene") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			app.startupScenePath = v;
+		}
+		else if (std::strcmp(arg, "--size") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			unsigned w = 0, h = 0;
+			if (std::sscanf(v, "%ux%u", &w, &h) != 2 || w == 0 || h == 0)
+			{
+				std::fprintf(stderr, "Error: invalid --size '%s'\n", v);
+				return false;
+			}
+			app.headlessWidth = w;
+			app.headlessHeight = h;
+		}
+		else if (std::strcmp(arg, "--frames") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			unsigned long n = std::strtoul(v, nullptr, 10);
+			if (n == 0)
+			{
+				std::fprintf(stderr, "Error: invalid --frames '%s'\n", v);
+				return false;
+			}
+			frames = static_cast<uint32_t>(n);
+		}
+		else if (std::strcmp(arg, "--output") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			app.headlessOutput = v;
+		}
+		else if (std::strcmp(arg, "--bench") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			app.benchScenePath = v;
+		}
+		else if (std::strcmp(arg, "--path") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			app.benchCameraPath = v;
+		}
+		else if (std::strcmp(arg, "--warmup") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			char* end = nullptr;
+			unsigned long n = std::strtoul(v, &end, 10);
+			if (end == v || *end != '\0')
+			{
+				std::fprintf(stderr, "Error: invalid --warmup '%s'\n", v);
+				return false;
+			}
+			app.benchWarmupFrames = static_cast<uint32_t>(n);
+		}
+		else if (std::strcmp(arg, "--report") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			app.benchReportPath = v;
+		}
+		else if (std::strcmp(arg, "--resize-stress") == 0)
+		{
+			app.benchResizeStress = true;
+		}
+		else if (std::strcmp(arg, "--present-mode") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			if (std::strcmp(v, "fifo") == 0)
+				app.renderer.set_present_mode(VK_PRESENT_MODE_FIFO_KHR);
+			else if (std::strcmp(v, "mailbox") == 0)
+				app.renderer.set_present_mode(VK_PRESENT_MODE_MAILBOX_KHR);
+			else if (std::strcmp(v, "immediate") == 0)
+				app.renderer.set_present_mode(VK_PRESENT_MODE_IMMEDIATE_KHR);
+			else
+			{
+				std::fprintf(stderr, "Error: invalid --present-mode '%s'\n",
+							 v);
+				return false;
+			}
+		}
+		else if (std::strcmp(arg, "--frames-in-flight") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			unsigned long n = std::strtoul(v, nullptr, 10);
+			if (n < 1 || n > Renderer::MAX_FRAMES_IN_FLIGHT)
+			{
+				std::fprintf(stderr, "Error: invalid --frames-in-flight '%s'\n",
+							 v);
+				return false;
+			}
+			app.renderer.set_frames_in_flight(static_cast<uint32_t>(n));
+		}
+		else if (std::strcmp(arg, "--fps-limit") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			double fps = std::strtod(v, nullptr);
+			if (fps <= 0.0)
+			{
+				std::fprintf(stderr, "Error: invalid --fps-limit '%s'\n", v);
+				return false;
+			}
+			app.framePacer.targetFps = static_cast<float>(fps);
+		}
+		else if (std::strcmp(arg, "--low-latency") == 0)
+		{
+			app.renderer.lowLatencyMode_ = true;
+		}
+		else if (std::strcmp(arg, "--async-compute") == 0)
+		{
+			app.renderer.asyncCompute_ = true;
+		}
+		else if (std::strcmp(arg, "--dynamic-resolution") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			double ms = std::strtod(v, nullptr);
+			if (ms <= 0.0)
+			{
+				std::fprintf(stderr,
+							 "Error: invalid --dynamic-resolution '%s'\n", v);
+				return false;
+			}
+			app.renderer.dynamicResolution_ = true;
+			app.renderer.resolutionScaler_.targetGpuMs =
+				static_cast<float>(ms);
+		}
+		else if (std::strcmp(arg, "--texture-budget") == 0)
+		{
+			const char* v = value();
+			if (!v) return false;
+			unsigned long mb = std::strtoul(v, nullptr, 10);
+			if (mb == 0)
+			{
+				std::fprintf(stderr, "Error: invalid --texture-budget '%s'\n",
+							 v);
+				return false;
+			}
+			app.renderer.textureStreaming_ = true;
+			app.renderer.textureResidency_.budgetBytes =
+				static_cast<uint64_t>(mb) << 20;
+		}
+		else if (std::strcmp(arg, "--transparency") == 0)
+		{
+			using Mode = Renderer::TransparencyMode;
+			const char* v = value();
+			if (!v) return false;
+			if (std::strcmp(v, "sorted") == 0)
+				app.renderer.transparencyMode_ = Mode::Sorted;
+			else if (std::strcmp(v, "weighted") == 0)
+				app.renderer.transparencyMode_ = Mode::WeightedOit;
+			else if (std::strcmp(v, "list") == 0)
+				app.renderer.transparencyMode_ = Mode::LinkedListOit;
+			else
+			{
+				std::fprintf(stderr, "Error: invalid --transparency '%s'\n",
+							 v);
+				return false;
+			}
+		}
+		else if (arg[0] == '-')
+		{
+			std::fprintf(stderr, "Error: unknown option '%s'\n", arg);
+			return false;
+		}
+		else
+		{
+			app.modelPath = arg;
+		}
+	}
+
+	if (frames)
+	{
+		if (app.benchScenePath.empty())
+			app.headlessFrames = *frames;
+		else
+			app.benchFrames = *frames;
+	}
+	if (!app.benchCameraPath.empty() && app.benchScenePath.empty())
+	{
+		std::fprintf(stderr, "Error: --path requires --bench\n");
+		return false;
+	}
+	if (app.benchResizeStress && app.benchScenePath.empty())
+	{
+		std::fprintf(stderr, "Error: --resize-stress requires --bench\n");
+		return false;
+	}
+	return true;
+}
+
 int main(int argc, char* argv[])
 {
 	Logger::instance().init();
 	LOG_INFO("=== vulkanwork startup ===");
 
 	App app;
+	app.modelPath = std::string(MODEL_DIR) + "/DamagedHelmet.glb";
 
-	if (argc > 1)
-		app.modelPath = argv[1];
-	else
-		app.modelPath = std::string(MODEL_DIR) + "/DamagedHelmet.glb";
+	bool showHelp = false;
+	if (!parse_args(argc, argv, app, showHelp) || showHelp)
+	{
+		print_usage(argv[0]);
+		return showHelp ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
 	LOG_INFO("Initial model path: %s", app.modelPath.c_str());
 
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "benchmarks.h"
+#include "config.h"
+#include "graphics/textureResidency.h"
+#include "harness.h"
+#include "loaders/gltfLoader.h"
+#include "pak/packfile.h"
+
+namespace fs = std::filesystem;
+
+// =============================================================================
+// Helpers
+// =============================================================================
+
+// Flat grid in the XZ plane with UVs spanning [0, 1]
+static void make_grid(uint32_t n, std::vector<Vertex>& verts,
+					  std::vector<uint32_t>& indices)
+{
+	verts.clear();
+	indices.clear();
+	verts.reserve(static_cast<size_t>(n + 1) * (n + 1));
+	indices.reserve(static_cast<size_t>(n) * n * 6);
+
+	for (uint32_t z = 0; z <= n; ++z)
+	{
+		for (uint32_t x = 0; x <= n; ++x)
+		{
+			Vertex v{};
+			float u = static_cast<float>(x) / n;
+			float w = static_cast<float>(z) / n;
+			v.pos = {u - 0.5f, 0.0f, w - 0.5f};
+			v.normal = {0.0f, 1.0f, 0.0f};
+			v.uv = {u, w};
+			verts.push_back(v);
+		}
+	}
+	for (uint32_t z = 0; z < n; ++z)
+	{
+		for (uint32_t x = 0; x < n; ++x)
+		{
+			uint32_t i0 = z * (n + 1) + x;
+			uint32_t i1 = i0 + 1;
+			uint32_t i2 = i0 + (n + 1);
+			uint32_t i3 = i2 + 1;
+			indices.insert(indices.end(), {i0, i2, i1, i1, i2, i3});
+		}
+	}
+}
+
+// Every .glb / .gltf below MODEL_DIR, relative to it, sorted
+static std::vector<std::string> find_models()
+{
+	std::vector<std::string> models;
+	std::error_code ec;
+	for (fs::recursive_directory_iterator it(MODEL_DIR, ec), end;
+		 !ec && it != end; it.increment(ec))
+	{
+		if (!it->is_regular_file()) continue;
+		std::string ext = it->path().extension().string();
+		std::transform(ext.begin(), ext.end(), ext.begin(),
+					   [](unsigned char c) { return std::tolower(c); });
+		if (ext != ".glb" && ext != ".gltf") continue;
+		models.push_back(
+			fs::relative(it->path(), MODEL_DIR).generic_string());
+	}
+	std::sort(models.begin(), models.end());
+	return models;
+}
+
+// =============================================================================
+// Registration
+// =============================================================================
+
+void register_asset_benchmarks()
+{
+	// --- Pack file -----------------------------------------------------------
+	bench::register_benchmark(
+		"pak/open",
+		[](bench::State& state)
+		{
+			while (state.keep_running())
+			{
+				pak::PackFile pak(PAK_FILE);
+				bench::do_not_optimize(pak);
+			}
+		});
+
+	std::vector<std::string> assets;
+	try
+	{
+		assets = pak::PackFile(PAK_FILE).list_assets();
+	}
+	catch (const std::exception&)
+	{
+		// pak/open reports the failure
+	}
+	std::sort(assets.begin(), assets.end());
+
+	for (const auto& asset : assets)
+	{
+		bench::register_benchmark(
+			"pak/read/" + asset,
+			[asset](bench::State& state)
+			{
+				pak::PackFile pak(PAK_FILE);
+				state.set_items_per_iteration(pak.original_size(asset));
+				while (state.keep_running())
+					bench::do_not_optimize(pak.read(asset));
+			});
+	}
+
+	// --- glTF loading --------------------------------------------------------
+	for (const auto& model : find_models())
+	{
+		bench::register_benchmark(
+			"gltf/load/" + model,
+			[model](bench::State& state)
+			{
+				std::string path = std::string(MODEL_DIR) + "/" + model;
+				while (state.keep_running())
+					bench::do_not_optimize(load_gltf(path));
+			});
+	}
+
+	// --- Tangents ------------------------------------------------------------
+	for (uint32_t n : {64u, 256u, 1024u})
+	{
+		bench::register_benchmark(
+			"gltf/compute_tangents/grid" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				std::vector<Vertex> verts;
+				std::vector<uint32_t> indices;
+				make_grid(n, verts, indices);
+				state.set_items_per_iteration(verts.size());
+				while (state.keep_running())
+				{
+					compute_tangents(verts, indices);
+					bench::do_not_optimize(verts);
+				}
+			});
+	}
+
+	// --- Texture streaming ---------------------------------------------------
+	// CPU cost of one streamed-in level below the top
+	for (uint32_t size : {1024u, 4096u})
+	{
+		bench::register_benchmark(
+			"texture/mip1/" + std::to_string(size),
+			[size](bench::State& state)
+			{
+				Texture tex;
+				tex.width = size;
+				tex.height = size;
+				tex.pixels.assign(static_cast<size_t>(size) * size * 4, 128);
+				state.set_items_per_iteration(tex.pixels.size() / 4);
+				while (state.keep_running())
+					bench::do_not_optimize(tex.mip(1));
+			});
+	}
+
+	// Half the textures on screen at assorted levels, the rest stale, with
+	// room for a quarter of them at full size
+	for (uint32_t count : {1000u, 10000u})
+	{
+		bench::register_benchmark(
+			"texture/residency_plan/" + std::to_string(count),
+			[count](bench::State& state)
+			{
+				std::vector<Texture> textures(count);
+				TextureResidency residency;
+				for (auto& tex : textures)
+				{
+					tex.width = 1024;
+					tex.height = 1024;
+					tex.residentMip = TextureResidency::tail_mip(tex);
+				}
+				residency.budgetBytes = textures[0].chain_bytes(0) * count / 4;
+				for (uint32_t round = 0; round < 2; ++round)
+				{
+					residency.begin_round();
+					for (uint32_t i = round; i < count; i += 2)
+						residency.request(textures[i], i % 4);
+				}
+				state.set_items_per_iteration(count);
+				while (state.keep_running())
+					bench::do_not_optimize(residency.plan(textures));
+			});
+	}
+}
@@ -0,0 +1,909 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <glm/gtc/matrix_transform.hpp>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmarks.h"
+#include "core/radixSort.h"
+#include "core/threadPool.h"
+#include "editor/sceneFile.h"
+#include "editor/sceneGraph.h"
+#include "editor/selection.h"
+#include "graphics/animation.h"
+#include "graphics/debugLines.h"
+#include "graphics/light.h"
+#include "graphics/mesh.h"
+#include "graphics/skin.h"
+#include "harness.h"
+
+// =============================================================================
+// Fixtures
+// =============================================================================
+
+// 1 sun, then an even mix of point and spot lights on a grid
+static LightEnvironment make_lights(uint32_t count)
+{
+	LightEnvironment env;
+	env.directionals.push_back({});
+	for (uint32_t i = 1; i < count; ++i)
+	{
+		glm::vec3 pos(static_cast<float>(i % 32), 1.0f,
+					  static_cast<float>(i / 32));
+		if (i % 2 == 0)
+		{
+			PointLight p;
+			p.position = pos;
+			env.points.push_back(p);
+		}
+		else
+		{
+			SpotLight s;
+			s.position = pos;
+			env.spots.push_back(s);
+		}
+	}
+	return env;
+}
+
+// Every node gets `branching` children until `count` nodes exist (BFS order)
+static SceneGraph make_tree(uint32_t count, uint32_t branching)
+{
+	SceneGraph graph;
+	glm::mat4 local =
+		glm::translate(glm::mat4(1.0f), glm::vec3(0.1f, 0.0f, 0.0f));
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		std::optional<uint32_t> parent;
+		if (i > 0 && branching > 0) parent = (i - 1) / branching;
+		graph.add_node("Node " + std::to_string(i), local, i, "bench.glb", i,
+					   parent);
+	}
+	return graph;
+}
+
+// Humanoid-sized skeleton: limbs of 8 joints hanging off a root joint
+static Skin make_skin(uint32_t jointCount)
+{
+	Skin skin;
+	glm::mat4 local =
+		glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.1f, 0.0f));
+	for (uint32_t i = 0; i < jointCount; ++i)
+	{
+		SkinJoint joint;
+		joint.parent = i == 0 ? -1 : (i % 8 == 1 ? 0 : static_cast<int>(i) - 1);
+		joint.localTransform = local;
+		joint.inverseBind = glm::inverse(local);
+		skin.joints.push_back(joint);
+	}
+	skin.sort_joints();
+	return skin;
+}
+
+// The same skeleton as animation nodes, each turned about Y by a linear
+// rotation channel of `keyCount` keys over one second; the root also moves
+static AnimationSet make_animation(uint32_t nodeCount, uint32_t keyCount)
+{
+	AnimationSet set;
+	set.nodes.resize(nodeCount);
+	for (uint32_t i = 1; i < nodeCount; ++i)
+		set.nodes[i].parent = i % 8 == 1 ? 0 : static_cast<int32_t>(i) - 1;
+	set.sort_nodes();
+
+	AnimationClip clip;
+	clip.duration = 1.0f;
+	auto add_channel = [&](uint32_t node, AnimationPath path)
+	{
+		AnimationChannel ch;
+		ch.node = node;
+		ch.path = path;
+		ch.firstKey = static_cast<uint32_t>(clip.times.size());
+		ch.keyCount = keyCount;
+		ch.firstValue = static_cast<uint32_t>(clip.values.size());
+		for (uint32_t k = 0; k < keyCount; ++k)
+		{
+			float t = static_cast<float>(k) / static_cast<float>(keyCount - 1);
+			float half = 0.05f * static_cast<float>(k + node);
+			clip.times.push_back(t);
+			clip.values.push_back(
+				path == AnimationPath::Rotation
+					? glm::vec4(0.0f, std::sin(half), 0.0f, std::cos(half))
+					: glm::vec4(t, 0.0f, 0.0f, 0.0f));
+		}
+		clip.channels.push_back(ch);
+	};
+	add_channel(0, AnimationPath::Translation);
+	for (uint32_t i = 0; i < nodeCount; ++i)
+		add_channel(i, AnimationPath::Rotation);
+	set.clips.push_back(std::move(clip));
+	return set;
+}
+
+// n copies of `cube` on a 100-wide grid in the XZ plane, one node each
+struct CubeGrid
+{
+	std::vector<Mesh> meshes;
+	SceneGraph graph;
+};
+
+static CubeGrid make_cube_grid(uint32_t n, const Mesh& cube)
+{
+	CubeGrid grid;
+	grid.meshes.assign(n, cube);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		glm::vec3 pos(static_cast<float>(i % 100) - 50.0f, 0.0f,
+					  static_cast<float>(i / 100) - 50.0f);
+		grid.graph.add_node("Cube", glm::translate(glm::mat4(1.0f), pos), i,
+							"", 0, std::nullopt);
+	}
+	grid.graph.update_world_transforms(0, {});
+	return grid;
+}
+
+// Bounds only, for the picks that stop at the boxes
+static Mesh make_box_mesh()
+{
+	Mesh box;
+	box.localBounds.min = glm::vec3(-0.4f);
+	box.localBounds.max = glm::vec3(0.4f);
+	return box;
+}
+
+// The same box as `grid` x `grid` quads per face, for exact triangle hits
+static Mesh make_tessellated_cube(uint32_t grid)
+{
+	Mesh cube;
+	for (int face = 0; face < 6; ++face)
+	{
+		int axis = face / 2;
+		float side = (face % 2) ? 0.4f : -0.4f;
+		auto base = static_cast<uint32_t>(cube.vertices.size());
+		for (uint32_t y = 0; y <= grid; ++y)
+			for (uint32_t x = 0; x <= grid; ++x)
+			{
+				Vertex v{};
+				v.pos[axis] = side;
+				v.pos[(axis + 1) % 3] = 0.8f * x / grid - 0.4f;
+				v.pos[(axis + 2) % 3] = 0.8f * y / grid - 0.4f;
+				cube.vertices.push_back(v);
+				cube.localBounds.expand(v.pos);
+			}
+		for (uint32_t y = 0; y < grid; ++y)
+			for (uint32_t x = 0; x < grid; ++x)
+			{
+				uint32_t i = base + y * (grid + 1) + x;
+				cube.indices.insert(cube.indices.end(),
+									{i, i + 1, i + grid + 1, i + 1,
+									 i + grid + 2, i + grid + 1});
+			}
+	}
+	return cube;
+}
+
+// A 1280x720 view looking down at the cube grid
+struct PickCamera
+{
+	static constexpr float WIDTH = 1280.0f;
+	static constexpr float HEIGHT = 720.0f;
+	glm::mat4 view =
+		glm::lookAt(glm::vec3(0.0f, 40.0f, 20.0f), glm::vec3(0.0f),
+					glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 proj = glm::perspective(glm::radians(45.0f), WIDTH / HEIGHT,
+									  0.1f, 100.0f);
+
+	// Click in the middle of the view
+	void pick(Selection& selection, const CubeGrid& grid) const
+	{
+		selection.pick(WIDTH / 2, HEIGHT / 2, WIDTH, HEIGHT, view, proj,
+					   grid.graph, grid.meshes);
+	}
+};
+
+// Sets every field the scene files store, with values that differ between
+// nodes and lights: names needing escapes, nodes without meshes, scaled and
+// rotated transforms, all light types and a moved camera
+static SceneFileData make_scene_file_data(uint32_t nodeCount)
+{
+	SceneFileData data;
+	data.modelPath = "models/bench/scene.glb";
+	data.camera.position = glm::vec3(1.5f, 2.25f, -3.0f);
+	data.camera.yaw = 30.0f;
+	data.camera.pitch = -12.5f;
+	data.camera.fov = 60.0f;
+
+	for (uint32_t i = 0; i < nodeCount; ++i)
+	{
+		float f = static_cast<float>(i);
+		glm::mat4 local =
+			glm::translate(glm::mat4(1.0f), glm::vec3(0.1f * f, -0.25f, 1.5f));
+		local = glm::rotate(local, 0.01f * f, glm::vec3(0.0f, 1.0f, 0.0f));
+		local = glm::scale(local, glm::vec3(1.0f + 0.001f * f));
+		std::optional<uint32_t> mesh;
+		if (i % 3 != 0) mesh = i;
+		std::optional<uint32_t> parent;
+		if (i > 0) parent = (i - 1) / 4;
+		data.sceneGraph.add_node(
+			"Node " + std::to_string(i) + (i % 2 ? " \"a\\b\"" : ""), local,
+			mesh, "models/part" + std::to_string(i % 7) + ".glb", i % 5,
+			parent);
+	}
+
+	data.lights = make_lights(64);
+	data.lights.ambient = {glm::vec3(0.2f, 0.3f, 0.4f), 0.1f};
+	data.lights.directionals[0] = {
+		glm::normalize(glm::vec3(0.3f, -1.0f, 0.2f)),
+		glm::vec3(1.0f, 0.9f, 0.8f), 3.0f};
+	for (size_t i = 0; i < data.lights.points.size(); ++i)
+	{
+		PointLight& p = data.lights.points[i];
+		p.color = glm::vec3(0.5f, 1.0f, 0.25f);
+		p.intensity = 1.0f + 0.5f * static_cast<float>(i);
+		p.radius = 4.0f + static_cast<float>(i % 5);
+	}
+	for (size_t i = 0; i < data.lights.spots.size(); ++i)
+	{
+		SpotLight& sl = data.lights.spots[i];
+		sl.direction = glm::normalize(glm::vec3(0.1f, -1.0f, 0.0f));
+		sl.color = glm::vec3(1.0f, 0.5f, 0.0f);
+		sl.intensity = 2.0f + static_cast<float>(i);
+		sl.radius = 6.0f;
+		sl.innerConeAngle = glm::radians(10.0f + static_cast<float>(i % 10));
+		sl.outerConeAngle = sl.innerConeAngle + glm::radians(5.0f);
+	}
+	return data;
+}
+
+// The first field that differs between two scene files, empty when they
+// match. Everything the files store is compared exactly: both formats keep
+// floats bit for bit.
+static std::string scene_file_mismatch(const SceneFileData& a,
+									   const SceneFileData& b)
+{
+	if (a.modelPath != b.modelPath) return "modelPath";
+	if (a.camera.position != b.camera.position ||
+		a.camera.yaw != b.camera.yaw || a.camera.pitch != b.camera.pitch ||
+		a.camera.fov != b.camera.fov)
+		return "camera";
+
+	const LightEnvironment& la = a.lights;
+	const LightEnvironment& lb = b.lights;
+	if (la.ambient.color != lb.ambient.color ||
+		la.ambient.intensity != lb.ambient.intensity)
+		return "ambient light";
+	if (la.directionals.size() != lb.directionals.size())
+		return "directional light count";
+	for (size_t i = 0; i < la.directionals.size(); ++i)
+	{
+		const DirectionalLight& x = la.directionals[i];
+		const DirectionalLight& y = lb.directionals[i];
+		if (x.direction != y.direction || x.color != y.color ||
+			x.intensity != y.intensity)
+			return "directional light " + std::to_string(i);
+	}
+	if (la.points.size() != lb.points.size()) return "point light count";
+	for (size_t i = 0; i < la.points.size(); ++i)
+	{
+		const PointLight& x = la.points[i];
+		const PointLight& y = lb.points[i];
+		if (x.position != y.position || x.color != y.color ||
+			x.intensity != y.intensity || x.radius != y.radius)
+			return "point light " + std::to_string(i);
+	}
+	if (la.spots.size() != lb.spots.size()) return "spot light count";
+	for (size_t i = 0; i < la.spots.size(); ++i)
+	{
+		const SpotLight& x = la.spots[i];
+		const SpotLight& y = lb.spots[i];
+		if (x.position != y.position || x.direction != y.direction ||
+			x.color != y.color || x.intensity != y.intensity ||
+			x.radius != y.radius || x.innerConeAngle != y.innerConeAngle ||
+			x.outerConeAngle != y.outerConeAngle)
+			return "spot light " + std::to_string(i);
+	}
+
+	const SceneGraph& ga = a.sceneGraph;
+	const SceneGraph& gb = b.sceneGraph;
+	if (ga.nodes.size() != gb.nodes.size()) return "node count";
+	if (ga.roots != gb.roots) return "roots";
+	for (uint32_t i = 0; i < ga.nodes.size(); ++i)
+	{
+		const SceneNode& x = ga.nodes[i];
+		const SceneNode& y = gb.nodes[i];
+		std::string node = "node " + std::to_string(i) + " ";
+		if (x.name != y.name) return node + "name";
+		if (x.meshIndex != y.meshIndex) return node + "meshIndex";
+		if (x.modelPath != y.modelPath) return node + "modelPath";
+		if (x.meshIndexInModel != y.meshIndexInModel)
+			return node + "meshIndexInModel";
+		if (x.parent != y.parent) return node + "parent";
+		if (x.children != y.children) return node + "children";
+		if (ga.local_transform(i) != gb.local_transform(i))
+			return node + "local transform";
+	}
+	return {};
+}
+
+// Saves and reloads make_scene_file_data(nodeCount) as `path`; the first
+// mismatch, or why the round trip failed
+static std::string scene_file_round_trip(const std::string& path,
+										 uint32_t nodeCount)
+{
+	SceneFileData data = make_scene_file_data(nodeCount);
+	if (!save_scene_file(path, data)) return "cannot write " + path;
+	SceneFileData loaded;
+	std::string error;
+	if (!load_scene_file(path, loaded))
+		error = "cannot read " + path;
+	else if (std::string field = scene_file_mismatch(data, loaded);
+			 !field.empty())
+		error = path + ": round trip changed " + field;
+	std::error_code ec;
+	std::filesystem::remove(path, ec);
+	return error;
+}
+
+static std::string bench_scene_path(const std::string& name, bool binary)
+{
+	return (std::filesystem::temp_directory_path() /
+			("vulkanwork_bench_" + name + (binary ? ".sceneb" : ".scene")))
+		.string();
+}
+
+// =============================================================================
+// Registration
+// =============================================================================
+
+void register_scene_benchmarks()
+{
+	// --- Lights --------------------------------------------------------------
+	for (uint32_t n : {16u, 256u, 1024u})
+	{
+		bench::register_benchmark(
+			"lights/pack_gpu_lights/" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				LightEnvironment env = make_lights(n);
+				state.set_items_per_iteration(n);
+				while (state.keep_running())
+					bench::do_not_optimize(env.pack_gpu_lights());
+			});
+		bench::register_benchmark(
+			"lights/generate_light_lines/" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				LightEnvironment env = make_lights(n);
+				state.set_items_per_iteration(n);
+				while (state.keep_running())
+					bench::do_not_optimize(generate_light_lines(env));
+			});
+	}
+
+	// --- Scene graph ---------------------------------------------------------
+	struct Shape
+	{
+		const char* name;
+		uint32_t count;
+		uint32_t branching;	 // 0 = all roots
+	};
+	static constexpr Shape SHAPES[] = {
+		{"flat", 10000, 0},
+		{"tree", 10000, 4},
+		{"chain", 1000, 1},
+	};
+
+	for (const Shape& shape : SHAPES)
+	{
+		std::string suffix = std::string(shape.name) + "/" +
+							 std::to_string(shape.count);
+		bench::register_benchmark(
+			"scene_graph/update_world_transforms/" + suffix,
+			[shape](bench::State& state)
+			{
+				SceneGraph graph = make_tree(shape.count, shape.branching);
+				std::vector<glm::mat4> instances(shape.count);
+				state.set_items_per_iteration(shape.count);
+				while (state.keep_running())
+				{
+					graph.mark_all_dirty();
+					graph.update_world_transforms(0, instances);
+					bench::do_not_optimize(instances);
+				}
+			});
+		// The common editor case: one node moved since the last frame
+		bench::register_benchmark(
+			"scene_graph/update_one_dirty/" + suffix,
+			[shape](bench::State& state)
+			{
+				SceneGraph graph = make_tree(shape.count, shape.branching);
+				std::vector<glm::mat4> instances(shape.count);
+				graph.update_world_transforms(0, instances);
+				uint32_t moved = shape.count - 1;
+				glm::mat4 local = graph.local_transform(moved);
+				while (state.keep_running())
+				{
+					graph.set_local_transform(moved, local);
+					graph.update_world_transforms(0, instances);
+					bench::do_not_optimize(instances);
+				}
+			});
+		bench::register_benchmark(
+			"scene_graph/remove_node/" + suffix,
+			[shape](bench::State& state)
+			{
+				SceneGraph source = make_tree(shape.count, shape.branching);
+				uint32_t victim = shape.count / 2;
+				while (state.keep_running())
+				{
+					state.pause_timing();
+					SceneGraph graph = source;
+					state.resume_timing();
+					graph.remove_node(victim);
+					bench::do_not_optimize(graph.nodes);
+				}
+			});
+	}
+
+	// Deleting a large assembly: node 1's subtree is about 90k nodes
+	bench::register_benchmark(
+		"scene_graph/remove_subtree/200000",
+		[](bench::State& state)
+		{
+			SceneGraph source = make_tree(200000, 4);
+			while (state.keep_running())
+			{
+				state.pause_timing();
+				SceneGraph graph = source;
+				state.resume_timing();
+				graph.remove_node(1);
+				bench::do_not_optimize(graph.nodes);
+			}
+		});
+
+	// Large hierarchies (instanced CAD assemblies): the wide levels are
+	// split across the pool. items/s is nodes per second.
+	for (uint32_t threads : {1u, 4u, 16u})
+	{
+		bench::register_benchmark(
+			"scene_graph/update_parallel/100000/" + std::to_string(threads),
+			[threads](bench::State& state)
+			{
+				constexpr uint32_t COUNT = 100000;
+				SceneGraph graph = make_tree(COUNT, 8);
+				std::vector<glm::mat4> instances(COUNT);
+				ThreadPool pool(threads);
+				state.set_items_per_iteration(COUNT);
+				while (state.keep_running())
+				{
+					graph.mark_all_dirty();
+					graph.update_world_transforms(0, instances, &pool);
+					bench::do_not_optimize(instances);
+				}
+			});
+	}
+
+	// --- Picking -------------------------------------------------------------
+	for (uint32_t n : {100u, 1000u, 10000u})
+	{
+		bench::register_benchmark(
+			"selection/pick/" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				CubeGrid grid = make_cube_grid(n, make_box_mesh());
+				PickCamera camera;
+				Selection selection;
+				state.set_items_per_iteration(n);
+				while (state.keep_running())
+				{
+					camera.pick(selection, grid);
+					bench::do_not_optimize(selection.selectedNode);
+				}
+			});
+	}
+
+	// Exact hits: every cube is a 32x32 grid of quads per face
+	for (uint32_t n : {100u, 1000u})
+	{
+		bench::register_benchmark(
+			"selection/pick_triangles/" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				CubeGrid grid = make_cube_grid(n, make_tessellated_cube(32));
+				PickCamera camera;
+
+				// The first pick builds the BVHs; time the ones after it
+				Selection selection;
+				camera.pick(selection, grid);
+				state.set_items_per_iteration(1);
+				while (state.keep_running())
+				{
+					camera.pick(selection, grid);
+					bench::do_not_optimize(selection.selectedNode);
+				}
+			});
+	}
+
+	// Marquee over the middle of the view, on the pick grid
+	for (uint32_t n : {1000u, 10000u})
+	{
+		bench::register_benchmark(
+			"selection/box_select/" + std::to_string(n),
+			[n](bench::State& state)
+			{
+				CubeGrid grid = make_cube_grid(n, make_box_mesh());
+				PickCamera camera;
+				glm::vec2 size(PickCamera::WIDTH, PickCamera::HEIGHT);
+				Selection selection;
+				state.set_items_per_iteration(n);
+				while (state.keep_running())
+				{
+					selection.box_select(0.25f * size, 0.75f * size, size.x,
+										 size.y, camera.view, camera.proj,
+										 grid.graph, grid.meshes,
+										 Selection::Mode::Replace);
+					bench::do_not_optimize(selection.selectedNodes);
+				}
+			});
+	}
+
+	// --- Scene files ---------------------------------------------------------
+	// JSON (.scene) as scene_file/save|load, binary (.sceneb) as
+	// scene_file/save_binary|load_binary. Loading checks the round trip
+	// once before timing; --verify runs the same check on its own.
+	for (uint32_t n : {100u, 1000u, 10000u, 100000u})
+	{
+		for (bool binary : {false, true})
+		{
+			std::string suffix =
+				(binary ? "_binary/" : "/") + std::to_string(n);
+			std::string path = bench_scene_path(std::to_string(n), binary);
+
+			bench::register_benchmark(
+				"scene_file/save" + suffix,
+				[n, path](bench::State& state)
+				{
+					SceneFileData data = make_scene_file_data(n);
+					state.set_items_per_iteration(n);
+					while (state.keep_running())
+					{
+						if (!save_scene_file(path, data))
+							state.skip_with_error("cannot write " + path);
+					}
+				});
+			bench::register_benchmark(
+				"scene_file/load" + suffix,
+				[n, path](bench::State& state)
+				{
+					if (std::string error = scene_file_round_trip(path, n);
+						!error.empty())
+					{
+						state.skip_with_error(error);
+						return;
+					}
+					if (!save_scene_file(path, make_scene_file_data(n)))
+					{
+						state.skip_with_error("cannot write " + path);
+						return;
+					}
+					state.set_items_per_iteration(n);
+					while (state.keep_running())
+					{
+						SceneFileData loaded;
+						if (!load_scene_file(path, loaded))
+							state.skip_with_error("cannot read " + path);
+						bench::do_not_optimize(loaded);
+					}
+					std::error_code ec;
+					std::filesystem::remove(path, ec);
+				});
+		}
+	}
+
+	// --- Skinning ------------------------------------------------------------
+	// The CPU half of GPU skinning for 1000 characters: every skin's joint
+	// matrices each frame, split across the pool like
+	// Renderer::update_skinning. items/s is joints per second.
+	for (uint32_t threads : {1u, 4u, 16u})
+	{
+		bench::register_benchmark(
+			"skinning/joint_matrices/1000x64/" + std::to_string(threads),
+			[threads](bench::State& state)
+			{
+				constexpr uint32_t SKINS = 1000;
+				constexpr uint32_t JOINTS = 64;
+				std::vector<Skin> skins(SKINS, make_skin(JOINTS));
+				std::vector<glm::mat4> matrices(SKINS * JOINTS);
+				ThreadPool pool(threads);
+				state.set_items_per_iteration(SKINS * JOINTS);
+				while (state.keep_running())
+				{
+					pool.parallel_for(
+						SKINS, 16,
+						[&](uint32_t begin, uint32_t end)
+						{
+							for (uint32_t s = begin; s < end; ++s)
+								skins[s].joint_matrices(
+									{}, std::span<glm::mat4>(
+											matrices.data() + s * JOINTS,
+											JOINTS));
+						});
+					bench::do_not_optimize(matrices);
+				}
+			});
+	}
+
+	// --- Animation -----------------------------------------------------------
+	// 1000 characters at different points of a 30-key clip: key search,
+	// slerp and the hierarchy walk each frame, split across the pool like
+	// Renderer::update_animation. items/s is animated nodes per second.
+	for (uint32_t threads : {1u, 4u, 16u})
+	{
+		bench::register_benchmark(
+			"animation/animate/1000x64/" + std::to_string(threads),
+			[threads](bench::State& state)
+			{
+				constexpr uint32_t SETS = 1000;
+				constexpr uint32_t NODES = 64;
+				std::vector<AnimationSet> sets(SETS,
+											   make_animation(NODES, 30));
+				for (uint32_t i = 0; i < SETS; ++i)
+					sets[i].time = static_cast<float>(i) / SETS;
+				ThreadPool pool(threads);
+				state.set_items_per_iteration(SETS * NODES);
+				while (state.keep_running())
+				{
+					animate(sets, 1.0f / 60.0f, &pool);
+					bench::do_not_optimize(sets);
+				}
+			});
+	}
+
+	// --- Transparency --------------------------------------------------------
+	// Back-to-front order of 10k blended meshes from their view depths, as
+	// Renderer::sort_transparent does each frame, against std::sort
+	{
+		constexpr uint32_t MESHES = 10000;
+		std::vector<float> depths(MESHES);
+		for (uint32_t i = 0; i < MESHES; ++i)
+			depths[i] = -std::fmod(static_cast<float>(i) * 7.31f, 500.0f);
+
+		bench::register_benchmark(
+			"transparency/radix_sort/10000",
+			[depths](bench::State& state)
+			{
+				std::vector<uint32_t> keys(MESHES), order(MESHES), scratch;
+				state.set_items_per_iteration(MESHES);
+				while (state.keep_running())
+				{
+					for (uint32_t i = 0; i < MESHES; ++i)
+					{
+						keys[i] = float_sort_key(depths[i]);
+						order[i] = i;
+					}
+					radix_sort(keys, order, scratch);
+					bench::do_not_optimize(order);
+				}
+			});
+		bench::register_benchmark(
+			"transparency/std_sort/10000",
+			[depths](bench::State& state)
+			{
+				std::vector<uint32_t> order(MESHES);
+				state.set_items_per_iteration(MESHES);
+				while (state.keep_running())
+				{
+					for (uint32_t i = 0; i < MESHES; ++i) order[i] = i;
+					std::sort(order.begin(), order.end(),
+							  [&](uint32_t a, uint32_t b)
+							  { return depths[a] < depths[b]; });
+					bench::do_not_optimize(order);
+				}
+			});
+	}
+}
+
+// =============================================================================
+// Checks
+// =============================================================================
+
+// Nearest hit found by testing every triangle of every node in world
+// space, with the rules of MeshBvh's packet test (either facing, t >= 0)
+static std::optional<SceneBvh::Hit> brute_force_pick(const Ray& ray,
+													 const CubeGrid& grid)
+{
+	std::optional<SceneBvh::Hit> best;
+	for (uint32_t n = 0; n < grid.graph.nodes.size(); ++n)
+	{
+		auto meshIndex = grid.graph.nodes[n].meshIndex;
+		if (!meshIndex.has_value()) continue;
+		const Mesh& mesh = grid.meshes[*meshIndex];
+		const glm::mat4& world = grid.graph.world_transform(n);
+		auto corner = [&](size_t i)
+		{
+			return glm::vec3(
+				world * glm::vec4(mesh.vertices[mesh.indices[i]].pos, 1.0f));
+		};
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			glm::vec3 v0 = corner(i);
+			glm::vec3 e1 = corner(i + 1) - v0;
+			glm::vec3 e2 = corner(i + 2) - v0;
+			glm::vec3 p = glm::cross(ray.direction, e2);
+			float det = glm::dot(e1, p);
+			if (std::abs(det) < 1e-12f) continue;
+			glm::vec3 s = ray.origin - v0;
+			glm::vec3 q = glm::cross(s, e1);
+			float u = glm::dot(s, p) / det;
+			float v = glm::dot(ray.direction, q) / det;
+			float t = glm::dot(e2, q) / det;
+			if (u < 0.0f || v < 0.0f || u + v > 1.0f || t < 0.0f) continue;
+			if (!best.has_value() || t < best->t) best = SceneBvh::Hit{n, t};
+		}
+	}
+	return best;
+}
+
+// The two-level BVH against brute_force_pick() on the pick grid, as built
+// and after a node was moved and refit
+static std::string check_pick()
+{
+	CubeGrid grid = make_cube_grid(10000, make_tessellated_cube(4));
+	PickCamera camera;
+	std::vector<MeshBvh> meshBvhs(grid.meshes.size());
+	for (size_t i = 0; i < meshBvhs.size(); ++i)
+		meshBvhs[i].build(grid.meshes[i].vertices, grid.meshes[i].indices);
+	SceneBvh sceneBvh;
+	sceneBvh.build(grid.graph, grid.meshes);
+
+	auto ray_at = [&](glm::vec2 pixel)
+	{
+		return Selection::screen_to_ray(pixel.x, pixel.y, PickCamera::WIDTH,
+										PickCamera::HEIGHT, camera.view,
+										camera.proj);
+	};
+	// The center first, then the corners and spots between
+	const glm::vec2 pixels[] = {{640.0f, 360.0f}, {0.0f, 0.0f},
+								{1279.0f, 719.0f}, {100.0f, 650.0f},
+								{1180.0f, 80.0f}, {300.0f, 500.0f}};
+	auto compare = [&](const std::string& stage) -> std::string
+	{
+		for (glm::vec2 pixel : pixels)
+		{
+			Ray ray = ray_at(pixel);
+			auto hit = sceneBvh.intersect(ray.origin, ray.direction, meshBvhs);
+			auto expected = brute_force_pick(ray, grid);
+			std::string where = stage + ", pixel (" +
+								std::to_string(static_cast<int>(pixel.x)) +
+								", " +
+								std::to_string(static_cast<int>(pixel.y)) +
+								"): ";
+			if (hit.has_value() != expected.has_value())
+				return where + (hit ? "hit, expected a miss"
+									: "missed, expected a hit");
+			if (!hit.has_value()) continue;
+			if (hit->node != expected->node)
+				return where + "hit node " + std::to_string(hit->node) +
+					   ", expected " + std::to_string(expected->node);
+			if (std::abs(hit->t - expected->t) >
+				1e-4f * std::max(1.0f, expected->t))
+				return where + "distance " + std::to_string(hit->t) +
+					   ", expected " + std::to_string(expected->t);
+		}
+		return {};
+	};
+
+	auto center = brute_force_pick(ray_at(pixels[0]), grid);
+	if (!center.has_value()) return "the center pixel misses the grid";
+	if (std::string error = compare("built"); !error.empty()) return error;
+
+	// Lift the cube under the center halfway to the camera, turned and
+	// scaled; the center pixel must now hit its new triangles
+	glm::mat4 moved =
+		glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 20.0f, 10.0f));
+	moved = glm::rotate(moved, 0.7f,
+						glm::normalize(glm::vec3(1.0f, 1.0f, 0.0f)));
+	moved = glm::scale(moved, glm::vec3(3.0f));
+	grid.graph.set_local_transform(center->node, moved);
+	grid.graph.update_world_transforms(0, {});
+	sceneBvh.refit(center->node, grid.graph);
+	if (std::string error = compare("refit"); !error.empty()) return error;
+	Ray ray = ray_at(pixels[0]);
+	auto hit = sceneBvh.intersect(ray.origin, ray.direction, meshBvhs);
+	if (!hit.has_value() || hit->node != center->node)
+		return "refit: the moved node is not hit";
+	return {};
+}
+
+// radix_sort over float_sort_key against std::stable_sort of the same
+// keys: the back-to-front order sorted transparency blends in
+static std::string check_radix_sort()
+{
+	std::vector<std::vector<float>> cases;
+	// View depths of both signs, with every seventh one repeated
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> depth(-500.0f, 500.0f);
+	std::vector<float> random(10000);
+	for (float& d : random) d = depth(rng);
+	for (size_t i = 7; i < random.size(); i += 7) random[i] = random[i / 7];
+	cases.push_back(std::move(random));
+	cases.push_back({-0.0f, 0.0f, -1.0f, 1.0f, -0.0f, 0.0f, -1.0f});
+	cases.push_back(std::vector<float>(100, -3.5f));  // every digit shared
+	cases.push_back({-2.0f});
+	cases.push_back({});
+
+	std::vector<uint32_t> scratch;
+	for (size_t c = 0; c < cases.size(); ++c)
+	{
+		const std::vector<float>& depths = cases[c];
+		auto n = static_cast<uint32_t>(depths.size());
+		std::vector<uint32_t> keys(n), order(n), expected(n);
+		for (uint32_t i = 0; i < n; ++i)
+		{
+			keys[i] = float_sort_key(depths[i]);
+			order[i] = expected[i] = i;
+		}
+		std::stable_sort(expected.begin(), expected.end(),
+						 [&](uint32_t a, uint32_t b)
+						 { return keys[a] < keys[b]; });
+		radix_sort(keys, order, scratch);
+
+		std::string where = "case " + std::to_string(c) + " (" +
+							std::to_string(n) + " keys): ";
+		if (order != expected)
+			return where + "order differs from std::stable_sort";
+		for (uint32_t i = 0; i < n; ++i)
+			if (keys[i] != float_sort_key(depths[order[i]]))
+				return where + "keys not moved along with the order";
+		for (uint32_t i = 0; i + 1 < n; ++i)
+			if (depths[order[i]] > depths[order[i + 1]])
+				return where + "depths not ascending";
+	}
+	return {};
+}
+
+int run_scene_checks()
+{
+	struct Check
+	{
+		const char* name;
+		std::function<std::string()> run;
+	};
+	const Check checks[] = {
+		{"scene_file/round_trip",
+		 []
+		 {
+			 return scene_file_round_trip(bench_scene_path("verify", false),
+										  1000);
+		 }},
+		{"scene_file/round_trip_binary",
+		 []
+		 {
+			 return scene_file_round_trip(bench_scene_path("verify", true),
+										  1000);
+		 }},
+		{"selection/pick_brute_force", check_pick},
+		{"transparency/radix_sort_order", check_radix_sort},
+	};
+
+	int failed = 0;
+	for (const Check& check : checks)
+	{
+		std::string error = check.run();
+		if (error.empty())
+		{
+			std::fprintf(stderr, "%-56s ok\n", check.name);
+		}
+		else
+		{
+			std::fprintf(stderr, "%-56s FAILED: %s\n", check.name,
+						 error.c_str());
+			++failed;
+		}
+	}
+	return failed;
+}
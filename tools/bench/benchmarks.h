@@ -0,0 +1,16 @@
+#pragma once
+
+// Registration entry points, one per bench_*.cpp file
+
+// PackFile reads, glTF loading, tangent generation
+void register_asset_benchmarks();
+
+// Lights, debug lines, scene graph, picking, scene files, skinning,
+// animation
+void register_scene_benchmarks();
+
+// Correctness checks run by --verify instead of the benchmarks; return the
+// number that failed. Scene files: both formats keep every field.
+// Picking: the two-level BVH finds the same node and distance as testing
+// every triangle. Transparency: radix_sort orders like std::stable_sort.
+int run_scene_checks();
@@ -0,0 +1,253 @@
+#include "harness.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <numeric>
+
+using json = nlohmann::json;
+
+namespace bench
+{
+
+// =============================================================================
+// State
+// =============================================================================
+
+State::State(double minTimeSec, uint64_t maxIterations)
+	: minTimeNs_(minTimeSec * 1e9), maxIterations_(maxIterations)
+{
+}
+
+bool State::keep_running()
+{
+	auto now = Clock::now();
+	if (!started_)
+	{
+		started_ = true;
+		start_ = now;
+	}
+	else
+	{
+		double ns =
+			std::chrono::duration<double, std::nano>(now - iterStart_).count() -
+			pausedNs_;
+		samples_.push_back(ns);
+		totalNs_ += ns;
+	}
+
+	if (!error_.empty()) return false;
+	if (samples_.size() >= maxIterations_) return false;
+	if (!samples_.empty() && totalNs_ >= minTimeNs_) return false;
+
+	// Mostly-paused benchmarks would otherwise run for a very long time
+	double wallNs =
+		std::chrono::duration<double, std::nano>(now - start_).count();
+	if (!samples_.empty() && wallNs >= 20.0 * minTimeNs_) return false;
+
+	pausedNs_ = 0.0;
+	iterStart_ = Clock::now();
+	return true;
+}
+
+void State::pause_timing() { pauseStart_ = Clock::now(); }
+
+void State::resume_timing()
+{
+	pausedNs_ += std::chrono::duration<double, std::nano>(Clock::now() -
+														  pauseStart_)
+					 .count();
+}
+
+// =============================================================================
+// Registry
+// =============================================================================
+
+struct Entry
+{
+	std::string name;
+	Function fn;
+};
+
+static std::vector<Entry>& registry()
+{
+	static std::vector<Entry> entries;
+	return entries;
+}
+
+void register_benchmark(const std::string& name, Function fn)
+{
+	registry().push_back({name, std::move(fn)});
+}
+
+// =============================================================================
+// Runner
+// =============================================================================
+
+struct Result
+{
+	std::string name;
+	uint64_t iterations = 0;
+	double meanNs = 0.0;
+	double medianNs = 0.0;
+	double p95Ns = 0.0;
+	double minNs = 0.0;
+	double maxNs = 0.0;
+	double itemsPerSecond = 0.0;
+	std::string error;
+};
+
+static Result summarize(const std::string& name, const State& state)
+{
+	Result r;
+	r.name = name;
+	r.error = state.error();
+
+	std::vector<double> s = state.samples_ns();
+	if (s.empty()) return r;
+
+	std::sort(s.begin(), s.end());
+	size_t n = s.size();
+	auto rank = [&](double p)
+	{
+		size_t k = static_cast<size_t>(std::ceil(p * n));
+		return s[std::clamp<size_t>(k, 1, n) - 1];
+	};
+
+	r.iterations = n;
+	r.meanNs = std::accumulate(s.begin(), s.end(), 0.0) / n;
+	r.medianNs = rank(0.50);
+	r.p95Ns = rank(0.95);
+	r.minNs = s.front();
+	r.maxNs = s.back();
+	if (state.items_per_iteration() > 0 && r.meanNs > 0.0)
+		r.itemsPerSecond = state.items_per_iteration() * 1e9 / r.meanNs;
+	return r;
+}
+
+static std::string format_time(double ns)
+{
+	char buf[32];
+	if (ns < 1e3)
+		std::snprintf(buf, sizeof(buf), "%.1f ns", ns);
+	else if (ns < 1e6)
+		std::snprintf(buf, sizeof(buf), "%.2f us", ns / 1e3);
+	else if (ns < 1e9)
+		std::snprintf(buf, sizeof(buf), "%.2f ms", ns / 1e6);
+	else
+		std::snprintf(buf, sizeof(buf), "%.2f s", ns / 1e9);
+	return buf;
+}
+
+static bool write_report(const Options& options,
+						 const std::vector<Result>& results)
+{
+	json benchmarks = json::array();
+	for (const auto& r : results)
+	{
+		json b = {
+			{"name", r.name},
+			{"iterations", r.iterations},
+			{"mean_ns", r.meanNs},
+			{"median_ns", r.medianNs},
+			{"p95_ns", r.p95Ns},
+			{"min_ns", r.minNs},
+			{"max_ns", r.maxNs},
+		};
+		if (r.itemsPerSecond > 0.0) b["items_per_second"] = r.itemsPerSecond;
+		if (!r.error.empty()) b["error"] = r.error;
+		benchmarks.push_back(b);
+	}
+
+	char date[32] = {};
+	std::time_t now = std::time(nullptr);
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S",
+				  std::localtime(&now));
+
+	json root;
+	root["context"] = {
+		{"date", date},
+#ifdef NDEBUG
+		{"build_type", "release"},
+#else
+		{"build_type", "debug"},
+#endif
+		{"min_time_s", options.minTimeSec},
+	};
+	root["benchmarks"] = benchmarks;
+
+	std::string text = root.dump(2);
+	if (options.reportPath.empty())
+	{
+		std::cout << text << std::endl;
+		return static_cast<bool>(std::cout);
+	}
+
+	std::ofstream f(options.reportPath);
+	if (!f)
+	{
+		std::fprintf(stderr, "Error: cannot write '%s'\n",
+					 options.reportPath.c_str());
+		return false;
+	}
+	f << text << '\n';
+	return f.good();
+}
+
+int run_benchmarks(const Options& options)
+{
+	auto& entries = registry();
+
+	if (options.list)
+	{
+		for (const auto& e : entries)
+			if (e.name.find(options.filter) != std::string::npos)
+				std::printf("%s\n", e.name.c_str());
+		return 0;
+	}
+
+	std::vector<Result> results;
+	int failed = 0;
+	std::fprintf(stderr, "%-56s %12s %12s %12s %10s\n", "Benchmark", "Mean",
+				 "Median", "p95", "Iters");
+	for (const auto& e : entries)
+	{
+		if (e.name.find(options.filter) == std::string::npos) continue;
+
+		State state(options.minTimeSec, options.maxIterations);
+		try
+		{
+			e.fn(state);
+		}
+		catch (const std::exception& ex)
+		{
+			state.skip_with_error(ex.what());
+		}
+
+		Result r = summarize(e.name, state);
+		if (!r.error.empty())
+		{
+			std::fprintf(stderr, "%-56s ERROR: %s\n", r.name.c_str(),
+						 r.error.c_str());
+			++failed;
+		}
+		else
+		{
+			std::fprintf(stderr, "%-56s %12s %12s %12s %10llu\n",
+						 r.name.c_str(), format_time(r.meanNs).c_str(),
+						 format_time(r.medianNs).c_str(),
+						 format_time(r.p95Ns).c_str(),
+						 static_cast<unsigned long long>(r.iterations));
+		}
+		results.push_back(std::move(r));
+	}
+
+	if (!write_report(options, results)) ++failed;
+	return failed;
+}
+
+}  // namespace bench
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// =============================================================================
+// Minimal benchmark harness
+// =============================================================================
+//
+// Each benchmark is a function taking a State. Setup goes before the loop,
+// only the loop body is timed:
+//
+//   bench::register_benchmark("lights/pack/256", [](bench::State& state)
+//   {
+//       LightEnvironment env = make_lights(256);
+//       while (state.keep_running())
+//           bench::do_not_optimize(env.pack_gpu_lights());
+//   });
+//
+// Every iteration is timed on its own so the report can carry percentiles
+// as well as the mean.
+
+namespace bench
+{
+
+class State
+{
+   public:
+	State(double minTimeSec, uint64_t maxIterations);
+
+	// Returns true while more iterations are needed
+	bool keep_running();
+
+	// Exclude per-iteration setup (e.g. rebuilding a graph that the
+	// measured code consumes) from the timing
+	void pause_timing();
+	void resume_timing();
+
+	// Work items per iteration, reported as items/s
+	void set_items_per_iteration(uint64_t items) { items_ = items; }
+
+	// Abort with an error; keep_running() returns false from now on
+	void skip_with_error(const std::string& message) { error_ = message; }
+
+	const std::vector<double>& samples_ns() const { return samples_; }
+	uint64_t items_per_iteration() const { return items_; }
+	const std::string& error() const { return error_; }
+
+   private:
+	using Clock = std::chrono::steady_clock;
+
+	double minTimeNs_;
+	uint64_t maxIterations_;
+	bool started_ = false;
+	Clock::time_point start_;
+	Clock::time_point iterStart_;
+	Clock::time_point pauseStart_;
+	double pausedNs_ = 0.0;
+	double totalNs_ = 0.0;
+	std::vector<double> samples_;
+	uint64_t items_ = 0;
+	std::string error_;
+};
+
+using Function = std::function<void(State&)>;
+
+void register_benchmark(const std::string& name, Function fn);
+
+struct Options
+{
+	std::string filter;			 // substring match on the name
+	double minTimeSec = 0.5;	 // per benchmark
+	uint64_t maxIterations = 1000000;
+	std::string reportPath;	 // empty = stdout
+	bool list = false;
+};
+
+// Run every registered benchmark that matches the filter, print a summary
+// table to stderr and the JSON report to reportPath. Returns the number of
+// benchmarks that failed.
+int run_benchmarks(const Options& options);
+
+// Keep the compiler from discarding a result that is otherwise unused
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static const volatile void* sink;
+	sink = &value;
+#endif
+}
+
+}  // namespace bench
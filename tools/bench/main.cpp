@@ -0,0 +1,98 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "benchmarks.h"
+#include "harness.h"
+#include "logger.h"
+
+static void print_usage(const char* argv0)
+{
+	std::fprintf(
+		stderr,
+		"Usage: %s [options]\n"
+		"\n"
+		"CPU-only microbenchmarks; no GPU or Vulkan driver is needed.\n"
+		"\n"
+		"Options:\n"
+		"  --filter <text>       run benchmarks whose name contains <text>\n"
+		"  --min-time <seconds>  measured time per benchmark (default: 0.5)\n"
+		"  --max-iters <N>       iteration cap per benchmark (default: 1e6)\n"
+		"  --report <file.json>  write the JSON report (default: stdout)\n"
+		"  --list                list benchmark names and exit\n"
+		"  --verify              run the correctness checks instead; exit\n"
+		"                        status is non-zero when one fails\n"
+		"  -h, --help            show this help\n",
+		argv0);
+}
+
+int main(int argc, char* argv[])
+{
+	bench::Options options;
+	bool verify = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (std::strcmp(arg, "-h") == 0 || std::strcmp(arg, "--help") == 0)
+		{
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+		else if (std::strcmp(arg, "--list") == 0)
+		{
+			options.list = true;
+		}
+		else if (std::strcmp(arg, "--verify") == 0)
+		{
+			verify = true;
+		}
+		else if (std::strcmp(arg, "--filter") == 0 && hasValue)
+		{
+			options.filter = argv[++i];
+		}
+		else if (std::strcmp(arg, "--min-time") == 0 && hasValue)
+		{
+			options.minTimeSec = std::strtod(argv[++i], nullptr);
+			if (options.minTimeSec <= 0.0)
+			{
+				std::fprintf(stderr, "Error: invalid --min-time\n");
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(arg, "--max-iters") == 0 && hasValue)
+		{
+			options.maxIterations = std::strtoull(argv[++i], nullptr, 10);
+			if (options.maxIterations == 0)
+			{
+				std::fprintf(stderr, "Error: invalid --max-iters\n");
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(arg, "--report") == 0 && hasValue)
+		{
+			options.reportPath = argv[++i];
+		}
+		else
+		{
+			std::fprintf(stderr, "Error: unknown or incomplete option '%s'\n",
+						 arg);
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	// The code under test logs; keep it out of the table and the timings
+	Logger::instance().set_console_enabled(false);
+
+	if (verify)
+		return run_scene_checks() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+	register_asset_benchmarks();
+	register_scene_benchmarks();
+
+	int failed = bench::run_benchmarks(options);
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}